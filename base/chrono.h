@@ -1,4 +1,5 @@
 // LAF Base Library
+// Copyright (c) 2024 Igara Studio S.A.
 // Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -8,18 +9,31 @@
 #define BASE_CHRONO_H_INCLUDED
 #pragma once
 
+#include "base/clock.h"
+
 namespace base {
 
+  // Measures the elapsed time since its creation (or the last
+  // reset() call) with the monotonic clock (see base/clock.h).
   class Chrono {
   public:
-    Chrono();
-    ~Chrono();
-    void reset();
-    double elapsed() const;
+    Chrono() : m_point(monotonic_ns()) { }
+
+    void reset() {
+      m_point = monotonic_ns();
+    }
+
+    // Returns the elapsed time in seconds.
+    double elapsed() const {
+      return double(elapsedNs()) / 1.0e9;
+    }
+
+    uint64_t elapsedNs() const {
+      return monotonic_ns() - m_point;
+    }
 
   private:
-    class ChronoImpl;
-    ChronoImpl* m_impl;
+    uint64_t m_point;
   };
 
 } // namespace base
@@ -0,0 +1,116 @@
+// LAF Base Library
+// Copyright (c) 2024 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef BASE_CLOCK_H_INCLUDED
+#define BASE_CLOCK_H_INCLUDED
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#if !LAF_WINDOWS
+  #include <time.h>
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  #include <intrin.h>
+  #define LAF_HAVE_TSC 1
+#elif (defined(__GNUC__) || defined(__clang__)) && \
+      (defined(__x86_64__) || defined(__i386__))
+  #include <x86intrin.h>
+  #define LAF_HAVE_TSC 1
+#elif (defined(__GNUC__) || defined(__clang__)) && defined(__aarch64__)
+  #define LAF_HAVE_TSC 1
+#endif
+
+namespace base {
+
+  // Returns a monotonic time in nanoseconds from an unspecified
+  // starting point (e.g. the system boot). It's not affected by
+  // changes of the system date/time (nor by NTP frequency adjustments
+  // on Linux), so it can be used to measure intervals.
+  inline uint64_t monotonic_ns() {
+#if LAF_WINDOWS
+    // steady_clock uses QueryPerformanceCounter() on Windows
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+#elif LAF_MACOS
+    return clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+#else
+    timespec ts;
+  #ifdef CLOCK_MONOTONIC_RAW
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+  #else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+  #endif
+    return uint64_t(ts.tv_sec)*1000000000ull + uint64_t(ts.tv_nsec);
+#endif
+  }
+
+  // Reads the CPU time stamp counter (rdtsc on x86, cntvct_el0 on
+  // ARM64), which is cheaper than monotonic_ns() but its frequency is
+  // unknown (see TscClock). Without a TSC it returns monotonic_ns().
+  inline uint64_t read_tsc() {
+#if LAF_HAVE_TSC && defined(__aarch64__)
+    uint64_t v;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(v));
+    return v;
+#elif LAF_HAVE_TSC
+    return __rdtsc();
+#else
+    return monotonic_ns();
+#endif
+  }
+
+  // Converts read_tsc() values to nanoseconds since the TscClock was
+  // created. The TSC frequency is calibrated against monotonic_ns()
+  // with the time elapsed since then, so a long-living TscClock gives
+  // a more precise conversion. We assume an invariant TSC (which is
+  // the case of all x86 CPUs of the last decade and ARM64).
+  class TscClock {
+  public:
+    TscClock()
+      : m_startTsc(read_tsc())
+      , m_startNs(monotonic_ns()) {
+    }
+
+    uint64_t startTsc() const { return m_startTsc; }
+    uint64_t startNs() const { return m_startNs; }
+
+    // Returns the nanoseconds per TSC tick. It might wait some
+    // milliseconds if the TscClock was just created.
+    double nsPerTick() const {
+#if LAF_HAVE_TSC
+      uint64_t ticks = read_tsc() - m_startTsc;
+      uint64_t ns = monotonic_ns() - m_startNs;
+      if (ns < kMinCalibrationNs) {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(kMinCalibrationNs - ns));
+        ticks = read_tsc() - m_startTsc;
+        ns = monotonic_ns() - m_startNs;
+      }
+      return (ticks ? double(ns) / double(ticks): 1.0);
+#else
+      return 1.0;
+#endif
+    }
+
+    // Converts a read_tsc() value to nanoseconds since the TscClock
+    // creation using the given nsPerTick() value.
+    uint64_t toNs(const uint64_t tsc, const double nsPerTick) const {
+      return (tsc > m_startTsc ? uint64_t(double(tsc - m_startTsc) * nsPerTick): 0);
+    }
+
+  private:
+    static constexpr uint64_t kMinCalibrationNs = 10000000; // 10ms
+
+    uint64_t m_startTsc;
+    uint64_t m_startNs;
+  };
+
+} // namespace base
+
+#endif
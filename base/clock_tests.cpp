@@ -0,0 +1,68 @@
+// LAF Base Library
+// Copyright (c) 2024 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include <gtest/gtest.h>
+
+#include "base/chrono.h"
+#include "base/clock.h"
+
+#include <chrono>
+#include <thread>
+
+using namespace base;
+
+TEST(Clock, MonotonicNs)
+{
+  uint64_t prev = monotonic_ns();
+  for (int i=0; i<10000; ++i) {
+    const uint64_t now = monotonic_ns();
+    ASSERT_LE(prev, now);
+    prev = now;
+  }
+
+  const uint64_t t0 = monotonic_ns();
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  EXPECT_GE(monotonic_ns() - t0, 2000000);
+}
+
+TEST(Clock, TscClock)
+{
+  const TscClock clock;
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+  const double nsPerTick = clock.nsPerTick();
+  EXPECT_GT(nsPerTick, 0.0);
+
+  const uint64_t tscNs = clock.toNs(read_tsc(), nsPerTick);
+  const uint64_t ns = monotonic_ns() - clock.startNs();
+  EXPECT_GE(tscNs, 20000000);
+  EXPECT_NEAR(double(ns), double(tscNs), 5000000.0);
+
+  // Values before the clock creation are clamped to 0
+  EXPECT_EQ(0, clock.toNs(clock.startTsc() - 1, nsPerTick));
+}
+
+TEST(Chrono, Elapsed)
+{
+  Chrono chrono;
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  const double elapsed = chrono.elapsed();
+  EXPECT_GE(elapsed, 0.005);
+  EXPECT_GE(chrono.elapsedNs(), 5000000);
+
+  // Chrono is a value type
+  Chrono copy = chrono;
+  EXPECT_GE(copy.elapsed(), elapsed);
+
+  chrono.reset();
+  EXPECT_LT(chrono.elapsed(), copy.elapsed());
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
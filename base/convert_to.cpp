@@ -1,5 +1,5 @@
 // LAF Base Library
-// Copyright (c) 2023 Igara Studio S.A.
+// Copyright (c) 2023-2024 Igara Studio S.A.
 // Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -14,45 +14,111 @@
 #include "base/sha1.h"
 #include "base/uuid.h"
 
+#include <cctype>
+#include <charconv>
 #include <cstdio>
 #include <cstdlib>
 
+// Floating point support for std::from_chars()/to_chars() is not
+// available in all standard libraries.
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+  #define LAF_FLOAT_CHARCONV 1
+#endif
+
 namespace base {
 
+namespace {
+
+// Skips whitespace and the '+' sign like strtol()/strtod() do.
+const char* skip_prefix(const char* p, const char* end)
+{
+  while (p < end && std::isspace(uint8_t(*p)))
+    ++p;
+  if (p < end && *p == '+')
+    ++p;
+  return p;
+}
+
+template<typename T>
+T parse_number(const std::string_view& from)
+{
+  const char* end = from.data() + from.size();
+  T value = 0;
+  if (std::from_chars(skip_prefix(from.data(), end), end, value).ec != std::errc())
+    return 0;
+  return value;
+}
+
+template<typename T>
+std::string format_integer(const T from)
+{
+  char buf[32];
+  const auto res = std::to_chars(buf, buf+sizeof(buf), from);
+  return std::string(buf, res.ptr);
+}
+
+} // anonymous namespace
+
+template<> int convert_to(const std::string_view& from)
+{
+  return parse_number<int>(from);
+}
+
 template<> int convert_to(const std::string& from)
 {
-  return std::strtol(from.c_str(), NULL, 10);
+  return parse_number<int>(from);
 }
 
 template<> std::string convert_to(const int& from)
 {
-  char buf[32];
-  std::snprintf(buf, sizeof(buf), "%d", from);
-  return buf;
+  return format_integer(from);
+}
+
+template<> uint32_t convert_to(const std::string_view& from)
+{
+  return parse_number<uint32_t>(from);
 }
 
 template<> uint32_t convert_to(const std::string& from)
 {
-  return std::strtoul(from.c_str(), NULL, 10);
+  return parse_number<uint32_t>(from);
 }
 
 template<> std::string convert_to(const uint32_t& from)
 {
-  char buf[32];
-  std::snprintf(buf, sizeof(buf), "%u", from);
-  return buf;
+  return format_integer(from);
+}
+
+template<> double convert_to(const std::string_view& from)
+{
+#if LAF_FLOAT_CHARCONV
+  return parse_number<double>(from);
+#else
+  return std::strtod(std::string(from).c_str(), NULL);
+#endif
 }
 
 template<> double convert_to(const std::string& from)
 {
+#if LAF_FLOAT_CHARCONV
+  return parse_number<double>(from);
+#else
   return std::strtod(from.c_str(), NULL);
+#endif
 }
 
 template<> std::string convert_to(const double& from)
 {
   char buf[32];
+#if LAF_FLOAT_CHARCONV
+  // Same output as printf("%g")
+  const auto res = std::to_chars(buf, buf+sizeof(buf), from,
+                                 std::chars_format::general, 6);
+  return std::string(buf, res.ptr);
+#else
   std::snprintf(buf, sizeof(buf), "%g", from);
   return buf;
+#endif
 }
 
 template<> Sha1 convert_to(const std::string& from)
@@ -1,5 +1,5 @@
 // LAF Base Library
-// Copyright (c) 2023 Igara Studio S.A.
+// Copyright (c) 2023-2024 Igara Studio S.A.
 // Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -12,6 +12,7 @@
 #include "base/base.h"
 #include "base/ints.h"
 #include <string>
+#include <string_view>
 
 namespace base {
 
@@ -27,12 +28,18 @@ namespace base {
     static_assert(false && sizeof(To), "Invalid conversion"); // NOLINT readability-simplify-boolean-expr
   }
 
+  // Numbers are converted with std::from_chars()/to_chars() (no
+  // locale, no allocations). Leading whitespace and a '+' sign are
+  // skipped, invalid or out of range inputs are converted to 0.
+  template<> int convert_to(const std::string_view& from);
   template<> int convert_to(const std::string& from);
   template<> std::string convert_to(const int& from);
 
+  template<> uint32_t convert_to(const std::string_view& from);
   template<> uint32_t convert_to(const std::string& from);
   template<> std::string convert_to(const uint32_t& from);
 
+  template<> double convert_to(const std::string_view& from);
   template<> double convert_to(const std::string& from);
   template<> std::string convert_to(const double& from);
 
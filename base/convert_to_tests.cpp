@@ -0,0 +1,54 @@
+// LAF Base Library
+// Copyright (c) 2024 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include <gtest/gtest.h>
+
+#include "base/convert_to.h"
+
+#include <string>
+#include <string_view>
+
+using namespace base;
+
+TEST(ConvertTo, Int)
+{
+  EXPECT_EQ(0, convert_to<int>(std::string("")));
+  EXPECT_EQ(0, convert_to<int>(std::string("abc")));
+  EXPECT_EQ(12, convert_to<int>(std::string("12")));
+  EXPECT_EQ(12, convert_to<int>(std::string(" +12")));
+  EXPECT_EQ(-12, convert_to<int>(std::string("-12abc")));
+  EXPECT_EQ(34, convert_to<int>(std::string_view("1234").substr(2)));
+
+  EXPECT_EQ("0", convert_to<std::string>(0));
+  EXPECT_EQ("-2147483648", convert_to<std::string>(int(0x80000000)));
+}
+
+TEST(ConvertTo, Uint32)
+{
+  EXPECT_EQ(4294967295u, convert_to<uint32_t>(std::string("4294967295")));
+  EXPECT_EQ(0u, convert_to<uint32_t>(std::string("4294967296"))); // Out of range
+  EXPECT_EQ(7u, convert_to<uint32_t>(std::string_view("7,8")));
+  EXPECT_EQ("4294967295", convert_to<std::string>(uint32_t(4294967295u)));
+}
+
+TEST(ConvertTo, Double)
+{
+  EXPECT_EQ(1.5, convert_to<double>(std::string("1.5")));
+  EXPECT_EQ(-0.25, convert_to<double>(std::string(" -0.25")));
+  EXPECT_EQ(100.0, convert_to<double>(std::string_view("1e2;")));
+  EXPECT_EQ(0.0, convert_to<double>(std::string_view("x")));
+
+  // Same format as printf("%g")
+  EXPECT_EQ("1.5", convert_to<std::string>(1.5));
+  EXPECT_EQ("0.333333", convert_to<std::string>(1.0/3.0));
+  EXPECT_EQ("1e+10", convert_to<std::string>(1e10));
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,96 @@
+// LAF Base Library
+// Copyright (c) 2024 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "base/cpu_features.h"
+
+#if LAF_HAVE_X86_DISPATCH
+  #ifdef _MSC_VER
+    #include <intrin.h>
+  #else
+    #include <cpuid.h>
+  #endif
+#endif
+
+#include <cstdint>
+
+namespace base {
+
+#if LAF_HAVE_X86_DISPATCH
+
+static void cpuid(int leaf, int subleaf, uint32_t regs[4])
+{
+#ifdef _MSC_VER
+  int r[4];
+  __cpuidex(r, leaf, subleaf);
+  for (int i=0; i<4; ++i)
+    regs[i] = uint32_t(r[i]);
+#else
+  __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// Returns XCR0 to know if the OS saves the YMM registers on context
+// switches (required to use AVX instructions).
+static uint64_t xgetbv0()
+{
+#ifdef _MSC_VER
+  return _xgetbv(0);
+#else
+  uint32_t eax, edx;
+  __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return (uint64_t(edx) << 32) | eax;
+#endif
+}
+
+static CpuFeatures detect_cpu_features()
+{
+  CpuFeatures f;
+  uint32_t regs[4];               // eax, ebx, ecx, edx
+
+  cpuid(0, 0, regs);
+  const uint32_t maxLeaf = regs[0];
+  if (maxLeaf < 1)
+    return f;
+
+  cpuid(1, 0, regs);
+  f.sse2  = (regs[3] & (1 << 26)) != 0;
+  f.ssse3 = (regs[2] & (1 << 9)) != 0;
+  f.sse41 = (regs[2] & (1 << 19)) != 0;
+
+  const bool osxsave = (regs[2] & (1 << 27)) != 0;
+  const bool avx = (regs[2] & (1 << 28)) != 0;
+  if (maxLeaf >= 7 && osxsave && avx &&
+      (xgetbv0() & 0x6) == 0x6) { // XMM and YMM state enabled
+    cpuid(7, 0, regs);
+    f.avx2 = (regs[1] & (1 << 5)) != 0;
+  }
+  return f;
+}
+
+#else
+
+static CpuFeatures detect_cpu_features()
+{
+  CpuFeatures f;
+#if LAF_HAVE_NEON
+  f.neon = true;
+#endif
+  return f;
+}
+
+#endif
+
+const CpuFeatures& get_cpu_features()
+{
+  static const CpuFeatures features = detect_cpu_features();
+  return features;
+}
+
+} // namespace base
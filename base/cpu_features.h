@@ -0,0 +1,52 @@
+// LAF Base Library
+// Copyright (c) 2024 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef BASE_CPU_FEATURES_H_INCLUDED
+#define BASE_CPU_FEATURES_H_INCLUDED
+#pragma once
+
+// Instruction sets that can be used unconditionally in this build
+// (LAF_HAVE_SSE2/LAF_HAVE_NEON), and a LAF_TARGET() attribute to
+// compile specific functions for an extended instruction set
+// (e.g. LAF_TARGET("avx2")) that must be called only when the
+// runtime check in base::get_cpu_features() says so.
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define LAF_HAVE_SSE2 1
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+  #define LAF_HAVE_NEON 1
+#endif
+
+#if LAF_HAVE_SSE2 && (defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER))
+  #define LAF_HAVE_X86_DISPATCH 1
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+  #define LAF_TARGET(isa) __attribute__((target(isa)))
+#else
+  // MSVC can emit any intrinsic without an extra attribute
+  #define LAF_TARGET(isa)
+#endif
+
+namespace base {
+
+  // CPU features detected at runtime (only once, the first time
+  // get_cpu_features() is called).
+  struct CpuFeatures {
+    bool sse2 = false;
+    bool ssse3 = false;
+    bool sse41 = false;
+    bool avx2 = false;
+    bool neon = false;
+  };
+
+  const CpuFeatures& get_cpu_features();
+
+} // namespace base
+
+#endif
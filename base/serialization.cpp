@@ -1,4 +1,5 @@
 // LAF Base Library
+// Copyright (c) 2024 Igara Studio S.A.
 // Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -10,11 +11,344 @@
 
 #include "base/serialization.h"
 
+#include "base/cpu_features.h"
+
+#include <algorithm>
 #include <iostream>
 
+#if LAF_HAVE_SSE2
+  #include <immintrin.h>
+#elif LAF_HAVE_NEON
+  #include <arm_neon.h>
+#endif
+
 namespace base {
 namespace serialization {
 
+namespace {
+
+//////////////////////////////////////////////////////////////////////
+// Byte swap kernels
+
+// Each kernel processes complete SIMD blocks and returns the number
+// of swapped elements, the rest is done with the scalar code.
+struct SwapKernels {
+  size_t (*swap16)(const uint8_t* src, uint8_t* dst, size_t n);
+  size_t (*swap32)(const uint8_t* src, uint8_t* dst, size_t n);
+  size_t (*swap64)(const uint8_t* src, uint8_t* dst, size_t n);
+};
+
+#if !LAF_HAVE_SSE2 && !LAF_HAVE_NEON
+size_t swap_none(const uint8_t*, uint8_t*, size_t) { return 0; }
+#endif
+
+#if LAF_HAVE_SSE2
+
+inline __m128i swap16_sse2(__m128i v)
+{
+  return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+size_t swap16_sse2(const uint8_t* src, uint8_t* dst, size_t n)
+{
+  size_t i = 0;
+  for (; i+8 <= n; i += 8, src += 16, dst += 16) {
+    const __m128i v = _mm_loadu_si128((const __m128i*)src);
+    _mm_storeu_si128((__m128i*)dst, swap16_sse2(v));
+  }
+  return i;
+}
+
+size_t swap32_sse2(const uint8_t* src, uint8_t* dst, size_t n)
+{
+  size_t i = 0;
+  for (; i+4 <= n; i += 4, src += 16, dst += 16) {
+    __m128i v = swap16_sse2(_mm_loadu_si128((const __m128i*)src));
+    // Swap 16-bit words of each 32-bit element
+    v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xb1), 0xb1);
+    _mm_storeu_si128((__m128i*)dst, v);
+  }
+  return i;
+}
+
+size_t swap64_sse2(const uint8_t* src, uint8_t* dst, size_t n)
+{
+  size_t i = 0;
+  for (; i+2 <= n; i += 2, src += 16, dst += 16) {
+    __m128i v = swap16_sse2(_mm_loadu_si128((const __m128i*)src));
+    // Reverse the four 16-bit words of each 64-bit element
+    v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0x1b), 0x1b);
+    _mm_storeu_si128((__m128i*)dst, v);
+  }
+  return i;
+}
+
+#endif // LAF_HAVE_SSE2
+
+#if LAF_HAVE_X86_DISPATCH
+
+template<int Size>
+LAF_TARGET("avx2")
+size_t swap_avx2(const uint8_t* src, uint8_t* dst, size_t n)
+{
+  // Shuffle mask to reverse each group of "Size" bytes (indexes are
+  // relative to each 128-bit lane)
+  __m256i m;
+  if constexpr (Size == 2)
+    m = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+                         1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+  else if constexpr (Size == 4)
+    m = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                         3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+  else
+    m = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+                         7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+
+  const size_t perBlock = 32 / Size;
+  size_t i = 0;
+  for (; i+perBlock <= n; i += perBlock, src += 32, dst += 32) {
+    const __m256i v = _mm256_loadu_si256((const __m256i*)src);
+    _mm256_storeu_si256((__m256i*)dst, _mm256_shuffle_epi8(v, m));
+  }
+  return i;
+}
+
+#endif // LAF_HAVE_X86_DISPATCH
+
+#if LAF_HAVE_NEON
+
+size_t swap16_neon(const uint8_t* src, uint8_t* dst, size_t n)
+{
+  size_t i = 0;
+  for (; i+8 <= n; i += 8, src += 16, dst += 16)
+    vst1q_u8(dst, vrev16q_u8(vld1q_u8(src)));
+  return i;
+}
+
+size_t swap32_neon(const uint8_t* src, uint8_t* dst, size_t n)
+{
+  size_t i = 0;
+  for (; i+4 <= n; i += 4, src += 16, dst += 16)
+    vst1q_u8(dst, vrev32q_u8(vld1q_u8(src)));
+  return i;
+}
+
+size_t swap64_neon(const uint8_t* src, uint8_t* dst, size_t n)
+{
+  size_t i = 0;
+  for (; i+2 <= n; i += 2, src += 16, dst += 16)
+    vst1q_u8(dst, vrev64q_u8(vld1q_u8(src)));
+  return i;
+}
+
+#endif // LAF_HAVE_NEON
+
+SwapKernels select_kernels()
+{
+#if LAF_HAVE_X86_DISPATCH
+  if (get_cpu_features().avx2)
+    return { swap_avx2<2>, swap_avx2<4>, swap_avx2<8> };
+#endif
+#if LAF_HAVE_SSE2
+  return { swap16_sse2, swap32_sse2, swap64_sse2 };
+#elif LAF_HAVE_NEON
+  return { swap16_neon, swap32_neon, swap64_neon };
+#else
+  return { swap_none, swap_none, swap_none };
+#endif
+}
+
+const SwapKernels& kernels()
+{
+  static const SwapKernels k = select_kernels();
+  return k;
+}
+
+template<typename T>
+void byte_swap_tail(const uint8_t* src, uint8_t* dst, size_t n)
+{
+  for (size_t i=0; i<n; ++i, src += sizeof(T), dst += sizeof(T)) {
+    T v;
+    std::memcpy(&v, src, sizeof(T));
+    v = byte_swap(v);
+    std::memcpy(dst, &v, sizeof(T));
+  }
+}
+
+void byte_swap_array(const void* src, void* dst, size_t n, size_t elemSize)
+{
+  switch (elemSize) {
+    case 2: byte_swap16(src, dst, n); break;
+    case 4: byte_swap32(src, dst, n); break;
+    case 8: byte_swap64(src, dst, n); break;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+// Helpers for the std::istream/ostream functions
+
+template<typename T>
+std::ostream& write_stream(std::ostream& os, T v, byte_order order)
+{
+  if (order != native_byte_order)
+    v = byte_swap(v);
+  os.write((const char*)&v, sizeof(T));
+  return os;
+}
+
+template<typename T>
+T read_stream(std::istream& is, byte_order order)
+{
+  // Bytes after the end of the stream are read as 0xff (as
+  // is.get() == EOF in the old byte-by-byte implementation)
+  uint8_t buf[sizeof(T)];
+  std::memset(buf, 0xff, sizeof(T));
+  is.read((char*)buf, sizeof(T));
+
+  T v;
+  std::memcpy(&v, buf, sizeof(T));
+  return (order != native_byte_order ? byte_swap(v): v);
+}
+
+template<typename F, typename U>
+U float_bits(F value)
+{
+  U u;
+  std::memcpy(&u, &value, sizeof(U));
+  return u;
+}
+
+template<typename F, typename U>
+F bits_to_float(U u)
+{
+  F value;
+  std::memcpy(&value, &u, sizeof(F));
+  return value;
+}
+
+} // anonymous namespace
+
+void byte_swap16(const void* src, void* dst, size_t n)
+{
+  auto s = (const uint8_t*)src;
+  auto d = (uint8_t*)dst;
+  const size_t i = kernels().swap16(s, d, n);
+  byte_swap_tail<uint16_t>(s+2*i, d+2*i, n-i);
+}
+
+void byte_swap32(const void* src, void* dst, size_t n)
+{
+  auto s = (const uint8_t*)src;
+  auto d = (uint8_t*)dst;
+  const size_t i = kernels().swap32(s, d, n);
+  byte_swap_tail<uint32_t>(s+4*i, d+4*i, n-i);
+}
+
+void byte_swap64(const void* src, void* dst, size_t n)
+{
+  auto s = (const uint8_t*)src;
+  auto d = (uint8_t*)dst;
+  const size_t i = kernels().swap64(s, d, n);
+  byte_swap_tail<uint64_t>(s+8*i, d+8*i, n-i);
+}
+
+//////////////////////////////////////////////////////////////////////
+// buffer_writer
+
+void buffer_writer::write_bytes(const void* src, size_t n)
+{
+  // memcpy() with null pointers is undefined even if n == 0
+  if (n == 0)
+    return;
+
+  if (m_limit == std::numeric_limits<size_t>::max()) {
+    std::memcpy(reserve(n), src, n);
+    return;
+  }
+
+  // Write in pieces to respect the limit of the derived class
+  auto p = (const uint8_t*)src;
+  while (n > 0) {
+    const size_t m = std::min(n, std::max<size_t>(m_limit, 1));
+    std::memcpy(reserve(m), p, m);
+    p += m;
+    n -= m;
+  }
+}
+
+void buffer_writer::write_array(const void* src, size_t n, size_t elemSize)
+{
+  if (!m_swap) {
+    write_bytes(src, n*elemSize);
+    return;
+  }
+
+  auto p = (const uint8_t*)src;
+  const size_t piece = std::max<size_t>(1, std::min(m_limit, size_t(64*1024)) / elemSize);
+  while (n > 0) {
+    const size_t m = std::min(n, piece);
+    byte_swap_array(p, reserve(m*elemSize), m, elemSize);
+    p += m*elemSize;
+    n -= m;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+// ostream_writer
+
+ostream_writer::ostream_writer(std::ostream& os,
+                               byte_order order,
+                               size_t chunkSize)
+  : buffer_writer(m_chunk, order)
+  , m_os(os)
+{
+  chunkSize = std::max<size_t>(chunkSize, 64);
+  m_chunk.reserve(chunkSize);
+  set_limit(chunkSize);
+}
+
+ostream_writer::~ostream_writer()
+{
+  flush();
+}
+
+void ostream_writer::flush()
+{
+  if (!m_chunk.empty()) {
+    m_os.write((const char*)m_chunk.data(), m_chunk.size());
+    m_chunk.clear();
+  }
+}
+
+void ostream_writer::overflow()
+{
+  flush();
+}
+
+//////////////////////////////////////////////////////////////////////
+// buffer_reader
+
+bool buffer_reader::read_array(void* dst, size_t n, size_t elemSize)
+{
+  if (!m_ok || n > remaining() / elemSize) {
+    m_ok = false;
+    return false;
+  }
+  if (n == 0)
+    return true;
+
+  const uint8_t* p = read_bytes(n*elemSize);
+
+  if (m_swap)
+    byte_swap_array(p, dst, n, elemSize);
+  else
+    std::memcpy(dst, p, n*elemSize);
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+// std::istream/ostream functions
+
 std::ostream& write8(std::ostream& os, uint8_t byte)
 {
   os.put(byte);
@@ -28,254 +362,103 @@ uint8_t read8(std::istream& is)
 
 std::ostream& little_endian::write16(std::ostream& os, uint16_t word)
 {
-  os.put((int)((word & 0x00ff)));
-  os.put((int)((word & 0xff00) >> 8));
-  return os;
+  return write_stream(os, word, byte_order::little_endian);
 }
 
 std::ostream& little_endian::write32(std::ostream& os, uint32_t dword)
 {
-  os.put((int)((dword & 0x000000ffl)));
-  os.put((int)((dword & 0x0000ff00l) >> 8));
-  os.put((int)((dword & 0x00ff0000l) >> 16));
-  os.put((int)((dword & 0xff000000l) >> 24));
-  return os;
+  return write_stream(os, dword, byte_order::little_endian);
 }
 
 std::ostream& little_endian::write64(std::ostream& os, uint64_t qword)
 {
-  os.put((int)((qword & 0x00000000000000ffl)));
-  os.put((int)((qword & 0x000000000000ff00l) >> 8));
-  os.put((int)((qword & 0x0000000000ff0000l) >> 16));
-  os.put((int)((qword & 0x00000000ff000000l) >> 24));
-  os.put((int)((qword & 0x000000ff00000000l) >> 32));
-  os.put((int)((qword & 0x0000ff0000000000l) >> 40));
-  os.put((int)((qword & 0x00ff000000000000l) >> 48));
-  os.put((int)((qword & 0xff00000000000000l) >> 56));
-  return os;
+  return write_stream(os, qword, byte_order::little_endian);
 }
 
 std::ostream& little_endian::write_float(std::ostream& os, float value)
 {
-  const int b = *(reinterpret_cast<int*>(&value));
-  os.put((int)((b & 0x000000ffl)));
-  os.put((int)((b & 0x0000ff00l) >> 8));
-  os.put((int)((b & 0x00ff0000l) >> 16));
-  os.put((int)((b & 0xff000000l) >> 24));
-  return os;
+  return write_stream(os, float_bits<float, uint32_t>(value), byte_order::little_endian);
 }
 
 std::ostream& little_endian::write_double(std::ostream& os, double value)
 {
-  const long long b = *(reinterpret_cast<long long*>(&value));
-  os.put((int)((b & 0x00000000000000ffl)));
-  os.put((int)((b & 0x000000000000ff00l) >> 8));
-  os.put((int)((b & 0x0000000000ff0000l) >> 16));
-  os.put((int)((b & 0x00000000ff000000l) >> 24));
-  os.put((int)((b & 0x000000ff00000000l) >> 32));
-  os.put((int)((b & 0x0000ff0000000000l) >> 40));
-  os.put((int)((b & 0x00ff000000000000l) >> 48));
-  os.put((int)((b & 0xff00000000000000l) >> 56));
-  return os;
+  return write_stream(os, float_bits<double, uint64_t>(value), byte_order::little_endian);
 }
 
 uint16_t little_endian::read16(std::istream& is)
 {
-  int b1, b2;
-  b1 = is.get();
-  b2 = is.get();
-  return ((b2 << 8) | b1);
+  return read_stream<uint16_t>(is, byte_order::little_endian);
 }
 
 uint32_t little_endian::read32(std::istream& is)
 {
-  int b1, b2, b3, b4;
-  b1 = is.get();
-  b2 = is.get();
-  b3 = is.get();
-  b4 = is.get();
-  return ((b4 << 24) | (b3 << 16) | (b2 << 8) | b1);
+  return read_stream<uint32_t>(is, byte_order::little_endian);
 }
 
 uint64_t little_endian::read64(std::istream& is)
 {
-  int b1, b2, b3, b4, b5, b6, b7, b8;
-  b1 = is.get();
-  b2 = is.get();
-  b3 = is.get();
-  b4 = is.get();
-  b5 = is.get();
-  b6 = is.get();
-  b7 = is.get();
-  b8 = is.get();
-  return (((long long)b8 << 56) |
-          ((long long)b7 << 48) |
-          ((long long)b6 << 40) |
-          ((long long)b5 << 32) |
-          ((long long)b4 << 24) |
-          ((long long)b3 << 16) |
-          ((long long)b2 << 8) |
-          (long long)b1);
+  return read_stream<uint64_t>(is, byte_order::little_endian);
 }
 
 float little_endian::read_float(std::istream& is)
 {
-  int b1, b2, b3, b4;
-  b1 = is.get();
-  b2 = is.get();
-  b3 = is.get();
-  b4 = is.get();
-  int v = ((b4 << 24) | (b3 << 16) | (b2 << 8) | b1);
-  return *reinterpret_cast<float*>(&v);
+  return bits_to_float<float>(read_stream<uint32_t>(is, byte_order::little_endian));
 }
 
 double little_endian::read_double(std::istream& is)
 {
-  int b1, b2, b3, b4, b5, b6, b7, b8;
-  b1 = is.get();
-  b2 = is.get();
-  b3 = is.get();
-  b4 = is.get();
-  b5 = is.get();
-  b6 = is.get();
-  b7 = is.get();
-  b8 = is.get();
-  int v = (((long long)b8 << 56) |
-           ((long long)b7 << 48) |
-           ((long long)b6 << 40) |
-           ((long long)b5 << 32) |
-           ((long long)b4 << 24) |
-           ((long long)b3 << 16) |
-           ((long long)b2 << 8) |
-           (long long)b1);
-  return *reinterpret_cast<double*>(&v);
+  return bits_to_float<double>(read_stream<uint64_t>(is, byte_order::little_endian));
 }
 
 std::ostream& big_endian::write16(std::ostream& os, uint16_t word)
 {
-  os.put((int)((word & 0xff00) >> 8));
-  os.put((int)((word & 0x00ff)));
-  return os;
+  return write_stream(os, word, byte_order::big_endian);
 }
 
 std::ostream& big_endian::write32(std::ostream& os, uint32_t dword)
 {
-  os.put((int)((dword & 0xff000000l) >> 24));
-  os.put((int)((dword & 0x00ff0000l) >> 16));
-  os.put((int)((dword & 0x0000ff00l) >> 8));
-  os.put((int)((dword & 0x000000ffl)));
-  return os;
+  return write_stream(os, dword, byte_order::big_endian);
 }
 
 std::ostream& big_endian::write64(std::ostream& os, uint64_t qword)
 {
-  os.put((int)((qword & 0xff00000000000000l) >> 56));
-  os.put((int)((qword & 0x00ff000000000000l) >> 48));
-  os.put((int)((qword & 0x0000ff0000000000l) >> 40));
-  os.put((int)((qword & 0x000000ff00000000l) >> 32));
-  os.put((int)((qword & 0x00000000ff000000l) >> 24));
-  os.put((int)((qword & 0x0000000000ff0000l) >> 16));
-  os.put((int)((qword & 0x000000000000ff00l) >> 8));
-  os.put((int)((qword & 0x00000000000000ffl)));
-  return os;
+  return write_stream(os, qword, byte_order::big_endian);
 }
 
 std::ostream& big_endian::write_float(std::ostream& os, float value)
 {
-  const int b = *(reinterpret_cast<int*>(&value));
-  os.put((int)((b & 0xff000000l) >> 24));
-  os.put((int)((b & 0x00ff0000l) >> 16));
-  os.put((int)((b & 0x0000ff00l) >> 8));
-  os.put((int)((b & 0x000000ffl)));
-  return os;
+  return write_stream(os, float_bits<float, uint32_t>(value), byte_order::big_endian);
 }
 
 std::ostream& big_endian::write_double(std::ostream& os, double value)
 {
-  const long long b = *(reinterpret_cast<long long*>(&value));
-  os.put((int)((b & 0xff00000000000000l) >> 56));
-  os.put((int)((b & 0x00ff000000000000l) >> 48));
-  os.put((int)((b & 0x0000ff0000000000l) >> 40));
-  os.put((int)((b & 0x000000ff00000000l) >> 32));
-  os.put((int)((b & 0x00000000ff000000l) >> 24));
-  os.put((int)((b & 0x0000000000ff0000l) >> 16));
-  os.put((int)((b & 0x000000000000ff00l) >> 8));
-  os.put((int)((b & 0x00000000000000ffl)));
-  return os;
+  return write_stream(os, float_bits<double, uint64_t>(value), byte_order::big_endian);
 }
 
 uint16_t big_endian::read16(std::istream& is)
 {
-  int b1, b2;
-  b2 = is.get();
-  b1 = is.get();
-  return ((b2 << 8) | b1);
+  return read_stream<uint16_t>(is, byte_order::big_endian);
 }
 
 uint32_t big_endian::read32(std::istream& is)
 {
-  int b1, b2, b3, b4;
-  b4 = is.get();
-  b3 = is.get();
-  b2 = is.get();
-  b1 = is.get();
-  return ((b4 << 24) | (b3 << 16) | (b2 << 8) | b1);
+  return read_stream<uint32_t>(is, byte_order::big_endian);
 }
 
 uint64_t big_endian::read64(std::istream& is)
 {
-  int b1, b2, b3, b4, b5, b6, b7, b8;
-  b8 = is.get();
-  b7 = is.get();
-  b6 = is.get();
-  b5 = is.get();
-  b4 = is.get();
-  b3 = is.get();
-  b2 = is.get();
-  b1 = is.get();
-  return (((long long)b8 << 56) |
-          ((long long)b7 << 48) |
-          ((long long)b6 << 40) |
-          ((long long)b5 << 32) |
-          ((long long)b4 << 24) |
-          ((long long)b3 << 16) |
-          ((long long)b2 << 8) |
-          (long long)b1);
+  return read_stream<uint64_t>(is, byte_order::big_endian);
 }
 
 float big_endian::read_float(std::istream& is)
 {
-  int b1, b2, b3, b4;
-  b4 = is.get();
-  b3 = is.get();
-  b2 = is.get();
-  b1 = is.get();
-  int v = ((b4 << 24) | (b3 << 16) | (b2 << 8) | b1);
-  return *reinterpret_cast<float*>(&v);
+  return bits_to_float<float>(read_stream<uint32_t>(is, byte_order::big_endian));
 }
 
 double big_endian::read_double(std::istream& is)
 {
-  int b1, b2, b3, b4, b5, b6, b7, b8;
-  b8 = is.get();
-  b7 = is.get();
-  b6 = is.get();
-  b5 = is.get();
-  b4 = is.get();
-  b3 = is.get();
-  b2 = is.get();
-  b1 = is.get();
-  int v = (((long long)b8 << 56) |
-           ((long long)b7 << 48) |
-           ((long long)b6 << 40) |
-           ((long long)b5 << 32) |
-           ((long long)b4 << 24) |
-           ((long long)b3 << 16) |
-           ((long long)b2 << 8) |
-           (long long)b1);
-  return *reinterpret_cast<double*>(&v);
+  return bits_to_float<double>(read_stream<uint64_t>(is, byte_order::big_endian));
 }
 
-
 } // namespace serialization
 } // namespace base
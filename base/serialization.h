@@ -1,4 +1,5 @@
 // LAF Base Library
+// Copyright (c) 2024 Igara Studio S.A.
 // Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -8,8 +9,19 @@
 #define BASE_SERIALIZATION_H_INCLUDED
 #pragma once
 
+#include "base/buffer.h"
+#include "base/config.h"
 #include "base/ints.h"
+
+#include <cstddef>
+#include <cstring>
 #include <iosfwd>
+#include <limits>
+#include <string_view>
+
+#ifdef _MSC_VER
+  #include <stdlib.h>
+#endif
 
 namespace base {
 namespace serialization {
@@ -47,6 +59,274 @@ namespace serialization {
 
   } // big_endian namespace
 
+  //////////////////////////////////////////////////////////////////////
+  // Buffer-based serialization
+  //
+  // buffer_writer/ostream_writer and buffer_reader work with whole
+  // memory blocks instead of one iostream call per byte. Arrays are
+  // converted from/to the specified byte order with SIMD
+  // instructions (see base/cpu_features.h).
+
+  enum class byte_order { little_endian, big_endian };
+
+#ifdef LAF_BIG_ENDIAN
+  constexpr byte_order native_byte_order = byte_order::big_endian;
+#else
+  constexpr byte_order native_byte_order = byte_order::little_endian;
+#endif
+
+  inline uint16_t byte_swap(uint16_t v) {
+#ifdef _MSC_VER
+    return _byteswap_ushort(v);
+#else
+    return __builtin_bswap16(v);
+#endif
+  }
+
+  inline uint32_t byte_swap(uint32_t v) {
+#ifdef _MSC_VER
+    return _byteswap_ulong(v);
+#else
+    return __builtin_bswap32(v);
+#endif
+  }
+
+  inline uint64_t byte_swap(uint64_t v) {
+#ifdef _MSC_VER
+    return _byteswap_uint64(v);
+#else
+    return __builtin_bswap64(v);
+#endif
+  }
+
+  // Reverses the bytes of each element of "src" into "dst" (which can
+  // be the same array as "src"). Buffers don't need to be aligned.
+  void byte_swap16(const void* src, void* dst, size_t n);
+  void byte_swap32(const void* src, void* dst, size_t n);
+  void byte_swap64(const void* src, void* dst, size_t n);
+
+  // ZigZag encoding to save small negative numbers as small varints.
+  inline uint64_t zigzag_encode(int64_t v) {
+    return (uint64_t(v) << 1) ^ uint64_t(v >> 63);
+  }
+
+  inline int64_t zigzag_decode(uint64_t v) {
+    return int64_t(v >> 1) ^ -int64_t(v & 1);
+  }
+
+  // Appends values to a base::buffer.
+  class buffer_writer {
+  public:
+    explicit buffer_writer(buffer& buf,
+                           byte_order order = byte_order::little_endian)
+      : m_buf(buf)
+      , m_swap(order != native_byte_order) { }
+    virtual ~buffer_writer() { }
+
+    buffer_writer(const buffer_writer&) = delete;
+    buffer_writer& operator=(const buffer_writer&) = delete;
+
+    buffer& data() { return m_buf; }
+    size_t size() const { return m_buf.size(); }
+
+    void write8(uint8_t v) { *reserve(1) = v; }
+    void write16(uint16_t v) { write_value(m_swap ? byte_swap(v): v); }
+    void write32(uint32_t v) { write_value(m_swap ? byte_swap(v): v); }
+    void write64(uint64_t v) { write_value(m_swap ? byte_swap(v): v); }
+
+    void write_float(float v) {
+      uint32_t u;
+      std::memcpy(&u, &v, sizeof(u));
+      write32(u);
+    }
+
+    void write_double(double v) {
+      uint64_t u;
+      std::memcpy(&u, &v, sizeof(u));
+      write64(u);
+    }
+
+    // Bulk writes of arrays.
+    void write_bytes(const void* src, size_t n);
+    void write16(const uint16_t* src, size_t n) { write_array(src, n, 2); }
+    void write32(const uint32_t* src, size_t n) { write_array(src, n, 4); }
+    void write64(const uint64_t* src, size_t n) { write_array(src, n, 8); }
+    void write_float(const float* src, size_t n) { write_array(src, n, 4); }
+    void write_double(const double* src, size_t n) { write_array(src, n, 8); }
+
+    // Variable-length integers (LEB128, 1 to 10 bytes), signed
+    // integers are ZigZag-encoded.
+    void write_varint(uint64_t v) {
+      uint8_t tmp[10];
+      size_t n = 0;
+      while (v >= 0x80) {
+        tmp[n++] = uint8_t(v | 0x80);
+        v >>= 7;
+      }
+      tmp[n++] = uint8_t(v);
+      std::memcpy(reserve(n), tmp, n);
+    }
+
+    void write_svarint(int64_t v) {
+      write_varint(zigzag_encode(v));
+    }
+
+  protected:
+    // Called when the buffer reaches the limit (used to write chunks
+    // in derived classes).
+    virtual void overflow() { }
+
+    void set_limit(size_t limit) { m_limit = limit; }
+
+    uint8_t* reserve(size_t n) {
+      if (m_buf.size() + n > m_limit)
+        overflow();
+      const size_t pos = m_buf.size();
+      m_buf.resize(pos + n);
+      return m_buf.data() + pos;
+    }
+
+  private:
+    template<typename T>
+    void write_value(T v) {
+      std::memcpy(reserve(sizeof(T)), &v, sizeof(T));
+    }
+
+    void write_array(const void* src, size_t n, size_t elemSize);
+
+    buffer& m_buf;
+    bool m_swap;
+    size_t m_limit = std::numeric_limits<size_t>::max();
+  };
+
+  // Writes to a std::ostream in large chunks (the pending data is
+  // written when the chunk is full, on flush(), and in the
+  // destructor).
+  class ostream_writer : public buffer_writer {
+  public:
+    explicit ostream_writer(std::ostream& os,
+                            byte_order order = byte_order::little_endian,
+                            size_t chunkSize = 64*1024);
+    ~ostream_writer();
+
+    void flush();
+
+  protected:
+    void overflow() override;
+
+  private:
+    std::ostream& m_os;
+    buffer m_chunk;
+  };
+
+  // Reads values from a memory block (e.g. a file mapped in memory)
+  // without copying it. All reads are bounds-checked: reading past
+  // the end returns 0 (or nullptr) and ok() returns false from that
+  // point (the reader doesn't advance anymore).
+  class buffer_reader {
+  public:
+    buffer_reader(const void* data, size_t size,
+                  byte_order order = byte_order::little_endian)
+      : m_begin((const uint8_t*)data)
+      , m_ptr(m_begin)
+      , m_end(m_begin + size)
+      , m_swap(order != native_byte_order) { }
+
+    explicit buffer_reader(const buffer& buf,
+                           byte_order order = byte_order::little_endian)
+      : buffer_reader(buf.data(), buf.size(), order) { }
+
+    bool ok() const { return m_ok; }
+    size_t position() const { return m_ptr - m_begin; }
+    size_t remaining() const { return m_end - m_ptr; }
+    bool eof() const { return m_ptr == m_end; }
+
+    uint8_t read8() { return read_value<uint8_t>(); }
+    uint16_t read16() { return swap(read_value<uint16_t>()); }
+    uint32_t read32() { return swap(read_value<uint32_t>()); }
+    uint64_t read64() { return swap(read_value<uint64_t>()); }
+
+    float read_float() {
+      const uint32_t u = read32();
+      float v;
+      std::memcpy(&v, &u, sizeof(v));
+      return v;
+    }
+
+    double read_double() {
+      const uint64_t u = read64();
+      double v;
+      std::memcpy(&v, &u, sizeof(v));
+      return v;
+    }
+
+    // Returns a pointer to the next "n" bytes inside the memory block
+    // (zero-copy), or nullptr if there are not enough bytes.
+    const uint8_t* read_bytes(size_t n) {
+      if (!m_ok || n > remaining()) {
+        m_ok = false;
+        return nullptr;
+      }
+      const uint8_t* p = m_ptr;
+      m_ptr += n;
+      return p;
+    }
+
+    std::string_view read_string(size_t n) {
+      const uint8_t* p = read_bytes(n);
+      return (p ? std::string_view((const char*)p, n): std::string_view());
+    }
+
+    void skip(size_t n) { read_bytes(n); }
+
+    // Bulk reads of arrays, they return false (and don't modify
+    // "dst") if there are not enough bytes.
+    bool read16(uint16_t* dst, size_t n) { return read_array(dst, n, 2); }
+    bool read32(uint32_t* dst, size_t n) { return read_array(dst, n, 4); }
+    bool read64(uint64_t* dst, size_t n) { return read_array(dst, n, 8); }
+    bool read_float(float* dst, size_t n) { return read_array(dst, n, 4); }
+    bool read_double(double* dst, size_t n) { return read_array(dst, n, 8); }
+
+    uint64_t read_varint() {
+      if (!m_ok)
+        return 0;
+      uint64_t v = 0;
+      for (int shift=0; shift<64 && m_ptr < m_end; shift += 7) {
+        const uint8_t b = *m_ptr++;
+        v |= uint64_t(b & 0x7f) << shift;
+        if ((b & 0x80) == 0)
+          return v;
+      }
+      // Truncated or too long varint
+      m_ok = false;
+      return 0;
+    }
+
+    int64_t read_svarint() {
+      return zigzag_decode(read_varint());
+    }
+
+  private:
+    template<typename T>
+    T read_value() {
+      T v = 0;
+      if (const uint8_t* p = read_bytes(sizeof(T)))
+        std::memcpy(&v, p, sizeof(T));
+      return v;
+    }
+
+    template<typename T>
+    T swap(T v) const { return (m_swap ? byte_swap(v): v); }
+
+    bool read_array(void* dst, size_t n, size_t elemSize);
+
+    const uint8_t* m_begin;
+    const uint8_t* m_ptr;
+    const uint8_t* m_end;
+    bool m_swap;
+    bool m_ok = true;
+  };
+
 } // serialization namespace
 } // base namespace
 
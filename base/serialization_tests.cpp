@@ -0,0 +1,254 @@
+// LAF Base Library
+// Copyright (c) 2024 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include <gtest/gtest.h>
+
+#include "base/serialization.h"
+
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+using namespace base;
+using namespace base::serialization;
+
+TEST(Serialization, StreamByteOrder)
+{
+  std::stringstream s;
+  little_endian::write16(s, 0x0102);
+  little_endian::write32(s, 0x01020304);
+  big_endian::write16(s, 0x0102);
+  big_endian::write32(s, 0x01020304);
+  big_endian::write64(s, 0x0102030405060708ull);
+  EXPECT_EQ(std::string("\x02\x01\x04\x03\x02\x01"
+                        "\x01\x02\x01\x02\x03\x04"
+                        "\x01\x02\x03\x04\x05\x06\x07\x08", 20), s.str());
+
+  EXPECT_EQ(0x0102, little_endian::read16(s));
+  EXPECT_EQ(0x01020304, little_endian::read32(s));
+  EXPECT_EQ(0x0102, big_endian::read16(s));
+  EXPECT_EQ(0x01020304, big_endian::read32(s));
+  EXPECT_EQ(0x0102030405060708ull, big_endian::read64(s));
+}
+
+TEST(Serialization, StreamFloats)
+{
+  std::stringstream s;
+  little_endian::write_float(s, 1.5f);
+  little_endian::write_double(s, -2.25);
+  big_endian::write_float(s, 3.75f);
+  big_endian::write_double(s, 1e100);
+  EXPECT_EQ(1.5f, little_endian::read_float(s));
+  EXPECT_EQ(-2.25, little_endian::read_double(s));
+  EXPECT_EQ(3.75f, big_endian::read_float(s));
+  EXPECT_EQ(1e100, big_endian::read_double(s));
+}
+
+TEST(Serialization, WriterReaderValues)
+{
+  for (auto order : { byte_order::little_endian, byte_order::big_endian }) {
+    buffer buf;
+    buffer_writer w(buf, order);
+    w.write8(0xab);
+    w.write16(0x1234);
+    w.write32(0x12345678);
+    w.write64(0x123456789abcdef0ull);
+    w.write_float(0.5f);
+    w.write_double(-0.125);
+    EXPECT_EQ(1+2+4+8+4+8, w.size());
+
+    if (order == byte_order::big_endian) {
+      EXPECT_EQ(0x12, buf[1]);
+      EXPECT_EQ(0x34, buf[2]);
+    }
+    else {
+      EXPECT_EQ(0x34, buf[1]);
+      EXPECT_EQ(0x12, buf[2]);
+    }
+
+    buffer_reader r(buf, order);
+    EXPECT_EQ(0xab, r.read8());
+    EXPECT_EQ(0x1234, r.read16());
+    EXPECT_EQ(0x12345678, r.read32());
+    EXPECT_EQ(0x123456789abcdef0ull, r.read64());
+    EXPECT_EQ(0.5f, r.read_float());
+    EXPECT_EQ(-0.125, r.read_double());
+    EXPECT_TRUE(r.ok());
+    EXPECT_TRUE(r.eof());
+  }
+}
+
+TEST(Serialization, BulkArrays)
+{
+  // Different sizes to test SIMD blocks and scalar tails
+  for (size_t n=0; n<70; ++n) {
+    std::vector<uint16_t> a16(n);
+    std::vector<uint32_t> a32(n);
+    std::vector<uint64_t> a64(n);
+    std::vector<float> af(n);
+    for (size_t i=0; i<n; ++i) {
+      a16[i] = uint16_t(0x0102 * (i+1));
+      a32[i] = uint32_t(0x01020304 * (i+1));
+      a64[i] = 0x0102030405060708ull * (i+1);
+      af[i] = float(i) / 3.0f;
+    }
+
+    for (auto order : { byte_order::little_endian, byte_order::big_endian }) {
+      buffer buf;
+      buffer_writer w(buf, order);
+      w.write16(a16.data(), n);
+      w.write32(a32.data(), n);
+      w.write64(a64.data(), n);
+      w.write_float(af.data(), n);
+      ASSERT_EQ(n*(2+4+8+4), buf.size());
+
+      // Compare with single value writes
+      buffer buf2;
+      buffer_writer w2(buf2, order);
+      for (auto v : a16) w2.write16(v);
+      for (auto v : a32) w2.write32(v);
+      for (auto v : a64) w2.write64(v);
+      for (auto v : af) w2.write_float(v);
+      ASSERT_EQ(buf2, buf);
+
+      std::vector<uint16_t> b16(n);
+      std::vector<uint32_t> b32(n);
+      std::vector<uint64_t> b64(n);
+      std::vector<float> bf(n);
+      buffer_reader r(buf, order);
+      EXPECT_TRUE(r.read16(b16.data(), n));
+      EXPECT_TRUE(r.read32(b32.data(), n));
+      EXPECT_TRUE(r.read64(b64.data(), n));
+      EXPECT_TRUE(r.read_float(bf.data(), n));
+      EXPECT_TRUE(r.eof());
+      EXPECT_EQ(a16, b16);
+      EXPECT_EQ(a32, b32);
+      EXPECT_EQ(a64, b64);
+      EXPECT_EQ(af, bf);
+    }
+  }
+}
+
+TEST(Serialization, ByteSwapInPlace)
+{
+  std::vector<uint32_t> v(37);
+  for (size_t i=0; i<v.size(); ++i)
+    v[i] = uint32_t(0x11223344 + i);
+  byte_swap32(v.data(), v.data(), v.size());
+  for (size_t i=0; i<v.size(); ++i)
+    EXPECT_EQ(byte_swap(uint32_t(0x11223344 + i)), v[i]);
+}
+
+TEST(Serialization, Varints)
+{
+  const uint64_t values[] = {
+    0, 1, 127, 128, 300, 16383, 16384, 0xffffffffull,
+    std::numeric_limits<uint64_t>::max()
+  };
+  const int64_t svalues[] = {
+    0, -1, 1, -64, 64, -65, std::numeric_limits<int64_t>::min(),
+    std::numeric_limits<int64_t>::max()
+  };
+
+  buffer buf;
+  buffer_writer w(buf);
+  for (auto v : values)
+    w.write_varint(v);
+  for (auto v : svalues)
+    w.write_svarint(v);
+
+  EXPECT_EQ(0x00, buf[0]);
+  EXPECT_EQ(0x01, buf[1]);
+  EXPECT_EQ(0x7f, buf[2]);
+  EXPECT_EQ(0x80, buf[3]);
+  EXPECT_EQ(0x01, buf[4]);
+
+  buffer_reader r(buf);
+  for (auto v : values)
+    EXPECT_EQ(v, r.read_varint());
+  for (auto v : svalues)
+    EXPECT_EQ(v, r.read_svarint());
+  EXPECT_TRUE(r.ok());
+  EXPECT_TRUE(r.eof());
+
+  EXPECT_EQ(0, zigzag_encode(0));
+  EXPECT_EQ(1, zigzag_encode(-1));
+  EXPECT_EQ(2, zigzag_encode(1));
+  EXPECT_EQ(3, zigzag_encode(-2));
+
+  // Truncated varint
+  const uint8_t truncated[] = { 0x80, 0x80 };
+  buffer_reader r2(truncated, sizeof(truncated));
+  EXPECT_EQ(0, r2.read_varint());
+  EXPECT_FALSE(r2.ok());
+}
+
+TEST(Serialization, ReaderBounds)
+{
+  const uint8_t data[] = { 1, 2, 3, 4, 5 };
+  buffer_reader r(data, sizeof(data));
+  EXPECT_EQ(0x0201, r.read16());
+  EXPECT_EQ(3, r.remaining());
+
+  // Zero-copy read
+  const uint8_t* p = r.read_bytes(2);
+  EXPECT_EQ(data+2, p);
+  EXPECT_TRUE(r.ok());
+
+  // Out of bounds
+  EXPECT_EQ(0, r.read32());
+  EXPECT_FALSE(r.ok());
+  EXPECT_EQ(4, r.position());
+  EXPECT_EQ(0, r.read8());      // Fails after the first error
+
+  buffer_reader r2(data, sizeof(data));
+  uint32_t v[2] = { 0, 0 };
+  EXPECT_FALSE(r2.read32(v, 2));
+  EXPECT_EQ(0, v[0]);
+  EXPECT_EQ(0, r2.position());
+
+  buffer_reader r3(data, sizeof(data));
+  EXPECT_EQ("\x01\x02\x03", r3.read_string(3));
+  EXPECT_EQ("", r3.read_string(3));
+  EXPECT_FALSE(r3.ok());
+}
+
+TEST(Serialization, OStreamWriterChunks)
+{
+  std::vector<uint32_t> values(10000);
+  for (size_t i=0; i<values.size(); ++i)
+    values[i] = uint32_t(i * 2654435761u);
+
+  buffer expected;
+  {
+    buffer_writer w(expected, byte_order::big_endian);
+    for (int i=0; i<100; ++i)
+      w.write_varint(i * 1000);
+    w.write32(values.data(), values.size());
+    w.write_double(3.5);
+  }
+
+  std::stringstream s;
+  {
+    ostream_writer w(s, byte_order::big_endian, 256);
+    for (int i=0; i<100; ++i)
+      w.write_varint(i * 1000);
+    w.write32(values.data(), values.size());
+    w.write_double(3.5);
+    // Data is written in chunks before the flush
+    EXPECT_GT(s.str().size(), 0);
+    EXPECT_LE(s.str().size(), expected.size());
+  }
+  const std::string str = s.str();
+  EXPECT_EQ(std::string(expected.begin(), expected.end()), str);
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1,4 +1,5 @@
 // LAF Base Library
+// Copyright (c) 2024 Igara Studio S.A.
 // Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -10,7 +11,21 @@
 
 #include "base/split_string.h"
 
+#include "base/cpu_features.h"
+
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if LAF_HAVE_SSE2
+  #include <emmintrin.h>
+#elif LAF_HAVE_NEON
+  #include <arm_neon.h>
+#endif
+
+#ifdef _MSC_VER
+  #include <intrin.h>
+#endif
 
 namespace {
 
@@ -32,6 +47,23 @@ namespace {
     }
   };
 
+  // Max number of separators compared with SIMD instructions, for
+  // more separators we use a lookup table.
+  constexpr size_t kMaxSimdSeparators = 8;
+
+  size_t find_with_table(const uint8_t* p, size_t i, const size_t n,
+                         std::string_view separators)
+  {
+    bool table[256] = { false };
+    for (char chr : separators)
+      table[uint8_t(chr)] = true;
+    for (; i<n; ++i) {
+      if (table[p[i]])
+        return i;
+    }
+    return n;
+  }
+
 }
 
 void base::split_string(const std::string& string,
@@ -56,3 +88,73 @@ void base::split_string(const std::string& string,
     }
   }
 }
+
+void base::split_string(std::string_view string,
+                        std::vector<std::string_view>& parts,
+                        std::string_view separators)
+{
+  for (std::string_view part : split_string_view(string, separators))
+    parts.push_back(part);
+}
+
+size_t base::find_first_separator(std::string_view string,
+                                  std::string_view separators)
+{
+  const size_t n = string.size();
+  if (n == 0 || separators.empty())
+    return n;
+
+  if (separators.size() == 1) {
+    auto found = (const char*)std::memchr(string.data(), separators[0], n);
+    return (found ? found - string.data(): n);
+  }
+
+  auto p = (const uint8_t*)string.data();
+  size_t i = 0;
+  if (separators.size() > kMaxSimdSeparators)
+    return find_with_table(p, i, n, separators);
+
+#if LAF_HAVE_SSE2
+  __m128i seps[kMaxSimdSeparators];
+  const size_t nseps = separators.size();
+  for (size_t j=0; j<nseps; ++j)
+    seps[j] = _mm_set1_epi8(separators[j]);
+
+  for (; i+16 <= n; i += 16) {
+    const __m128i v = _mm_loadu_si128((const __m128i*)(p+i));
+    __m128i eq = _mm_cmpeq_epi8(v, seps[0]);
+    for (size_t j=1; j<nseps; ++j)
+      eq = _mm_or_si128(eq, _mm_cmpeq_epi8(v, seps[j]));
+    if (const int mask = _mm_movemask_epi8(eq)) {
+#ifdef _MSC_VER
+      unsigned long k;
+      _BitScanForward(&k, mask);
+      return i + k;
+#else
+      return i + __builtin_ctz(mask);
+#endif
+    }
+  }
+#elif LAF_HAVE_NEON
+  uint8x16_t seps[kMaxSimdSeparators];
+  const size_t nseps = separators.size();
+  for (size_t j=0; j<nseps; ++j)
+    seps[j] = vdupq_n_u8(uint8_t(separators[j]));
+
+  for (; i+16 <= n; i += 16) {
+    const uint8x16_t v = vld1q_u8(p+i);
+    uint8x16_t eq = vceqq_u8(v, seps[0]);
+    for (size_t j=1; j<nseps; ++j)
+      eq = vorrq_u8(eq, vceqq_u8(v, seps[j]));
+    if (vmaxvq_u8(eq))
+      break;                    // Find the exact position below
+  }
+#endif
+
+  // Remaining bytes
+  for (; i<n; ++i) {
+    if (separators.find(char(p[i])) != std::string_view::npos)
+      return i;
+  }
+  return n;
+}
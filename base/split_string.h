@@ -1,4 +1,5 @@
 // LAF Base Library
+// Copyright (c) 2024 Igara Studio S.A.
 // Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -8,7 +9,9 @@
 #define BASE_SPLIT_STRING_H_INCLUDED
 #pragma once
 
+#include <iterator>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace base {
@@ -17,6 +20,106 @@ namespace base {
                     std::vector<std::string>& parts,
                     const std::string& separators);
 
+  // Same as split_string() but the parts reference the original
+  // string (so it must outlive them).
+  void split_string(std::string_view string,
+                    std::vector<std::string_view>& parts,
+                    std::string_view separators);
+
+  // Returns the position of the first character in "string" that is
+  // one of the given "separators", or string.size() if there is
+  // none. It uses memchr() for one separator and SIMD comparisons
+  // for small sets of separators.
+  size_t find_first_separator(std::string_view string,
+                              std::string_view separators);
+
+  // Lazy range of tokens separated by any of the given separators
+  // (including empty tokens, like split_string()) which doesn't
+  // allocate memory. E.g.
+  //
+  //   for (std::string_view field : base::split_string_view(line, ",;"))
+  //     ...
+  //
+  class split_string_range {
+  public:
+    class iterator {
+    public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = std::string_view;
+      using difference_type = std::ptrdiff_t;
+      using pointer = const std::string_view*;
+      using reference = const std::string_view&;
+
+      iterator() = default;
+      iterator(std::string_view rest, std::string_view separators)
+        : m_rest(rest)
+        , m_separators(separators)
+        , m_done(false) {
+        next();
+      }
+
+      reference operator*() const { return m_token; }
+      pointer operator->() const { return &m_token; }
+
+      iterator& operator++() {
+        next();
+        return *this;
+      }
+
+      iterator operator++(int) {
+        iterator old = *this;
+        next();
+        return old;
+      }
+
+      bool operator==(const iterator& that) const {
+        return (m_done == that.m_done &&
+                (m_done || m_token.data() == that.m_token.data()));
+      }
+      bool operator!=(const iterator& that) const {
+        return !operator==(that);
+      }
+
+    private:
+      void next() {
+        if (m_last) {
+          m_done = true;
+          return;
+        }
+        const size_t i = find_first_separator(m_rest, m_separators);
+        m_token = m_rest.substr(0, i);
+        if (i < m_rest.size())
+          m_rest.remove_prefix(i+1);
+        else
+          m_last = true;
+      }
+
+      std::string_view m_rest;
+      std::string_view m_separators;
+      std::string_view m_token;
+      bool m_last = false;
+      bool m_done = true;
+    };
+
+    split_string_range(std::string_view string,
+                       std::string_view separators)
+      : m_string(string)
+      , m_separators(separators) {
+    }
+
+    iterator begin() const { return iterator(m_string, m_separators); }
+    iterator end() const { return iterator(); }
+
+  private:
+    std::string_view m_string;
+    std::string_view m_separators;
+  };
+
+  inline split_string_range split_string_view(std::string_view string,
+                                              std::string_view separators) {
+    return split_string_range(string, separators);
+  }
+
 }
 
 #endif
@@ -1,4 +1,5 @@
 // LAF Base Library
+// Copyright (c) 2024 Igara Studio S.A.
 // Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -7,6 +8,7 @@
 #include <gtest/gtest.h>
 
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "base/split_string.h"
@@ -46,6 +48,63 @@ TEST(SplitString, MultipleSeparators)
   EXPECT_EQ("ld", result[2]);
 }
 
+TEST(SplitString, StringViewParts)
+{
+  const std::string str = "Hello,World;,";
+  std::vector<std::string_view> result;
+  base::split_string(std::string_view(str), result, ",;");
+  ASSERT_EQ(4, result.size());
+  EXPECT_EQ("Hello", result[0]);
+  EXPECT_EQ("World", result[1]);
+  EXPECT_EQ("", result[2]);
+  EXPECT_EQ("", result[3]);
+
+  // Parts reference the original string
+  EXPECT_EQ(str.data(), result[0].data());
+  EXPECT_EQ(str.data()+6, result[1].data());
+}
+
+TEST(SplitString, LazyRangeMatchesSplitString)
+{
+  const char* inputs[] = {
+    "", ",", ",,", "a", "a,b", ",a,", "a;b,c d", "Hello,World",
+    "a long line with more than sixteen characters, and separators; here",
+    "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa,b",
+  };
+  const char* seps[] = { "", ",", ",;", ",; ", ",;: \t\n|/-", "r" };
+
+  for (const char* input : inputs) {
+    for (const char* sep : seps) {
+      std::vector<std::string> expected;
+      base::split_string(input, expected, sep);
+
+      std::vector<std::string> result;
+      for (std::string_view part : base::split_string_view(input, sep))
+        result.emplace_back(part);
+
+      EXPECT_EQ(expected, result) << "input=\"" << input << "\" seps=\"" << sep << "\"";
+    }
+  }
+}
+
+TEST(SplitString, FindFirstSeparator)
+{
+  std::string s(100, 'x');
+  EXPECT_EQ(100, base::find_first_separator(s, ","));
+  EXPECT_EQ(100, base::find_first_separator(s, ",;"));
+  EXPECT_EQ(100, base::find_first_separator(s, ""));
+
+  for (int i=0; i<100; ++i) {
+    std::string t = s;
+    t[i] = ';';
+    EXPECT_EQ(i, base::find_first_separator(t, ";"));
+    EXPECT_EQ(i, base::find_first_separator(t, ",;"));
+    EXPECT_EQ(i, base::find_first_separator(t, "abcdefghi;")); // Lookup table
+    t[99] = ',';
+    EXPECT_EQ(i, base::find_first_separator(t, ",;"));
+  }
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
@@ -112,95 +112,34 @@ std::wstring from_utf8(const std::string& src)
 
 #else
 
-// Based on Allegro Unicode code (allegro/src/unicode.c)
-static std::size_t insert_utf8_char(std::string* result, wchar_t chr)
-{
-  int size, bits, b, i;
-
-  if (chr < 128) {
-    if (result)
-      result->push_back(chr);
-    return 1;
-  }
-
-  bits = 7;
-  while (chr >= (1<<bits))
-    bits++;
-
-  size = 2;
-  b = 11;
-
-  while (b < bits) {
-    size++;
-    b += 5;
-  }
-
-  if (result) {
-    b -= (7-size);
-    int firstbyte = chr>>b;
-    for (i=0; i<size; i++)
-      firstbyte |= (0x80>>i);
-
-    result->push_back(firstbyte);
-
-    for (i=1; i<size; i++) {
-      b -= 6;
-      result->push_back(0x80 | ((chr>>b)&0x3F));
-    }
-  }
-
-  return size;
-}
-
 std::string to_utf8(const wchar_t* src, const size_t n)
 {
-  // Get required size to reserve a string so string::push_back()
-  // doesn't need to reallocate its data.
-  std::size_t required_size = 0;
-  const auto* p = src;
-  for (size_t i=0; i<n; ++i, ++p)
-    required_size += insert_utf8_char(nullptr, *p);
+  // Get the required size to encode the whole string directly in
+  // the std::string buffer.
+  const size_t required_size = wchar_to_utf8(src, n, nullptr, 0);
   if (!required_size)
     return "";
 
-  std::string result;
-  result.reserve(++required_size);
-  p = src;
-  for (int i=0; i<n; ++i, ++p)
-    insert_utf8_char(&result, *p);
+  std::string result(required_size, 0);
+  wchar_to_utf8(src, n, result.data(), required_size);
   return result;
 }
 
 std::wstring from_utf8(const std::string& src)
 {
-  int required_size = utf8_length(src);
-  std::vector<wchar_t> buf(++required_size);
-  std::vector<wchar_t>::iterator buf_it = buf.begin();
-#ifdef _DEBUG
-  std::vector<wchar_t>::iterator buf_end = buf.end();
-#endif
-  utf8_decode decode(src);
-
-  while (const int chr = decode.next()) {
-    ASSERT(buf_it != buf_end);
-    *buf_it = chr;
-    ++buf_it;
-  }
-
-  return std::wstring(buf.data());
+  // The number of decoded characters cannot be greater than the
+  // number of bytes of the UTF-8 string.
+  std::wstring result(src.size(), 0);
+  result.resize(utf8_to_wchar(src.data(), src.size(),
+                              result.data(), result.size()));
+  return result;
 }
 
 #endif
 
 int utf8_length(const std::string& utf8string)
 {
-  utf8_decode decode(utf8string);
-  int c = 0;
-
-  while (decode.next())
-    ++c;
-
-  return c;
+  return int(utf8_length(utf8string.data(), utf8string.size()));
 }
 
 int utf8_icmp(const std::string& a, const std::string& b, int n)
@@ -10,6 +10,7 @@
 #pragma once
 
 #include <cstdarg>
+#include <cstddef>
 #include <iterator>
 #include <string>
 
@@ -32,6 +33,35 @@ namespace base {
   int utf8_length(const std::string& utf8string);
   int utf8_icmp(const std::string& a, const std::string& b, int n = 0);
 
+  // Bulk UTF-8 routines over caller buffers. They decode exactly
+  // like base::utf8_decode (i.e. decoding stops at the first NUL
+  // character or at the first invalid sequence), but runs of ASCII
+  // characters are processed 16/32 bytes at a time with SIMD
+  // instructions selected at runtime (see base/cpu_features.h).
+  //
+  // wchar_t is UTF-32 on Unix-like platforms and UTF-16 on Windows
+  // (surrogate pairs are generated/combined in that case).
+
+  // Returns the number of code points in the given buffer.
+  size_t utf8_length(const char* src, size_t n);
+
+  // Returns true if the whole buffer is well-formed UTF-8 as defined
+  // by RFC 3629 (no overlong forms, surrogates, or code points
+  // above U+10FFFF).
+  bool utf8_is_valid(const char* src, size_t n);
+
+  // Decodes up to "dst_size" characters into "dst", returns the
+  // number of characters written.
+  size_t utf8_to_utf32(const char* src, size_t n, char32_t* dst, size_t dst_size);
+  size_t utf8_to_wchar(const char* src, size_t n, wchar_t* dst, size_t dst_size);
+
+  // Encodes "n" characters into "dst" (without a NUL terminator),
+  // returns the number of bytes written. A character that doesn't
+  // fit completely in "dst" isn't written. If "dst" is nullptr,
+  // returns the number of bytes required to encode the whole input.
+  size_t utf32_to_utf8(const char32_t* src, size_t n, char* dst, size_t dst_size);
+  size_t wchar_to_utf8(const wchar_t* src, size_t n, char* dst, size_t dst_size);
+
 }
 
 #endif
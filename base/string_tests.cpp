@@ -1,5 +1,5 @@
 // LAF Base Library
-// Copyright (c) 2022 Igara Studio S.A.
+// Copyright (c) 2022-2024 Igara Studio S.A.
 // Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -12,6 +12,8 @@
 
 #include <algorithm>
 #include <clocale>
+#include <random>
+#include <vector>
 
 using namespace base;
 
@@ -183,6 +185,133 @@ TEST(String, Utf8DecodeDontCrash)
   }
 }
 
+// Generates mostly-ASCII strings with some multi-byte characters,
+// and (if "garbage" is true) invalid sequences and NUL characters.
+static std::string random_utf8(std::mt19937& rng, bool garbage)
+{
+  std::string s;
+  const int pieces = rng() % 16;
+  for (int i=0; i<pieces; ++i) {
+    switch (rng() % (garbage ? 6: 4)) {
+      case 0:
+      case 1: {
+        const int n = rng() % 70;
+        for (int j=0; j<n; ++j)
+          s.push_back(char(1 + rng() % 127));
+        break;
+      }
+      case 2:
+      case 3: {
+        const uint32_t ranges[] = { 0x80, 0x800, 0x10000, 0x110000 };
+        uint32_t cp = rng() % ranges[rng() % 4];
+        if (cp == 0 || (cp >= 0xd800 && cp < 0xe000))
+          cp = 0x6f22;
+        std::wstring w(1, wchar_t(cp));
+        if (sizeof(wchar_t) == 2 && cp >= 0x10000) {
+          cp -= 0x10000;
+          w = { wchar_t(0xd800 | (cp >> 10)), wchar_t(0xdc00 | (cp & 0x3ff)) };
+        }
+        s += to_utf8(w);
+        break;
+      }
+      case 4:
+        s.push_back(char(rng() % 256));
+        break;
+      case 5:
+        s.push_back(0);
+        break;
+    }
+  }
+  return s;
+}
+
+TEST(String, Utf8BulkRoutinesMatchUtf8Decode)
+{
+  std::mt19937 rng(1065);
+  for (int i=0; i<20000; ++i) {
+    const bool garbage = (i & 1);
+    const std::string s = random_utf8(rng, garbage);
+
+    std::vector<int> expected;
+    utf8_decode dec(s);
+    while (const int chr = dec.next())
+      expected.push_back(chr);
+
+    EXPECT_EQ(expected.size(), utf8_length(s.data(), s.size()));
+
+    std::vector<char32_t> u32(s.size()+1, 0);
+    const size_t n = utf8_to_utf32(s.data(), s.size(), u32.data(), u32.size());
+    ASSERT_EQ(expected.size(), n);
+    for (size_t j=0; j<n; ++j)
+      ASSERT_EQ(expected[j], int(u32[j]));
+
+    // Decoding to a small buffer must stop at the buffer size
+    const size_t m = std::min<size_t>(n, 7);
+    EXPECT_EQ(m, utf8_to_utf32(s.data(), s.size(), u32.data(), m));
+
+    if (!garbage) {
+      ASSERT_TRUE(dec.is_valid());
+      // Round-trip of valid strings
+      EXPECT_EQ(s, to_utf8(from_utf8(s)));
+      EXPECT_TRUE(utf8_is_valid(s.data(), s.size()));
+
+      std::string t(utf32_to_utf8(u32.data(), n, nullptr, 0), 0);
+      EXPECT_EQ(t.size(), utf32_to_utf8(u32.data(), n, t.data(), t.size()));
+      EXPECT_EQ(s, t);
+    }
+    else if (!dec.is_valid()) {
+      EXPECT_FALSE(utf8_is_valid(s.data(), s.size()));
+    }
+  }
+}
+
+TEST(String, Utf8IsValid)
+{
+  EXPECT_TRUE(utf8_is_valid("", 0));
+  EXPECT_TRUE(utf8_is_valid("abc\0def", 7));
+  EXPECT_TRUE(utf8_is_valid("\xE6\xBC\xA2\xE5\xAD\x97", 6));
+  EXPECT_TRUE(utf8_is_valid("\xF4\x8F\xBF\xBF", 4)); // U+10FFFF
+  EXPECT_FALSE(utf8_is_valid("\xE6\xBC", 2));        // Truncated
+  EXPECT_FALSE(utf8_is_valid("\xC0\x80", 2));        // Overlong NUL
+  EXPECT_FALSE(utf8_is_valid("\xE0\x80\xAF", 3));    // Overlong '/'
+  EXPECT_FALSE(utf8_is_valid("\xED\xA0\x80", 3));    // Surrogate
+  EXPECT_FALSE(utf8_is_valid("\xF4\x90\x80\x80", 4)); // > U+10FFFF
+  EXPECT_FALSE(utf8_is_valid("\xFF", 1));
+
+  // Invalid byte after a long ASCII run (SIMD blocks + scalar tail)
+  std::string s(100, 'a');
+  EXPECT_TRUE(utf8_is_valid(s.data(), s.size()));
+  s[77] = '\x80';
+  EXPECT_FALSE(utf8_is_valid(s.data(), s.size()));
+}
+
+TEST(String, Utf8BulkAsciiBoundaries)
+{
+  for (int len=0; len<100; ++len) {
+    for (int pos=0; pos<=len; ++pos) {
+      std::string s(len, 'x');
+      s.insert(pos, "\xC2\xA9");
+
+      EXPECT_EQ(len+1, utf8_length(s.data(), s.size()));
+
+      std::wstring w(s.size(), 0);
+      w.resize(utf8_to_wchar(s.data(), s.size(), w.data(), w.size()));
+      ASSERT_EQ(len+1, w.size());
+      EXPECT_EQ(0xA9, w[pos]);
+
+      std::string t(s.size(), 0);
+      EXPECT_EQ(s.size(), wchar_to_utf8(w.data(), w.size(), t.data(), t.size()));
+      EXPECT_EQ(s, t);
+    }
+
+    // A NUL character stops the decoding
+    std::string s(len, 'x');
+    s.push_back(0);
+    s += "yz";
+    EXPECT_EQ(len, utf8_length(s.data(), s.size()));
+  }
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
@@ -11,6 +11,7 @@
 #include "base/debug.h"
 #include "base/log.h"
 #include "base/thread_pool.h"
+#include "base/trace.h"
 
 namespace base {
 
@@ -93,8 +94,10 @@ void thread_pool::worker()
       }
     }
     try {
-      if (func)
+      if (func) {
+        LAF_TRACE_ZONE("base::thread_pool task");
         func();
+      }
     }
     // TODO handle exceptions in a better way
     catch (const std::exception& e) {
@@ -1,5 +1,5 @@
 // LAF Base Library
-// Copyright (c) 2021-2022 Igara Studio S.A.
+// Copyright (c) 2021-2024 Igara Studio S.A.
 // Copyright (c) 2001-2018 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -11,13 +11,10 @@
 
 #include "base/time.h"
 
+#include "base/clock.h"
+
 #if LAF_WINDOWS
   #include <windows.h>
-#else
-  #include <sys/time.h>
-  #if __APPLE__
-    #include <mach/mach_time.h>
-  #endif
 #endif
 
 namespace base {
@@ -54,29 +51,7 @@ Time current_time()
 
 tick_t current_tick()
 {
-#if LAF_WINDOWS
-  // GetTickCount() is limited to the system timer resolution (from 10
-  // to 16 milliseconds), we prefer QueryPerformanceCounter().
-  LARGE_INTEGER counter, freq;
-  if (QueryPerformanceCounter(&counter) &&
-      // TODO Call QueryPerformanceFrequency() just one time
-      QueryPerformanceFrequency(&freq)) {
-    // TODO Some precision is lost, we could return float or double
-    return counter.QuadPart * 1000 / freq.QuadPart;
-  }
-  else
-    return GetTickCount();
-#elif __APPLE__
-  static mach_timebase_info_data_t timebase = { 0, 0 };
-  if (timebase.denom == 0)
-    (void)mach_timebase_info(&timebase);
-  return tick_t(double(mach_absolute_time()) * double(timebase.numer) / double(timebase.denom) / 1.0e6);
-#else
-  // TODO use clock_gettime(CLOCK_MONOTONIC, &now); if it's possible
-  struct timeval now;
-  gettimeofday(&now, nullptr);
-  return now.tv_sec*1000 + now.tv_usec/1000;
-#endif
+  return monotonic_ns() / 1000000;
 }
 
 Time& Time::addSeconds(const int seconds)
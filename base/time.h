@@ -1,5 +1,5 @@
 // LAF Base Library
-// Copyright (c) 2021 Igara Studio S.A.
+// Copyright (c) 2021-2024 Igara Studio S.A.
 // Copyright (c) 2001-2018 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -16,7 +16,8 @@
 
 namespace base {
 
-  // ~1000 per second
+  // Milliseconds of the monotonic clock (use base::monotonic_ns() from
+  // base/clock.h for nanoseconds)
   typedef uint64_t tick_t;
 
   class Time {
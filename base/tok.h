@@ -11,8 +11,11 @@
 #define BASE_TOK_H_INCLUDED
 #pragma once
 
+#include <cstring>
 #include <iterator>
 #include <string>
+#include <string_view>
+#include <type_traits>
 
 namespace base {
 namespace tok {
@@ -20,6 +23,15 @@ namespace tok {
 struct ignore_empties { enum { allow_empty = false }; };
 struct include_empties { enum { allow_empty = true }; };
 
+// When the tokenized string is a std::string_view, tokens are
+// std::string_views too (no copies/allocations), so the original
+// string must outlive the tokens.
+template<typename T>
+constexpr bool is_string_view_v =
+  std::is_same_v<std::remove_const_t<T>,
+                 std::basic_string_view<typename T::value_type,
+                                        typename T::traits_type>>;
+
 template<typename T, typename EmptyPolicy>
 class token_iterator {
 public:
@@ -56,10 +68,27 @@ public:
       }
     }
     begin_ = inter_;
-    while (inter_ != end_ && *inter_ != chr_) {
-      ++inter_;
+    if constexpr (sizeof(char_type) == 1) {
+      // Contiguous strings of bytes, memchr() is generally
+      // implemented with SIMD instructions
+      if (inter_ != end_) {
+        const char_type* p = &*inter_;
+        auto found = (const char_type*)std::memchr(p, chr_, end_ - inter_);
+        inter_ = (found ? inter_ + (found - p): end_);
+      }
+    }
+    else {
+      while (inter_ != end_ && *inter_ != chr_) {
+        ++inter_;
+      }
+    }
+    if constexpr (is_string_view_v<T>) {
+      str_ = value_type(begin_ != end_ ? &*begin_: nullptr,
+                        inter_ - begin_);
+    }
+    else {
+      str_.assign(begin_, inter_);
     }
-    str_.assign(begin_, inter_);
     return *this;
   }
 
@@ -89,7 +118,8 @@ public:
   iterator end() const { return iterator(str_.end(), str_.end(), chr_); }
 
 private:
-  const T& str_;
+  // String views are copied by value (they can be temporaries)
+  std::conditional_t<is_string_view_v<T>, T, const T&> str_;
   char_type chr_;
 };
 
@@ -11,6 +11,7 @@
 
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "base/tok.h"
@@ -37,6 +38,30 @@ TEST(Tok, Csv)
   }
 }
 
+TEST(Tok, StringViewTokens)
+{
+  const std::string a = "This is a phrase.   Several whitespaces are ignored.";
+  auto a_result = std::vector<std::string>{ "This", "is", "a", "phrase.", "Several", "whitespaces", "are", "ignored." };
+  int i = 0;
+  for (std::string_view tok : base::tok::split_tokens(std::string_view(a), ' ')) {
+    // Tokens point to the original string
+    EXPECT_GE(tok.data(), a.data());
+    EXPECT_LE(tok.data()+tok.size(), a.data()+a.size());
+    EXPECT_EQ(tok, a_result[i++]);
+  }
+  EXPECT_EQ(a_result.size(), i);
+
+  // Same tokens as with std::string
+  const std::string b = "In comma,separated,,values,,,empties are included";
+  std::vector<std::string> b_result;
+  for (auto& tok : base::tok::csv(b, ','))
+    b_result.push_back(tok);
+  i = 0;
+  for (std::string_view tok : base::tok::csv(std::string_view(b), ','))
+    EXPECT_EQ(tok, b_result[i++]);
+  EXPECT_EQ(b_result.size(), i);
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
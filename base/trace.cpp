@@ -0,0 +1,687 @@
+// LAF Base Library
+// Copyright (c) 2024 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "base/trace.h"
+
+#include "base/clock.h"
+#include "base/fs.h"
+#include "base/fstream_path.h"
+#include "base/string.h"
+#include "base/thread.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace base {
+namespace trace {
+
+namespace detail {
+  std::atomic<bool> enabled(false);
+}
+
+namespace {
+
+// Events per chunk (each thread allocates chunks as needed) and max
+// number of chunks per thread (~64 MB of events).
+constexpr size_t kChunkSize = 8192;
+constexpr size_t kMaxChunks = 256;
+
+// Max number of chunks of exited threads kept to be reused by new
+// threads (~2 MB).
+constexpr size_t kMaxFreeChunks = 8;
+
+// Process ID used in exported traces.
+constexpr int kPid = 1;
+
+struct Event {
+  const char* name;
+  uint64_t ticks;
+  union {
+    uint64_t id;
+    double value;
+  };
+  EventType type;
+};
+
+struct Chunk {
+  Event events[kChunkSize];
+  // Number of events that can be read from other threads (it's
+  // incremented by the owner thread only).
+  std::atomic<size_t> count { 0 };
+  std::atomic<Chunk*> next { nullptr };
+};
+
+struct ThreadBuffer {
+  int tid = 0;
+  std::string name;
+  std::unique_ptr<Chunk> head;
+  Chunk* tail = nullptr;        // Used by the owner thread only
+  size_t chunks = 0;            // Number of allocated chunks
+  uint64_t epoch = 0;
+  // Events of the thread copied from its chunks when it exits (its
+  // chunks are released/reused by other threads)
+  std::vector<Event> exitedEvents;
+  bool exited = false;
+  // Locked to clear the buffer or to read it from another thread
+  std::mutex mutex;
+
+  explicit ThreadBuffer(std::unique_ptr<Chunk>&& chunk)
+    : head(std::move(chunk)), tail(head.get()), chunks(1) { }
+
+  ~ThreadBuffer() {
+    for (Chunk* chunk : take_chunks())
+      delete chunk;
+  }
+
+  // Removes all chunks from the buffer.
+  std::vector<Chunk*> take_chunks() {
+    std::vector<Chunk*> result;
+    if (head) {
+      Chunk* chunk = head.release();
+      while (chunk) {
+        result.push_back(chunk);
+        chunk = chunk->next;
+      }
+    }
+    tail = nullptr;
+    chunks = 0;
+    return result;
+  }
+
+  // Chunks are kept to be reused (so we don't have to allocate
+  // memory and touch new pages again).
+  void reset() {
+    for (Chunk* chunk=head.get(); chunk; chunk=chunk->next)
+      chunk->count.store(0, std::memory_order_release);
+    tail = head.get();
+  }
+
+  template<typename Func>
+  void for_each_event(Func&& func) {
+    for (Chunk* chunk=head.get(); chunk;
+         chunk=chunk->next.load(std::memory_order_acquire)) {
+      const size_t n = chunk->count.load(std::memory_order_acquire);
+      for (size_t i=0; i<n; ++i)
+        func(chunk->events[i]);
+    }
+    for (const Event& ev : exitedEvents)
+      func(ev);
+  }
+};
+
+struct Registry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+  std::vector<std::unique_ptr<Chunk>> freeChunks;
+  int nextTid = 1;
+  std::atomic<uint64_t> epoch { 0 };
+  std::atomic<uint64_t> dropped { 0 };
+
+  // Event ticks are converted to nanoseconds since the first start()
+  std::unique_ptr<TscClock> clock;
+};
+
+// The registry is never destroyed because threads could record
+// events after static destructors are called.
+Registry& registry()
+{
+  static Registry* r = new Registry;
+  return *r;
+}
+
+thread_local ThreadBuffer* t_buffer = nullptr;
+// True when the thread is exiting and its buffer was retired
+thread_local bool t_exited = false;
+
+// Converts ticks to nanoseconds since the first call of start().
+class TicksToNs {
+public:
+  TicksToNs() {
+    Registry& r = registry();
+    {
+      const std::lock_guard lock(r.mutex);
+      if (!r.clock)
+        r.clock = std::make_unique<TscClock>();
+      m_clock = r.clock.get();
+    }
+    m_nsPerTick = m_clock->nsPerTick();
+  }
+
+  uint64_t operator()(uint64_t ticks) const {
+    return m_clock->toNs(ticks, m_nsPerTick);
+  }
+
+private:
+  const TscClock* m_clock;
+  double m_nsPerTick;
+};
+
+// Must be called with the registry mutex locked.
+void recycle_chunks(Registry& r, ThreadBuffer& buf)
+{
+  for (Chunk* chunk : buf.take_chunks()) {
+    if (r.freeChunks.size() < kMaxFreeChunks) {
+      chunk->count.store(0, std::memory_order_relaxed);
+      chunk->next.store(nullptr, std::memory_order_relaxed);
+      r.freeChunks.emplace_back(chunk);
+    }
+    else
+      delete chunk;
+  }
+}
+
+// Called when a thread that recorded events exits. Its events are
+// copied to the buffer (so they can be exported later) and its
+// chunks are released, so threads that are created and destroyed
+// frequently (e.g. the workers of a base::thread_pool) don't keep
+// their chunks alive.
+void retire_thread(ThreadBuffer* buf)
+{
+  Registry& r = registry();
+  const std::lock_guard lock(r.mutex);
+  {
+    const std::lock_guard bufLock(buf->mutex);
+    std::vector<Event> events;
+    if (buf->epoch == r.epoch)
+      buf->for_each_event([&events](const Event& ev){
+        events.push_back(ev);
+      });
+    recycle_chunks(r, *buf);
+    buf->exitedEvents = std::move(events);
+    buf->exited = true;
+  }
+  if (buf->exitedEvents.empty()) {
+    auto it = std::find_if(r.buffers.begin(), r.buffers.end(),
+                           [buf](const auto& b){ return b.get() == buf; });
+    if (it != r.buffers.end())
+      r.buffers.erase(it);
+  }
+}
+
+struct ThreadExit {
+  ~ThreadExit() {
+    if (t_buffer) {
+      retire_thread(t_buffer);
+      t_buffer = nullptr;
+    }
+    t_exited = true;
+  }
+};
+
+ThreadBuffer* register_thread()
+{
+  // Retires the buffer when the thread exits
+  static thread_local ThreadExit t_exit;
+
+  Registry& r = registry();
+  std::unique_ptr<ThreadBuffer> buffer;
+  {
+    const std::lock_guard lock(r.mutex);
+    if (!r.freeChunks.empty()) {
+      buffer = std::make_unique<ThreadBuffer>(std::move(r.freeChunks.back()));
+      r.freeChunks.pop_back();
+    }
+  }
+  if (!buffer)
+    buffer = std::make_unique<ThreadBuffer>(std::make_unique<Chunk>());
+  buffer->name = base::this_thread::get_name();
+  buffer->epoch = r.epoch;
+
+  const std::lock_guard lock(r.mutex);
+  buffer->tid = r.nextTid++;
+  if (buffer->name.empty())
+    buffer->name = "Thread " + std::to_string(buffer->tid);
+  r.buffers.push_back(std::move(buffer));
+  return r.buffers.back().get();
+}
+
+Event* new_event()
+{
+  ThreadBuffer* buf = t_buffer;
+  if (!buf) {
+    // Events recorded from thread_local destructors after the buffer
+    // of the thread was retired are ignored
+    if (t_exited)
+      return nullptr;
+    buf = t_buffer = register_thread();
+  }
+
+  Registry& r = registry();
+  const uint64_t epoch = r.epoch.load(std::memory_order_relaxed);
+  if (buf->epoch != epoch) {
+    const std::lock_guard lock(buf->mutex);
+    buf->reset();
+    buf->epoch = epoch;
+  }
+
+  Chunk* chunk = buf->tail;
+  if (chunk->count.load(std::memory_order_relaxed) == kChunkSize) {
+    Chunk* next = chunk->next.load(std::memory_order_relaxed);
+    if (!next) {
+      if (buf->chunks == kMaxChunks) {
+        r.dropped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+      }
+      next = new Chunk;
+      chunk->next.store(next, std::memory_order_release);
+      ++buf->chunks;
+    }
+    buf->tail = chunk = next;
+  }
+  return &chunk->events[chunk->count.load(std::memory_order_relaxed)];
+}
+
+// Makes the last event returned by new_event() visible for readers.
+inline void commit_event()
+{
+  Chunk* chunk = t_buffer->tail;
+  chunk->count.store(chunk->count.load(std::memory_order_relaxed) + 1,
+                     std::memory_order_release);
+}
+
+// Calls func(buffer) for each thread buffer with its mutex locked.
+template<typename Func>
+void for_each_buffer(Func&& func)
+{
+  Registry& r = registry();
+  const std::lock_guard lock(r.mutex);
+  for (auto& buf : r.buffers) {
+    const std::lock_guard bufLock(buf->mutex);
+    // Ignore buffers that weren't cleared yet by its thread
+    if (buf->epoch == r.epoch)
+      func(*buf);
+  }
+}
+
+void write_json_string(std::ostream& os, const char* s)
+{
+  os << '"';
+  for (; *s; ++s) {
+    switch (*s) {
+      case '"': os << "\\\""; break;
+      case '\\': os << "\\\\"; break;
+      case '\n': os << "\\n"; break;
+      default:
+        if (uint8_t(*s) < 0x20)
+          os << ' ';
+        else
+          os << *s;
+        break;
+    }
+  }
+  os << '"';
+}
+
+//////////////////////////////////////////////////////////////////////
+// Minimal protobuf encoder for the Perfetto trace format
+// https://perfetto.dev/docs/reference/trace-packet-proto
+
+class ProtoWriter {
+public:
+  enum WireType { Varint = 0, Fixed64 = 1, Bytes = 2 };
+
+  void varint(int field, uint64_t v) {
+    tag(field, Varint);
+    raw_varint(v);
+  }
+
+  void fixed64(int field, uint64_t v) {
+    tag(field, Fixed64);
+    for (int i=0; i<8; ++i, v >>= 8)
+      m_data.push_back(char(v & 0xff));
+  }
+
+  void float64(int field, double v) {
+    uint64_t u;
+    std::memcpy(&u, &v, sizeof(u));
+    fixed64(field, u);
+  }
+
+  void bytes(int field, const std::string& s) {
+    tag(field, Bytes);
+    raw_varint(s.size());
+    m_data += s;
+  }
+
+  void message(int field, const ProtoWriter& msg) {
+    bytes(field, msg.m_data);
+  }
+
+  const std::string& data() const { return m_data; }
+  void clear() { m_data.clear(); }
+
+private:
+  void tag(int field, WireType type) {
+    raw_varint((uint64_t(field) << 3) | type);
+  }
+
+  void raw_varint(uint64_t v) {
+    while (v >= 0x80) {
+      m_data.push_back(char((v & 0x7f) | 0x80));
+      v >>= 7;
+    }
+    m_data.push_back(char(v));
+  }
+
+  std::string m_data;
+};
+
+// Field numbers of the Perfetto protos
+namespace pf {
+  enum Trace { Trace_packet = 1 };
+  enum TracePacket {
+    TracePacket_timestamp = 8,
+    TracePacket_trusted_packet_sequence_id = 10,
+    TracePacket_track_event = 11,
+    TracePacket_sequence_flags = 13,
+    TracePacket_track_descriptor = 60,
+  };
+  enum TrackDescriptor {
+    TrackDescriptor_uuid = 1,
+    TrackDescriptor_name = 2,
+    TrackDescriptor_process = 3,
+    TrackDescriptor_thread = 4,
+    TrackDescriptor_parent_uuid = 5,
+    TrackDescriptor_counter = 8,
+  };
+  enum ProcessDescriptor {
+    ProcessDescriptor_pid = 1,
+    ProcessDescriptor_process_name = 6,
+  };
+  enum ThreadDescriptor {
+    ThreadDescriptor_pid = 1,
+    ThreadDescriptor_tid = 2,
+    ThreadDescriptor_thread_name = 5,
+  };
+  enum TrackEvent {
+    TrackEvent_type = 9,
+    TrackEvent_track_uuid = 11,
+    TrackEvent_name = 23,
+    TrackEvent_double_counter_value = 44,
+    TrackEvent_flow_ids = 47,
+    TrackEvent_terminating_flow_ids = 48,
+  };
+  enum TrackEventType {
+    TYPE_SLICE_BEGIN = 1,
+    TYPE_SLICE_END = 2,
+    TYPE_INSTANT = 3,
+    TYPE_COUNTER = 4,
+  };
+  enum SequenceFlags { SEQ_INCREMENTAL_STATE_CLEARED = 1 };
+}
+
+constexpr uint64_t kProcessTrackUuid = 1;
+
+uint64_t hash_name(const char* name, uint64_t id)
+{
+  // FNV-1a
+  uint64_t h = 0xcbf29ce484222325ull ^ id;
+  for (; *name; ++name)
+    h = (h ^ uint8_t(*name)) * 0x100000001b3ull;
+  // Avoid collisions with process/thread track IDs
+  return h | (1ull << 63);
+}
+
+void write_packet(std::ostream& os, const ProtoWriter& packet)
+{
+  ProtoWriter trace;
+  trace.message(pf::Trace_packet, packet);
+  os.write(trace.data().data(), trace.data().size());
+}
+
+} // anonymous namespace
+
+void start()
+{
+  Registry& r = registry();
+  {
+    const std::lock_guard lock(r.mutex);
+    if (!r.clock)
+      r.clock = std::make_unique<TscClock>();
+  }
+  detail::enabled.store(true, std::memory_order_relaxed);
+}
+
+void stop()
+{
+  detail::enabled.store(false, std::memory_order_relaxed);
+}
+
+void clear()
+{
+  Registry& r = registry();
+  const std::lock_guard lock(r.mutex);
+  // Each thread resets its own buffer in the next recorded event
+  // (and we ignore buffers from the old epoch on export).
+  r.epoch.fetch_add(1);
+  r.dropped = 0;
+
+  // Buffers of exited threads are not needed anymore
+  r.buffers.erase(
+    std::remove_if(r.buffers.begin(), r.buffers.end(),
+                   [](const auto& buf){ return buf->exited; }),
+    r.buffers.end());
+}
+
+void record(EventType type, const char* name, uint64_t id)
+{
+  if (Event* ev = new_event()) {
+    ev->name = name;
+    ev->ticks = read_tsc();
+    ev->id = id;
+    ev->type = type;
+    commit_event();
+  }
+}
+
+void record_counter(const char* name, double value)
+{
+  if (Event* ev = new_event()) {
+    ev->name = name;
+    ev->ticks = read_tsc();
+    ev->value = value;
+    ev->type = EventType::Counter;
+    commit_event();
+  }
+}
+
+uint64_t dropped_events()
+{
+  return registry().dropped;
+}
+
+void write_chrome_trace(std::ostream& os)
+{
+  const TicksToNs ticksToNs;
+  bool first = true;
+  auto sep = [&os, &first]{
+    os << (first ? "\n": ",\n");
+    first = false;
+  };
+
+  os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  sep();
+  os << "{\"ph\":\"M\",\"pid\":" << kPid
+     << ",\"name\":\"process_name\",\"args\":{\"name\":\"laf\"}}";
+
+  for_each_buffer([&](ThreadBuffer& buf){
+    sep();
+    os << "{\"ph\":\"M\",\"pid\":" << kPid << ",\"tid\":" << buf.tid
+       << ",\"name\":\"thread_name\",\"args\":{\"name\":";
+    write_json_string(os, buf.name.c_str());
+    os << "}}";
+
+    buf.for_each_event([&](const Event& ev){
+      const uint64_t ns = ticksToNs(ev.ticks);
+      sep();
+      os << "{\"ph\":\"";
+      switch (ev.type) {
+        case EventType::ZoneBegin:  os << 'B'; break;
+        case EventType::ZoneEnd:    os << 'E'; break;
+        case EventType::Instant:    os << "i\",\"s\":\"t"; break;
+        case EventType::Counter:    os << 'C'; break;
+        case EventType::AsyncBegin: os << 'b'; break;
+        case EventType::AsyncEnd:   os << 'e'; break;
+        case EventType::FlowBegin:  os << 's'; break;
+        case EventType::FlowStep:   os << 't'; break;
+        case EventType::FlowEnd:    os << "f\",\"bp\":\"e"; break;
+      }
+      os << "\",\"pid\":" << kPid << ",\"tid\":" << buf.tid
+         << ",\"ts\":" << (ns / 1000) << '.'
+         << char('0' + (ns / 100) % 10)
+         << char('0' + (ns / 10) % 10)
+         << char('0' + ns % 10)
+         << ",\"name\":";
+      write_json_string(os, ev.name);
+
+      switch (ev.type) {
+        case EventType::Counter:
+          os << ",\"args\":{\"value\":" << ev.value << '}';
+          break;
+        case EventType::AsyncBegin:
+        case EventType::AsyncEnd:
+        case EventType::FlowBegin:
+        case EventType::FlowStep:
+        case EventType::FlowEnd:
+          os << ",\"cat\":\"laf\",\"id\":" << ev.id;
+          break;
+        default:
+          break;
+      }
+      os << '}';
+    });
+  });
+  os << "\n]}\n";
+}
+
+void write_perfetto_trace(std::ostream& os)
+{
+  const TicksToNs ticksToNs;
+  ProtoWriter packet, desc, sub, event;
+
+  // Process track
+  sub.varint(pf::ProcessDescriptor_pid, kPid);
+  sub.bytes(pf::ProcessDescriptor_process_name, "laf");
+  desc.varint(pf::TrackDescriptor_uuid, kProcessTrackUuid);
+  desc.message(pf::TrackDescriptor_process, sub);
+  packet.message(pf::TracePacket_track_descriptor, desc);
+  write_packet(os, packet);
+
+  // Counter and async slice tracks are created as needed
+  std::map<uint64_t, const char*> extraTracks;
+  auto extraTrack = [&](uint64_t uuid, const char* name, bool counter) {
+    if (extraTracks.find(uuid) != extraTracks.end())
+      return;
+    extraTracks[uuid] = name;
+    desc.clear();
+    desc.varint(pf::TrackDescriptor_uuid, uuid);
+    desc.varint(pf::TrackDescriptor_parent_uuid, kProcessTrackUuid);
+    desc.bytes(pf::TrackDescriptor_name, name);
+    if (counter)
+      desc.bytes(pf::TrackDescriptor_counter, std::string());
+    packet.clear();
+    packet.message(pf::TracePacket_track_descriptor, desc);
+    write_packet(os, packet);
+  };
+
+  bool firstEvent = true;
+  for_each_buffer([&](ThreadBuffer& buf){
+    const uint64_t threadUuid = 0x1000 + buf.tid;
+
+    sub.clear();
+    sub.varint(pf::ThreadDescriptor_pid, kPid);
+    sub.varint(pf::ThreadDescriptor_tid, buf.tid);
+    sub.bytes(pf::ThreadDescriptor_thread_name, buf.name);
+    desc.clear();
+    desc.varint(pf::TrackDescriptor_uuid, threadUuid);
+    desc.varint(pf::TrackDescriptor_parent_uuid, kProcessTrackUuid);
+    desc.message(pf::TrackDescriptor_thread, sub);
+    packet.clear();
+    packet.message(pf::TracePacket_track_descriptor, desc);
+    write_packet(os, packet);
+
+    buf.for_each_event([&](const Event& ev){
+      uint64_t trackUuid = threadUuid;
+      event.clear();
+      switch (ev.type) {
+        case EventType::ZoneBegin:
+          event.varint(pf::TrackEvent_type, pf::TYPE_SLICE_BEGIN);
+          break;
+        case EventType::ZoneEnd:
+          event.varint(pf::TrackEvent_type, pf::TYPE_SLICE_END);
+          break;
+        case EventType::Instant:
+          event.varint(pf::TrackEvent_type, pf::TYPE_INSTANT);
+          break;
+        case EventType::Counter:
+          trackUuid = hash_name(ev.name, 0);
+          extraTrack(trackUuid, ev.name, true);
+          event.varint(pf::TrackEvent_type, pf::TYPE_COUNTER);
+          event.float64(pf::TrackEvent_double_counter_value, ev.value);
+          break;
+        case EventType::AsyncBegin:
+        case EventType::AsyncEnd:
+          trackUuid = hash_name(ev.name, ev.id);
+          extraTrack(trackUuid, ev.name, false);
+          event.varint(pf::TrackEvent_type,
+                       ev.type == EventType::AsyncBegin ? pf::TYPE_SLICE_BEGIN:
+                                                          pf::TYPE_SLICE_END);
+          break;
+        case EventType::FlowBegin:
+        case EventType::FlowStep:
+          event.varint(pf::TrackEvent_type, pf::TYPE_INSTANT);
+          event.fixed64(pf::TrackEvent_flow_ids, ev.id);
+          break;
+        case EventType::FlowEnd:
+          event.varint(pf::TrackEvent_type, pf::TYPE_INSTANT);
+          event.fixed64(pf::TrackEvent_terminating_flow_ids, ev.id);
+          break;
+      }
+      event.varint(pf::TrackEvent_track_uuid, trackUuid);
+      if (ev.type != EventType::ZoneEnd &&
+          ev.type != EventType::AsyncEnd)
+        event.bytes(pf::TrackEvent_name, ev.name);
+
+      packet.clear();
+      packet.varint(pf::TracePacket_timestamp, ticksToNs(ev.ticks));
+      packet.varint(pf::TracePacket_trusted_packet_sequence_id, 1);
+      if (firstEvent) {
+        packet.varint(pf::TracePacket_sequence_flags,
+                      pf::SEQ_INCREMENTAL_STATE_CLEARED);
+        firstEvent = false;
+      }
+      packet.message(pf::TracePacket_track_event, event);
+      write_packet(os, packet);
+    });
+  });
+}
+
+bool save_trace(const std::string& filename)
+{
+  const bool json = (base::string_to_lower(base::get_file_extension(filename)) == "json");
+  std::ofstream f(FSTREAM_PATH(filename),
+                  json ? std::ios::out: std::ios::out | std::ios::binary);
+  if (!f)
+    return false;
+  if (json)
+    write_chrome_trace(f);
+  else
+    write_perfetto_trace(f);
+  return f.good();
+}
+
+} // namespace trace
+} // namespace base
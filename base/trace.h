@@ -0,0 +1,152 @@
+// LAF Base Library
+// Copyright (c) 2024 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef BASE_TRACE_H_INCLUDED
+#define BASE_TRACE_H_INCLUDED
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+// Hierarchical tracing of laf internals and the app itself. Events
+// are recorded in per-thread buffers (without locks) and can be
+// exported to the Chrome trace JSON format (chrome://tracing,
+// https://ui.perfetto.dev) or to the Perfetto protobuf format.
+//
+// The LAF_TRACE_*() macros are compiled only if LAF_TRACE is defined
+// (cmake -DLAF_WITH_TRACE=ON), in other case they expand to nothing.
+// When they are compiled, they record events only between
+// base::trace::start() and stop() calls. E.g.
+//
+//   void Window::paint() {
+//     LAF_TRACE_ZONE("Window::paint");
+//     ...
+//   }
+//
+//   base::trace::start();
+//   ...
+//   base::trace::stop();
+//   base::trace::save_trace("trace.json");
+//
+// All names must be strings with static storage duration (e.g. string
+// literals or __func__) because only the pointer is saved.
+
+namespace base {
+namespace trace {
+
+  enum class EventType : uint8_t {
+    ZoneBegin,
+    ZoneEnd,
+    Instant,
+    Counter,
+    AsyncBegin,
+    AsyncEnd,
+    FlowBegin,
+    FlowStep,
+    FlowEnd,
+  };
+
+  namespace detail {
+    extern std::atomic<bool> enabled;
+  }
+
+  inline bool is_enabled() {
+    return detail::enabled.load(std::memory_order_relaxed);
+  }
+
+  // Starts/stops recording events. Events recorded in previous
+  // start/stop sessions are kept until clear() is called.
+  void start();
+  void stop();
+
+  // Discards all recorded events.
+  void clear();
+
+  // Records an event in the buffer of the current thread. "id"
+  // identifies async slices and flows.
+  void record(EventType type, const char* name, uint64_t id = 0);
+  void record_counter(const char* name, double value);
+
+  // Number of events that couldn't be recorded because a thread
+  // buffer was full.
+  uint64_t dropped_events();
+
+  // Exports all recorded events. They can be called while other
+  // threads are recording events (only completed events are
+  // exported).
+  void write_chrome_trace(std::ostream& os);
+  void write_perfetto_trace(std::ostream& os);
+
+  // Saves a Chrome JSON trace if the filename has the .json
+  // extension, or a Perfetto protobuf trace in other case
+  // (e.g. .perfetto-trace or .pftrace).
+  bool save_trace(const std::string& filename);
+
+  // Records a zone in the current scope (use LAF_TRACE_ZONE()).
+  class Zone {
+  public:
+    explicit Zone(const char* name)
+      : m_name(is_enabled() ? name: nullptr) {
+      if (m_name)
+        record(EventType::ZoneBegin, m_name);
+    }
+    ~Zone() {
+      // The end is recorded even if the tracing was stopped in the
+      // middle of the zone
+      if (m_name)
+        record(EventType::ZoneEnd, m_name);
+    }
+    Zone(const Zone&) = delete;
+    Zone& operator=(const Zone&) = delete;
+  private:
+    const char* m_name;
+  };
+
+} // namespace trace
+} // namespace base
+
+#if LAF_TRACE
+
+  #define LAF_TRACE_CONCAT_(a, b) a##b
+  #define LAF_TRACE_CONCAT(a, b) LAF_TRACE_CONCAT_(a, b)
+
+  #define LAF_TRACE_ZONE(name)                                  \
+    const base::trace::Zone LAF_TRACE_CONCAT(laf_trace_zone_, __LINE__)(name)
+
+  #define LAF_TRACE_FUNC() LAF_TRACE_ZONE(__func__)
+
+  #define LAF_TRACE_RECORD_(type, name, id)                     \
+    (base::trace::is_enabled() ?                                \
+     base::trace::record(base::trace::EventType::type, (name), (id)): (void)0)
+
+  #define LAF_TRACE_INSTANT(name)         LAF_TRACE_RECORD_(Instant, name, 0)
+  #define LAF_TRACE_ASYNC_BEGIN(name, id) LAF_TRACE_RECORD_(AsyncBegin, name, id)
+  #define LAF_TRACE_ASYNC_END(name, id)   LAF_TRACE_RECORD_(AsyncEnd, name, id)
+  #define LAF_TRACE_FLOW_BEGIN(name, id)  LAF_TRACE_RECORD_(FlowBegin, name, id)
+  #define LAF_TRACE_FLOW_STEP(name, id)   LAF_TRACE_RECORD_(FlowStep, name, id)
+  #define LAF_TRACE_FLOW_END(name, id)    LAF_TRACE_RECORD_(FlowEnd, name, id)
+
+  #define LAF_TRACE_COUNTER(name, value)                        \
+    (base::trace::is_enabled() ?                                \
+     base::trace::record_counter((name), double(value)): (void)0)
+
+#else
+
+  #define LAF_TRACE_ZONE(name)            ((void)0)
+  #define LAF_TRACE_FUNC()                ((void)0)
+  #define LAF_TRACE_INSTANT(name)         ((void)0)
+  #define LAF_TRACE_ASYNC_BEGIN(name, id) ((void)0)
+  #define LAF_TRACE_ASYNC_END(name, id)   ((void)0)
+  #define LAF_TRACE_FLOW_BEGIN(name, id)  ((void)0)
+  #define LAF_TRACE_FLOW_STEP(name, id)   ((void)0)
+  #define LAF_TRACE_FLOW_END(name, id)    ((void)0)
+  #define LAF_TRACE_COUNTER(name, value)  ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,158 @@
+// LAF Base Library
+// Copyright (c) 2024 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+// Enable LAF_TRACE_*() macros in this file even if laf was compiled
+// without LAF_WITH_TRACE
+#ifndef LAF_TRACE
+  #define LAF_TRACE 1
+#endif
+
+#include <gtest/gtest.h>
+
+#include "base/thread_pool.h"
+#include "base/trace.h"
+
+#include <sstream>
+#include <string>
+
+using namespace base;
+
+static int count(const std::string& s, const std::string& sub)
+{
+  int n = 0;
+  for (size_t i=s.find(sub); i != std::string::npos; i=s.find(sub, i+1))
+    ++n;
+  return n;
+}
+
+static std::string chrome_trace()
+{
+  std::stringstream s;
+  trace::write_chrome_trace(s);
+  return s.str();
+}
+
+TEST(Trace, DisabledByDefault)
+{
+  trace::clear();
+  {
+    LAF_TRACE_ZONE("NotRecorded");
+    LAF_TRACE_COUNTER("NotRecordedCounter", 1);
+  }
+  const std::string json = chrome_trace();
+  EXPECT_EQ(0, count(json, "NotRecorded"));
+}
+
+TEST(Trace, Zones)
+{
+  trace::clear();
+  trace::start();
+  {
+    LAF_TRACE_ZONE("Outer");
+    for (int i=0; i<3; ++i) {
+      LAF_TRACE_ZONE("Inner");
+      LAF_TRACE_COUNTER("Counter", i);
+    }
+    LAF_TRACE_INSTANT("Instant");
+  }
+  trace::stop();
+
+  const std::string json = chrome_trace();
+  EXPECT_EQ(2, count(json, "\"name\":\"Outer\""));
+  EXPECT_EQ(6, count(json, "\"name\":\"Inner\""));
+  EXPECT_EQ(3, count(json, "\"name\":\"Counter\""));
+  EXPECT_EQ(1, count(json, "\"name\":\"Instant\""));
+  EXPECT_EQ(count(json, "\"ph\":\"B\""),
+            count(json, "\"ph\":\"E\""));
+}
+
+TEST(Trace, AsyncAndFlowsBetweenThreads)
+{
+  trace::clear();
+  trace::start();
+  {
+    thread_pool pool(4);
+    for (int i=0; i<16; ++i) {
+      LAF_TRACE_ASYNC_BEGIN("Job", i);
+      LAF_TRACE_FLOW_BEGIN("Dispatch", i);
+      pool.execute([i]{
+        LAF_TRACE_ZONE("Task");
+        LAF_TRACE_FLOW_END("Dispatch", i);
+        LAF_TRACE_ASYNC_END("Job", i);
+      });
+    }
+    pool.wait_all();
+  }
+  trace::stop();
+
+  const std::string json = chrome_trace();
+  EXPECT_EQ(32, count(json, "\"name\":\"Task\""));
+  EXPECT_EQ(16, count(json, "\"ph\":\"b\""));
+  EXPECT_EQ(16, count(json, "\"ph\":\"e\""));
+  EXPECT_EQ(16, count(json, "\"ph\":\"s\""));
+  EXPECT_EQ(16, count(json, "\"ph\":\"f\""));
+  EXPECT_EQ(0, trace::dropped_events());
+
+  std::stringstream pf;
+  trace::write_perfetto_trace(pf);
+  const std::string data = pf.str();
+  ASSERT_FALSE(data.empty());
+  EXPECT_EQ(0x0a, data[0]);    // Trace.packet field (1, length-delimited)
+  EXPECT_NE(std::string::npos, data.find("Task"));
+}
+
+TEST(Trace, ClearDiscardsEvents)
+{
+  trace::start();
+  { LAF_TRACE_ZONE("BeforeClear"); }
+  trace::clear();
+  { LAF_TRACE_ZONE("AfterClear"); }
+  trace::stop();
+
+  const std::string json = chrome_trace();
+  EXPECT_EQ(0, count(json, "BeforeClear"));
+  EXPECT_EQ(2, count(json, "AfterClear"));
+}
+
+TEST(Trace, ExitedThreads)
+{
+  trace::clear();
+  trace::start();
+  // Workers of short-lived pools exit before the export, their
+  // events are kept until the next clear()
+  for (int i=0; i<8; ++i) {
+    thread_pool pool(2);
+    pool.execute([]{ LAF_TRACE_ZONE("ShortLived"); });
+    pool.wait_all();
+  }
+  trace::stop();
+
+  std::string json = chrome_trace();
+  EXPECT_EQ(16, count(json, "\"name\":\"ShortLived\""));
+  EXPECT_EQ(count(json, "\"ph\":\"B\""),
+            count(json, "\"ph\":\"E\""));
+  // The same events can be exported several times
+  EXPECT_EQ(16, count(chrome_trace(), "\"name\":\"ShortLived\""));
+
+  trace::clear();
+  trace::start();
+  {
+    thread_pool pool(2);
+    pool.execute([]{ LAF_TRACE_ZONE("AfterClear"); });
+    pool.wait_all();
+  }
+  trace::stop();
+
+  json = chrome_trace();
+  EXPECT_EQ(0, count(json, "ShortLived"));
+  EXPECT_EQ(2, count(json, "\"name\":\"AfterClear\""));
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
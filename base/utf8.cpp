@@ -0,0 +1,592 @@
+// LAF Base Library
+// Copyright (c) 2024 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "base/cpu_features.h"
+#include "base/string.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if LAF_HAVE_SSE2
+  #include <immintrin.h>
+#elif LAF_HAVE_NEON
+  #include <arm_neon.h>
+#endif
+
+#ifdef _MSC_VER
+  #include <intrin.h>
+#endif
+
+namespace base {
+
+namespace {
+
+// SIMD kernels only process complete blocks (16 or 32 units) and
+// return the number of processed units, the rest of the input is
+// handled by the scalar code. All kernels stop in the first block
+// that contains a non-ASCII character (or a NUL character for the
+// decoding kernels, as utf8_decode stops there).
+struct Utf8Kernels {
+  // Returns the length of the run of [1, 0x7f] bytes.
+  size_t (*ascii_run)(const uint8_t* src, size_t n);
+  // Converts ASCII bytes to 16/32-bit units.
+  size_t (*widen16)(const uint8_t* src, size_t n, void* dst);
+  size_t (*widen32)(const uint8_t* src, size_t n, void* dst);
+  // Converts 16/32-bit units in the [0, 0x7f] range to bytes.
+  size_t (*narrow16)(const void* src, size_t n, uint8_t* dst);
+  size_t (*narrow32)(const void* src, size_t n, uint8_t* dst);
+};
+
+inline int count_trailing_zeros(uint32_t v)
+{
+#ifdef _MSC_VER
+  unsigned long i;
+  _BitScanForward(&i, v);
+  return int(i);
+#else
+  return __builtin_ctz(v);
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////
+// Scalar (SWAR) fallback
+
+#if !LAF_HAVE_SSE2 && !LAF_HAVE_NEON
+
+size_t ascii_run_scalar(const uint8_t* src, size_t n)
+{
+  constexpr uint64_t kOnes = 0x0101010101010101ull;
+  constexpr uint64_t kHigh = 0x8080808080808080ull;
+  size_t i = 0;
+  for (; i+8 <= n; i += 8) {
+    uint64_t v;
+    std::memcpy(&v, src+i, 8);
+    // High bit set in a byte or a zero byte
+    if ((v | ((v - kOnes) & ~v)) & kHigh)
+      break;
+  }
+  return i;
+}
+
+size_t widen_none(const uint8_t*, size_t, void*) { return 0; }
+size_t narrow_none(const void*, size_t, uint8_t*) { return 0; }
+
+#endif
+
+//////////////////////////////////////////////////////////////////////
+// SSE2 (and AVX2 with runtime dispatch)
+
+#if LAF_HAVE_SSE2
+
+inline int non_ascii_or_nul_mask(__m128i v)
+{
+  return _mm_movemask_epi8(_mm_or_si128(v, _mm_cmpeq_epi8(v, _mm_setzero_si128())));
+}
+
+size_t ascii_run_sse2(const uint8_t* src, size_t n)
+{
+  size_t i = 0;
+  for (; i+16 <= n; i += 16) {
+    const int mask = non_ascii_or_nul_mask(_mm_loadu_si128((const __m128i*)(src+i)));
+    if (mask)
+      return i + count_trailing_zeros(mask);
+  }
+  return i;
+}
+
+size_t widen16_sse2(const uint8_t* src, size_t n, void* dst)
+{
+  const __m128i zero = _mm_setzero_si128();
+  auto out = (__m128i*)dst;
+  size_t i = 0;
+  for (; i+16 <= n; i += 16, out += 2) {
+    const __m128i v = _mm_loadu_si128((const __m128i*)(src+i));
+    if (non_ascii_or_nul_mask(v))
+      break;
+    _mm_storeu_si128(out,   _mm_unpacklo_epi8(v, zero));
+    _mm_storeu_si128(out+1, _mm_unpackhi_epi8(v, zero));
+  }
+  return i;
+}
+
+size_t widen32_sse2(const uint8_t* src, size_t n, void* dst)
+{
+  const __m128i zero = _mm_setzero_si128();
+  auto out = (__m128i*)dst;
+  size_t i = 0;
+  for (; i+16 <= n; i += 16, out += 4) {
+    const __m128i v = _mm_loadu_si128((const __m128i*)(src+i));
+    if (non_ascii_or_nul_mask(v))
+      break;
+    const __m128i lo = _mm_unpacklo_epi8(v, zero);
+    const __m128i hi = _mm_unpackhi_epi8(v, zero);
+    _mm_storeu_si128(out,   _mm_unpacklo_epi16(lo, zero));
+    _mm_storeu_si128(out+1, _mm_unpackhi_epi16(lo, zero));
+    _mm_storeu_si128(out+2, _mm_unpacklo_epi16(hi, zero));
+    _mm_storeu_si128(out+3, _mm_unpackhi_epi16(hi, zero));
+  }
+  return i;
+}
+
+size_t narrow16_sse2(const void* src, size_t n, uint8_t* dst)
+{
+  const __m128i nonAscii = _mm_set1_epi16(int16_t(0xff80));
+  const __m128i zero = _mm_setzero_si128();
+  auto in = (const __m128i*)src;
+  size_t i = 0;
+  for (; i+16 <= n; i += 16, in += 2) {
+    const __m128i a = _mm_loadu_si128(in);
+    const __m128i b = _mm_loadu_si128(in+1);
+    const __m128i high = _mm_and_si128(_mm_or_si128(a, b), nonAscii);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, zero)) != 0xffff)
+      break;
+    _mm_storeu_si128((__m128i*)(dst+i), _mm_packus_epi16(a, b));
+  }
+  return i;
+}
+
+size_t narrow32_sse2(const void* src, size_t n, uint8_t* dst)
+{
+  const __m128i nonAscii = _mm_set1_epi32(int32_t(0xffffff80));
+  const __m128i zero = _mm_setzero_si128();
+  auto in = (const __m128i*)src;
+  size_t i = 0;
+  for (; i+16 <= n; i += 16, in += 4) {
+    const __m128i a = _mm_loadu_si128(in);
+    const __m128i b = _mm_loadu_si128(in+1);
+    const __m128i c = _mm_loadu_si128(in+2);
+    const __m128i d = _mm_loadu_si128(in+3);
+    const __m128i high = _mm_and_si128(
+      _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d)), nonAscii);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(high, zero)) != 0xffff)
+      break;
+    // Values are in [0, 0x7f] so the signed saturation is a no-op
+    _mm_storeu_si128((__m128i*)(dst+i),
+                     _mm_packus_epi16(_mm_packs_epi32(a, b),
+                                      _mm_packs_epi32(c, d)));
+  }
+  return i;
+}
+
+#if LAF_HAVE_X86_DISPATCH
+
+LAF_TARGET("avx2")
+inline uint32_t non_ascii_or_nul_mask_avx2(__m256i v)
+{
+  return uint32_t(_mm256_movemask_epi8(
+    _mm256_or_si256(v, _mm256_cmpeq_epi8(v, _mm256_setzero_si256()))));
+}
+
+LAF_TARGET("avx2")
+size_t ascii_run_avx2(const uint8_t* src, size_t n)
+{
+  size_t i = 0;
+  for (; i+32 <= n; i += 32) {
+    const uint32_t mask = non_ascii_or_nul_mask_avx2(
+      _mm256_loadu_si256((const __m256i*)(src+i)));
+    if (mask)
+      return i + count_trailing_zeros(mask);
+  }
+  return i + ascii_run_sse2(src+i, n-i);
+}
+
+LAF_TARGET("avx2")
+size_t widen16_avx2(const uint8_t* src, size_t n, void* dst)
+{
+  auto out = (__m256i*)dst;
+  size_t i = 0;
+  for (; i+32 <= n; i += 32, out += 2) {
+    const __m256i v = _mm256_loadu_si256((const __m256i*)(src+i));
+    if (non_ascii_or_nul_mask_avx2(v))
+      break;
+    _mm256_storeu_si256(out,   _mm256_cvtepu8_epi16(_mm256_castsi256_si128(v)));
+    _mm256_storeu_si256(out+1, _mm256_cvtepu8_epi16(_mm256_extracti128_si256(v, 1)));
+  }
+  return i;
+}
+
+LAF_TARGET("avx2")
+size_t widen32_avx2(const uint8_t* src, size_t n, void* dst)
+{
+  auto out = (__m256i*)dst;
+  size_t i = 0;
+  for (; i+32 <= n; i += 32, out += 4) {
+    const __m256i v = _mm256_loadu_si256((const __m256i*)(src+i));
+    if (non_ascii_or_nul_mask_avx2(v))
+      break;
+    const __m128i lo = _mm256_castsi256_si128(v);
+    const __m128i hi = _mm256_extracti128_si256(v, 1);
+    _mm256_storeu_si256(out,   _mm256_cvtepu8_epi32(lo));
+    _mm256_storeu_si256(out+1, _mm256_cvtepu8_epi32(_mm_srli_si128(lo, 8)));
+    _mm256_storeu_si256(out+2, _mm256_cvtepu8_epi32(hi));
+    _mm256_storeu_si256(out+3, _mm256_cvtepu8_epi32(_mm_srli_si128(hi, 8)));
+  }
+  return i;
+}
+
+#endif // LAF_HAVE_X86_DISPATCH
+
+#endif // LAF_HAVE_SSE2
+
+//////////////////////////////////////////////////////////////////////
+// NEON
+
+#if LAF_HAVE_NEON
+
+inline bool is_ascii_without_nul(uint8x16_t v)
+{
+  return vmaxvq_u8(v) < 0x80 && vminvq_u8(v) != 0;
+}
+
+size_t ascii_run_neon(const uint8_t* src, size_t n)
+{
+  size_t i = 0;
+  for (; i+16 <= n; i += 16) {
+    if (!is_ascii_without_nul(vld1q_u8(src+i)))
+      break;
+  }
+  return i;
+}
+
+size_t widen16_neon(const uint8_t* src, size_t n, void* dst)
+{
+  auto out = (uint16_t*)dst;
+  size_t i = 0;
+  for (; i+16 <= n; i += 16, out += 16) {
+    const uint8x16_t v = vld1q_u8(src+i);
+    if (!is_ascii_without_nul(v))
+      break;
+    vst1q_u16(out,   vmovl_u8(vget_low_u8(v)));
+    vst1q_u16(out+8, vmovl_u8(vget_high_u8(v)));
+  }
+  return i;
+}
+
+size_t widen32_neon(const uint8_t* src, size_t n, void* dst)
+{
+  auto out = (uint32_t*)dst;
+  size_t i = 0;
+  for (; i+16 <= n; i += 16, out += 16) {
+    const uint8x16_t v = vld1q_u8(src+i);
+    if (!is_ascii_without_nul(v))
+      break;
+    const uint16x8_t lo = vmovl_u8(vget_low_u8(v));
+    const uint16x8_t hi = vmovl_u8(vget_high_u8(v));
+    vst1q_u32(out,    vmovl_u16(vget_low_u16(lo)));
+    vst1q_u32(out+4,  vmovl_u16(vget_high_u16(lo)));
+    vst1q_u32(out+8,  vmovl_u16(vget_low_u16(hi)));
+    vst1q_u32(out+12, vmovl_u16(vget_high_u16(hi)));
+  }
+  return i;
+}
+
+size_t narrow16_neon(const void* src, size_t n, uint8_t* dst)
+{
+  auto in = (const uint16_t*)src;
+  size_t i = 0;
+  for (; i+16 <= n; i += 16, in += 16) {
+    const uint16x8_t a = vld1q_u16(in);
+    const uint16x8_t b = vld1q_u16(in+8);
+    if (vmaxvq_u16(vorrq_u16(a, b)) >= 0x80)
+      break;
+    vst1q_u8(dst+i, vcombine_u8(vmovn_u16(a), vmovn_u16(b)));
+  }
+  return i;
+}
+
+size_t narrow32_neon(const void* src, size_t n, uint8_t* dst)
+{
+  auto in = (const uint32_t*)src;
+  size_t i = 0;
+  for (; i+16 <= n; i += 16, in += 16) {
+    const uint32x4_t a = vld1q_u32(in);
+    const uint32x4_t b = vld1q_u32(in+4);
+    const uint32x4_t c = vld1q_u32(in+8);
+    const uint32x4_t d = vld1q_u32(in+12);
+    if (vmaxvq_u32(vorrq_u32(vorrq_u32(a, b), vorrq_u32(c, d))) >= 0x80)
+      break;
+    const uint16x8_t ab = vcombine_u16(vmovn_u32(a), vmovn_u32(b));
+    const uint16x8_t cd = vcombine_u16(vmovn_u32(c), vmovn_u32(d));
+    vst1q_u8(dst+i, vcombine_u8(vmovn_u16(ab), vmovn_u16(cd)));
+  }
+  return i;
+}
+
+#endif // LAF_HAVE_NEON
+
+Utf8Kernels select_kernels()
+{
+#if LAF_HAVE_X86_DISPATCH
+  if (get_cpu_features().avx2) {
+    return { ascii_run_avx2,
+             widen16_avx2, widen32_avx2,
+             narrow16_sse2, narrow32_sse2 };
+  }
+#endif
+#if LAF_HAVE_SSE2
+  return { ascii_run_sse2,
+           widen16_sse2, widen32_sse2,
+           narrow16_sse2, narrow32_sse2 };
+#elif LAF_HAVE_NEON
+  return { ascii_run_neon,
+           widen16_neon, widen32_neon,
+           narrow16_neon, narrow32_neon };
+#else
+  return { ascii_run_scalar,
+           widen_none, widen_none,
+           narrow_none, narrow_none };
+#endif
+}
+
+const Utf8Kernels& kernels()
+{
+  static const Utf8Kernels k = select_kernels();
+  return k;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Scalar code shared by all implementations
+
+// Decodes one multi-byte sequence (*p >= 0x80) in the same way that
+// utf8_decode::next() does. Returns the number of consumed bytes or 0
+// if the sequence is invalid.
+inline size_t decode_multibyte(const uint8_t* p, const uint8_t* end, uint32_t& cp)
+{
+  uint32_t c = *p;
+  int n = 0;
+  for (int f=0b0100'0000; c & f; f >>= 1)
+    ++n;
+  if (n == 0 || end-p-1 < n)
+    return 0;
+
+  c &= (0b0001'1111 >> (n-1));
+  for (int i=1; i<=n; ++i) {
+    const uint32_t chr = p[i];
+    if ((chr & 0b1100'0000) != 0b1000'0000)
+      return 0;
+    c = (c << 6) | (chr & 0b0011'1111);
+  }
+  cp = c;
+  return n+1;
+}
+
+// Same encoding rules as the old Allegro-based to_utf8()
+// implementation (values above 0x10ffff use 5 or 6 bytes).
+inline size_t encoded_size(uint32_t c)
+{
+  if (c < 0x80) return 1;
+  if (c < 0x800) return 2;
+  if (c < 0x10000) return 3;
+  if (c < 0x200000) return 4;
+  if (c < 0x4000000) return 5;
+  return 6;
+}
+
+inline void encode(uint32_t c, size_t size, uint8_t* dst)
+{
+  if (size == 1) {
+    *dst = uint8_t(c);
+    return;
+  }
+  for (size_t i=size-1; i>0; --i) {
+    dst[i] = uint8_t(0x80 | (c & 0x3f));
+    c >>= 6;
+  }
+  dst[0] = uint8_t((0xff00 >> size) | c);
+}
+
+template<typename Char>
+size_t decode_to(const char* src, const size_t n,
+                 Char* dst, const size_t dst_size)
+{
+  static_assert(sizeof(Char) == 2 || sizeof(Char) == 4);
+  const Utf8Kernels& k = kernels();
+  auto p = (const uint8_t*)src;
+  const auto end = p + n;
+  size_t out = 0;
+
+  while (p < end && out < dst_size) {
+    if (*p < 0x80) {
+      if (*p == 0)
+        break;
+      const size_t m = std::min<size_t>(end-p, dst_size-out);
+      const size_t len = (sizeof(Char) == 2 ? k.widen16(p, m, dst+out):
+                                              k.widen32(p, m, dst+out));
+      p += len;
+      out += len;
+      while (p < end && out < dst_size && *p && *p < 0x80)
+        dst[out++] = Char(*p++);
+      continue;
+    }
+
+    uint32_t cp;
+    const size_t len = decode_multibyte(p, end, cp);
+    if (len == 0 || cp == 0)
+      break;
+
+    if constexpr (sizeof(Char) == 2) {
+      if (cp >= 0x10000) {
+        if (cp > 0x10ffff) {
+          cp = 0xfffd;          // Replacement character
+        }
+        else {
+          if (dst_size-out < 2)
+            break;
+          cp -= 0x10000;
+          dst[out++] = Char(0xd800 | (cp >> 10));
+          dst[out++] = Char(0xdc00 | (cp & 0x3ff));
+          p += len;
+          continue;
+        }
+      }
+    }
+    dst[out++] = Char(cp);
+    p += len;
+  }
+  return out;
+}
+
+template<typename Char>
+size_t encode_from(const Char* src, const size_t n,
+                   char* dst, const size_t dst_size)
+{
+  static_assert(sizeof(Char) == 2 || sizeof(Char) == 4);
+  using Unit = std::conditional_t<sizeof(Char) == 2, uint16_t, uint32_t>;
+  const Utf8Kernels& k = kernels();
+  auto out = (uint8_t*)dst;
+  size_t size = 0;
+
+  for (size_t i=0; i<n; ) {
+    uint32_t c = Unit(src[i]);
+    if (dst && c < 0x80) {
+      const size_t m = std::min(n-i, dst_size-size);
+      const size_t len = (sizeof(Char) == 2 ? k.narrow16(src+i, m, out+size):
+                                              k.narrow32(src+i, m, out+size));
+      i += len;
+      size += len;
+      if (len > 0)
+        continue;
+    }
+
+    size_t units = 1;
+    if constexpr (sizeof(Char) == 2) {
+      // Combine surrogate pairs (lone surrogates are encoded as is)
+      if (c >= 0xd800 && c < 0xdc00 && i+1 < n) {
+        const uint32_t c2 = Unit(src[i+1]);
+        if (c2 >= 0xdc00 && c2 < 0xe000) {
+          c = 0x10000 + ((c - 0xd800) << 10) + (c2 - 0xdc00);
+          units = 2;
+        }
+      }
+    }
+
+    const size_t len = encoded_size(c);
+    if (dst) {
+      if (dst_size-size < len)
+        break;
+      encode(c, len, out+size);
+    }
+    size += len;
+    i += units;
+  }
+  return size;
+}
+
+} // anonymous namespace
+
+size_t utf8_length(const char* src, const size_t n)
+{
+  const Utf8Kernels& k = kernels();
+  auto p = (const uint8_t*)src;
+  const auto end = p + n;
+  size_t count = 0;
+
+  while (p < end) {
+    if (*p < 0x80) {
+      if (*p == 0)
+        break;
+      size_t len = k.ascii_run(p, end-p);
+      while (p+len < end && p[len] && p[len] < 0x80)
+        ++len;
+      p += len;
+      count += len;
+      continue;
+    }
+
+    uint32_t cp;
+    const size_t len = decode_multibyte(p, end, cp);
+    if (len == 0 || cp == 0)
+      break;
+    p += len;
+    ++count;
+  }
+  return count;
+}
+
+bool utf8_is_valid(const char* src, const size_t n)
+{
+  const Utf8Kernels& k = kernels();
+  auto p = (const uint8_t*)src;
+  const auto end = p + n;
+
+  while (p < end) {
+    const uint8_t c = *p;
+    if (c < 0x80) {
+      p += (c ? std::max<size_t>(k.ascii_run(p, end-p), 1): 1);
+      continue;
+    }
+
+    // Valid ranges for the second byte (RFC 3629, section 4)
+    size_t len;
+    uint8_t lo = 0x80, hi = 0xbf;
+    if (c >= 0xc2 && c <= 0xdf) len = 2;
+    else if (c == 0xe0) { len = 3; lo = 0xa0; }
+    else if (c >= 0xe1 && c <= 0xec) len = 3;
+    else if (c == 0xed) { len = 3; hi = 0x9f; }
+    else if (c >= 0xee && c <= 0xef) len = 3;
+    else if (c == 0xf0) { len = 4; lo = 0x90; }
+    else if (c >= 0xf1 && c <= 0xf3) len = 4;
+    else if (c == 0xf4) { len = 4; hi = 0x8f; }
+    else
+      return false;
+
+    if (size_t(end-p) < len || p[1] < lo || p[1] > hi)
+      return false;
+    for (size_t i=2; i<len; ++i) {
+      if ((p[i] & 0b1100'0000) != 0b1000'0000)
+        return false;
+    }
+    p += len;
+  }
+  return true;
+}
+
+size_t utf8_to_utf32(const char* src, size_t n, char32_t* dst, size_t dst_size)
+{
+  return decode_to(src, n, dst, dst_size);
+}
+
+size_t utf8_to_wchar(const char* src, size_t n, wchar_t* dst, size_t dst_size)
+{
+  return decode_to(src, n, dst, dst_size);
+}
+
+size_t utf32_to_utf8(const char32_t* src, size_t n, char* dst, size_t dst_size)
+{
+  return encode_from(src, n, dst, dst_size);
+}
+
+size_t wchar_to_utf8(const wchar_t* src, size_t n, char* dst, size_t dst_size)
+{
+  return encode_from(src, n, dst, dst_size);
+}
+
+} // namespace base
@@ -0,0 +1,354 @@
+// LAF Benchmarks
+// Copyright (c) 2024 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+// Enable LAF_TRACE_*() macros to measure the cost of a zone even if
+// laf was compiled without LAF_WITH_TRACE
+#ifndef LAF_TRACE
+  #define LAF_TRACE 1
+#endif
+
+#include "benchmarks/benchmark.h"
+
+#include "base/base64.h"
+#include "base/buffer.h"
+#include "base/concurrent_queue.h"
+#include "base/convert_to.h"
+#include "base/serialization.h"
+#include "base/sha1.h"
+#include "base/split_string.h"
+#include "base/string.h"
+#include "base/thread_pool.h"
+#include "base/trace.h"
+#include "base/utf8_decode.h"
+
+#include <atomic>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Generates "n" bytes of UTF-8 text where "percent" of the characters
+// are non-ASCII (2, 3 and 4 bytes sequences).
+std::string make_utf8_text(size_t n, int percent)
+{
+  static const char* kNonAscii[] = {
+    "\xC2\xA9",                 // ©
+    "\xE6\xBC\xA2",             // 漢
+    "\xF0\x9F\x98\x80",         // 😀
+  };
+  std::mt19937 rng(42);
+  std::string text;
+  text.reserve(n+4);
+  while (text.size() < n) {
+    if (int(rng() % 100) < percent)
+      text += kNonAscii[rng() % 3];
+    else
+      text.push_back(char('a' + rng() % 26));
+  }
+  return text;
+}
+
+base::buffer make_random_buffer(size_t n)
+{
+  std::mt19937 rng(42);
+  base::buffer buf(n);
+  for (auto& b : buf)
+    b = uint8_t(rng());
+  return buf;
+}
+
+} // anonymous namespace
+
+//////////////////////////////////////////////////////////////////////
+// base::thread_pool
+
+static void BM_ThreadPoolExecute(benchmark::State& state)
+{
+  const int kTasks = 1000;
+  base::thread_pool pool(state.range(0));
+  std::atomic<int> counter(0);
+  for (auto _ : state) {
+    for (int i=0; i<kTasks; ++i)
+      pool.execute([&counter]{ ++counter; });
+    pool.wait_all();
+  }
+  benchmark::DoNotOptimize(counter.load());
+  state.SetItemsProcessed(state.iterations() * kTasks);
+}
+BENCHMARK(BM_ThreadPoolExecute)->Arg(1)->Arg(2)->Arg(4)->Arg(8);
+
+//////////////////////////////////////////////////////////////////////
+// base::concurrent_queue
+
+static void BM_ConcurrentQueuePushPop(benchmark::State& state)
+{
+  const int kItems = 1000;
+  base::concurrent_queue<int> queue;
+  int value = 0;
+  for (auto _ : state) {
+    for (int i=0; i<kItems; ++i)
+      queue.push(i);
+    while (queue.try_pop(value))
+      benchmark::DoNotOptimize(value);
+  }
+  state.SetItemsProcessed(state.iterations() * kItems);
+}
+BENCHMARK(BM_ConcurrentQueuePushPop);
+
+// One producer thread and the main thread as consumer.
+static void BM_ConcurrentQueueProducerConsumer(benchmark::State& state)
+{
+  const int kItems = 10000;
+  base::concurrent_queue<int> queue;
+  for (auto _ : state) {
+    std::thread producer([&queue]{
+      for (int i=0; i<kItems; ++i)
+        queue.push(i);
+    });
+    int received = 0, value = 0;
+    while (received < kItems) {
+      if (queue.try_pop(value))
+        ++received;
+    }
+    producer.join();
+  }
+  state.SetItemsProcessed(state.iterations() * kItems);
+}
+BENCHMARK(BM_ConcurrentQueueProducerConsumer)->Unit(benchmark::kMicrosecond);
+
+//////////////////////////////////////////////////////////////////////
+// base64
+
+static void BM_Base64Encode(benchmark::State& state)
+{
+  const base::buffer input = make_random_buffer(state.range(0));
+  std::string output;
+  for (auto _ : state) {
+    base::encode_base64(input, output);
+    benchmark::DoNotOptimize(output.data());
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_Base64Encode)->Arg(64)->Arg(4096)->Arg(1 << 20);
+
+static void BM_Base64Decode(benchmark::State& state)
+{
+  const std::string input =
+    base::encode_base64(make_random_buffer(state.range(0)));
+  base::buffer output;
+  for (auto _ : state) {
+    base::decode_base64(input, output);
+    benchmark::DoNotOptimize(output.data());
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_Base64Decode)->Arg(64)->Arg(4096)->Arg(1 << 20);
+
+//////////////////////////////////////////////////////////////////////
+// base::Sha1
+
+static void BM_Sha1(benchmark::State& state)
+{
+  const base::buffer buf = make_random_buffer(state.range(0));
+  const std::string input(buf.begin(), buf.end());
+  for (auto _ : state) {
+    base::Sha1 sha1 = base::Sha1::calculateFromString(input);
+    benchmark::DoNotOptimize(sha1[0]);
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_Sha1)->Arg(64)->Arg(4096)->Arg(1 << 20);
+
+//////////////////////////////////////////////////////////////////////
+// UTF-8 decoding
+//
+// state.range(0) is the percentage of non-ASCII characters.
+
+static void BM_Utf8Decode(benchmark::State& state)
+{
+  const std::string text = make_utf8_text(1 << 16, state.range(0));
+  for (auto _ : state) {
+    base::utf8_decode decode(text);
+    int sum = 0;
+    while (int chr = decode.next())
+      sum += chr;
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_Utf8Decode)->Arg(0)->Arg(10)->Arg(100);
+
+static void BM_Utf8Length(benchmark::State& state)
+{
+  const std::string text = make_utf8_text(1 << 16, state.range(0));
+  for (auto _ : state)
+    benchmark::DoNotOptimize(base::utf8_length(text.data(), text.size()));
+  state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_Utf8Length)->Arg(0)->Arg(10)->Arg(100);
+
+static void BM_Utf8ToUtf32(benchmark::State& state)
+{
+  const std::string text = make_utf8_text(1 << 16, state.range(0));
+  std::vector<char32_t> output(text.size());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+      base::utf8_to_utf32(text.data(), text.size(),
+                          output.data(), output.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_Utf8ToUtf32)->Arg(0)->Arg(10)->Arg(100);
+
+static void BM_FromUtf8(benchmark::State& state)
+{
+  const std::string text = make_utf8_text(1 << 16, state.range(0));
+  for (auto _ : state) {
+    std::wstring wide = base::from_utf8(text);
+    benchmark::DoNotOptimize(wide.data());
+  }
+  state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_FromUtf8)->Arg(0)->Arg(10)->Arg(100);
+
+//////////////////////////////////////////////////////////////////////
+// Parsing of a CSV-like palette export
+
+namespace {
+
+std::string make_csv_text()
+{
+  std::string text;
+  for (int i=0; i<20000; ++i) {
+    text += base::convert_to<std::string>(i % 256) + "," +
+            base::convert_to<std::string>((i*3) % 256) + "," +
+            base::convert_to<std::string>((i*7) % 256) + ",1.5\n";
+  }
+  return text;
+}
+
+} // anonymous namespace
+
+static void BM_ParseCsvSplitString(benchmark::State& state)
+{
+  const std::string text = make_csv_text();
+  std::vector<std::string> lines, fields;
+  for (auto _ : state) {
+    double sum = 0.0;
+    lines.clear();
+    base::split_string(text, lines, "\n");
+    for (const auto& line : lines) {
+      fields.clear();
+      base::split_string(line, fields, ",");
+      for (const auto& field : fields)
+        sum += base::convert_to<double>(field);
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_ParseCsvSplitString)->Unit(benchmark::kMillisecond);
+
+static void BM_ParseCsvSplitStringView(benchmark::State& state)
+{
+  const std::string text = make_csv_text();
+  for (auto _ : state) {
+    double sum = 0.0;
+    for (std::string_view line : base::split_string_view(text, "\n")) {
+      for (std::string_view field : base::split_string_view(line, ","))
+        sum += base::convert_to<double>(field);
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_ParseCsvSplitStringView)->Unit(benchmark::kMillisecond);
+
+//////////////////////////////////////////////////////////////////////
+// base::serialization
+//
+// Big endian writes of 32-bit values (one byte swap per value).
+
+static void BM_SerializationStreamWrite32(benchmark::State& state)
+{
+  const int n = state.range(0);
+  for (auto _ : state) {
+    std::ostringstream os;
+    for (int i=0; i<n; ++i)
+      base::serialization::big_endian::write32(os, uint32_t(i));
+    benchmark::DoNotOptimize(os.tellp());
+  }
+  state.SetBytesProcessed(state.iterations() * n * 4);
+}
+BENCHMARK(BM_SerializationStreamWrite32)->Arg(1 << 16);
+
+static void BM_SerializationOStreamWriterWrite32(benchmark::State& state)
+{
+  std::vector<uint32_t> values(state.range(0));
+  for (size_t i=0; i<values.size(); ++i)
+    values[i] = uint32_t(i);
+  for (auto _ : state) {
+    std::ostringstream os;
+    {
+      base::serialization::ostream_writer w(
+        os, base::serialization::byte_order::big_endian);
+      w.write32(values.data(), values.size());
+    }
+    benchmark::DoNotOptimize(os.tellp());
+  }
+  state.SetBytesProcessed(state.iterations() * values.size() * 4);
+}
+BENCHMARK(BM_SerializationOStreamWriterWrite32)->Arg(1 << 16);
+
+static void BM_SerializationReaderRead32(benchmark::State& state)
+{
+  base::buffer buf;
+  base::serialization::buffer_writer w(
+    buf, base::serialization::byte_order::big_endian);
+  for (int i=0; i<state.range(0); ++i)
+    w.write32(uint32_t(i));
+
+  std::vector<uint32_t> values(state.range(0));
+  for (auto _ : state) {
+    base::serialization::buffer_reader r(
+      buf, base::serialization::byte_order::big_endian);
+    r.read32(values.data(), values.size());
+    benchmark::DoNotOptimize(values.data());
+  }
+  state.SetBytesProcessed(state.iterations() * buf.size());
+}
+BENCHMARK(BM_SerializationReaderRead32)->Arg(1 << 16);
+
+//////////////////////////////////////////////////////////////////////
+// base::trace
+
+// Cost of one zone (begin and end events) while recording. It should
+// be less than 20ns.
+static void BM_TraceZone(benchmark::State& state)
+{
+  const int kZones = 1000;
+  base::trace::clear();
+  base::trace::start();
+  for (auto _ : state) {
+    for (int i=0; i<kZones; ++i) {
+      LAF_TRACE_ZONE("BM_TraceZone");
+    }
+    state.PauseTiming();
+    base::trace::clear();
+    state.ResumeTiming();
+  }
+  base::trace::stop();
+  base::trace::clear();
+  state.SetItemsProcessed(state.iterations() * kZones);
+}
+BENCHMARK(BM_TraceZone);
@@ -0,0 +1,588 @@
+// LAF Benchmarks
+// Copyright (c) 2024 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "benchmarks/benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <regex>
+#include <thread>
+
+namespace benchmark {
+
+namespace {
+
+// Command line options
+struct Options {
+  std::string filter;
+  double minTime = 0.5;         // Seconds
+  int64_t minIters = 0;         // Fixed number of iterations (e.g. "10x")
+  int repetitions = 1;
+  std::string out;
+  std::string format = "console";
+  bool listTests = false;
+};
+
+Options g_options;
+
+std::vector<std::unique_ptr<Benchmark>>& benchmarks()
+{
+  static std::vector<std::unique_ptr<Benchmark>> list;
+  return list;
+}
+
+double real_now()
+{
+  return std::chrono::duration<double>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Process CPU time (including all threads on POSIX systems).
+double cpu_now()
+{
+  return double(std::clock()) / CLOCKS_PER_SEC;
+}
+
+const char* unit_name(TimeUnit unit)
+{
+  switch (unit) {
+    case kMicrosecond: return "us";
+    case kMillisecond: return "ms";
+    default:           return "ns";
+  }
+}
+
+double unit_multiplier(TimeUnit unit)
+{
+  switch (unit) {
+    case kMicrosecond: return 1e6;
+    case kMillisecond: return 1e3;
+    default:           return 1e9;
+  }
+}
+
+std::string json_escape(const std::string& s)
+{
+  std::string r;
+  for (char c : s) {
+    switch (c) {
+      case '"':  r += "\\\""; break;
+      case '\\': r += "\\\\"; break;
+      case '\n': r += "\\n"; break;
+      default:
+        if (uint8_t(c) < 0x20) {
+          char buf[8];
+          std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+          r += buf;
+        }
+        else
+          r.push_back(c);
+        break;
+    }
+  }
+  return r;
+}
+
+// Result of one repetition of a benchmark (or an aggregate of
+// several repetitions).
+struct Run {
+  std::string runName;
+  std::string aggregate;        // "mean", "median", "stddev", or empty
+  int repetitionIndex = 0;
+  int64_t iterations = 0;
+  double realTime = 0.0;        // Per iteration in "unit"
+  double cpuTime = 0.0;
+  TimeUnit unit = kNanosecond;
+  double bytesPerSecond = 0.0;
+  double itemsPerSecond = 0.0;
+  std::string label;
+  std::string error;
+
+  std::string name() const {
+    return (aggregate.empty() ? runName: runName + "_" + aggregate);
+  }
+};
+
+bool parse_flag(const char* arg, const char* flag, std::string& value)
+{
+  const size_t n = std::strlen(flag);
+  if (std::strncmp(arg, flag, n) != 0)
+    return false;
+  if (arg[n] == '=')
+    value = arg+n+1;
+  else if (arg[n] == 0)
+    value = "true";
+  else
+    return false;
+  return true;
+}
+
+bool is_true(const std::string& value)
+{
+  return (value == "true" || value == "1" || value == "yes");
+}
+
+bool matches_filter(const std::string& name)
+{
+  std::string filter = g_options.filter;
+  if (filter.empty() || filter == "all" || filter == ".")
+    return true;
+
+  bool negative = false;
+  if (filter[0] == '-') {
+    negative = true;
+    filter.erase(0, 1);
+  }
+  const bool found = std::regex_search(name, std::regex(filter));
+  return (negative ? !found: found);
+}
+
+} // anonymous namespace
+
+//////////////////////////////////////////////////////////////////////
+// State
+
+State::State(int64_t maxIterations, const std::vector<int64_t>& args)
+  : m_maxIterations(maxIterations)
+  , m_args(args)
+{
+}
+
+void State::PauseTiming()
+{
+  if (m_running) {
+    m_realTime += real_now() - m_realStart;
+    m_cpuTime += cpu_now() - m_cpuStart;
+    m_running = false;
+  }
+}
+
+void State::ResumeTiming()
+{
+  if (!m_running) {
+    m_realStart = real_now();
+    m_cpuStart = cpu_now();
+    m_running = true;
+  }
+}
+
+void State::startKeepRunning()
+{
+  ResumeTiming();
+}
+
+void State::finishKeepRunning()
+{
+  PauseTiming();
+}
+
+//////////////////////////////////////////////////////////////////////
+// Benchmark
+
+Benchmark::Benchmark(const char* name, Function func)
+  : m_name(name)
+  , m_func(func)
+{
+}
+
+Benchmark* Benchmark::Arg(int64_t x)
+{
+  m_args.push_back(x);
+  return this;
+}
+
+Benchmark* Benchmark::Range(int64_t lo, int64_t hi)
+{
+  for (int64_t x=lo; x<hi; x*=m_rangeMultiplier) {
+    m_args.push_back(x);
+    if (x <= 0)
+      break;
+  }
+  m_args.push_back(hi);
+  return this;
+}
+
+Benchmark* Benchmark::RangeMultiplier(int multiplier)
+{
+  m_rangeMultiplier = std::max(2, multiplier);
+  return this;
+}
+
+Benchmark* Benchmark::Unit(TimeUnit unit)
+{
+  m_unit = unit;
+  return this;
+}
+
+Benchmark* RegisterBenchmark(const char* name, Function func)
+{
+  benchmarks().push_back(std::make_unique<Benchmark>(name, func));
+  return benchmarks().back().get();
+}
+
+//////////////////////////////////////////////////////////////////////
+// Runner
+
+class Runner {
+public:
+  // Runs the benchmark once with the given number of iterations.
+  static Run runOnce(const Benchmark& b,
+                     const std::vector<int64_t>& args,
+                     const int64_t iters) {
+    State state(iters, args);
+    b.function()(state);
+    state.PauseTiming();
+
+    Run run;
+    run.iterations = iters;
+    run.unit = b.unit();
+    run.label = state.m_label;
+    if (state.m_error) {
+      run.error = state.m_error;
+      return run;
+    }
+
+    // Total seconds, converted to time per iteration in finish()
+    run.realTime = state.m_realTime;
+    run.cpuTime = state.m_cpuTime;
+    if (state.m_realTime > 0.0) {
+      run.bytesPerSecond = state.m_bytes / state.m_realTime;
+      run.itemsPerSecond = state.m_items / state.m_realTime;
+    }
+    return run;
+  }
+
+  // Converts total seconds to time per iteration in the run unit.
+  static void finish(Run& run) {
+    const double mult = unit_multiplier(run.unit);
+    if (run.iterations > 0) {
+      run.realTime = run.realTime * mult / run.iterations;
+      run.cpuTime = run.cpuTime * mult / run.iterations;
+    }
+  }
+
+  // Runs all repetitions of the given benchmark instance, the number
+  // of iterations is increased until the run takes --benchmark_min_time.
+  static void run(const Benchmark& b,
+                  const std::string& runName,
+                  const std::vector<int64_t>& args,
+                  std::vector<Run>& results) {
+    const int64_t kMaxIters = 1000000000;
+    int64_t iters = (g_options.minIters > 0 ? g_options.minIters: 1);
+    Run run;
+    while (true) {
+      run = runOnce(b, args, iters);
+      if (!run.error.empty() ||
+          g_options.minIters > 0 ||
+          run.realTime >= g_options.minTime ||
+          iters >= kMaxIters)
+        break;
+
+      // Predict the number of iterations needed (like Google
+      // Benchmark, with a 40% margin), or multiply by 10 if the
+      // last run was too short to be significant.
+      double mult = 10.0;
+      if (run.realTime / g_options.minTime > 0.1)
+        mult = g_options.minTime * 1.4 / std::max(run.realTime, 1e-9);
+      iters = std::min(kMaxIters,
+                       std::max(int64_t(mult * iters), iters+1));
+    }
+
+    std::vector<Run> reps;
+    for (int i=0; i<g_options.repetitions; ++i) {
+      if (i > 0)
+        run = runOnce(b, args, iters);
+      run.runName = runName;
+      run.repetitionIndex = i;
+      finish(run);
+      reps.push_back(run);
+      if (!run.error.empty())
+        break;
+    }
+    results.insert(results.end(), reps.begin(), reps.end());
+
+    if (reps.size() > 1 && reps[0].error.empty())
+      addAggregates(reps, results);
+  }
+
+private:
+  static void addAggregates(const std::vector<Run>& reps,
+                            std::vector<Run>& results) {
+    auto aggregate = [&reps](const char* name, auto&& func) {
+      Run r = reps[0];
+      r.aggregate = name;
+      r.realTime = func([](const Run& r){ return r.realTime; });
+      r.cpuTime = func([](const Run& r){ return r.cpuTime; });
+      r.bytesPerSecond = func([](const Run& r){ return r.bytesPerSecond; });
+      r.itemsPerSecond = func([](const Run& r){ return r.itemsPerSecond; });
+      return r;
+    };
+    auto mean = [&reps](auto&& field) {
+      double sum = 0.0;
+      for (const auto& r : reps)
+        sum += field(r);
+      return sum / reps.size();
+    };
+    auto median = [&reps](auto&& field) {
+      std::vector<double> v;
+      for (const auto& r : reps)
+        v.push_back(field(r));
+      std::sort(v.begin(), v.end());
+      const size_t n = v.size();
+      return (n & 1 ? v[n/2]: (v[n/2-1] + v[n/2]) / 2.0);
+    };
+    auto stddev = [&reps, &mean](auto&& field) {
+      const double m = mean(field);
+      double sum = 0.0;
+      for (const auto& r : reps)
+        sum += (field(r) - m) * (field(r) - m);
+      return std::sqrt(sum / (reps.size() - 1));
+    };
+    results.push_back(aggregate("mean", mean));
+    results.push_back(aggregate("median", median));
+    results.push_back(aggregate("stddev", stddev));
+  }
+};
+
+//////////////////////////////////////////////////////////////////////
+// Reporters
+
+namespace {
+
+void print_console_header()
+{
+  std::printf("%-48s %15s %15s %12s\n", "Benchmark", "Time", "CPU", "Iterations");
+  std::printf("%s\n", std::string(93, '-').c_str());
+}
+
+void print_console_run(const Run& run)
+{
+  const std::string name = run.name();
+  if (!run.error.empty()) {
+    std::printf("%-48s ERROR OCCURRED: '%s'\n",
+                name.c_str(), run.error.c_str());
+    return;
+  }
+
+  std::printf("%-48s %12.1f %-2s %12.1f %-2s %12lld",
+              name.c_str(),
+              run.realTime, unit_name(run.unit),
+              run.cpuTime, unit_name(run.unit),
+              (long long)run.iterations);
+  if (run.bytesPerSecond > 0.0)
+    std::printf(" %10.2fMiB/s", run.bytesPerSecond / 1024.0 / 1024.0);
+  if (run.itemsPerSecond > 0.0)
+    std::printf(" %10.3fM items/s", run.itemsPerSecond / 1e6);
+  if (!run.label.empty())
+    std::printf(" %s", run.label.c_str());
+  std::printf("\n");
+  std::fflush(stdout);
+}
+
+void write_json(std::ostream& os, const std::vector<Run>& results)
+{
+  char date[64] = "";
+  const std::time_t now = std::time(nullptr);
+  std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+  os << "{\n"
+     << "  \"context\": {\n"
+     << "    \"date\": \"" << date << "\",\n"
+     << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n"
+#ifdef NDEBUG
+     << "    \"library_build_type\": \"release\"\n"
+#else
+     << "    \"library_build_type\": \"debug\"\n"
+#endif
+     << "  },\n"
+     << "  \"benchmarks\": [";
+
+  // Enough digits to compare results between runs
+  os.precision(10);
+
+  bool first = true;
+  for (const Run& run : results) {
+    os << (first ? "\n": ",\n") << "    {\n"
+       << "      \"name\": \"" << json_escape(run.name()) << "\",\n"
+       << "      \"run_name\": \"" << json_escape(run.runName) << "\",\n"
+       << "      \"run_type\": \"" << (run.aggregate.empty() ? "iteration": "aggregate") << "\",\n"
+       << "      \"repetitions\": " << g_options.repetitions << ",\n";
+    if (run.aggregate.empty())
+      os << "      \"repetition_index\": " << run.repetitionIndex << ",\n";
+    else
+      os << "      \"aggregate_name\": \"" << run.aggregate << "\",\n";
+    os << "      \"threads\": 1,\n";
+    if (!run.error.empty()) {
+      os << "      \"error_occurred\": true,\n"
+         << "      \"error_message\": \"" << json_escape(run.error) << "\"\n";
+    }
+    else {
+      os << "      \"iterations\": " << run.iterations << ",\n"
+         << "      \"real_time\": " << run.realTime << ",\n"
+         << "      \"cpu_time\": " << run.cpuTime << ",\n"
+         << "      \"time_unit\": \"" << unit_name(run.unit) << "\"";
+      if (run.bytesPerSecond > 0.0)
+        os << ",\n      \"bytes_per_second\": " << run.bytesPerSecond;
+      if (run.itemsPerSecond > 0.0)
+        os << ",\n      \"items_per_second\": " << run.itemsPerSecond;
+      if (!run.label.empty())
+        os << ",\n      \"label\": \"" << json_escape(run.label) << "\"";
+      os << "\n";
+    }
+    os << "    }";
+    first = false;
+  }
+  os << "\n  ]\n}\n";
+}
+
+void print_usage(const char* argv0)
+{
+  std::printf(
+    "Usage: %s [options]\n"
+    "  --benchmark_list_tests               Only list benchmark names\n"
+    "  --benchmark_filter=<regex>           Run matching benchmarks (\"-<regex>\" to exclude)\n"
+    "  --benchmark_min_time=<N>[s|x]        Minimum seconds (or iterations) per benchmark\n"
+    "  --benchmark_repetitions=<N>          Repeat each benchmark N times (adds mean/median/stddev)\n"
+    "  --benchmark_format=<console|json>    Format of the standard output\n"
+    "  --benchmark_out=<filename>           Save the results to a JSON file\n",
+    argv0);
+}
+
+} // anonymous namespace
+
+bool Initialize(int* argc, char** argv)
+{
+  bool ok = true;
+  int j = 1;
+  for (int i=1; i<*argc; ++i) {
+    const char* arg = argv[i];
+    std::string value;
+    if (parse_flag(arg, "--benchmark_filter", value))
+      g_options.filter = value;
+    else if (parse_flag(arg, "--benchmark_min_time", value)) {
+      if (!value.empty() && value.back() == 'x') {
+        g_options.minIters = std::max<int64_t>(1, std::atoll(value.c_str()));
+      }
+      else {
+        if (!value.empty() && value.back() == 's')
+          value.pop_back();
+        g_options.minTime = std::max(0.0, std::atof(value.c_str()));
+        g_options.minIters = 0;
+      }
+    }
+    else if (parse_flag(arg, "--benchmark_repetitions", value))
+      g_options.repetitions = std::max(1, std::atoi(value.c_str()));
+    else if (parse_flag(arg, "--benchmark_out", value))
+      g_options.out = value;
+    else if (parse_flag(arg, "--benchmark_out_format", value)) {
+      if (value != "json") {
+        std::fprintf(stderr, "Only JSON output files are supported\n");
+        ok = false;
+      }
+    }
+    else if (parse_flag(arg, "--benchmark_format", value)) {
+      if (value != "console" && value != "json") {
+        std::fprintf(stderr, "Invalid --benchmark_format: %s\n", value.c_str());
+        ok = false;
+      }
+      g_options.format = value;
+    }
+    else if (parse_flag(arg, "--benchmark_list_tests", value))
+      g_options.listTests = is_true(value);
+    else if (std::strcmp(arg, "--help") == 0 ||
+             std::strcmp(arg, "-h") == 0) {
+      print_usage(argv[0]);
+      std::exit(0);
+    }
+    else {
+      // Keep unknown arguments in argv
+      argv[j++] = argv[i];
+      if (std::strncmp(arg, "--benchmark_", 12) == 0) {
+        std::fprintf(stderr, "Unknown flag: %s\n", arg);
+        ok = false;
+      }
+    }
+  }
+  *argc = j;
+  return ok;
+}
+
+int RunSpecifiedBenchmarks()
+{
+  const bool console = (g_options.format == "console");
+  std::vector<Run> results;
+
+  if (console && !g_options.listTests)
+    print_console_header();
+
+  for (const auto& b : benchmarks()) {
+    std::vector<std::vector<int64_t>> instances;
+    if (b->args().empty())
+      instances.push_back({});
+    else {
+      for (int64_t arg : b->args())
+        instances.push_back({ arg });
+    }
+
+    for (const auto& args : instances) {
+      std::string runName = b->name();
+      for (int64_t arg : args)
+        runName += "/" + std::to_string(arg);
+
+      if (!matches_filter(runName))
+        continue;
+
+      if (g_options.listTests) {
+        std::printf("%s\n", runName.c_str());
+        continue;
+      }
+
+      const size_t first = results.size();
+      Runner::run(*b, runName, args, results);
+      if (console) {
+        for (size_t i=first; i<results.size(); ++i)
+          print_console_run(results[i]);
+      }
+    }
+  }
+
+  if (g_options.listTests)
+    return 0;
+
+  if (!console)
+    write_json(std::cout, results);
+
+  if (!g_options.out.empty()) {
+    std::ofstream f(g_options.out, std::ios::binary);
+    if (!f) {
+      std::fprintf(stderr, "Cannot write %s\n", g_options.out.c_str());
+      return 1;
+    }
+    write_json(f, results);
+  }
+  return 0;
+}
+
+} // namespace benchmark
+
+int main(int argc, char** argv)
+{
+  if (!benchmark::Initialize(&argc, argv))
+    return 1;
+  return benchmark::RunSpecifiedBenchmarks();
+}
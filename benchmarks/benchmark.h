@@ -0,0 +1,184 @@
+// LAF Benchmarks
+// Copyright (c) 2024 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef LAF_BENCHMARKS_BENCHMARK_H_INCLUDED
+#define LAF_BENCHMARKS_BENCHMARK_H_INCLUDED
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#if _MSC_VER
+  #include <intrin.h>
+#endif
+
+// Minimal microbenchmark harness used by the laf_benchmarks target.
+//
+// The API is a small subset of Google Benchmark
+// (https://github.com/google/benchmark) with the same names, command
+// line flags (--benchmark_filter, --benchmark_min_time,
+// --benchmark_repetitions, --benchmark_out, etc.) and JSON output,
+// so the tools for one work with the other. E.g.
+//
+//   static void BM_Something(benchmark::State& state) {
+//     Data data(state.range(0));
+//     for (auto _ : state)
+//       benchmark::DoNotOptimize(process(data));
+//     state.SetBytesProcessed(state.iterations() * data.size());
+//   }
+//   BENCHMARK(BM_Something)->Arg(1024)->Arg(65536);
+
+namespace benchmark {
+
+  enum TimeUnit { kNanosecond, kMicrosecond, kMillisecond };
+
+  class State {
+  public:
+    // Type of the loop variable ("_"). It has a user-provided
+    // constructor/destructor so compilers don't warn about an unused
+    // variable.
+    struct Value {
+      Value() { }
+      ~Value() { }
+    };
+
+    class Iterator {
+    public:
+      Iterator() : m_state(nullptr), m_remaining(0) { }
+      explicit Iterator(State* state)
+        : m_state(state)
+        , m_remaining(state->m_error ? 0: state->m_maxIterations) { }
+
+      Value operator*() const { return Value(); }
+      Iterator& operator++() { --m_remaining; return *this; }
+
+      bool operator!=(const Iterator&) {
+        if (m_remaining > 0)
+          return true;
+        m_state->finishKeepRunning();
+        return false;
+      }
+
+    private:
+      State* m_state;
+      int64_t m_remaining;
+    };
+
+    State(int64_t maxIterations, const std::vector<int64_t>& args);
+
+    Iterator begin() {
+      startKeepRunning();
+      return Iterator(this);
+    }
+    Iterator end() { return Iterator(); }
+
+    int64_t range(size_t i = 0) const { return m_args[i]; }
+    int64_t iterations() const { return m_maxIterations; }
+
+    // Excludes setup code inside the loop from the measured time.
+    void PauseTiming();
+    void ResumeTiming();
+
+    // Reports a throughput (bytes/items per second of real time).
+    void SetBytesProcessed(int64_t bytes) { m_bytes = bytes; }
+    void SetItemsProcessed(int64_t items) { m_items = items; }
+
+    void SetLabel(const std::string& label) { m_label = label; }
+
+    // Stops the benchmark (call it before the loop) and reports the
+    // given error message (e.g. a required file wasn't found).
+    void SkipWithError(const char* msg) { m_error = msg; }
+
+  private:
+    void startKeepRunning();
+    void finishKeepRunning();
+
+    int64_t m_maxIterations;
+    std::vector<int64_t> m_args;
+    bool m_running = false;
+    double m_realStart = 0.0;
+    double m_cpuStart = 0.0;
+    double m_realTime = 0.0;
+    double m_cpuTime = 0.0;
+    int64_t m_bytes = 0;
+    int64_t m_items = 0;
+    std::string m_label;
+    const char* m_error = nullptr;
+
+    friend class Runner;
+  };
+
+  typedef void (*Function)(State&);
+
+  class Benchmark {
+  public:
+    Benchmark(const char* name, Function func);
+
+    // Each Arg() call adds a new run with the given state.range(0).
+    Benchmark* Arg(int64_t x);
+
+    // Adds runs for lo, lo*mult, lo*mult^2... and hi (with the
+    // multiplier specified in RangeMultiplier(), 8 by default).
+    Benchmark* Range(int64_t lo, int64_t hi);
+    Benchmark* RangeMultiplier(int multiplier);
+
+    // Time unit used to report the time per iteration.
+    Benchmark* Unit(TimeUnit unit);
+
+    const std::string& name() const { return m_name; }
+    Function function() const { return m_func; }
+    const std::vector<int64_t>& args() const { return m_args; }
+    TimeUnit unit() const { return m_unit; }
+
+  private:
+    std::string m_name;
+    Function m_func;
+    std::vector<int64_t> m_args;
+    int m_rangeMultiplier = 8;
+    TimeUnit m_unit = kNanosecond;
+  };
+
+  Benchmark* RegisterBenchmark(const char* name, Function func);
+
+  // Parses the --benchmark_* flags (removing them from argv) and runs
+  // the registered benchmarks. Initialize() returns false if there
+  // are unknown arguments.
+  bool Initialize(int* argc, char** argv);
+  int RunSpecifiedBenchmarks();
+
+  // Prevents the compiler from optimizing away the given value or
+  // the memory writes done before this call.
+#if _MSC_VER
+  template<typename T>
+  inline void DoNotOptimize(const T& value) {
+    const volatile char* volatile ptr = (const volatile char*)&value;
+    (void)*ptr;
+    _ReadWriteBarrier();
+  }
+  inline void ClobberMemory() { _ReadWriteBarrier(); }
+#else
+  template<typename T>
+  inline void DoNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+  }
+  template<typename T>
+  inline void DoNotOptimize(T& value) {
+    asm volatile("" : "+r,m"(value) : : "memory");
+  }
+  inline void ClobberMemory() { asm volatile("" : : : "memory"); }
+#endif
+
+} // namespace benchmark
+
+#define BENCHMARK_CONCAT_(a, b) a##b
+#define BENCHMARK_CONCAT(a, b) BENCHMARK_CONCAT_(a, b)
+
+#define BENCHMARK(func)                                         \
+  static benchmark::Benchmark* BENCHMARK_CONCAT(benchmark_, __LINE__) = \
+    (benchmark::RegisterBenchmark(#func, func))
+
+#endif
@@ -0,0 +1,91 @@
+#! /usr/bin/env python3
+# LAF Benchmarks
+# Copyright (c) 2024 Igara Studio S.A.
+#
+# Compares two JSON files generated with
+#
+#   laf_benchmarks --benchmark_out=result.json [--benchmark_repetitions=N]
+#
+# and reports the benchmarks that are slower (or faster) than the
+# given threshold. Returns 1 if there are regressions, so it can be
+# used in CI. When the results include repetitions, the median is
+# compared. E.g.
+#
+#   compare.py baseline.json contender.json --threshold 5
+
+import argparse
+import json
+import sys
+
+def load_results(filename, metric):
+    with open(filename) as f:
+        data = json.load(f)
+
+    medians = {}
+    iterations = {}
+    for b in data.get('benchmarks', []):
+        if b.get('error_occurred'):
+            continue
+        name = b.get('run_name', b['name'])
+        if b.get('run_type') == 'aggregate':
+            if b.get('aggregate_name') == 'median':
+                medians[name] = b
+        else:
+            iterations.setdefault(name, []).append(b)
+
+    results = {}
+    for name, runs in iterations.items():
+        if name in medians:
+            b = medians[name]
+        else:
+            runs = sorted(runs, key=lambda b: b[metric])
+            b = runs[len(runs) // 2]
+        results[name] = (b[metric], b.get('time_unit', 'ns'))
+    return results
+
+def to_ns(value, unit):
+    return value * { 'ns': 1, 'us': 1e3, 'ms': 1e6, 's': 1e9 }[unit]
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Compare two laf_benchmarks JSON results')
+    parser.add_argument('baseline')
+    parser.add_argument('contender')
+    parser.add_argument('-t', '--threshold', type=float, default=5.0,
+                        help='percentage of change to report (default: 5)')
+    parser.add_argument('-m', '--metric', default='real_time',
+                        choices=['real_time', 'cpu_time'],
+                        help='time to compare (default: real_time)')
+    args = parser.parse_args()
+
+    old = load_results(args.baseline, args.metric)
+    new = load_results(args.contender, args.metric)
+
+    regressions = 0
+    print('%-56s %14s %14s %9s' % ('Benchmark', 'Baseline', 'Contender', 'Change'))
+    print('-' * 96)
+    for name in old:
+        if name not in new:
+            continue
+        a = to_ns(*old[name])
+        b = to_ns(*new[name])
+        change = (b - a) / a * 100.0 if a > 0 else 0.0
+        if change > args.threshold:
+            status = 'REGRESSION'
+            regressions += 1
+        elif change < -args.threshold:
+            status = 'improvement'
+        else:
+            status = ''
+        print('%-56s %12.1fns %12.1fns %+8.1f%% %s' % (name, a, b, change, status))
+
+    for name in sorted(set(old) ^ set(new)):
+        print('%-56s only in %s' % (name, 'baseline' if name in old else 'contender'))
+
+    if regressions:
+        print('\n%d benchmark(s) regressed more than %g%%' % (regressions, args.threshold))
+        return 1
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main())
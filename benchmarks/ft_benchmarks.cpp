@@ -0,0 +1,110 @@
+// LAF Benchmarks
+// Copyright (c) 2024 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "benchmarks/benchmark.h"
+
+#include "base/fs.h"
+#include "ft/algorithm.h"
+#include "ft/hb_face.h"
+#include "ft/lib.h"
+
+#include <cstdlib>
+#include <string>
+
+namespace {
+
+// Font used to measure text, it can be specified with the
+// LAF_BENCHMARK_FONT environment variable.
+std::string find_font()
+{
+  if (const char* env = std::getenv("LAF_BENCHMARK_FONT"))
+    return env;
+
+  static const char* kCandidates[] = {
+    "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf",
+    "/usr/share/fonts/TTF/DejaVuSans.ttf",
+    "/usr/share/fonts/dejavu/DejaVuSans.ttf",
+    "/usr/share/fonts/truetype/liberation/LiberationSans-Regular.ttf",
+    "/System/Library/Fonts/Supplemental/Arial.ttf",
+    "/Library/Fonts/Arial.ttf",
+    "C:/Windows/Fonts/arial.ttf",
+  };
+  for (const char* fn : kCandidates) {
+    if (base::is_file(fn))
+      return fn;
+  }
+  return std::string();
+}
+
+const char* kText =
+  "The quick brown fox jumps over the lazy dog. "
+  "Pack my box with five dozen liquor jugs. "
+  "Sphinx of black quartz, judge my vow! 0123456789";
+
+template<typename Shaper>
+void measure_text(benchmark::State& state, const bool metricsOnly = false)
+{
+  const std::string fontFile = find_font();
+  if (fontFile.empty()) {
+    state.SkipWithError("font not found (set LAF_BENCHMARK_FONT)");
+    return;
+  }
+
+  ft::Lib lib;
+  ft::Face face(lib.open(fontFile));
+  if (!face.isValid()) {
+    state.SkipWithError("cannot open font");
+    return;
+  }
+  face.setSize(state.range(0));
+  face.setAntialias(true);
+
+  const std::string text(kText);
+  for (auto _ : state) {
+    gfx::Rect bounds;
+    ft::ForEachGlyph<ft::Face, Shaper> feg(face, text, metricsOnly);
+    while (feg.next()) {
+      if (auto glyph = feg.glyph())
+        bounds |= gfx::Rect(int(glyph->x), int(glyph->y),
+                            glyph->bitmap->width,
+                            glyph->bitmap->rows);
+    }
+    benchmark::DoNotOptimize(bounds.w);
+  }
+  state.SetItemsProcessed(state.iterations() * text.size());
+}
+
+} // anonymous namespace
+
+//////////////////////////////////////////////////////////////////////
+// Text measurement through ft::ForEachGlyph
+//
+// state.range(0) is the font size in pixels.
+
+static void BM_FtForEachGlyphDefaultShaper(benchmark::State& state)
+{
+  measure_text<ft::DefaultShaper<ft::Face>>(state);
+}
+BENCHMARK(BM_FtForEachGlyphDefaultShaper)->Arg(12)->Arg(32)
+  ->Unit(benchmark::kMicrosecond);
+
+static void BM_FtForEachGlyphHBShaper(benchmark::State& state)
+{
+  measure_text<ft::HBShaper<ft::Face>>(state);
+}
+BENCHMARK(BM_FtForEachGlyphHBShaper)->Arg(12)->Arg(32)
+  ->Unit(benchmark::kMicrosecond);
+
+static void BM_FtForEachGlyphMetricsOnly(benchmark::State& state)
+{
+  measure_text<ft::HBShaper<ft::Face>>(state, true);
+}
+BENCHMARK(BM_FtForEachGlyphMetricsOnly)->Arg(12)->Arg(32)
+  ->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,612 @@
+// LAF Benchmarks
+// Copyright (c) 2024 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "benchmarks/benchmark.h"
+
+#include "base/thread_pool.h"
+#include "gfx/atlas_allocator.h"
+#include "gfx/color_transform.h"
+#include "gfx/hsl.h"
+#include "gfx/hsv.h"
+#include "gfx/hsv_hsl_bulk.h"
+#include "gfx/rect_index.h"
+#include "gfx/rgb.h"
+
+#if LAF_WITH_REGION
+  #include "base/task.h"
+  #include "gfx/packing_rects.h"
+  #include "gfx/point.h"
+  #include "gfx/region.h"
+  #include "gfx/size.h"
+#endif
+
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+std::vector<gfx::Rgb> make_random_colors(int n)
+{
+  std::mt19937 rng(42);
+  std::vector<gfx::Rgb> colors;
+  colors.reserve(n);
+  for (int i=0; i<n; ++i)
+    colors.emplace_back(rng() % 256, rng() % 256, rng() % 256);
+  return colors;
+}
+
+} // anonymous namespace
+
+//////////////////////////////////////////////////////////////////////
+// HSV/HSL conversions
+
+static void BM_RgbToHsv(benchmark::State& state)
+{
+  const std::vector<gfx::Rgb> colors = make_random_colors(4096);
+  for (auto _ : state) {
+    double sum = 0.0;
+    for (const auto& rgb : colors)
+      sum += gfx::Hsv(rgb).hue();
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * colors.size());
+}
+BENCHMARK(BM_RgbToHsv);
+
+static void BM_HsvToRgb(benchmark::State& state)
+{
+  std::vector<gfx::Hsv> colors;
+  for (const auto& rgb : make_random_colors(4096))
+    colors.emplace_back(rgb);
+  for (auto _ : state) {
+    int sum = 0;
+    for (const auto& hsv : colors)
+      sum += gfx::Rgb(hsv).red();
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * colors.size());
+}
+BENCHMARK(BM_HsvToRgb);
+
+static void BM_RgbToHsl(benchmark::State& state)
+{
+  const std::vector<gfx::Rgb> colors = make_random_colors(4096);
+  for (auto _ : state) {
+    double sum = 0.0;
+    for (const auto& rgb : colors)
+      sum += gfx::Hsl(rgb).hue();
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * colors.size());
+}
+BENCHMARK(BM_RgbToHsl);
+
+static void BM_HslToRgb(benchmark::State& state)
+{
+  std::vector<gfx::Hsl> colors;
+  for (const auto& rgb : make_random_colors(4096))
+    colors.emplace_back(rgb);
+  for (auto _ : state) {
+    int sum = 0;
+    for (const auto& hsl : colors)
+      sum += gfx::Rgb(hsl).red();
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * colors.size());
+}
+BENCHMARK(BM_HslToRgb);
+
+// Bulk conversions of a 1024x1024 image, state.range(0) is the
+// number of threads (0 to convert the image in the calling thread).
+
+namespace {
+
+std::vector<gfx::Color> make_random_image()
+{
+  std::vector<gfx::Color> pixels;
+  for (const auto& rgb : make_random_colors(1 << 20))
+    pixels.push_back(gfx::rgba(rgb.red(), rgb.green(), rgb.blue()));
+  return pixels;
+}
+
+} // anonymous namespace
+
+static void BM_RgbaToHsvBulk(benchmark::State& state)
+{
+  const std::vector<gfx::Color> pixels = make_random_image();
+  const size_t n = pixels.size();
+  std::vector<float> h(n), s(n), v(n);
+  std::unique_ptr<base::thread_pool> pool;
+  if (state.range(0) > 0)
+    pool = std::make_unique<base::thread_pool>(state.range(0));
+  for (auto _ : state) {
+    if (pool)
+      gfx::rgba_to_hsv(pixels.data(), n, h.data(), s.data(), v.data(), *pool, 1024);
+    else
+      gfx::rgba_to_hsv(pixels.data(), n, h.data(), s.data(), v.data());
+    benchmark::DoNotOptimize(h.data());
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_RgbaToHsvBulk)->Arg(0)->Arg(4)->Unit(benchmark::kMicrosecond);
+
+static void BM_HsvToRgbaBulk(benchmark::State& state)
+{
+  std::vector<gfx::Color> pixels = make_random_image();
+  const size_t n = pixels.size();
+  std::vector<float> h(n), s(n), v(n);
+  gfx::rgba_to_hsv(pixels.data(), n, h.data(), s.data(), v.data());
+  std::unique_ptr<base::thread_pool> pool;
+  if (state.range(0) > 0)
+    pool = std::make_unique<base::thread_pool>(state.range(0));
+  for (auto _ : state) {
+    if (pool)
+      gfx::hsv_to_rgba(h.data(), s.data(), v.data(), n, pixels.data(), *pool, 1024);
+    else
+      gfx::hsv_to_rgba(h.data(), s.data(), v.data(), n, pixels.data());
+    benchmark::DoNotOptimize(pixels.data());
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_HsvToRgbaBulk)->Arg(0)->Arg(4)->Unit(benchmark::kMicrosecond);
+
+static void BM_RgbaToHslBulk(benchmark::State& state)
+{
+  const std::vector<gfx::Color> pixels = make_random_image();
+  const size_t n = pixels.size();
+  std::vector<float> h(n), s(n), l(n);
+  for (auto _ : state) {
+    gfx::rgba_to_hsl(pixels.data(), n, h.data(), s.data(), l.data());
+    benchmark::DoNotOptimize(h.data());
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_RgbaToHslBulk)->Unit(benchmark::kMicrosecond);
+
+static void BM_HslToRgbaBulk(benchmark::State& state)
+{
+  std::vector<gfx::Color> pixels = make_random_image();
+  const size_t n = pixels.size();
+  std::vector<float> h(n), s(n), l(n);
+  gfx::rgba_to_hsl(pixels.data(), n, h.data(), s.data(), l.data());
+  for (auto _ : state) {
+    gfx::hsl_to_rgba(h.data(), s.data(), l.data(), n, pixels.data());
+    benchmark::DoNotOptimize(pixels.data());
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_HslToRgbaBulk)->Unit(benchmark::kMicrosecond);
+
+// Converts a 3840x2160 image from sRGB to Display P3
+static void BM_ColorTransformSRGBToP3(benchmark::State& state)
+{
+  const gfx::ColorSpacePrimaries displayP3 = {
+    0.680f, 0.320f, 0.265f, 0.690f, 0.150f, 0.060f, 0.3127f, 0.3290f
+  };
+  const auto transform =
+    gfx::ColorTransform::Make(gfx::ColorSpace::MakeSRGB(),
+                              gfx::ColorSpace::MakeRGBWithSRGBGamma(displayP3));
+  std::mt19937 rng(42);
+  std::vector<uint32_t> src(3840 * 2160);
+  for (auto& p : src)
+    p = rng();
+  std::vector<uint32_t> dst(src.size());
+  for (auto _ : state) {
+    transform->convertRgba(dst.data(), src.data(), int(src.size()));
+    benchmark::DoNotOptimize(dst.data());
+  }
+  state.SetItemsProcessed(state.iterations() * src.size());
+}
+BENCHMARK(BM_ColorTransformSRGBToP3)->Unit(benchmark::kMillisecond);
+
+// Same image converting chunks of rows in a thread pool with
+// state.range(0) threads
+static void BM_ColorTransformSRGBToP3Threads(benchmark::State& state)
+{
+  const gfx::ColorSpacePrimaries displayP3 = {
+    0.680f, 0.320f, 0.265f, 0.690f, 0.150f, 0.060f, 0.3127f, 0.3290f
+  };
+  const auto transform =
+    gfx::ColorTransform::Make(gfx::ColorSpace::MakeSRGB(),
+                              gfx::ColorSpace::MakeRGBWithSRGBGamma(displayP3));
+  std::mt19937 rng(42);
+  std::vector<uint32_t> src(3840 * 2160);
+  for (auto& p : src)
+    p = rng();
+  std::vector<uint32_t> dst(src.size());
+  base::thread_pool pool(state.range(0));
+  for (auto _ : state) {
+    transform->convertRgba(dst.data(), src.data(), int(src.size()), pool, 3840);
+    benchmark::DoNotOptimize(dst.data());
+  }
+  state.SetItemsProcessed(state.iterations() * src.size());
+}
+BENCHMARK(BM_ColorTransformSRGBToP3Threads)->Arg(2)->Arg(4)->Arg(8)
+  ->Unit(benchmark::kMillisecond);
+
+#if LAF_WITH_REGION
+
+//////////////////////////////////////////////////////////////////////
+// gfx::Region
+//
+// state.range(0) is the number of rectangles. The label of each
+// result is the gfx::Region implementation, to compare the native
+// one with Pixman/Skia, build two times (with and without
+// LAF_WITH_NATIVE_REGION) and use compare.py with both results.
+
+namespace {
+
+const char* region_impl()
+{
+#if LAF_NATIVE_REGION
+  return "native";
+#elif LAF_SKIA
+  return "skia";
+#elif LAF_PIXMAN
+  return "pixman";
+#else
+  return "";
+#endif
+}
+
+// Random rectangles (that can overlap) inside a 1024x1024 area.
+std::vector<gfx::Rect> make_random_rects(int n, int maxSize)
+{
+  std::mt19937 rng(42);
+  std::vector<gfx::Rect> rects;
+  rects.reserve(n);
+  for (int i=0; i<n; ++i) {
+    rects.emplace_back(rng() % 1024, rng() % 1024,
+                       1 + rng() % maxSize, 1 + rng() % maxSize);
+  }
+  return rects;
+}
+
+} // anonymous namespace
+
+// Common case of clipping/invalidation code (regions with a few
+// rectangles).
+static void BM_RegionSmallOps(benchmark::State& state)
+{
+  const auto rects = make_random_rects(256, 512);
+  const gfx::Region clip(gfx::Rect(128, 128, 512, 512));
+  for (auto _ : state) {
+    size_t n = 0;
+    for (size_t i=0; i+1<rects.size(); i+=2) {
+      gfx::Region rgn(rects[i]);
+      rgn |= gfx::Region(rects[i+1]);
+      rgn &= clip;
+      n += rgn.size();
+    }
+    benchmark::DoNotOptimize(n);
+  }
+  state.SetItemsProcessed(state.iterations() * rects.size() / 2);
+  state.SetLabel(region_impl());
+}
+BENCHMARK(BM_RegionSmallOps);
+
+static void BM_RegionUnion(benchmark::State& state)
+{
+  const auto rects = make_random_rects(state.range(0), 64);
+  for (auto _ : state) {
+    gfx::Region rgn;
+    for (const auto& rc : rects)
+      rgn |= gfx::Region(rc);
+    benchmark::DoNotOptimize(rgn.size());
+  }
+  state.SetItemsProcessed(state.iterations() * rects.size());
+  state.SetLabel(region_impl());
+}
+BENCHMARK(BM_RegionUnion)->Arg(16)->Arg(256)->Arg(1024);
+
+static void BM_RegionSubtract(benchmark::State& state)
+{
+  const auto rects = make_random_rects(state.range(0), 64);
+  for (auto _ : state) {
+    gfx::Region rgn(gfx::Rect(0, 0, 1024, 1024));
+    for (const auto& rc : rects)
+      rgn -= gfx::Region(rc);
+    benchmark::DoNotOptimize(rgn.size());
+  }
+  state.SetItemsProcessed(state.iterations() * rects.size());
+  state.SetLabel(region_impl());
+}
+BENCHMARK(BM_RegionSubtract)->Arg(16)->Arg(256)->Arg(1024);
+
+static void BM_RegionContainsPoint(benchmark::State& state)
+{
+  gfx::Region rgn;
+  for (const auto& rc : make_random_rects(state.range(0), 64))
+    rgn |= gfx::Region(rc);
+
+  std::mt19937 rng(42);
+  std::vector<gfx::Point> points;
+  for (int i=0; i<1024; ++i)
+    points.emplace_back(rng() % 1100, rng() % 1100);
+
+  for (auto _ : state) {
+    int count = 0;
+    for (const auto& pt : points)
+      count += (rgn.contains(pt) ? 1: 0);
+    benchmark::DoNotOptimize(count);
+  }
+  state.SetItemsProcessed(state.iterations() * points.size());
+  state.SetLabel(region_impl());
+}
+BENCHMARK(BM_RegionContainsPoint)->Arg(16)->Arg(256)->Arg(1024);
+
+static void BM_RegionContainsRect(benchmark::State& state)
+{
+  gfx::Region rgn;
+  for (const auto& rc : make_random_rects(state.range(0), 64))
+    rgn |= gfx::Region(rc);
+
+  const auto rects = make_random_rects(1024, 32);
+  for (auto _ : state) {
+    int count = 0;
+    for (const auto& rc : rects)
+      count += int(rgn.contains(rc));
+    benchmark::DoNotOptimize(count);
+  }
+  state.SetItemsProcessed(state.iterations() * rects.size());
+  state.SetLabel(region_impl());
+}
+BENCHMARK(BM_RegionContainsRect)->Arg(16)->Arg(256)->Arg(1024);
+
+//////////////////////////////////////////////////////////////////////
+// gfx::PackingRects
+
+namespace {
+
+void pack_rects(benchmark::State& state,
+                gfx::PackingRects::Algorithm algorithm)
+{
+  std::mt19937 rng(42);
+  std::vector<gfx::Size> sizes;
+  for (int i=0; i<state.range(0); ++i)
+    sizes.emplace_back(4 + rng() % 60, 4 + rng() % 60);
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    gfx::PackingRects pr(0, 0, algorithm);
+    for (const auto& sz : sizes)
+      pr.add(sz);
+    base::task_token token;
+    state.ResumeTiming();
+
+    benchmark::DoNotOptimize(pr.pack(gfx::Size(2048, 2048), token));
+  }
+  state.SetItemsProcessed(state.iterations() * sizes.size());
+}
+
+} // anonymous namespace
+
+static void BM_PackingRectsPack(benchmark::State& state)
+{
+  pack_rects(state, gfx::PackingRects::Algorithm::Region);
+}
+BENCHMARK(BM_PackingRectsPack)->Arg(16)->Arg(64)->Arg(128)
+  ->Unit(benchmark::kMicrosecond);
+
+static void BM_PackingRectsPackSkyline(benchmark::State& state)
+{
+  pack_rects(state, gfx::PackingRects::Algorithm::SkylineBottomLeft);
+}
+BENCHMARK(BM_PackingRectsPackSkyline)->Arg(128)->Arg(1024)->Arg(2048)
+  ->Unit(benchmark::kMicrosecond);
+
+static void BM_PackingRectsPackMaxRectsBSSF(benchmark::State& state)
+{
+  pack_rects(state, gfx::PackingRects::Algorithm::MaxRectsBestShortSideFit);
+}
+BENCHMARK(BM_PackingRectsPackMaxRectsBSSF)->Arg(128)->Arg(1024)->Arg(2048)
+  ->Unit(benchmark::kMicrosecond);
+
+static void BM_PackingRectsPackMaxRectsBAF(benchmark::State& state)
+{
+  pack_rects(state, gfx::PackingRects::Algorithm::MaxRectsBestAreaFit);
+}
+BENCHMARK(BM_PackingRectsPackMaxRectsBAF)->Arg(128)->Arg(1024)->Arg(2048)
+  ->Unit(benchmark::kMicrosecond);
+
+static void BM_PackingRectsPackGuillotine(benchmark::State& state)
+{
+  pack_rects(state, gfx::PackingRects::Algorithm::Guillotine);
+}
+BENCHMARK(BM_PackingRectsPackGuillotine)->Arg(128)->Arg(1024)->Arg(2048)
+  ->Unit(benchmark::kMicrosecond);
+
+namespace {
+
+void best_fit(benchmark::State& state,
+              gfx::PackingRects::Algorithm algorithm)
+{
+  std::mt19937 rng(42);
+  std::vector<gfx::Size> sizes;
+  for (int i=0; i<state.range(0); ++i)
+    sizes.emplace_back(4 + rng() % 60, 4 + rng() % 60);
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    gfx::PackingRects pr(0, 0, algorithm);
+    for (const auto& sz : sizes)
+      pr.add(sz);
+    base::task_token token;
+    state.ResumeTiming();
+
+    benchmark::DoNotOptimize(pr.bestFit(token).w);
+  }
+  state.SetItemsProcessed(state.iterations() * sizes.size());
+}
+
+} // anonymous namespace
+
+static void BM_PackingRectsBestFit(benchmark::State& state)
+{
+  best_fit(state, gfx::PackingRects::Algorithm::Region);
+}
+BENCHMARK(BM_PackingRectsBestFit)->Arg(16)->Arg(64)
+  ->Unit(benchmark::kMillisecond);
+
+static void BM_PackingRectsBestFitMaxRects(benchmark::State& state)
+{
+  best_fit(state, gfx::PackingRects::Algorithm::MaxRectsBestShortSideFit);
+}
+BENCHMARK(BM_PackingRectsBestFitMaxRects)->Arg(64)->Arg(512)->Arg(2048)
+  ->Unit(benchmark::kMillisecond);
+
+#endif // LAF_WITH_REGION
+
+//////////////////////////////////////////////////////////////////////
+// gfx::AtlasAllocator
+//
+// Glyph cache like usage: random sizes are allocated and freed in a
+// 2048x2048 texture keeping state.range(0) live allocations.
+
+static void BM_AtlasAllocatorChurn(benchmark::State& state)
+{
+  const int kOps = 10000;
+  std::mt19937 rng(42);
+  std::vector<gfx::Size> sizes(kOps);
+  for (auto& sz : sizes)
+    sz = gfx::Size(4 + rng() % 28, 8 + rng() % 24);
+
+  for (auto _ : state) {
+    gfx::AtlasAllocator atlas(gfx::Size(2048, 2048));
+    std::vector<gfx::AtlasAllocator::Id> ids;
+    ids.reserve(state.range(0));
+    for (int i=0; i<kOps; ++i) {
+      if (int(ids.size()) >= state.range(0)) {
+        const size_t j = rng() % ids.size();
+        atlas.free(ids[j]);
+        ids[j] = ids.back();
+        ids.pop_back();
+      }
+      const auto id = atlas.allocate(sizes[i]);
+      if (id != gfx::AtlasAllocator::kNoId)
+        ids.push_back(id);
+    }
+    benchmark::DoNotOptimize(atlas.occupancy());
+  }
+  state.SetItemsProcessed(state.iterations() * kOps);
+}
+BENCHMARK(BM_AtlasAllocatorChurn)->Arg(256)->Arg(4096)
+  ->Unit(benchmark::kMicrosecond);
+
+static void BM_AtlasAllocatorCompact(benchmark::State& state)
+{
+  std::mt19937 rng(42);
+  gfx::AtlasAllocator atlas(gfx::Size(2048, 2048));
+  std::vector<gfx::AtlasAllocator::Id> ids;
+  for (int i=0; i<state.range(0); ++i)
+    ids.push_back(atlas.allocate(gfx::Size(4 + rng() % 28, 8 + rng() % 24)));
+  for (size_t i=0; i<ids.size(); i += 2)
+    atlas.free(ids[i]);
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    gfx::AtlasAllocator copy = atlas;
+    state.ResumeTiming();
+
+    benchmark::DoNotOptimize(copy.compact().size());
+  }
+  state.SetItemsProcessed(state.iterations() * atlas.allocationCount());
+}
+BENCHMARK(BM_AtlasAllocatorCompact)->Arg(1024)->Arg(8192)
+  ->Unit(benchmark::kMicrosecond);
+
+//////////////////////////////////////////////////////////////////////
+// gfx::RectIndex
+//
+// state.range(0) widget-sized rectangles in a 4096x4096 area, each
+// iteration hit-tests 256 points (and compares it with a linear
+// search of the same rectangles).
+
+namespace {
+
+std::vector<gfx::Rect> make_random_rects(int n)
+{
+  std::mt19937 rng(42);
+  std::vector<gfx::Rect> rects(n);
+  for (auto& rc : rects)
+    rc = gfx::Rect(rng() % 4096, rng() % 4096, 8 + rng() % 120, 8 + rng() % 40);
+  return rects;
+}
+
+std::vector<gfx::Point> make_random_points()
+{
+  std::mt19937 rng(1);
+  std::vector<gfx::Point> points(256);
+  for (auto& pt : points)
+    pt = gfx::Point(rng() % 4096, rng() % 4096);
+  return points;
+}
+
+} // anonymous namespace
+
+static void BM_RectIndexHitTest(benchmark::State& state)
+{
+  const std::vector<gfx::Rect> rects = make_random_rects(state.range(0));
+  const std::vector<gfx::Point> points = make_random_points();
+  gfx::RectIndex<int> index;
+  for (int i=0; i<int(rects.size()); ++i)
+    index.insert(rects[i], i);
+  index.build();
+
+  for (auto _ : state) {
+    int hits = 0;
+    for (const auto& pt : points)
+      index.forEach(pt, [&hits](gfx::RectIndex<int>::Id, int){ ++hits; });
+    benchmark::DoNotOptimize(hits);
+  }
+  state.SetItemsProcessed(state.iterations() * points.size());
+}
+BENCHMARK(BM_RectIndexHitTest)->Arg(1000)->Arg(10000)->Arg(100000)
+  ->Unit(benchmark::kMicrosecond);
+
+static void BM_RectLinearHitTest(benchmark::State& state)
+{
+  const std::vector<gfx::Rect> rects = make_random_rects(state.range(0));
+  const std::vector<gfx::Point> points = make_random_points();
+
+  for (auto _ : state) {
+    int hits = 0;
+    for (const auto& pt : points)
+      for (const auto& rc : rects)
+        hits += (rc.contains(pt) ? 1: 0);
+    benchmark::DoNotOptimize(hits);
+  }
+  state.SetItemsProcessed(state.iterations() * points.size());
+}
+BENCHMARK(BM_RectLinearHitTest)->Arg(1000)->Arg(10000)->Arg(100000)
+  ->Unit(benchmark::kMicrosecond);
+
+static void BM_RectIndexMove(benchmark::State& state)
+{
+  const std::vector<gfx::Rect> rects = make_random_rects(state.range(0));
+  std::mt19937 rng(42);
+  gfx::RectIndex<int> index;
+  for (int i=0; i<int(rects.size()); ++i)
+    index.insert(rects[i], i);
+  index.build();
+
+  for (auto _ : state) {
+    // Move all rectangles a little (e.g. animated sprites)
+    for (int i=0; i<int(rects.size()); ++i) {
+      gfx::Rect rc = index.bounds(i);
+      rc.offset(int(rng() % 5) - 2, int(rng() % 5) - 2);
+      index.move(i, rc);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * rects.size());
+}
+BENCHMARK(BM_RectIndexMove)->Arg(1000)->Arg(10000)
+  ->Unit(benchmark::kMicrosecond);
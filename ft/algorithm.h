@@ -1,5 +1,5 @@
 // LAF FreeType Wrapper
-// Copyright (c) 2022 Igara Studio S.A.
+// Copyright (c) 2022-2024 Igara Studio S.A.
 // Copyright (c) 2016-2017 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -13,7 +13,9 @@
 #include "base/utf8_decode.h"
 #include "ft/freetype_headers.h"
 #include "ft/hb_shaper.h"
+#include "gfx/point.h"
 #include "gfx/rect.h"
+#include "gfx/size.h"
 
 namespace ft {
 
@@ -51,8 +53,8 @@ namespace ft {
     }
 
     void glyphAdvanceXY(const Glyph* glyph, double& x, double& y) {
-      x += glyph->ft_glyph->advance.x / double(1 << 16);
-      y += glyph->ft_glyph->advance.y / double(1 << 16);
+      x += glyph->advance.x / double(1 << 16);
+      y += glyph->advance.y / double(1 << 16);
     }
 
   private:
@@ -69,12 +71,17 @@ namespace ft {
   public:
     typedef typename FaceFT::Glyph Glyph;
 
-    ForEachGlyph(FaceFT& face, const std::string& str)
+    // If "metricsOnly" is true, glyphs are not rendered (their
+    // bitmaps have the size of the rendered glyph but no pixels),
+    // useful to measure text.
+    ForEachGlyph(FaceFT& face, const std::string& str,
+                 const bool metricsOnly = false)
       : m_face(face)
       , m_shaper(face, str)
       , m_glyph(nullptr)
       , m_useKerning(FT_HAS_KERNING(((FT_Face)face)) ? true: false)
       , m_prevGlyph(0)
+      , m_metricsOnly(metricsOnly)
       , m_x(0.0), m_y(0.0) {
     }
 
@@ -113,9 +120,11 @@ namespace ft {
       unloadGlyph();
 
       // Load new glyph
-      m_glyph = m_face.cache().loadGlyph(m_face, glyphIndex, m_face.antialias());
+      if (m_metricsOnly)
+        m_glyph = m_face.cache().loadGlyphMetrics(m_face, glyphIndex, m_face.antialias());
+      else
+        m_glyph = m_face.cache().loadGlyph(m_face, glyphIndex, m_face.antialias());
       if (m_glyph) {
-        m_glyph->bitmap = &FT_BitmapGlyph(m_glyph->ft_glyph)->bitmap;
         m_glyph->x = m_x
           + m_glyph->bearingX;
         m_glyph->y = m_y
@@ -144,13 +153,14 @@ namespace ft {
     Glyph* m_glyph;
     bool m_useKerning;
     FT_UInt m_prevGlyph;
+    bool m_metricsOnly;
     double m_x, m_y;
   };
 
   template<typename FaceFT>
   gfx::Rect calc_text_bounds(FaceFT& face, const std::string& str) {
     gfx::Rect bounds(0, 0, 0, 0);
-    ForEachGlyph<FaceFT> feg(face, str);
+    ForEachGlyph<FaceFT> feg(face, str, true);
     while (feg.next()) {
       if (auto glyph = feg.glyph())
         bounds |= gfx::Rect(int(glyph->x),
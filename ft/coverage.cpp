@@ -0,0 +1,79 @@
+// LAF FreeType Wrapper
+// Copyright (c) 2024 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include "ft/coverage.h"
+
+#include <algorithm>
+
+namespace ft {
+
+Coverage::Coverage()
+  : m_index(kIndexSize, kEmptyPage)
+  , m_pages(2)
+{
+  std::fill(std::begin(m_pages[kEmptyPage].bits),
+            std::end(m_pages[kEmptyPage].bits), 0);
+  std::fill(std::begin(m_pages[kFullPage].bits),
+            std::end(m_pages[kFullPage].bits), ~uint64_t(0));
+}
+
+Coverage::Coverage(FT_Face face)
+  : Coverage()
+{
+  if (!face)
+    return;
+
+  FT_UInt glyphIndex;
+  FT_ULong chr = FT_Get_First_Char(face, &glyphIndex);
+  while (glyphIndex != 0) {
+    if (chr <= FT_ULong(kMaxCodePoint))
+      add(int(chr));
+    chr = FT_Get_Next_Char(face, chr, &glyphIndex);
+  }
+  shareFullPages();
+}
+
+void Coverage::add(int codepoint)
+{
+  if (codepoint < 0 || codepoint > kMaxCodePoint)
+    return;
+
+  uint16_t& pageIndex = m_index[codepoint >> kPageShift];
+  if (pageIndex == kFullPage)
+    return;
+  if (pageIndex == kEmptyPage) {
+    pageIndex = uint16_t(m_pages.size());
+    m_pages.push_back(m_pages[kEmptyPage]);
+  }
+
+  const int i = (codepoint & kPageMask);
+  m_pages[pageIndex].bits[i >> 6] |= (uint64_t(1) << (i & 63));
+}
+
+void Coverage::shareFullPages()
+{
+  std::vector<Page> pages(m_pages.begin(), m_pages.begin()+2);
+  std::vector<uint16_t> newIndex(m_pages.size(), kEmptyPage);
+  newIndex[kFullPage] = kFullPage;
+
+  for (size_t i=2; i<m_pages.size(); ++i) {
+    const Page& page = m_pages[i];
+    if (std::all_of(std::begin(page.bits), std::end(page.bits),
+                    [](uint64_t b){ return b == ~uint64_t(0); })) {
+      newIndex[i] = kFullPage;
+    }
+    else {
+      newIndex[i] = uint16_t(pages.size());
+      pages.push_back(page);
+    }
+  }
+
+  for (uint16_t& pageIndex : m_index)
+    pageIndex = newIndex[pageIndex];
+  m_pages = std::move(pages);
+}
+
+} // namespace ft
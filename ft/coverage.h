@@ -0,0 +1,65 @@
+// LAF FreeType Wrapper
+// Copyright (c) 2024 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef FT_COVERAGE_H_INCLUDED
+#define FT_COVERAGE_H_INCLUDED
+#pragma once
+
+#include "ft/freetype_headers.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace ft {
+
+  // Set of Unicode code points supported by a face (computed once
+  // from its character map). It's a sparse two-level table: each
+  // page is a bitset of 256 code points, and all empty pages (and
+  // all full pages) share the same bitset.
+  class Coverage {
+  public:
+    static constexpr int kMaxCodePoint = 0x10ffff;
+
+    Coverage();
+    explicit Coverage(FT_Face face);
+
+    bool contains(int codepoint) const {
+      if (codepoint < 0 || codepoint > kMaxCodePoint)
+        return false;
+      const Page& page = m_pages[m_index[codepoint >> kPageShift]];
+      const int i = (codepoint & kPageMask);
+      return ((page.bits[i >> 6] >> (i & 63)) & 1);
+    }
+
+    // Code points out of the [0, kMaxCodePoint] range are ignored.
+    void add(int codepoint);
+
+    // Replaces pages that are completely covered with the shared
+    // full page (call it after adding a range of code points).
+    void shareFullPages();
+
+    // Number of pages that are partially covered.
+    int pageCount() const { return int(m_pages.size()) - 2; }
+
+  private:
+    static constexpr int kPageShift = 8;
+    static constexpr int kPageMask = (1 << kPageShift) - 1;
+    static constexpr int kIndexSize = (kMaxCodePoint >> kPageShift) + 1;
+    static constexpr uint16_t kEmptyPage = 0;
+    static constexpr uint16_t kFullPage = 1;
+
+    struct Page {
+      uint64_t bits[(1 << kPageShift) / 64];
+    };
+
+    // Page of each group of 256 code points
+    std::vector<uint16_t> m_index;
+    std::vector<Page> m_pages;
+  };
+
+} // namespace ft
+
+#endif
@@ -0,0 +1,148 @@
+// LAF FreeType Wrapper
+// Copyright (c) 2024 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "ft/coverage.h"
+
+#include <climits>
+
+using namespace ft;
+
+static void add_range(Coverage& cov, int from, int to)
+{
+  for (int chr=from; chr<=to; ++chr)
+    cov.add(chr);
+}
+
+TEST(Coverage, Empty)
+{
+  Coverage cov;
+  EXPECT_EQ(0, cov.pageCount());
+  EXPECT_FALSE(cov.contains(0));
+  EXPECT_FALSE(cov.contains('A'));
+  EXPECT_FALSE(cov.contains(0xffff));
+  EXPECT_FALSE(cov.contains(Coverage::kMaxCodePoint));
+
+  cov.shareFullPages();
+  EXPECT_EQ(0, cov.pageCount());
+  EXPECT_FALSE(cov.contains('A'));
+}
+
+TEST(Coverage, PartialPage)
+{
+  Coverage cov;
+  cov.add('A');
+  cov.add('z');
+  cov.add(0xff);
+  EXPECT_EQ(1, cov.pageCount());
+  EXPECT_TRUE(cov.contains('A'));
+  EXPECT_TRUE(cov.contains('z'));
+  EXPECT_TRUE(cov.contains(0xff));
+  EXPECT_FALSE(cov.contains('B'));
+  EXPECT_FALSE(cov.contains(0x100));
+  EXPECT_FALSE(cov.contains(0x141));
+
+  // Adding the same code point twice doesn't create other page
+  cov.add('A');
+  EXPECT_EQ(1, cov.pageCount());
+
+  cov.shareFullPages();
+  EXPECT_EQ(1, cov.pageCount());
+  EXPECT_TRUE(cov.contains('A'));
+  EXPECT_TRUE(cov.contains('z'));
+  EXPECT_FALSE(cov.contains('B'));
+}
+
+TEST(Coverage, FullPages)
+{
+  Coverage cov;
+  add_range(cov, 0x100, 0x2ff);  // Two full pages
+  add_range(cov, 0x300, 0x37f);  // Half page
+  EXPECT_EQ(3, cov.pageCount());
+
+  cov.shareFullPages();
+  EXPECT_EQ(1, cov.pageCount());
+  EXPECT_FALSE(cov.contains(0xff));
+  EXPECT_TRUE(cov.contains(0x100));
+  EXPECT_TRUE(cov.contains(0x1ff));
+  EXPECT_TRUE(cov.contains(0x200));
+  EXPECT_TRUE(cov.contains(0x2ff));
+  EXPECT_TRUE(cov.contains(0x37f));
+  EXPECT_FALSE(cov.contains(0x380));
+
+  // Adding to a full page doesn't modify the shared page
+  cov.add(0x150);
+  EXPECT_EQ(1, cov.pageCount());
+  EXPECT_FALSE(cov.contains(0x400));
+  EXPECT_FALSE(cov.contains(0));
+
+  // Completing the half page
+  add_range(cov, 0x380, 0x3ff);
+  cov.shareFullPages();
+  EXPECT_EQ(0, cov.pageCount());
+  EXPECT_TRUE(cov.contains(0x3ff));
+  EXPECT_FALSE(cov.contains(0x400));
+}
+
+TEST(Coverage, Edges)
+{
+  Coverage cov;
+  cov.add(0);
+  cov.add(Coverage::kMaxCodePoint);
+  EXPECT_EQ(2, cov.pageCount());
+  EXPECT_TRUE(cov.contains(0));
+  EXPECT_FALSE(cov.contains(1));
+  EXPECT_TRUE(cov.contains(Coverage::kMaxCodePoint));
+  EXPECT_FALSE(cov.contains(Coverage::kMaxCodePoint-1));
+
+  add_range(cov, 0, 0xff);
+  add_range(cov, 0x10ff00, Coverage::kMaxCodePoint);
+  cov.shareFullPages();
+  EXPECT_EQ(0, cov.pageCount());
+  EXPECT_TRUE(cov.contains(0));
+  EXPECT_TRUE(cov.contains(0xff));
+  EXPECT_FALSE(cov.contains(0x100));
+  EXPECT_FALSE(cov.contains(0x10feff));
+  EXPECT_TRUE(cov.contains(0x10ff00));
+  EXPECT_TRUE(cov.contains(Coverage::kMaxCodePoint));
+}
+
+TEST(Coverage, OutOfRange)
+{
+  Coverage cov;
+  add_range(cov, 0, 0xff);
+  add_range(cov, 0x10ff00, Coverage::kMaxCodePoint);
+  cov.shareFullPages();
+
+  // Code points out of range are never contained (even when the
+  // first and last pages are full)
+  EXPECT_FALSE(cov.contains(-1));
+  EXPECT_FALSE(cov.contains(-256));
+  EXPECT_FALSE(cov.contains(INT_MIN));
+  EXPECT_FALSE(cov.contains(Coverage::kMaxCodePoint+1));
+  EXPECT_FALSE(cov.contains(0x110100));
+  EXPECT_FALSE(cov.contains(INT_MAX));
+
+  // And they are ignored by add()
+  cov.add(-1);
+  cov.add(INT_MIN);
+  cov.add(Coverage::kMaxCodePoint+1);
+  cov.add(INT_MAX);
+  EXPECT_EQ(0, cov.pageCount());
+  EXPECT_FALSE(cov.contains(-1));
+  EXPECT_FALSE(cov.contains(Coverage::kMaxCodePoint+1));
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,278 @@
+// LAF FreeType Wrapper
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include "ft/face.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace ft {
+
+SimpleCache::SimpleCache(size_t budget)
+  : m_budget(budget)
+{
+  m_lru.prev = m_lru.next = &m_lru;
+}
+
+SimpleCache::~SimpleCache()
+{
+  invalidate();
+}
+
+void SimpleCache::invalidate()
+{
+  for (auto& it : m_entries) {
+    if (it.second.sizeClass < 0)
+      delete[] it.second.block;
+  }
+  m_entries.clear();
+  m_lru.prev = m_lru.next = &m_lru;
+  m_usedBytes = 0;
+  m_blockBytes = 0;
+
+  m_slabs.clear();
+  m_slabPos = m_slabEnd = nullptr;
+  for (auto& blocks : m_freeBlocks)
+    blocks.clear();
+
+  m_metricsTables.clear();
+}
+
+Glyph* SimpleCache::loadGlyph(FT_Face face, FT_UInt glyphIndex, bool antialias)
+{
+  const Key key = { glyphIndex,
+                    face->size->metrics.x_ppem,
+                    face->size->metrics.y_ppem,
+                    loadFlags(antialias) };
+
+  auto it = m_entries.find(key);
+  if (it != m_entries.end()) {
+    Entry* entry = &it->second;
+    ++m_stats.hits;
+    unlink(entry);
+    link(entry);
+    return &entry->glyph;
+  }
+
+  ++m_stats.misses;
+  Glyph* glyph = NoCache::loadGlyph(face, glyphIndex, antialias);
+  if (!glyph)
+    return nullptr;
+
+  // Copy the bitmap to our own storage
+  const FT_Bitmap& bitmap = *glyph->bitmap;
+  const size_t size = size_t(bitmap.rows) * std::abs(bitmap.pitch);
+  int sizeClass;
+  uint8_t* block = allocBlock(size, sizeClass);
+  if (size)
+    std::memcpy(block, bitmap.buffer, size);
+
+  Entry* entry = &m_entries[key];
+  entry->key = key;
+  entry->glyph = *glyph;
+  entry->glyph.ft_glyph = nullptr;
+  entry->glyph.bitmap = &entry->bitmap;
+  entry->bitmap = bitmap;
+  entry->bitmap.buffer = block;
+  entry->block = block;
+  entry->sizeClass = sizeClass;
+  entry->bytes = sizeof(Entry) + (sizeClass < 0 ? size: blockSize(sizeClass));
+  NoCache::doneGlyph(glyph);
+
+  link(entry);
+  m_usedBytes += entry->bytes;
+  if (sizeClass >= 0)
+    m_blockBytes += blockSize(sizeClass);
+  evict(entry);
+  return &entry->glyph;
+}
+
+Glyph* SimpleCache::loadGlyphMetrics(FT_Face face, FT_UInt glyphIndex, bool antialias)
+{
+  MetricsTable& table = metricsTable(face, antialias);
+
+  if (glyphIndex < kDenseGlyphs) {
+    uint8_t& state = table.denseState[glyphIndex];
+    GlyphMetrics& metrics = table.dense[glyphIndex];
+    if (state == 0) {
+      ++m_stats.metricsMisses;
+      state = (readGlyphMetrics(face, glyphIndex, antialias, metrics) ? 1: 2);
+    }
+    else
+      ++m_stats.metricsHits;
+
+    if (state == 2)
+      return nullptr;
+    return metricsGlyph(glyphIndex, metrics, antialias);
+  }
+
+  auto it = table.sparse.find(glyphIndex);
+  if (it != table.sparse.end()) {
+    ++m_stats.metricsHits;
+    return metricsGlyph(glyphIndex, it->second, antialias);
+  }
+
+  ++m_stats.metricsMisses;
+  GlyphMetrics metrics;
+  if (!readGlyphMetrics(face, glyphIndex, antialias, metrics))
+    return nullptr;
+  table.sparse[glyphIndex] = metrics;
+  return metricsGlyph(glyphIndex, metrics, antialias);
+}
+
+void SimpleCache::setBudget(size_t budget)
+{
+  m_budget = budget;
+  evict(nullptr);
+}
+
+SimpleCache::MetricsTable& SimpleCache::metricsTable(FT_Face face, bool antialias)
+{
+  const FT_UShort xPpem = face->size->metrics.x_ppem;
+  const FT_UShort yPpem = face->size->metrics.y_ppem;
+  const FT_Int32 flags = loadFlags(antialias);
+
+  auto it = std::find_if(m_metricsTables.begin(), m_metricsTables.end(),
+                         [=](const MetricsTable& t){
+                           return (t.xPpem == xPpem &&
+                                   t.yPpem == yPpem &&
+                                   t.loadFlags == flags);
+                         });
+  if (it == m_metricsTables.end()) {
+    if (int(m_metricsTables.size()) == kMaxMetricsTables)
+      m_metricsTables.pop_back();
+
+    MetricsTable table;
+    table.xPpem = xPpem;
+    table.yPpem = yPpem;
+    table.loadFlags = flags;
+    table.dense.resize(kDenseGlyphs);
+    table.denseState.resize(kDenseGlyphs, 0);
+    m_metricsTables.push_back(std::move(table));
+    it = m_metricsTables.end()-1;
+  }
+  if (it != m_metricsTables.begin())
+    std::rotate(m_metricsTables.begin(), it, it+1);
+  return m_metricsTables.front();
+}
+
+void SimpleCache::link(Entry* entry)
+{
+  entry->prev = &m_lru;
+  entry->next = m_lru.next;
+  m_lru.next->prev = entry;
+  m_lru.next = entry;
+}
+
+void SimpleCache::unlink(Entry* entry)
+{
+  entry->prev->next = entry->next;
+  entry->next->prev = entry->prev;
+  entry->prev = entry->next = nullptr;
+}
+
+void SimpleCache::evict(const Entry* keep)
+{
+  while (m_usedBytes > m_budget &&
+         m_lru.prev != &m_lru &&
+         m_lru.prev != keep) {
+    Entry* entry = static_cast<Entry*>(m_lru.prev);
+    unlink(entry);
+    freeBlock(entry->block, entry->sizeClass);
+    m_usedBytes -= entry->bytes;
+    if (entry->sizeClass >= 0)
+      m_blockBytes -= blockSize(entry->sizeClass);
+    ++m_stats.evictions;
+
+    const Key key = entry->key;
+    m_entries.erase(key);
+  }
+
+  // Freed blocks can be reused only for bitmaps of the same size
+  // class, so we compact the slabs when they waste too much memory
+  // (or release them when they are not used at all).
+  const size_t slack = std::max(m_budget / 4, kSlabSize);
+  if (slabBytes() > m_blockBytes + slack ||
+      (m_blockBytes == 0 && !m_slabs.empty()))
+    compactSlabs();
+}
+
+// Moves the blocks of all cached glyphs to new slabs (without free
+// blocks between them) and releases the old slabs.
+void SimpleCache::compactSlabs()
+{
+  // Biggest blocks first, so all blocks are packed without gaps (the
+  // size of each block divides the size of the slab)
+  std::vector<Entry*> entries;
+  entries.reserve(m_entries.size());
+  for (auto& it : m_entries) {
+    if (it.second.sizeClass >= 0)
+      entries.push_back(&it.second);
+  }
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry* a, const Entry* b){
+              return a->sizeClass > b->sizeClass;
+            });
+
+  std::vector<std::unique_ptr<uint8_t[]>> oldSlabs;
+  std::swap(oldSlabs, m_slabs);
+  m_slabPos = m_slabEnd = nullptr;
+  for (auto& blocks : m_freeBlocks)
+    blocks.clear();
+
+  for (Entry* entry : entries) {
+    int sizeClass;
+    uint8_t* block = allocBlock(blockSize(entry->sizeClass), sizeClass);
+    ASSERT(sizeClass == entry->sizeClass);
+    std::memcpy(block, entry->block,
+                size_t(entry->bitmap.rows) * std::abs(entry->bitmap.pitch));
+    entry->block = block;
+    entry->bitmap.buffer = block;
+  }
+}
+
+uint8_t* SimpleCache::allocBlock(size_t size, int& sizeClass)
+{
+  sizeClass = -1;
+  if (size == 0)
+    return nullptr;
+
+  // Big bitmaps are allocated separately
+  if (size > kSlabSize)
+    return new uint8_t[size];
+
+  sizeClass = 0;
+  while (blockSize(sizeClass) < size)
+    ++sizeClass;
+
+  auto& blocks = m_freeBlocks[sizeClass];
+  if (!blocks.empty()) {
+    uint8_t* block = blocks.back();
+    blocks.pop_back();
+    return block;
+  }
+
+  const size_t size2 = blockSize(sizeClass);
+  if (m_slabEnd - m_slabPos < std::ptrdiff_t(size2)) {
+    m_slabs.emplace_back(new uint8_t[kSlabSize]);
+    m_slabPos = m_slabs.back().get();
+    m_slabEnd = m_slabPos + kSlabSize;
+  }
+  uint8_t* block = m_slabPos;
+  m_slabPos += size2;
+  return block;
+}
+
+void SimpleCache::freeBlock(uint8_t* block, int sizeClass)
+{
+  if (sizeClass < 0)
+    delete[] block;
+  else
+    m_freeBlocks[sizeClass].push_back(block);
+}
+
+} // namespace ft
@@ -1,5 +1,5 @@
 // LAF FreeType Wrapper
-// Copyright (C) 2019  Igara Studio S.A.
+// Copyright (C) 2019-2024  Igara Studio S.A.
 // Copyright (C) 2016-2017  David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -12,15 +12,30 @@
 #include "base/debug.h"
 #include "base/disable_copying.h"
 #include "ft/freetype_headers.h"
-
-#include <map>
+#include "ft/sdf.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// FT_Load_Glyph() presets the bitmap size of outline glyphs since
+// FreeType 2.9.1
+#if FREETYPE_MAJOR > 2 || (FREETYPE_MAJOR == 2 && FREETYPE_MINOR > 9) || \
+  (FREETYPE_MAJOR == 2 && FREETYPE_MINOR == 9 && FREETYPE_PATCH >= 1)
+  #define LAF_FT_PRESET_BITMAP_SIZE 1
+#else
+  #define LAF_FT_PRESET_BITMAP_SIZE 0
+#endif
 
 namespace ft {
 
   struct Glyph {
     FT_UInt glyph_index;
-    FT_Glyph ft_glyph;
+    FT_Glyph ft_glyph;          // nullptr for cached glyphs
     FT_Bitmap* bitmap;
+    FT_Vector advance;          // In 16.16 format
     double startX;
     double endX;
     double bearingX;
@@ -29,12 +44,22 @@ namespace ft {
     double y;
   };
 
+  // Metrics of a glyph loaded without rendering it (see
+  // NoCache::loadGlyphMetrics()).
+  struct GlyphMetrics {
+    FT_Vector advance;          // In 16.16 format
+    FT_Pos bearingX;            // In 26.6 format
+    FT_Pos bearingY;
+    unsigned int width;         // Size of the rendered bitmap
+    unsigned int rows;
+  };
+
   template<typename Cache>
   class FaceFT {
   public:
     typedef ft::Glyph Glyph;
 
-    FaceFT(FT_Face face) : m_face(face) {
+    FaceFT(FT_Face face) : m_face(face), m_antialias(false) {
     }
 
     ~FaceFT() {
@@ -53,14 +78,14 @@ namespace ft {
       return m_antialias;
     }
 
+    // The cache is not invalidated when the antialias or size
+    // change, as glyphs are cached for each size/render mode.
     void setAntialias(bool antialias) {
       m_antialias = antialias;
-      m_cache.invalidate();
     }
 
     void setSize(int size) {
       FT_Set_Pixel_Sizes(m_face, size, size);
-      m_cache.invalidate();
     }
 
     double height() const {
@@ -94,10 +119,14 @@ namespace ft {
 
     Cache& cache() { return m_cache; }
 
+    // Signed distance fields of the glyphs (for all sizes).
+    SdfCache& sdfCache() { return m_sdfCache; }
+
   protected:
     FT_Face m_face;
     bool m_antialias;
     Cache m_cache;
+    SdfCache m_sdfCache;
 
   private:
     DISABLE_COPYING(FaceFT);
@@ -113,15 +142,19 @@ namespace ft {
       return FT_Get_Char_Index(face, charCode);
     }
 
-    Glyph* loadGlyph(FT_Face face, FT_UInt glyphIndex, bool antialias) {
-      FT_Error err = FT_Load_Glyph(
-        face, glyphIndex,
+    // Flags used to load glyphs (render mode and hinting).
+    static FT_Int32 loadFlags(bool antialias) {
+      return
         FT_LOAD_RENDER |
         // TODO Check if we can render correctly th embedded bitmaps
         //      in the future removing FT_LOAD_NO_BITMAP for fonts
         //      like Calibri, Cambria, Monaco, etc.
         (antialias ? FT_LOAD_TARGET_NORMAL | FT_LOAD_NO_BITMAP:
-                     FT_LOAD_TARGET_MONO));
+                     FT_LOAD_TARGET_MONO);
+    }
+
+    Glyph* loadGlyph(FT_Face face, FT_UInt glyphIndex, bool antialias) {
+      FT_Error err = FT_Load_Glyph(face, glyphIndex, loadFlags(antialias));
       if (err)
         return nullptr;
 
@@ -138,66 +171,232 @@ namespace ft {
         }
       }
 
+      m_glyph.glyph_index = glyphIndex;
       m_glyph.ft_glyph = ft_glyph;
+      m_glyph.bitmap = &FT_BitmapGlyph(ft_glyph)->bitmap;
+      m_glyph.advance = ft_glyph->advance;
       m_glyph.bearingX = face->glyph->metrics.horiBearingX / 64.0;
       m_glyph.bearingY = face->glyph->metrics.horiBearingY / 64.0;
 
       return &m_glyph;
     }
 
+    // Loads only the metrics of the glyph to measure text (it doesn't
+    // render the glyph). The bitmap of the returned glyph has the
+    // size of the rendered glyph but doesn't have pixels.
+    Glyph* loadGlyphMetrics(FT_Face face, FT_UInt glyphIndex, bool antialias) {
+      GlyphMetrics metrics;
+      if (!readGlyphMetrics(face, glyphIndex, antialias, metrics))
+        return nullptr;
+      return metricsGlyph(glyphIndex, metrics, antialias);
+    }
+
     void doneGlyph(Glyph* glyph) {
       ASSERT(glyph);
       FT_Done_Glyph(glyph->ft_glyph);
     }
 
+  protected:
+    static bool readGlyphMetrics(FT_Face face, FT_UInt glyphIndex,
+                                 bool antialias, GlyphMetrics& metrics) {
+      FT_Error err = FT_Load_Glyph(face, glyphIndex,
+                                   loadFlags(antialias) & ~FT_LOAD_RENDER);
+      if (err)
+        return false;
+
+      const FT_GlyphSlot slot = face->glyph;
+      metrics.advance.x = slot->advance.x << 10;
+      metrics.advance.y = slot->advance.y << 10;
+      metrics.bearingX = slot->metrics.horiBearingX;
+      metrics.bearingY = slot->metrics.horiBearingY;
+
+#if LAF_FT_PRESET_BITMAP_SIZE
+      // FT_Load_Glyph() presets the bitmap size of outline glyphs
+      // (the same size FT_Render_Glyph() will use)
+      metrics.width = slot->bitmap.width;
+      metrics.rows = slot->bitmap.rows;
+#else
+      if (slot->format == FT_GLYPH_FORMAT_OUTLINE) {
+        // Pixels touched by the control box of the outline (as
+        // FT_Render_Glyph() does)
+        FT_BBox cbox;
+        FT_Outline_Get_CBox(&slot->outline, &cbox);
+        const FT_Pos x0 = (cbox.xMin & ~63);
+        const FT_Pos y0 = (cbox.yMin & ~63);
+        const FT_Pos x1 = ((cbox.xMax + 63) & ~63);
+        const FT_Pos y1 = ((cbox.yMax + 63) & ~63);
+        metrics.width = (unsigned int)((x1 - x0) >> 6);
+        metrics.rows = (unsigned int)((y1 - y0) >> 6);
+      }
+      else {
+        metrics.width = slot->bitmap.width;
+        metrics.rows = slot->bitmap.rows;
+      }
+#endif
+      return true;
+    }
+
+    Glyph* metricsGlyph(FT_UInt glyphIndex, const GlyphMetrics& metrics,
+                        bool antialias) {
+      m_metricsBitmap = FT_Bitmap();
+      m_metricsBitmap.width = metrics.width;
+      m_metricsBitmap.rows = metrics.rows;
+      m_metricsBitmap.pixel_mode = (antialias ? FT_PIXEL_MODE_GRAY:
+                                                FT_PIXEL_MODE_MONO);
+
+      m_glyph.glyph_index = glyphIndex;
+      m_glyph.ft_glyph = nullptr;
+      m_glyph.bitmap = &m_metricsBitmap;
+      m_glyph.advance = metrics.advance;
+      m_glyph.bearingX = metrics.bearingX / 64.0;
+      m_glyph.bearingY = metrics.bearingY / 64.0;
+      return &m_glyph;
+    }
+
   private:
     Glyph m_glyph;
+    FT_Bitmap m_metricsBitmap;
   };
 
+  // Cache of glyphs of all sizes and render modes used with a face,
+  // so changing the size of the face doesn't invalidate it. When the
+  // memory used by the cached glyphs is bigger than the budget, the
+  // least recently used glyphs are evicted. Bitmaps are stored in
+  // blocks of power of two sizes carved from big slabs (freed
+  // blocks are reused for bitmaps of the same size class). When too
+  // much slab memory is in freed blocks, the live blocks are moved
+  // to new slabs, so the memory of the slabs is bounded by the budget
+  // plus some slack (see compactSlabs()).
+  //
+  // Glyphs returned by loadGlyph() are valid until the next
+  // loadGlyph() call (which can evict it).
   class SimpleCache : public NoCache {
   public:
-    ~SimpleCache() {
-      invalidate();
-    }
-
-    void invalidate() {
-      for (auto& it : m_glyphMap) {
-        FT_Done_Glyph(it.second->ft_glyph);
-        delete it.second;
-      }
-
-      m_glyphMap.clear();
-    }
-
-    Glyph* loadGlyph(FT_Face face, FT_UInt glyphIndex, bool antialias) {
-      auto it = m_glyphMap.find(glyphIndex);
-      if (it != m_glyphMap.end())
-        return it->second;
-
-      Glyph* glyph = NoCache::loadGlyph(face, glyphIndex, antialias);
-      if (!glyph)
-        return nullptr;
+    static constexpr size_t kDefaultBudget = 2*1024*1024;
 
-      FT_Glyph new_ft_glyph = nullptr;
-      FT_Glyph_Copy(glyph->ft_glyph, &new_ft_glyph);
-      if (!new_ft_glyph)
-        return nullptr;
+    struct Stats {
+      uint64_t hits = 0;
+      uint64_t misses = 0;
+      uint64_t evictions = 0;
+      uint64_t metricsHits = 0;
+      uint64_t metricsMisses = 0;
+    };
 
-      Glyph* newGlyph = new Glyph(*glyph);
-      newGlyph->ft_glyph = new_ft_glyph;
+    SimpleCache(size_t budget = kDefaultBudget);
+    ~SimpleCache();
 
-      m_glyphMap[glyphIndex] = newGlyph;
-      FT_Done_Glyph(glyph->ft_glyph);
+    void invalidate();
 
-      return newGlyph;
-    }
+    Glyph* loadGlyph(FT_Face face, FT_UInt glyphIndex, bool antialias);
+    Glyph* loadGlyphMetrics(FT_Face face, FT_UInt glyphIndex, bool antialias);
 
     void doneGlyph(Glyph* glyph) {
       // Do nothing
     }
 
+    size_t budget() const { return m_budget; }
+    void setBudget(size_t budget);
+
+    // Memory used by cached glyphs (in bytes)
+    size_t usedBytes() const { return m_usedBytes; }
+    // Memory reserved for bitmaps in slabs (including freed blocks)
+    size_t slabBytes() const { return m_slabs.size() * kSlabSize; }
+    int glyphCount() const { return int(m_entries.size()); }
+    const Stats& stats() const { return m_stats; }
+
   private:
-    std::map<FT_UInt, Glyph*> m_glyphMap;
+    // Bitmaps of up to kSlabSize bytes are stored in blocks of
+    // 2^kMinBlockShift to kSlabSize bytes.
+    static constexpr int kMinBlockShift = 6;
+    static constexpr int kSlabShift = 16;
+    static constexpr size_t kSlabSize = (size_t(1) << kSlabShift);
+    static constexpr int kSizeClasses = kSlabShift - kMinBlockShift + 1;
+
+    struct Key {
+      FT_UInt glyphIndex;
+      FT_UShort xPpem;
+      FT_UShort yPpem;
+      FT_Int32 loadFlags;
+
+      bool operator==(const Key& o) const {
+        return (glyphIndex == o.glyphIndex &&
+                xPpem == o.xPpem &&
+                yPpem == o.yPpem &&
+                loadFlags == o.loadFlags);
+      }
+    };
+
+    struct KeyHash {
+      size_t operator()(const Key& k) const {
+        uint64_t h = ((uint64_t(k.glyphIndex) << 32) |
+                      (uint64_t(k.xPpem) << 16) | k.yPpem);
+        h ^= uint64_t(uint32_t(k.loadFlags)) * 0x9e3779b97f4a7c15ull;
+        return size_t(h ^ (h >> 29));
+      }
+    };
+
+    // Intrusive LRU list node
+    struct Link {
+      Link* prev = nullptr;
+      Link* next = nullptr;
+    };
+
+    struct Entry : Link {
+      Key key;
+      Glyph glyph;
+      FT_Bitmap bitmap;
+      uint8_t* block = nullptr;
+      int sizeClass = -1;       // -1 if "block" is a big bitmap
+      size_t bytes = 0;
+    };
+
+    // Metrics of the glyphs of one size/render mode. The metrics of
+    // the first kDenseGlyphs glyph indexes (where the Latin glyphs
+    // are in most fonts) are stored in a dense table.
+    static constexpr FT_UInt kDenseGlyphs = 512;
+    static constexpr int kMaxMetricsTables = 8;
+
+    struct MetricsTable {
+      FT_UShort xPpem;
+      FT_UShort yPpem;
+      FT_Int32 loadFlags;
+      std::vector<GlyphMetrics> dense;
+      std::vector<uint8_t> denseState; // 0=not loaded, 1=loaded, 2=error
+      std::unordered_map<FT_UInt, GlyphMetrics> sparse;
+    };
+
+    MetricsTable& metricsTable(FT_Face face, bool antialias);
+
+    void link(Entry* entry);
+    void unlink(Entry* entry);
+    void evict(const Entry* keep);
+    void compactSlabs();
+    uint8_t* allocBlock(size_t size, int& sizeClass);
+    void freeBlock(uint8_t* block, int sizeClass);
+
+    static size_t blockSize(int sizeClass) {
+      return (size_t(1) << (sizeClass + kMinBlockShift));
+    }
+
+    std::unordered_map<Key, Entry, KeyHash> m_entries;
+    // m_lru.next is the most recently used entry, m_lru.prev the
+    // least recently used one
+    Link m_lru;
+    size_t m_budget;
+    size_t m_usedBytes = 0;
+    // Bytes of the slab blocks used by cached glyphs
+    size_t m_blockBytes = 0;
+    Stats m_stats;
+
+    std::vector<std::unique_ptr<uint8_t[]>> m_slabs;
+    uint8_t* m_slabPos = nullptr;
+    uint8_t* m_slabEnd = nullptr;
+    std::vector<uint8_t*> m_freeBlocks[kSizeClasses];
+
+    // Sorted from the most recently used
+    std::vector<MetricsTable> m_metricsTables;
+
+    DISABLE_COPYING(SimpleCache);
   };
 
 } // namespace ft
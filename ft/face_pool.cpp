@@ -0,0 +1,171 @@
+// LAF FreeType Wrapper
+// Copyright (c) 2024 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include "ft/face_pool.h"
+
+#include "base/file_content.h"
+#include "base/file_handle.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace ft {
+
+FacePool::FacePool(Lib& lib, const std::string& filename)
+  : m_lib(lib)
+  , m_filename(filename)
+  , m_ownerThread(std::this_thread::get_id())
+  , m_faces(std::make_shared<Faces>(lib))
+{
+  m_ownerFace = makeThreadFace(m_lib.open(filename));
+  if (m_ownerFace)
+    m_coverage = Coverage(*m_ownerFace->face);
+}
+
+FacePool::~FacePool()
+{
+  // Faces must be closed with the Lib mutex locked (and the faces of
+  // other threads before their font data is released)
+  {
+    const std::lock_guard lock(m_faces->mutex);
+    const std::lock_guard libLock(m_lib.mutex());
+    m_faces->map.clear();
+  }
+  const std::lock_guard libLock(m_lib.mutex());
+  m_ownerFace.reset();
+}
+
+Face& FacePool::face()
+{
+  ASSERT(isValid());
+  if (isOwnerThread())
+    return updateFace(*m_ownerFace);
+
+  ThreadFace* tf;
+  {
+    const std::lock_guard lock(m_faces->mutex);
+    auto it = m_faces->map.find(std::this_thread::get_id());
+    if (it != m_faces->map.end())
+      tf = it->second.get();
+    else
+      tf = openThreadFace();
+  }
+  // The same file was already opened for the owner thread, so this
+  // can fail only if we run out of memory.
+  ASSERT(tf);
+  return updateFace(*tf);
+}
+
+void FacePool::setSize(int size)
+{
+  m_size = size;
+}
+
+void FacePool::setAntialias(bool antialias)
+{
+  m_antialias = antialias;
+}
+
+int FacePool::threadFaceCount() const
+{
+  const std::lock_guard lock(m_faces->mutex);
+  return int(m_faces->map.size());
+}
+
+std::unique_ptr<FacePool::ThreadFace> FacePool::makeThreadFace(FT_Face ftFace) const
+{
+  if (!ftFace)
+    return nullptr;
+
+  auto tf = std::make_unique<ThreadFace>();
+  tf->face = std::make_unique<Face>(ftFace);
+  if (m_size > 0)
+    tf->face->setSize(m_size);
+  tf->face->setAntialias(m_antialias);
+  tf->size = m_size;
+  tf->antialias = m_antialias;
+  return tf;
+}
+
+// Must be called with m_faces->mutex locked.
+FacePool::ThreadFace* FacePool::openThreadFace()
+{
+  // Faces of other threads share the font data in memory (the file
+  // is loaded only when a second thread uses the pool)
+  if (m_data.empty()) {
+    if (FILE* file = base::open_file_raw(m_filename, "rb")) {
+      m_data = base::read_file_content(file);
+      fclose(file);
+    }
+    if (m_data.empty())
+      return nullptr;
+  }
+
+  auto tf = makeThreadFace(m_lib.open(m_data.data(), m_data.size()));
+  if (!tf)
+    return nullptr;
+
+  ThreadFace* result = tf.get();
+  m_faces->map[std::this_thread::get_id()] = std::move(tf);
+  closeOnThreadExit(m_faces);
+  return result;
+}
+
+Face& FacePool::updateFace(ThreadFace& tf)
+{
+  const int size = m_size;
+  const bool antialias = m_antialias;
+  if (tf.size != size) {
+    tf.face->setSize(size);
+    tf.size = size;
+  }
+  if (tf.antialias != antialias) {
+    tf.face->setAntialias(antialias);
+    tf.antialias = antialias;
+  }
+  return *tf.face;
+}
+
+void FacePool::Faces::close(std::thread::id id)
+{
+  const std::lock_guard lock(mutex);
+  auto it = map.find(id);
+  if (it != map.end()) {
+    const std::lock_guard libLock(lib.mutex());
+    map.erase(it);
+  }
+}
+
+// Closes the face of the current thread in the given pool when the
+// thread exits (if the pool is still alive).
+//
+// static
+void FacePool::closeOnThreadExit(const std::shared_ptr<Faces>& faces)
+{
+  struct ThreadPools {
+    std::vector<std::weak_ptr<Faces>> pools;
+
+    ~ThreadPools() {
+      const std::thread::id id = std::this_thread::get_id();
+      for (auto& weak : pools) {
+        if (auto faces = weak.lock())
+          faces->close(id);
+      }
+    }
+  };
+  static thread_local ThreadPools t;
+
+  // Forget destroyed pools
+  t.pools.erase(
+    std::remove_if(t.pools.begin(), t.pools.end(),
+                   [](const std::weak_ptr<Faces>& weak){
+                     return weak.expired();
+                   }),
+    t.pools.end());
+  t.pools.push_back(faces);
+}
+
+} // namespace ft
@@ -0,0 +1,113 @@
+// LAF FreeType Wrapper
+// Copyright (c) 2024 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef FT_FACE_POOL_H_INCLUDED
+#define FT_FACE_POOL_H_INCLUDED
+#pragma once
+
+#include "base/buffer.h"
+#include "base/disable_copying.h"
+#include "ft/coverage.h"
+#include "ft/hb_face.h"
+#include "ft/lib.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace ft {
+
+  // Faces of one font file, one face per thread (a FT_Face cannot be
+  // used from several threads at the same time). The face of the
+  // thread that created the pool reads the font file as a stream.
+  // The first time another thread calls face(), the font file is
+  // loaded in memory (only once), and the face of that thread is
+  // opened from that data.
+  //
+  // Each face has its own glyph/shaping caches. The face of a thread
+  // is closed when the thread exits, and the rest of the faces when
+  // the pool is destroyed (the pool must be destroyed when no other
+  // thread is using it).
+  class FacePool {
+  public:
+    FacePool(Lib& lib, const std::string& filename);
+    ~FacePool();
+
+    bool isValid() const { return m_ownerFace != nullptr; }
+
+    // Returns the face for the current thread with the size and
+    // antialias of the pool.
+    Face& face();
+
+    // Changes the size/antialias of all faces (each face is updated
+    // the next time its thread calls face()).
+    void setSize(int size);
+    void setAntialias(bool antialias);
+
+    // Code points supported by the font (it can be used from any
+    // thread without locking).
+    const Coverage& coverage() const { return m_coverage; }
+
+    int size() const { return m_size; }
+    bool antialias() const { return m_antialias; }
+
+    // Returns true if the current thread is the one that created the
+    // pool.
+    bool isOwnerThread() const {
+      return (std::this_thread::get_id() == m_ownerThread);
+    }
+
+    // Number of faces opened for other threads (for testing purposes)
+    int threadFaceCount() const;
+
+  private:
+    struct ThreadFace {
+      std::unique_ptr<Face> face;
+      int size = 0;
+      bool antialias = false;
+    };
+
+    // Faces of other threads, shared with the threads that use them
+    // to close their faces when they exit.
+    struct Faces {
+      Lib& lib;
+      mutable std::mutex mutex;
+      std::map<std::thread::id, std::unique_ptr<ThreadFace>> map;
+
+      Faces(Lib& lib) : lib(lib) { }
+      void close(std::thread::id id);
+    };
+
+    std::unique_ptr<ThreadFace> makeThreadFace(FT_Face ftFace) const;
+    ThreadFace* openThreadFace();
+    Face& updateFace(ThreadFace& tf);
+    static void closeOnThreadExit(const std::shared_ptr<Faces>& faces);
+
+    Lib& m_lib;
+    const std::string m_filename;
+    Coverage m_coverage;
+    std::atomic<int> m_size = 0;
+    std::atomic<bool> m_antialias = false;
+
+    // Face of the thread that created the pool (accessed without
+    // locking the mutex)
+    const std::thread::id m_ownerThread;
+    std::unique_ptr<ThreadFace> m_ownerFace;
+
+    // Font file loaded in memory for faces of other threads (loaded
+    // with m_faces->mutex locked)
+    base::buffer m_data;
+    std::shared_ptr<Faces> m_faces;
+
+    DISABLE_COPYING(FacePool);
+  };
+
+} // namespace ft
+
+#endif
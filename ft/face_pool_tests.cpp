@@ -0,0 +1,125 @@
+// LAF FreeType Wrapper
+// Copyright (c) 2024 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "base/thread_pool.h"
+#include "ft/algorithm.h"
+#include "ft/face_pool.h"
+#include "ft/test_font.h"
+#include "gfx/rect_io.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace ft;
+
+static const char* kText =
+  "The quick brown fox jumps over the lazy dog. 0123456789";
+
+// Measures the text from several threads of a thread pool (each one
+// using its own face of the pool).
+static std::vector<gfx::Rect> measure_from_threads(FacePool& pool,
+                                                   std::atomic<int>& ownerCalls)
+{
+  constexpr int kTasks = 32;
+  std::vector<gfx::Rect> bounds(kTasks);
+  base::thread_pool threads(4);
+  for (int i=0; i<kTasks; ++i) {
+    threads.execute([&pool, &bounds, &ownerCalls, i]{
+      if (pool.isOwnerThread())
+        ++ownerCalls;
+      bounds[i] = calc_text_bounds(pool.face(), kText);
+    });
+  }
+  threads.wait_all();
+  return bounds;
+}
+
+TEST(FacePool, MeasureFromThreads)
+{
+  const std::string fn = find_test_font();
+  if (fn.empty())
+    GTEST_SKIP() << "No font found (set LAF_TEST_FONT)";
+
+  Lib lib;
+  FacePool pool(lib, fn);
+  ASSERT_TRUE(pool.isValid());
+  pool.setSize(16);
+  pool.setAntialias(true);
+
+  const gfx::Rect expected = calc_text_bounds(pool.face(), kText);
+  ASSERT_FALSE(expected.isEmpty());
+
+  std::atomic<int> ownerCalls(0);
+  for (const gfx::Rect& bounds : measure_from_threads(pool, ownerCalls))
+    EXPECT_EQ(expected, bounds);
+  EXPECT_EQ(0, ownerCalls);
+
+  // A new size is used by the faces of all threads
+  pool.setSize(24);
+  const gfx::Rect expected24 = calc_text_bounds(pool.face(), kText);
+  EXPECT_NE(expected, expected24);
+  for (const gfx::Rect& bounds : measure_from_threads(pool, ownerCalls))
+    EXPECT_EQ(expected24, bounds);
+  EXPECT_EQ(0, ownerCalls);
+
+  // Faces of the threads were closed when the threads exited
+  EXPECT_EQ(0, pool.threadFaceCount());
+}
+
+TEST(FacePool, PoolDestroyedBeforeThreadExits)
+{
+  const std::string fn = find_test_font();
+  if (fn.empty())
+    GTEST_SKIP() << "No font found (set LAF_TEST_FONT)";
+
+  Lib lib;
+  auto pool = std::make_unique<FacePool>(lib, fn);
+  ASSERT_TRUE(pool->isValid());
+  pool->setSize(16);
+  EXPECT_EQ(0, pool->threadFaceCount());
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool measured = false;
+  bool destroyed = false;
+  gfx::Rect bounds;
+
+  std::thread thread([&]{
+    std::unique_lock lock(mutex);
+    bounds = calc_text_bounds(pool->face(), kText);
+    measured = true;
+    cv.notify_one();
+    cv.wait(lock, [&]{ return destroyed; });
+    // The face of this thread was already closed by ~FacePool()
+  });
+  {
+    std::unique_lock lock(mutex);
+    cv.wait(lock, [&]{ return measured; });
+    EXPECT_EQ(1, pool->threadFaceCount());
+    EXPECT_EQ(calc_text_bounds(pool->face(), kText), bounds);
+    pool.reset();
+    destroyed = true;
+    cv.notify_one();
+  }
+  thread.join();
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,245 @@
+// LAF FreeType Wrapper
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "ft/face.h"
+#include "ft/lib.h"
+#include "ft/test_font.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace ft;
+
+namespace {
+
+typedef FaceFT<SimpleCache> CachedFace;
+
+class SimpleCacheTest : public testing::Test {
+protected:
+  void SetUp() override {
+    const std::string fn = find_test_font();
+    if (fn.empty())
+      GTEST_SKIP() << "No font found (set LAF_TEST_FONT)";
+
+    m_face = std::make_unique<CachedFace>(m_lib.open(fn));
+    ASSERT_TRUE(m_face->isValid());
+    m_face->setSize(16);
+    m_face->setAntialias(true);
+  }
+
+  SimpleCache& cache() { return m_face->cache(); }
+
+  Glyph* load(int chr) {
+    const FT_UInt glyphIndex = cache().getGlyphIndex(*m_face, chr);
+    return cache().loadGlyph(*m_face, glyphIndex, m_face->antialias());
+  }
+
+  Lib m_lib;
+  std::unique_ptr<CachedFace> m_face;
+};
+
+} // anonymous namespace
+
+TEST(SimpleCache, Empty)
+{
+  SimpleCache cache(1024);
+  EXPECT_EQ(1024, cache.budget());
+  EXPECT_EQ(0, cache.usedBytes());
+  EXPECT_EQ(0, cache.glyphCount());
+  EXPECT_EQ(0, cache.stats().hits);
+  EXPECT_EQ(0, cache.stats().misses);
+  EXPECT_EQ(0, cache.stats().evictions);
+
+  cache.setBudget(0);
+  cache.invalidate();
+  EXPECT_EQ(0, cache.budget());
+  EXPECT_EQ(0, cache.usedBytes());
+  EXPECT_EQ(0, cache.stats().evictions);
+}
+
+TEST_F(SimpleCacheTest, Counters)
+{
+  ASSERT_TRUE(load('A') != nullptr);
+  ASSERT_TRUE(load('A') != nullptr);
+  ASSERT_TRUE(load('B') != nullptr);
+  EXPECT_EQ(1, cache().stats().hits);
+  EXPECT_EQ(2, cache().stats().misses);
+  EXPECT_EQ(0, cache().stats().evictions);
+  EXPECT_EQ(2, cache().glyphCount());
+
+  // Other size is other entry
+  m_face->setSize(24);
+  ASSERT_TRUE(load('A') != nullptr);
+  EXPECT_EQ(1, cache().stats().hits);
+  EXPECT_EQ(3, cache().stats().misses);
+  EXPECT_EQ(3, cache().glyphCount());
+
+  // Going back to the previous size hits the cached glyph
+  m_face->setSize(16);
+  ASSERT_TRUE(load('A') != nullptr);
+  EXPECT_EQ(2, cache().stats().hits);
+  EXPECT_EQ(3, cache().stats().misses);
+}
+
+TEST_F(SimpleCacheTest, LruEvictionOrder)
+{
+  load('A');
+  load('B');
+  load('C');
+  load('A');                    // Now 'B' is the least recently used
+  ASSERT_EQ(3, cache().glyphCount());
+  ASSERT_EQ(0, cache().stats().evictions);
+
+  cache().setBudget(cache().usedBytes() - 1);
+  EXPECT_EQ(1, cache().stats().evictions);
+  EXPECT_EQ(2, cache().glyphCount());
+  EXPECT_LE(cache().usedBytes(), cache().budget());
+
+  // 'A' and 'C' are still cached, 'B' was evicted
+  const uint64_t hits = cache().stats().hits;
+  const uint64_t misses = cache().stats().misses;
+  load('A');
+  load('C');
+  EXPECT_EQ(hits+2, cache().stats().hits);
+  EXPECT_EQ(misses, cache().stats().misses);
+  load('B');
+  EXPECT_EQ(misses+1, cache().stats().misses);
+}
+
+TEST_F(SimpleCacheTest, UsedBytesWithinBudget)
+{
+  const size_t budget = 16*1024;
+  cache().setBudget(budget);
+  for (int chr='!'; chr<='~'; ++chr) {
+    load(chr);
+    EXPECT_LE(cache().usedBytes(), budget);
+  }
+  for (int size=8; size<=64; size+=8) {
+    m_face->setSize(size);
+    load('W');
+    EXPECT_LE(cache().usedBytes(), budget);
+  }
+  EXPECT_GT(cache().stats().evictions, 0);
+  EXPECT_GT(cache().usedBytes(), 0);
+
+  cache().setBudget(0);
+  EXPECT_EQ(0, cache().usedBytes());
+  EXPECT_EQ(0, cache().glyphCount());
+}
+
+TEST_F(SimpleCacheTest, FreeBlockReuse)
+{
+  Glyph* glyph = load('A');
+  ASSERT_TRUE(glyph != nullptr);
+  ASSERT_GT(glyph->bitmap->rows, 0);
+  const uint8_t* block = glyph->bitmap->buffer;
+  const FT_Bitmap bitmap = *glyph->bitmap;
+
+  // Evicting 'A' returns its block to the free list, and the same
+  // glyph is loaded again in the same block
+  load('B');
+  cache().setBudget(cache().usedBytes() - 1);
+  ASSERT_EQ(1, cache().glyphCount());
+  cache().setBudget(SimpleCache::kDefaultBudget);
+
+  glyph = load('A');
+  ASSERT_TRUE(glyph != nullptr);
+  EXPECT_EQ(block, glyph->bitmap->buffer);
+  EXPECT_EQ(bitmap.rows, glyph->bitmap->rows);
+  EXPECT_EQ(bitmap.width, glyph->bitmap->width);
+  EXPECT_EQ(bitmap.pitch, glyph->bitmap->pitch);
+}
+
+TEST_F(SimpleCacheTest, SlabBytesWithinBudget)
+{
+  // Glyphs of several sizes use blocks of all size classes, the
+  // freed blocks of one class cannot be reused by other classes
+  const size_t budget = 128*1024;
+  const size_t slack = std::max(budget / 4, size_t(64*1024));
+  cache().setBudget(budget);
+  for (int i=0; i<4; ++i) {
+    for (int size=8; size<=80; size+=4) {
+      m_face->setSize(size);
+      for (int chr='!'; chr<='~'; ++chr) {
+        load(chr);
+        ASSERT_LE(cache().slabBytes(), budget + slack);
+      }
+    }
+  }
+  EXPECT_GT(cache().stats().evictions, 0);
+
+  // Cached bitmaps are still valid after compacting slabs
+  m_face->setSize(16);
+  Glyph* glyph = load('A');
+  const FT_Bitmap bitmap = *glyph->bitmap;
+  std::vector<uint8_t> pixels(bitmap.buffer,
+                              bitmap.buffer + bitmap.rows*std::abs(bitmap.pitch));
+  for (int size=8; size<=80; size+=4) {
+    m_face->setSize(size);
+    for (int chr='!'; chr<='~'; ++chr) {
+      load(chr);
+      m_face->setSize(16);
+      load('A');                // Keep 'A' as the most recently used glyph
+      m_face->setSize(size);
+    }
+  }
+  m_face->setSize(16);
+  const uint64_t misses = cache().stats().misses;
+  glyph = load('A');
+  EXPECT_EQ(misses, cache().stats().misses);
+  ASSERT_EQ(bitmap.rows, glyph->bitmap->rows);
+  EXPECT_EQ(0, std::memcmp(pixels.data(), glyph->bitmap->buffer, pixels.size()));
+
+  cache().setBudget(0);
+  EXPECT_EQ(0, cache().usedBytes());
+  EXPECT_EQ(0, cache().slabBytes());
+}
+
+// Metrics loaded without rendering the glyph must be the same as
+// the metrics of the rendered glyph.
+TEST_F(SimpleCacheTest, MetricsOfRenderedGlyphs)
+{
+  for (const bool antialias : { false, true }) {
+    for (const int size : { 9, 16, 31 }) {
+      m_face->setSize(size);
+      for (int chr='!'; chr<='~'; ++chr) {
+        SCOPED_TRACE(testing::Message() << "antialias=" << antialias
+                     << " size=" << size << " chr=" << char(chr));
+
+        const FT_UInt glyphIndex = cache().getGlyphIndex(*m_face, chr);
+        const Glyph* glyph = cache().loadGlyph(*m_face, glyphIndex, antialias);
+        ASSERT_TRUE(glyph != nullptr);
+        const Glyph rendered = *glyph;
+        const FT_Bitmap bitmap = *glyph->bitmap;
+
+        glyph = cache().loadGlyphMetrics(*m_face, glyphIndex, antialias);
+        ASSERT_TRUE(glyph != nullptr);
+        EXPECT_EQ(rendered.advance.x, glyph->advance.x);
+        EXPECT_EQ(rendered.advance.y, glyph->advance.y);
+        EXPECT_EQ(rendered.bearingX, glyph->bearingX);
+        EXPECT_EQ(rendered.bearingY, glyph->bearingY);
+        EXPECT_EQ(bitmap.width, glyph->bitmap->width);
+        EXPECT_EQ(bitmap.rows, glyph->bitmap->rows);
+      }
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -11,5 +11,6 @@
 #include <ft2build.h>
 #include FT_GLYPH_H
 #include FT_FREETYPE_H
+#include FT_OUTLINE_H
 
 #endif
@@ -1,5 +1,5 @@
 // LAF FreeType Wrapper
-// Copyright (c) 2020 Igara Studio S.A.
+// Copyright (c) 2020-2024 Igara Studio S.A.
 // Copyright (c) 2017 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -11,6 +11,7 @@
 
 #include "base/string.h"
 #include "ft/face.h"
+#include "ft/hb_run_cache.h"
 
 #include <hb.h>
 #include <hb-ft.h>
@@ -30,8 +31,17 @@ namespace ft {
 
     hb_font_t* font() const { return m_font; }
 
+    // Returns the glyphs of the string shaped with the current size
+    // (cached).
+    HBShapedRunPtr shape(const std::string& str) {
+      return m_runCache.shape(m_font, *this, str);
+    }
+
+    HBRunCache& runCache() { return m_runCache; }
+
   private:
     hb_font_t* m_font;
+    HBRunCache m_runCache;
   };
 
   typedef HBFace<FaceFT<SimpleCache> > Face;
@@ -0,0 +1,153 @@
+// LAF FreeType Wrapper
+// Copyright (c) 2024 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include "ft/hb_run_cache.h"
+
+#include "base/debug.h"
+#include "base/utf8_decode.h"
+
+namespace ft {
+
+namespace {
+
+hb_script_t run_script(hb_unicode_funcs_t* funcs, int codepoint)
+{
+  // Same as hb_buffer_guess_segment_properties() for one character
+  const hb_script_t script = hb_unicode_script(funcs, codepoint);
+  if (script == HB_SCRIPT_COMMON ||
+      script == HB_SCRIPT_INHERITED ||
+      script == HB_SCRIPT_UNKNOWN)
+    return HB_SCRIPT_INVALID;
+  return script;
+}
+
+// Scripts of the first code points (Latin, Greek, Cyrillic, Hebrew,
+// Arabic, etc.)
+struct ScriptTable {
+  static constexpr int kSize = 0x800;
+  hb_script_t scripts[kSize];
+
+  ScriptTable() {
+    hb_unicode_funcs_t* funcs = hb_unicode_funcs_get_default();
+    for (int i=0; i<kSize; ++i)
+      scripts[i] = run_script(funcs, i);
+  }
+};
+
+} // anonymous namespace
+
+hb_script_t script_for_code_point(int codepoint)
+{
+  static const ScriptTable table;
+  if (codepoint >= 0 && codepoint < ScriptTable::kSize)
+    return table.scripts[codepoint];
+  if (codepoint < 0 || codepoint > 0x10ffff)
+    return HB_SCRIPT_INVALID;
+  return run_script(hb_unicode_funcs_get_default(), codepoint);
+}
+
+HBRunCache::HBRunCache(int maxRuns)
+  : m_maxRuns(maxRuns)
+  , m_buf(hb_buffer_create())
+{
+  ASSERT(maxRuns > 0);
+}
+
+HBRunCache::~HBRunCache()
+{
+  hb_buffer_destroy(m_buf);
+}
+
+HBShapedRunPtr HBRunCache::shape(hb_font_t* font, FT_Face face,
+                                 const std::string& str)
+{
+  Key key = { str,
+              face->size->metrics.x_ppem,
+              face->size->metrics.y_ppem };
+
+  auto it = m_runs.find(key);
+  if (it != m_runs.end()) {
+    ++m_stats.hits;
+    m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+    return it->second.run;
+  }
+
+  ++m_stats.misses;
+  auto run = std::make_shared<HBShapedRun>();
+  shapeString(font, str, *run);
+
+  if (int(m_runs.size()) == m_maxRuns) {
+    m_runs.erase(*m_lru.back());
+    m_lru.pop_back();
+  }
+
+  it = m_runs.emplace(std::move(key), Entry()).first;
+  m_lru.push_front(&it->first);
+  it->second.run = run;
+  it->second.lru = m_lru.begin();
+  return run;
+}
+
+void HBRunCache::invalidate()
+{
+  m_runs.clear();
+  m_lru.clear();
+}
+
+void HBRunCache::shapeString(hb_font_t* font, const std::string& str,
+                             HBShapedRun& run)
+{
+  base::utf8_decode decode(str);
+  if (decode.is_end())
+    return;
+
+  hb_buffer_clear_contents(m_buf);
+  hb_script_t script = HB_SCRIPT_UNKNOWN;
+
+  const auto begin = str.begin();
+  while (true) {
+    const auto pos = decode.pos();
+    const int chr = decode.next();
+    if (!chr)
+      break;
+
+    const hb_script_t newScript = script_for_code_point(chr);
+    if (newScript && script != newScript) {
+      addBuffer(font, script, run);
+      hb_buffer_clear_contents(m_buf);
+      script = newScript;
+    }
+
+    hb_buffer_add(m_buf, chr, pos - begin);
+  }
+  addBuffer(font, script, run);
+}
+
+void HBRunCache::addBuffer(hb_font_t* font, hb_script_t script,
+                           HBShapedRun& run)
+{
+  if (hb_buffer_get_length(m_buf) == 0)
+    return;
+
+  // Just in case we're compiling with an old harfbuzz version
+#ifdef HB_BUFFER_CLUSTER_LEVEL_MONOTONE_CHARACTERS
+  hb_buffer_set_cluster_level(m_buf, HB_BUFFER_CLUSTER_LEVEL_MONOTONE_CHARACTERS);
+#endif
+  hb_buffer_set_content_type(m_buf, HB_BUFFER_CONTENT_TYPE_UNICODE);
+  hb_buffer_set_script(m_buf, script);
+  hb_buffer_set_direction(m_buf, hb_script_get_horizontal_direction(script));
+
+  hb_shape(font, m_buf, nullptr, 0);
+
+  unsigned int count;
+  auto info = hb_buffer_get_glyph_infos(m_buf, &count);
+  auto pos = hb_buffer_get_glyph_positions(m_buf, &count);
+
+  run.glyphInfo.insert(run.glyphInfo.end(), info, info+count);
+  run.glyphPos.insert(run.glyphPos.end(), pos, pos+count);
+}
+
+} // namespace ft
@@ -0,0 +1,108 @@
+// LAF FreeType Wrapper
+// Copyright (c) 2024 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef FT_HB_RUN_CACHE_H_INCLUDED
+#define FT_HB_RUN_CACHE_H_INCLUDED
+#pragma once
+
+#include "base/disable_copying.h"
+#include "ft/freetype_headers.h"
+
+#include <hb.h>
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ft {
+
+  // Glyphs of a string shaped with HarfBuzz.
+  struct HBShapedRun {
+    std::vector<hb_glyph_info_t> glyphInfo;
+    std::vector<hb_glyph_position_t> glyphPos;
+  };
+
+  using HBShapedRunPtr = std::shared_ptr<const HBShapedRun>;
+
+  // Returns the script of the given code point, or HB_SCRIPT_INVALID
+  // for characters that don't change the script of a run (common,
+  // inherited, or unknown scripts) and invalid code points. Uses a
+  // precalculated table for the first code points.
+  hb_script_t script_for_code_point(int codepoint);
+
+  // Cache of the most recently shaped strings of a face (with a
+  // specific pixel size). Shaped runs are shared pointers, so they
+  // remain valid for the user even if they are evicted from the
+  // cache.
+  class HBRunCache {
+  public:
+    static constexpr int kDefaultMaxRuns = 256;
+
+    struct Stats {
+      uint64_t hits = 0;
+      uint64_t misses = 0;
+    };
+
+    HBRunCache(int maxRuns = kDefaultMaxRuns);
+    ~HBRunCache();
+
+    // Returns the shaped glyphs of "str" (shaping the string if it
+    // isn't in the cache).
+    HBShapedRunPtr shape(hb_font_t* font, FT_Face face,
+                         const std::string& str);
+
+    void invalidate();
+
+    int runCount() const { return int(m_runs.size()); }
+    const Stats& stats() const { return m_stats; }
+
+  private:
+    struct Key {
+      std::string str;
+      FT_UShort xPpem;
+      FT_UShort yPpem;
+
+      bool operator==(const Key& o) const {
+        return (xPpem == o.xPpem &&
+                yPpem == o.yPpem &&
+                str == o.str);
+      }
+    };
+
+    struct KeyHash {
+      size_t operator()(const Key& k) const {
+        return (std::hash<std::string>()(k.str) ^
+                (size_t(k.xPpem) << 16 | k.yPpem) * 0x9e3779b9u);
+      }
+    };
+
+    struct Entry {
+      HBShapedRunPtr run;
+      std::list<const Key*>::iterator lru;
+    };
+
+    void shapeString(hb_font_t* font, const std::string& str,
+                     HBShapedRun& run);
+    void addBuffer(hb_font_t* font, hb_script_t script,
+                   HBShapedRun& run);
+
+    int m_maxRuns;
+    std::unordered_map<Key, Entry, KeyHash> m_runs;
+    // Keys sorted from the most recently used to the least one
+    std::list<const Key*> m_lru;
+    // Reused to shape all strings
+    hb_buffer_t* m_buf;
+    Stats m_stats;
+
+    DISABLE_COPYING(HBRunCache);
+  };
+
+} // namespace ft
+
+#endif
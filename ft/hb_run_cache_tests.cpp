@@ -0,0 +1,114 @@
+// LAF FreeType Wrapper
+// Copyright (c) 2024 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "ft/hb_face.h"
+#include "ft/hb_run_cache.h"
+#include "ft/lib.h"
+#include "ft/test_font.h"
+
+#include <string>
+
+using namespace ft;
+
+// script_for_code_point() must return the same script that
+// hb_buffer_guess_segment_properties() guesses for a run with one
+// character (HB_SCRIPT_INVALID if the character doesn't have a
+// specific script).
+TEST(HBRunCache, ScriptForCodePoint)
+{
+  hb_buffer_t* buf = hb_buffer_create();
+  int mismatch = -1;
+  for (int chr=0; chr<=0x10ffff; ++chr) {
+    hb_buffer_clear_contents(buf);
+    hb_buffer_set_content_type(buf, HB_BUFFER_CONTENT_TYPE_UNICODE);
+    hb_buffer_add(buf, chr, 0);
+    hb_buffer_guess_segment_properties(buf);
+
+    if (script_for_code_point(chr) != hb_buffer_get_script(buf)) {
+      mismatch = chr;
+      break;
+    }
+  }
+  hb_buffer_destroy(buf);
+  EXPECT_EQ(-1, mismatch);
+
+  EXPECT_EQ(HB_SCRIPT_INVALID, script_for_code_point(-1));
+  EXPECT_EQ(HB_SCRIPT_INVALID, script_for_code_point(' '));
+  EXPECT_EQ(HB_SCRIPT_LATIN, script_for_code_point('a'));
+}
+
+TEST(HBRunCache, LruEviction)
+{
+  const std::string fn = find_test_font();
+  if (fn.empty())
+    GTEST_SKIP() << "No font found (set LAF_TEST_FONT)";
+
+  Lib lib;
+  Face face(lib.open(fn));
+  ASSERT_TRUE(face.isValid());
+  face.setSize(16);
+
+  HBRunCache cache(3);
+  auto shape = [&](const char* str) {
+    return cache.shape(face.font(), face, str);
+  };
+
+  shape("a");
+  const HBShapedRunPtr b = shape("b");
+  shape("c");
+  EXPECT_EQ(3, cache.runCount());
+  EXPECT_EQ(0, cache.stats().hits);
+  EXPECT_EQ(3, cache.stats().misses);
+
+  // "b" is the least recently used run, so it's evicted
+  shape("a");
+  shape("d");
+  EXPECT_EQ(3, cache.runCount());
+  EXPECT_EQ(1, cache.stats().hits);
+  EXPECT_EQ(4, cache.stats().misses);
+
+  shape("c");
+  shape("a");
+  shape("d");
+  EXPECT_EQ(4, cache.stats().hits);
+  EXPECT_EQ(4, cache.stats().misses);
+
+  // Evicted runs are still valid for the user
+  ASSERT_TRUE(b != nullptr);
+  EXPECT_EQ(1, b->glyphInfo.size());
+  EXPECT_EQ(1, b->glyphPos.size());
+
+  shape("b");
+  EXPECT_EQ(4, cache.stats().hits);
+  EXPECT_EQ(5, cache.stats().misses);
+  EXPECT_EQ(3, cache.runCount());
+
+  // "c" was evicted to make room for "b"
+  shape("c");
+  EXPECT_EQ(6, cache.stats().misses);
+
+  // Other size is other run
+  face.setSize(24);
+  shape("c");
+  EXPECT_EQ(4, cache.stats().hits);
+  EXPECT_EQ(7, cache.stats().misses);
+  EXPECT_EQ(3, cache.runCount());
+
+  cache.invalidate();
+  EXPECT_EQ(0, cache.runCount());
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1,5 +1,5 @@
 // LAF FreeType Wrapper
-// Copyright (c) 2020  Igara Studio S.A.
+// Copyright (c) 2020-2024  Igara Studio S.A.
 // Copyright (c) 2016-2017 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -36,6 +36,7 @@ FT_Face Lib::open(const std::string& filename)
 
   LOG(VERBOSE, "FT: Loading font '%s'\n", filename.c_str());
 
+  const std::lock_guard lock(m_mutex);
   FT_Face face = nullptr;
   const FT_Error err = FT_Open_Face(m_ft, &args, 0, &face);
   if (!err)
@@ -43,4 +44,14 @@ FT_Face Lib::open(const std::string& filename)
   return face;
 }
 
+FT_Face Lib::open(const uint8_t* data, const size_t size)
+{
+  const std::lock_guard lock(m_mutex);
+  FT_Face face = nullptr;
+  const FT_Error err = FT_New_Memory_Face(m_ft, data, FT_Long(size), 0, &face);
+  if (!err)
+    FT_Select_Charmap(face, FT_ENCODING_UNICODE);
+  return face;
+}
+
 } // namespace ft
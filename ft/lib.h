@@ -1,4 +1,5 @@
 // LAF FreeType Wrapper
+// Copyright (c) 2024 Igara Studio S.A.
 // Copyright (c) 2016-2017 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -11,6 +12,9 @@
 #include "base/disable_copying.h"
 #include "ft/freetype_headers.h"
 
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
 #include <string>
 
 namespace ft {
@@ -24,8 +28,18 @@ namespace ft {
 
     FT_Face open(const std::string& filename);
 
+    // Opens a face from font data in memory (the data must be valid
+    // until the face is closed).
+    FT_Face open(const uint8_t* data, const size_t size);
+
+    // Faces can be used from different threads (one thread per face),
+    // but opening/closing faces must be synchronized (FT_Done_Face()
+    // must be called with this mutex locked).
+    std::mutex& mutex() { return m_mutex; }
+
   private:
     FT_Library m_ft;
+    std::mutex m_mutex;
 
     DISABLE_COPYING(Lib);
   };
@@ -0,0 +1,232 @@
+// LAF FreeType Wrapper
+// Copyright (c) 2024 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include "ft/sdf.h"
+
+#include "base/cpu_features.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+
+#if LAF_HAVE_SSE2
+  #include <emmintrin.h>
+#elif LAF_HAVE_NEON
+  #include <arm_neon.h>
+#endif
+
+#if FREETYPE_MAJOR > 2 || (FREETYPE_MAJOR == 2 && FREETYPE_MINOR >= 11)
+  #define FT_HAVE_SDF 1
+#else
+  #define FT_HAVE_SDF 0
+#endif
+
+namespace ft {
+
+bool is_sdf_supported()
+{
+  return FT_HAVE_SDF;
+}
+
+bool render_sdf_glyph(FT_Face face, FT_UInt glyphIndex, int baseSize,
+                      SdfGlyph& sdf)
+{
+#if FT_HAVE_SDF
+  const FT_UShort xPpem = face->size->metrics.x_ppem;
+  const FT_UShort yPpem = face->size->metrics.y_ppem;
+  FT_Set_Pixel_Sizes(face, baseSize, baseSize);
+
+  // Unhinted outlines as the SDF is scaled to other sizes
+  bool result = false;
+  if (FT_Load_Glyph(face, glyphIndex,
+                    FT_LOAD_NO_HINTING | FT_LOAD_NO_BITMAP) == 0 &&
+      face->glyph->format == FT_GLYPH_FORMAT_OUTLINE &&
+      FT_Render_Glyph(face->glyph, FT_RENDER_MODE_SDF) == 0) {
+    const FT_GlyphSlot slot = face->glyph;
+    const FT_Bitmap& bitmap = slot->bitmap;
+
+    sdf.width = int(bitmap.width);
+    sdf.rows = int(bitmap.rows);
+    sdf.left = slot->bitmap_left;
+    sdf.top = slot->bitmap_top;
+    sdf.baseSize = baseSize;
+    sdf.spread = 8;             // Default "spread" property of the "sdf" module
+    sdf.field.resize(size_t(sdf.width) * sdf.rows);
+    for (int v=0; v<sdf.rows; ++v) {
+      std::memcpy(&sdf.field[size_t(v)*sdf.width],
+                  bitmap.buffer + v*bitmap.pitch, sdf.width);
+    }
+    result = true;
+  }
+
+  FT_Set_Pixel_Sizes(face, xPpem, yPpem);
+  return result;
+#else
+  return false;
+#endif
+}
+
+void sdf_coverage_row(const SdfGlyph& sdf, double scale,
+                      double fx, double fy, int n, uint8_t* coverage)
+{
+  const int w = sdf.width;
+  const int h = sdf.rows;
+
+  // Pixels outside the field are at the max distance (outside)
+  const double fy0 = std::floor(fy);
+  const int y0 = int(fy0);
+  const float wy = float(fy - fy0);
+  const uint8_t* top = nullptr;
+  const uint8_t* bottom = nullptr;
+  if (w > 0) {
+    if (y0 >= 0 && y0 < h)
+      top = &sdf.field[size_t(y0)*w];
+    if (y0+1 >= 0 && y0+1 < h)
+      bottom = &sdf.field[size_t(y0+1)*w];
+  }
+  if (!top && !bottom) {
+    std::memset(coverage, 0, n);
+    return;
+  }
+
+  // The two rows are interpolated vertically only once, so each
+  // pixel is a linear interpolation in this row. row[x+1] is the
+  // distance at "x" in the [-1, w+1] range (0 outside the field).
+  float stackRow[256];
+  std::vector<float> heapRow;
+  float* row = stackRow;
+  if (w+3 > int(std::size(stackRow))) {
+    heapRow.resize(w+3);
+    row = heapRow.data();
+  }
+  row[0] = row[w+1] = row[w+2] = 0.0f;
+  for (int x=0; x<w; ++x) {
+    const float a = (top ? top[x]: 0.0f);
+    const float b = (bottom ? bottom[x]: 0.0f);
+    row[x+1] = a + (b - a) * wy;
+  }
+
+  // Distances are in the [-spread, +spread] range (base size
+  // pixels), then we scale them to output pixels. The coverage is
+  // 0.5 at the edge and goes from 0 to 1 in one output pixel.
+  const float k = float(scale * sdf.spread / 128.0);
+  const float step = float(1.0 / scale);
+  const float x0 = float(fx);
+  // Positions are clamped to [-1, w] (the field is 0 outside) and
+  // moved one pixel to the right, so the truncation is the floor.
+  const float maxX = float(w);
+
+  int i = 0;
+
+#if LAF_HAVE_SSE2
+  {
+    const __m128 lane = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    const __m128 vx0 = _mm_set1_ps(x0);
+    const __m128 vstep = _mm_set1_ps(step);
+    const __m128 vmin = _mm_set1_ps(-1.0f);
+    const __m128 vmax = _mm_set1_ps(maxX);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 vk = _mm_set1_ps(k);
+    const __m128 edge = _mm_set1_ps(128.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 v255 = _mm_set1_ps(255.0f);
+    alignas(16) int32_t idx[4];
+
+    for (; i+4<=n; i+=4) {
+      __m128 px = _mm_add_ps(vx0, _mm_mul_ps(_mm_add_ps(_mm_set1_ps(float(i)), lane), vstep));
+      px = _mm_add_ps(_mm_min_ps(_mm_max_ps(px, vmin), vmax), one);
+      const __m128i xi = _mm_cvttps_epi32(px);
+      const __m128 wx = _mm_sub_ps(px, _mm_cvtepi32_ps(xi));
+      _mm_store_si128((__m128i*)idx, xi);
+
+      const __m128 a = _mm_setr_ps(row[idx[0]], row[idx[1]], row[idx[2]], row[idx[3]]);
+      const __m128 b = _mm_setr_ps(row[idx[0]+1], row[idx[1]+1], row[idx[2]+1], row[idx[3]+1]);
+      const __m128 d = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), wx));
+
+      __m128 c = _mm_add_ps(half, _mm_mul_ps(_mm_sub_ps(d, edge), vk));
+      c = _mm_min_ps(_mm_max_ps(c, zero), one);
+      __m128i ci = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(c, v255), half));
+      ci = _mm_packs_epi32(ci, ci);
+      ci = _mm_packus_epi16(ci, ci);
+      const uint32_t v = _mm_cvtsi128_si32(ci);
+      std::memcpy(coverage+i, &v, 4);
+    }
+  }
+#elif LAF_HAVE_NEON
+  {
+    static const float kLane[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+    const float32x4_t lane = vld1q_f32(kLane);
+    const float32x4_t vx0 = vdupq_n_f32(x0);
+    const float32x4_t vstep = vdupq_n_f32(step);
+    const float32x4_t vmin = vdupq_n_f32(-1.0f);
+    const float32x4_t vmax = vdupq_n_f32(maxX);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t vk = vdupq_n_f32(k);
+    const float32x4_t edge = vdupq_n_f32(128.0f);
+    const float32x4_t half = vdupq_n_f32(0.5f);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const float32x4_t v255 = vdupq_n_f32(255.0f);
+    int32_t idx[4];
+    float av[4], bv[4];
+
+    for (; i+4<=n; i+=4) {
+      float32x4_t px = vaddq_f32(vx0, vmulq_f32(vaddq_f32(vdupq_n_f32(float(i)), lane), vstep));
+      px = vaddq_f32(vminq_f32(vmaxq_f32(px, vmin), vmax), one);
+      const int32x4_t xi = vcvtq_s32_f32(px);
+      const float32x4_t wx = vsubq_f32(px, vcvtq_f32_s32(xi));
+      vst1q_s32(idx, xi);
+
+      for (int j=0; j<4; ++j) {
+        av[j] = row[idx[j]];
+        bv[j] = row[idx[j]+1];
+      }
+      const float32x4_t a = vld1q_f32(av);
+      const float32x4_t b = vld1q_f32(bv);
+      const float32x4_t d = vaddq_f32(a, vmulq_f32(vsubq_f32(b, a), wx));
+
+      float32x4_t c = vaddq_f32(half, vmulq_f32(vsubq_f32(d, edge), vk));
+      c = vminq_f32(vmaxq_f32(c, zero), one);
+      const uint32x4_t ci = vcvtq_u32_f32(vaddq_f32(vmulq_f32(c, v255), half));
+      const uint16x4_t c16 = vmovn_u32(ci);
+      const uint8x8_t c8 = vmovn_u16(vcombine_u16(c16, c16));
+      const uint32_t v = vget_lane_u32(vreinterpret_u32_u8(c8), 0);
+      std::memcpy(coverage+i, &v, 4);
+    }
+  }
+#endif
+
+  for (; i<n; ++i) {
+    const float px = std::clamp(x0 + float(i) * step, -1.0f, maxX) + 1.0f;
+    const int xi = int(px);
+    const float wx = px - float(xi);
+    const float d = row[xi] + (row[xi+1] - row[xi]) * wx;
+
+    const float c = std::clamp(0.5f + (d - 128.0f) * k, 0.0f, 1.0f);
+    coverage[i] = uint8_t(c * 255.0f + 0.5f);
+  }
+}
+
+const SdfGlyph* SdfCache::glyph(FT_Face face, FT_UInt glyphIndex)
+{
+  auto it = m_glyphs.find(glyphIndex);
+  if (it != m_glyphs.end())
+    return it->second.get();
+
+  if (int(m_glyphs.size()) >= kMaxGlyphs)
+    m_glyphs.clear();
+
+  auto sdf = std::make_unique<SdfGlyph>();
+  if (!render_sdf_glyph(face, glyphIndex, kBaseSize, *sdf))
+    sdf.reset();
+
+  const SdfGlyph* result = sdf.get();
+  m_glyphs[glyphIndex] = std::move(sdf);
+  return result;
+}
+
+} // namespace ft
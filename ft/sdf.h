@@ -0,0 +1,68 @@
+// LAF FreeType Wrapper
+// Copyright (c) 2024 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef FT_SDF_H_INCLUDED
+#define FT_SDF_H_INCLUDED
+#pragma once
+
+#include "ft/freetype_headers.h"
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace ft {
+
+  // Signed distance field of a glyph rendered at a base size, which
+  // can be used to draw the glyph at any size.
+  struct SdfGlyph {
+    int width = 0;              // Size of the field
+    int rows = 0;
+    int left = 0;               // Position of the field relative to
+    int top = 0;                // the pen/baseline at the base size
+    int baseSize = 0;
+    int spread = 0;             // Max distance (in pixels) of the field
+    // 8-bit distances, 128 is the edge of the glyph and bigger values
+    // are inside the glyph
+    std::vector<uint8_t> field;
+  };
+
+  // Returns true if FreeType can render SDF glyphs
+  // (FT_RENDER_MODE_SDF needs FreeType 2.11).
+  bool is_sdf_supported();
+
+  // Renders the SDF of the given glyph at "baseSize" (in pixels). The
+  // size of the face is restored before returning.
+  bool render_sdf_glyph(FT_Face face, FT_UInt glyphIndex, int baseSize,
+                        SdfGlyph& sdf);
+
+  // Calculates the coverage of "n" pixels of a glyph scaled by
+  // "scale" (output size / base size). (fx, fy) is the position in
+  // the field (in field pixels) of the center of the first pixel,
+  // and the next pixels are at fx + i/scale.
+  void sdf_coverage_row(const SdfGlyph& sdf, double scale,
+                        double fx, double fy, int n, uint8_t* coverage);
+
+  // SDFs of the glyphs of a face at kBaseSize (one per glyph, valid
+  // for all sizes).
+  class SdfCache {
+  public:
+    static constexpr int kBaseSize = 48;
+    static constexpr int kMaxGlyphs = 1024;
+
+    // Returns nullptr if the SDF cannot be rendered.
+    const SdfGlyph* glyph(FT_Face face, FT_UInt glyphIndex);
+
+    void invalidate() { m_glyphs.clear(); }
+
+  private:
+    std::unordered_map<FT_UInt, std::unique_ptr<SdfGlyph>> m_glyphs;
+  };
+
+} // namespace ft
+
+#endif
@@ -0,0 +1,166 @@
+// LAF FreeType Wrapper
+// Copyright (c) 2024 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "ft/sdf.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace ft;
+
+// Field with a vertical edge at x=8 (the glyph is at the right side),
+// the distance grows 16 levels (i.e. one pixel) per pixel.
+static SdfGlyph make_edge_field(int width = 16, int rows = 4)
+{
+  SdfGlyph sdf;
+  sdf.width = width;
+  sdf.rows = rows;
+  sdf.baseSize = 48;
+  sdf.spread = 8;
+  sdf.field.resize(size_t(width) * rows);
+  for (int y=0; y<rows; ++y)
+    for (int x=0; x<width; ++x)
+      sdf.field[size_t(y)*width + x] = uint8_t(std::clamp(128 + (x-8)*16, 0, 255));
+  return sdf;
+}
+
+static std::vector<int> coverage_row(const SdfGlyph& sdf, double scale,
+                                     double fx, double fy, int n)
+{
+  std::vector<uint8_t> coverage(n, 77);
+  sdf_coverage_row(sdf, scale, fx, fy, n, coverage.data());
+  return std::vector<int>(coverage.begin(), coverage.end());
+}
+
+// Bilinear sampling of the field as it was calculated originally
+// (with doubles, one pixel at a time).
+static int reference_coverage(const SdfGlyph& sdf, double scale,
+                              double fx, double fy)
+{
+  auto texel = [&sdf](int x, int y) -> double {
+    if (x < 0 || y < 0 || x >= sdf.width || y >= sdf.rows)
+      return 0;
+    return sdf.field[size_t(y)*sdf.width + x];
+  };
+  const int x0 = int(std::floor(fx));
+  const int y0 = int(std::floor(fy));
+  const double wx = fx - x0;
+  const double wy = fy - y0;
+  const double top = texel(x0, y0) + (texel(x0+1, y0) - texel(x0, y0)) * wx;
+  const double bottom = texel(x0, y0+1) + (texel(x0+1, y0+1) - texel(x0, y0+1)) * wx;
+  const double d = top + (bottom - top) * wy;
+  const double c = std::clamp(0.5 + (d - 128.0) * scale * sdf.spread / 128.0, 0.0, 1.0);
+  return int(c * 255.0 + 0.5);
+}
+
+TEST(Sdf, EdgeCoverage)
+{
+  const SdfGlyph sdf = make_edge_field();
+
+  // Coverage is 0.5 just at the edge, 0 one pixel outside, and 1
+  // one pixel inside
+  EXPECT_EQ(std::vector<int>({ 0, 128, 255 }),
+            coverage_row(sdf, 1.0, 7.0, 1.0, 3));
+
+  // A quarter of pixel from the edge
+  EXPECT_EQ(64, coverage_row(sdf, 1.0, 7.75, 1.0, 1)[0]);
+  EXPECT_EQ(191, coverage_row(sdf, 1.0, 8.25, 1.0, 1)[0]);
+
+  // Same coverage in all rows of the field
+  for (int y=0; y<sdf.rows-1; ++y)
+    EXPECT_EQ(128, coverage_row(sdf, 1.0, 8.0, y + 0.25, 1)[0]);
+}
+
+TEST(Sdf, Scaling)
+{
+  const SdfGlyph sdf = make_edge_field();
+
+  // Two times bigger: pixels are at half a field pixel, and the
+  // transition is two times sharper
+  EXPECT_EQ(std::vector<int>({ 0, 0, 128, 255, 255 }),
+            coverage_row(sdf, 2.0, 7.0, 1.0, 5));
+
+  // Four times smaller: pixels are 4 field pixels away, and the
+  // transition is four times smoother
+  EXPECT_EQ(std::vector<int>({ 64, 255 }),
+            coverage_row(sdf, 0.25, 7.0, 1.0, 2));
+  EXPECT_EQ(std::vector<int>({ 0, 128, 255 }),
+            coverage_row(sdf, 0.25, 4.0, 1.0, 3));
+}
+
+TEST(Sdf, OutOfField)
+{
+  SdfGlyph sdf = make_edge_field();
+  std::fill(sdf.field.begin(), sdf.field.end(), 255);
+
+  // Inside the glyph
+  EXPECT_EQ(std::vector<int>(8, 255), coverage_row(sdf, 1.0, 4.0, 1.0, 8));
+
+  // Rows and columns outside the field are at the max distance
+  EXPECT_EQ(std::vector<int>(11, 0), coverage_row(sdf, 1.0, 2.0, -3.0, 11));
+  EXPECT_EQ(std::vector<int>(11, 0), coverage_row(sdf, 1.0, 2.0, 6.0, 11));
+  EXPECT_EQ(std::vector<int>(9, 0), coverage_row(sdf, 1.0, -100.0, 1.0, 9));
+  EXPECT_EQ(std::vector<int>(9, 0), coverage_row(sdf, 1.0, 17.0, 1.0, 9));
+  EXPECT_EQ(std::vector<int>(9, 0), coverage_row(sdf, 3.0, 1000.0, 1.0, 9));
+
+  // The row crosses the whole field
+  const std::vector<int> row = coverage_row(sdf, 1.0, -4.0, 1.0, 24);
+  EXPECT_EQ(std::vector<int>(row.begin(), row.begin()+3), std::vector<int>(3, 0));
+  EXPECT_EQ(std::vector<int>(row.begin()+5, row.begin()+19), std::vector<int>(14, 255));
+  EXPECT_EQ(std::vector<int>(row.begin()+21, row.end()), std::vector<int>(3, 0));
+
+  // Empty field
+  EXPECT_EQ(std::vector<int>(5, 0), coverage_row(SdfGlyph(), 1.0, 0.0, 0.0, 5));
+}
+
+// Float lanes give the same coverage as the original double
+// implementation (+/-1), with fields smaller and bigger than the
+// row buffer in the stack.
+TEST(Sdf, MatchesReference)
+{
+  std::mt19937 rng(42);
+  for (const int width : { 5, 64, 300 }) {
+    SdfGlyph sdf;
+    sdf.width = width;
+    sdf.rows = 7;
+    sdf.baseSize = 48;
+    sdf.spread = 8;
+    sdf.field.resize(size_t(sdf.width) * sdf.rows);
+    for (uint8_t& d : sdf.field)
+      d = uint8_t(rng());
+
+    for (const double scale : { 0.1, 0.37, 1.0, 1.5, 4.0 }) {
+      std::uniform_real_distribution<double> pos(-3.0, width+3.0);
+      for (int j=0; j<64; ++j) {
+        const double fx = pos(rng);
+        const double fy = std::uniform_real_distribution<double>(-2.0, 9.0)(rng);
+        const int n = 1 + int(rng() % 41);
+        const std::vector<int> row = coverage_row(sdf, scale, fx, fy, n);
+        for (int i=0; i<n; ++i) {
+          const int expected = reference_coverage(sdf, scale, fx + i/scale, fy);
+          ASSERT_LE(std::abs(expected - row[i]), 1)
+            << "width=" << width << " scale=" << scale
+            << " fx=" << fx << " fy=" << fy << " i=" << i;
+        }
+      }
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
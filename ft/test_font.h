@@ -0,0 +1,44 @@
+// LAF FreeType Wrapper
+// Copyright (c) 2024 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef FT_TEST_FONT_H_INCLUDED
+#define FT_TEST_FONT_H_INCLUDED
+#pragma once
+
+#include "base/fs.h"
+
+#include <cstdlib>
+#include <string>
+
+namespace ft {
+
+  // Font file used by the ft tests, it can be specified with the
+  // LAF_TEST_FONT environment variable. Returns an empty string if
+  // no font is found (tests that need glyphs are skipped in that
+  // case).
+  inline std::string find_test_font() {
+    if (const char* env = std::getenv("LAF_TEST_FONT"))
+      return env;
+
+    static const char* kCandidates[] = {
+      "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf",
+      "/usr/share/fonts/TTF/DejaVuSans.ttf",
+      "/usr/share/fonts/dejavu/DejaVuSans.ttf",
+      "/usr/share/fonts/truetype/liberation/LiberationSans-Regular.ttf",
+      "/System/Library/Fonts/Supplemental/Arial.ttf",
+      "/Library/Fonts/Arial.ttf",
+      "C:/Windows/Fonts/arial.ttf",
+    };
+    for (const char* fn : kCandidates) {
+      if (base::is_file(fn))
+        return fn;
+    }
+    return std::string();
+  }
+
+} // namespace ft
+
+#endif
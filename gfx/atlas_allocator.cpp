@@ -0,0 +1,331 @@
+// LAF Gfx Library
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gfx/atlas_allocator.h"
+
+#include "base/debug.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace gfx {
+
+AtlasAllocator::AtlasAllocator(const Size& size, int shelfAlignment)
+  : m_size(size)
+  , m_alignment(std::max(shelfAlignment, 1))
+{
+}
+
+void AtlasAllocator::clear()
+{
+  m_nextY = 0;
+  m_count = 0;
+  m_allocatedArea = 0;
+  m_shelves.clear();
+  m_deadShelves.clear();
+  m_shelvesByY.clear();
+  m_slots.clear();
+  m_emptyShelves.clear();
+  m_allocs.clear();
+  m_freeIds.clear();
+}
+
+double AtlasAllocator::occupancy() const
+{
+  const int64_t area = int64_t(m_size.w) * m_size.h;
+  return (area > 0 ? double(m_allocatedArea) / double(area): 0.0);
+}
+
+AtlasAllocator::Id AtlasAllocator::allocate(const Size& sz)
+{
+  if (sz.w <= 0 || sz.h <= 0 ||
+      sz.w > m_size.w || sz.h > m_size.h)
+    return kNoId;
+
+  Slot slot;
+  int shelf = findSlot(sz.w, sz.h, slot);
+  if (shelf < 0) {
+    // Height of the new shelf
+    int h = std::min(m_size.h,
+                     (sz.h + m_alignment - 1) / m_alignment * m_alignment);
+
+    shelf = takeEmptyShelf(h);
+    if (shelf < 0) {
+      // Use the rest of the texture if there is no room for a full
+      // aligned shelf.
+      if (m_nextY + h > m_size.h)
+        h = m_size.h - m_nextY;
+      if (h < sz.h)
+        return kNoId;
+
+      shelf = createShelf(m_nextY, h);
+      m_nextY += h;
+    }
+    slot = Slot{ m_size.w, shelf, 0 };
+  }
+
+  removeFreeSlot(shelf, slot.x, slot.w);
+  if (slot.w > sz.w)
+    addFreeSlot(shelf, slot.x + sz.w, slot.w - sz.w);
+  m_shelves[shelf].freeWidth -= sz.w;
+
+  Id id;
+  if (!m_freeIds.empty()) {
+    id = m_freeIds.back();
+    m_freeIds.pop_back();
+  }
+  else {
+    id = Id(m_allocs.size());
+    m_allocs.emplace_back();
+  }
+
+  Alloc& alloc = m_allocs[id];
+  alloc.rc = Rect(slot.x, m_shelves[shelf].y, sz.w, sz.h);
+  alloc.shelf = shelf;
+
+  ++m_count;
+  m_allocatedArea += int64_t(sz.w) * sz.h;
+  return id;
+}
+
+void AtlasAllocator::free(Id id)
+{
+  ASSERT(id >= 0 && id < Id(m_allocs.size()));
+  Alloc& alloc = m_allocs[id];
+  const int shelf = alloc.shelf;
+  if (shelf < 0)
+    return;
+
+  addFreeSlot(shelf, alloc.rc.x, alloc.rc.w);
+  m_shelves[shelf].freeWidth += alloc.rc.w;
+
+  --m_count;
+  m_allocatedArea -= int64_t(alloc.rc.w) * alloc.rc.h;
+  alloc.shelf = -1;
+  m_freeIds.push_back(id);
+
+  if (m_shelves[shelf].freeWidth == m_size.w)
+    releaseEmptyShelf(shelf);
+}
+
+std::vector<AtlasAllocator::Move> AtlasAllocator::compact()
+{
+  std::vector<Id> ids;
+  ids.reserve(m_count);
+  for (Id id=0; id<Id(m_allocs.size()); ++id) {
+    if (m_allocs[id].shelf >= 0)
+      ids.push_back(id);
+  }
+
+  // Taller allocations first to fill shelves with similar heights
+  // (keeping the current order of equal sizes, so compacting an
+  // already compacted atlas doesn't move anything).
+  std::sort(ids.begin(), ids.end(),
+            [this](Id a, Id b){
+              const Rect& ra = m_allocs[a].rc;
+              const Rect& rb = m_allocs[b].rc;
+              if (ra.h != rb.h) return ra.h > rb.h;
+              if (ra.w != rb.w) return ra.w > rb.w;
+              if (ra.y != rb.y) return ra.y < rb.y;
+              return ra.x < rb.x;
+            });
+
+  AtlasAllocator tmp(m_size, m_alignment);
+  std::vector<Id> tmpIds(ids.size());
+  for (size_t i=0; i<ids.size(); ++i) {
+    tmpIds[i] = tmp.allocate(m_allocs[ids[i]].rc.size());
+    if (tmpIds[i] == kNoId)
+      return std::vector<Move>();
+  }
+
+  std::vector<Move> moves;
+  for (size_t i=0; i<ids.size(); ++i) {
+    Alloc& alloc = m_allocs[ids[i]];
+    const Alloc& newAlloc = tmp.m_allocs[tmpIds[i]];
+    if (alloc.rc != newAlloc.rc)
+      moves.push_back(Move{ ids[i], alloc.rc, newAlloc.rc });
+    alloc.rc = newAlloc.rc;
+    alloc.shelf = newAlloc.shelf;
+  }
+
+  m_nextY = tmp.m_nextY;
+  m_shelves = std::move(tmp.m_shelves);
+  m_deadShelves = std::move(tmp.m_deadShelves);
+  m_shelvesByY = std::move(tmp.m_shelvesByY);
+  m_slots = std::move(tmp.m_slots);
+  m_emptyShelves = std::move(tmp.m_emptyShelves);
+  return moves;
+}
+
+// Finds the narrowest free slot (in the shortest shelf) for the given
+// size, only in shelves that are not too tall for it (to avoid
+// wasting space). Returns the shelf index or -1.
+int AtlasAllocator::findSlot(int w, int h, Slot& slot) const
+{
+  const int maxH = h + std::max(h/2, m_alignment);
+  for (auto it=m_slots.lower_bound(h), end=m_slots.end();
+       it != end && it->first <= maxH; ++it) {
+    const std::set<Slot>& slots = it->second;
+    auto jt = slots.lower_bound(Slot{ w, -1, -1 });
+    if (jt != slots.end()) {
+      slot = *jt;
+      return slot.shelf;
+    }
+  }
+  return -1;
+}
+
+// Returns an empty shelf with the given height (splitting a taller
+// empty shelf), or -1 if there is no empty shelf for it.
+int AtlasAllocator::takeEmptyShelf(int h)
+{
+  auto it = m_emptyShelves.lower_bound(std::make_pair(h, -1));
+  if (it == m_emptyShelves.end())
+    return -1;
+
+  const int shelf = it->second;
+  m_emptyShelves.erase(it);
+
+  Shelf& sh = m_shelves[shelf];
+  const int y = sh.y;
+  const int rest = sh.h - h;
+  sh.h = h;
+  sh.empty = false;
+  m_slots[h].insert(Slot{ m_size.w, shelf, 0 });
+
+  if (rest > 0) {
+    const int restShelf = createShelf(y + h, rest);
+    removeFreeSlot(restShelf, 0, m_size.w);
+    m_shelves[restShelf].free[0] = m_size.w;
+    m_shelves[restShelf].empty = true;
+    m_emptyShelves.insert(std::make_pair(rest, restShelf));
+  }
+  return shelf;
+}
+
+int AtlasAllocator::createShelf(int y, int h)
+{
+  int shelf;
+  if (!m_deadShelves.empty()) {
+    shelf = m_deadShelves.back();
+    m_deadShelves.pop_back();
+  }
+  else {
+    shelf = int(m_shelves.size());
+    m_shelves.emplace_back();
+  }
+
+  Shelf& sh = m_shelves[shelf];
+  sh.y = y;
+  sh.h = h;
+  sh.freeWidth = m_size.w;
+  sh.empty = false;
+  sh.free.clear();
+  sh.free[0] = m_size.w;
+
+  m_shelvesByY[y] = shelf;
+  m_slots[h].insert(Slot{ m_size.w, shelf, 0 });
+  return shelf;
+}
+
+// Removes an empty shelf (it must be in any list).
+void AtlasAllocator::destroyShelf(int shelf)
+{
+  m_shelvesByY.erase(m_shelves[shelf].y);
+  m_shelves[shelf].free.clear();
+  m_deadShelves.push_back(shelf);
+}
+
+// Adds the free slot [x, x+w) to the shelf merging it with adjacent
+// free slots.
+void AtlasAllocator::addFreeSlot(int shelf, int x, int w)
+{
+  std::map<int, int>& free = m_shelves[shelf].free;
+  auto next = free.lower_bound(x);
+  if (next != free.begin()) {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second == x) {
+      const int prevX = prev->first;
+      const int prevW = prev->second;
+      removeFreeSlot(shelf, prevX, prevW);
+      x = prevX;
+      w += prevW;
+    }
+  }
+  if (next != free.end() && x + w == next->first) {
+    const int nextX = next->first;
+    const int nextW = next->second;
+    removeFreeSlot(shelf, nextX, nextW);
+    w += nextW;
+  }
+
+  free[x] = w;
+  const Shelf& sh = m_shelves[shelf];
+  if (!sh.empty)
+    m_slots[sh.h].insert(Slot{ w, shelf, x });
+}
+
+void AtlasAllocator::removeFreeSlot(int shelf, int x, int w)
+{
+  Shelf& sh = m_shelves[shelf];
+  sh.free.erase(x);
+  if (sh.empty)
+    return;
+
+  auto it = m_slots.find(sh.h);
+  ASSERT(it != m_slots.end());
+  it->second.erase(Slot{ w, shelf, x });
+  if (it->second.empty())
+    m_slots.erase(it);
+}
+
+// Called when all the allocations of a shelf were freed, merges the
+// shelf with adjacent empty shelves (or with the unused area at the
+// bottom of the texture) so it can be reused for other heights.
+void AtlasAllocator::releaseEmptyShelf(int shelf)
+{
+  removeFreeSlot(shelf, 0, m_size.w);
+  m_shelves[shelf].free[0] = m_size.w;
+  m_shelves[shelf].empty = true;
+
+  auto it = m_shelvesByY.find(m_shelves[shelf].y);
+  ASSERT(it != m_shelvesByY.end());
+
+  auto next = std::next(it);
+  if (next != m_shelvesByY.end() &&
+      m_shelves[next->second].empty) {
+    const int other = next->second;
+    m_emptyShelves.erase(std::make_pair(m_shelves[other].h, other));
+    m_shelves[shelf].h += m_shelves[other].h;
+    destroyShelf(other);
+  }
+
+  if (it != m_shelvesByY.begin()) {
+    auto prev = std::prev(it);
+    const int other = prev->second;
+    if (m_shelves[other].empty) {
+      m_emptyShelves.erase(std::make_pair(m_shelves[other].h, other));
+      m_shelves[other].h += m_shelves[shelf].h;
+      destroyShelf(shelf);
+      shelf = other;
+    }
+  }
+
+  const Shelf& sh = m_shelves[shelf];
+  if (sh.y + sh.h == m_nextY) {
+    m_nextY = sh.y;
+    destroyShelf(shelf);
+  }
+  else {
+    m_emptyShelves.insert(std::make_pair(sh.h, shelf));
+  }
+}
+
+} // namespace gfx
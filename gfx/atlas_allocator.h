@@ -0,0 +1,125 @@
+// LAF Gfx Library
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef GFX_ATLAS_ALLOCATOR_H_INCLUDED
+#define GFX_ATLAS_ALLOCATOR_H_INCLUDED
+#pragma once
+
+#include "base/ints.h"
+#include "gfx/rect.h"
+#include "gfx/size.h"
+
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace gfx {
+
+  // Allocates rectangles inside a fixed size texture (e.g. a glyph
+  // atlas or a thumbnail cache) that can be freed at any moment.
+  //
+  // Rectangles are placed in horizontal shelves (with heights
+  // rounded up to a multiple of "shelfAlignment"). Free space inside
+  // shelves is kept as a list of free slots (adjacent free slots are
+  // merged), and empty shelves are merged/reused for other heights.
+  // allocate() and free() are O(log n) operations (allocate() checks
+  // the few shelf heights that are similar to the requested one).
+  class AtlasAllocator {
+  public:
+    using Id = int;
+    static constexpr Id kNoId = -1;
+
+    // Movement of an allocation in compact().
+    struct Move {
+      Id id;
+      Rect from;
+      Rect to;
+    };
+
+    explicit AtlasAllocator(const Size& size, int shelfAlignment = 8);
+
+    const Size& size() const { return m_size; }
+
+    // Returns the ID of the new allocation (see rect()), or kNoId if
+    // there is no room for it.
+    Id allocate(const Size& size);
+    void free(Id id);
+    void clear();
+
+    // Returns the position of the allocation in the texture.
+    const Rect& rect(Id id) const { return m_allocs[id].rc; }
+
+    // Statistics
+    int allocationCount() const { return m_count; }
+    int64_t allocatedArea() const { return m_allocatedArea; }
+    int usedHeight() const { return m_nextY; }
+    // Returns the allocated area / texture area (from 0.0 to 1.0).
+    double occupancy() const;
+
+    // Rearranges all allocations to remove fragmentation. Returns the
+    // list of allocations that were moved (IDs don't change). Moves
+    // can overlap, so pixels should be copied from a copy of the
+    // texture. If the allocations don't fit in the new arrangement,
+    // nothing changes and the returned list is empty.
+    std::vector<Move> compact();
+
+  private:
+    // Free horizontal slot [x, x+w) inside a shelf.
+    struct Slot {
+      int w;
+      int shelf;
+      int x;
+      bool operator<(const Slot& o) const {
+        return (w < o.w ||
+                (w == o.w && (shelf < o.shelf ||
+                              (shelf == o.shelf && x < o.x))));
+      }
+    };
+
+    struct Shelf {
+      int y = 0;
+      int h = 0;
+      int freeWidth = 0;
+      bool empty = false;       // In m_emptyShelves (not in m_slots)
+      std::map<int, int> free;  // Free slots (x -> width)
+    };
+
+    struct Alloc {
+      Rect rc;
+      int shelf = -1;
+    };
+
+    int findSlot(int w, int h, Slot& slot) const;
+    int takeEmptyShelf(int h);
+    int createShelf(int y, int h);
+    void destroyShelf(int shelf);
+    void addFreeSlot(int shelf, int x, int w);
+    void removeFreeSlot(int shelf, int x, int w);
+    void releaseEmptyShelf(int shelf);
+
+    Size m_size;
+    int m_alignment;
+    int m_nextY = 0;
+    int m_count = 0;
+    int64_t m_allocatedArea = 0;
+
+    std::vector<Shelf> m_shelves;
+    std::vector<int> m_deadShelves;
+    // Shelves sorted by y-coordinate (y -> shelf)
+    std::map<int, int> m_shelvesByY;
+    // Free slots of non-empty shelves by shelf height
+    std::map<int, std::set<Slot>> m_slots;
+    // Empty shelves by height (h, shelf)
+    std::set<std::pair<int, int>> m_emptyShelves;
+
+    std::vector<Alloc> m_allocs;
+    std::vector<Id> m_freeIds;
+  };
+
+} // namespace gfx
+
+#endif
@@ -0,0 +1,226 @@
+// LAF Gfx Library
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "gfx/atlas_allocator.h"
+#include "gfx/rect_io.h"
+#include "gfx/size_io.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace gfx;
+
+using Id = AtlasAllocator::Id;
+
+// Checks that all allocations are inside the texture and don't
+// overlap each other.
+static void expect_valid(const AtlasAllocator& atlas,
+                         const std::vector<Id>& ids,
+                         const std::vector<Size>& sizes)
+{
+  const Rect bounds(atlas.size());
+  std::vector<uint8_t> used(bounds.w * bounds.h, 0);
+  int64_t area = 0;
+  for (size_t i=0; i<ids.size(); ++i) {
+    const Rect& rc = atlas.rect(ids[i]);
+    EXPECT_EQ(sizes[i], rc.size());
+    ASSERT_TRUE(bounds.contains(rc)) << rc;
+    for (int y=rc.y; y<rc.y2(); ++y) {
+      for (int x=rc.x; x<rc.x2(); ++x) {
+        ASSERT_EQ(0, used[y*bounds.w + x]) << rc;
+        used[y*bounds.w + x] = 1;
+      }
+    }
+    area += rc.w * rc.h;
+  }
+  EXPECT_EQ(int(ids.size()), atlas.allocationCount());
+  EXPECT_EQ(area, atlas.allocatedArea());
+}
+
+TEST(AtlasAllocator, Simple)
+{
+  AtlasAllocator atlas(Size(64, 64), 8);
+  EXPECT_EQ(0, atlas.allocationCount());
+  EXPECT_EQ(0.0, atlas.occupancy());
+
+  Id a = atlas.allocate(Size(10, 8));
+  Id b = atlas.allocate(Size(20, 6));
+  Id c = atlas.allocate(Size(10, 12));
+  EXPECT_EQ(Rect(0, 0, 10, 8), atlas.rect(a));
+  EXPECT_EQ(Rect(10, 0, 20, 6), atlas.rect(b));
+  EXPECT_EQ(Rect(0, 8, 10, 12), atlas.rect(c));
+  EXPECT_EQ(24, atlas.usedHeight());
+  EXPECT_EQ(3, atlas.allocationCount());
+  EXPECT_EQ(80+120+120, atlas.allocatedArea());
+  EXPECT_DOUBLE_EQ(320.0 / 4096.0, atlas.occupancy());
+
+  EXPECT_EQ(AtlasAllocator::kNoId, atlas.allocate(Size(0, 4)));
+  EXPECT_EQ(AtlasAllocator::kNoId, atlas.allocate(Size(65, 4)));
+  EXPECT_EQ(AtlasAllocator::kNoId, atlas.allocate(Size(4, 65)));
+
+  atlas.clear();
+  EXPECT_EQ(0, atlas.allocationCount());
+  EXPECT_EQ(0, atlas.usedHeight());
+  EXPECT_EQ(Rect(0, 0, 4, 4), atlas.rect(atlas.allocate(Size(4, 4))));
+}
+
+TEST(AtlasAllocator, Full)
+{
+  AtlasAllocator atlas(Size(32, 32), 8);
+  for (int i=0; i<16; ++i)
+    EXPECT_NE(AtlasAllocator::kNoId, atlas.allocate(Size(8, 8)));
+  EXPECT_EQ(AtlasAllocator::kNoId, atlas.allocate(Size(1, 1)));
+  EXPECT_EQ(1.0, atlas.occupancy());
+
+  // The last shelf can be shorter than the alignment
+  AtlasAllocator atlas2(Size(32, 20), 8);
+  atlas2.allocate(Size(32, 16));
+  EXPECT_EQ(Rect(0, 16, 5, 4), atlas2.rect(atlas2.allocate(Size(5, 4))));
+  EXPECT_EQ(AtlasAllocator::kNoId, atlas2.allocate(Size(5, 5)));
+}
+
+TEST(AtlasAllocator, FreeMergesSlots)
+{
+  AtlasAllocator atlas(Size(30, 64), 8);
+  Id a = atlas.allocate(Size(10, 8));
+  Id b = atlas.allocate(Size(10, 8));
+  Id c = atlas.allocate(Size(10, 8));
+  atlas.allocate(Size(30, 8));  // Second shelf
+
+  // A 20 pixels slot is available only after merging a+b or b+c
+  atlas.free(a);
+  atlas.free(c);
+  EXPECT_EQ(Rect(0, 16, 20, 8), atlas.rect(atlas.allocate(Size(20, 8))));
+  atlas.free(b);
+  EXPECT_EQ(Rect(0, 0, 30, 8), atlas.rect(atlas.allocate(Size(30, 8))));
+
+  // Freed IDs are reused
+  EXPECT_EQ(3, atlas.allocationCount());
+}
+
+TEST(AtlasAllocator, EmptyShelvesAreReused)
+{
+  AtlasAllocator atlas(Size(16, 64), 8);
+  Id a = atlas.allocate(Size(16, 8));
+  Id b = atlas.allocate(Size(16, 8));
+  Id c = atlas.allocate(Size(16, 8));
+  EXPECT_EQ(24, atlas.usedHeight());
+
+  // Merged empty shelves can be used for taller allocations
+  atlas.free(a);
+  atlas.free(b);
+  Id d = atlas.allocate(Size(16, 16));
+  EXPECT_EQ(Rect(0, 0, 16, 16), atlas.rect(d));
+  EXPECT_EQ(24, atlas.usedHeight());
+
+  // Or split for smaller allocations
+  atlas.free(d);
+  Id e = atlas.allocate(Size(16, 4));
+  EXPECT_EQ(Rect(0, 0, 16, 4), atlas.rect(e));
+  EXPECT_EQ(Rect(0, 8, 16, 8), atlas.rect(atlas.allocate(Size(16, 8))));
+
+  // The last shelf gives its space back to the texture
+  atlas.free(c);
+  EXPECT_EQ(16, atlas.usedHeight());
+  EXPECT_EQ(Rect(0, 16, 16, 48), atlas.rect(atlas.allocate(Size(16, 48))));
+}
+
+TEST(AtlasAllocator, Compact)
+{
+  AtlasAllocator atlas(Size(64, 64), 8);
+  std::vector<Id> ids;
+  std::vector<Size> sizes;
+  for (int i=0; i<16; ++i) {
+    sizes.push_back(Size(16, 8 + 8*(i%2)));
+    ids.push_back(atlas.allocate(sizes.back()));
+  }
+  EXPECT_EQ(48, atlas.usedHeight());
+
+  // Free every other 16x8 allocation
+  std::vector<Id> liveIds;
+  std::vector<Size> liveSizes;
+  for (int i=0; i<16; ++i) {
+    if (i % 4 == 0)
+      atlas.free(ids[i]);
+    else {
+      liveIds.push_back(ids[i]);
+      liveSizes.push_back(sizes[i]);
+    }
+  }
+  EXPECT_EQ(AtlasAllocator::kNoId, atlas.allocate(Size(64, 24)));
+
+  std::vector<Rect> before;
+  for (Id id : liveIds)
+    before.push_back(atlas.rect(id));
+
+  const auto moves = atlas.compact();
+  EXPECT_FALSE(moves.empty());
+  expect_valid(atlas, liveIds, liveSizes);
+  EXPECT_EQ(40, atlas.usedHeight());
+  for (const auto& move : moves) {
+    auto it = std::find(liveIds.begin(), liveIds.end(), move.id);
+    ASSERT_TRUE(it != liveIds.end());
+    EXPECT_EQ(before[it - liveIds.begin()], move.from);
+    EXPECT_EQ(atlas.rect(move.id), move.to);
+    EXPECT_NE(move.from, move.to);
+  }
+
+  // Compacting again doesn't move anything
+  EXPECT_TRUE(atlas.compact().empty());
+  EXPECT_NE(AtlasAllocator::kNoId, atlas.allocate(Size(64, 24)));
+}
+
+TEST(AtlasAllocator, RandomChurn)
+{
+  std::mt19937 rng(42);
+  AtlasAllocator atlas(Size(256, 256), 4);
+  std::vector<Id> ids;
+  std::vector<Size> sizes;
+
+  for (int i=0; i<5000; ++i) {
+    if (!ids.empty() && rng() % 3 == 0) {
+      const size_t j = rng() % ids.size();
+      atlas.free(ids[j]);
+      ids[j] = ids.back(); ids.pop_back();
+      sizes[j] = sizes.back(); sizes.pop_back();
+    }
+    else {
+      const Size sz(1 + rng() % 32, 1 + rng() % 32);
+      const Id id = atlas.allocate(sz);
+      if (id != AtlasAllocator::kNoId) {
+        ids.push_back(id);
+        sizes.push_back(sz);
+      }
+    }
+    if (i % 500 == 0) {
+      expect_valid(atlas, ids, sizes);
+      atlas.compact();
+      expect_valid(atlas, ids, sizes);
+    }
+  }
+  expect_valid(atlas, ids, sizes);
+  EXPECT_GT(atlas.occupancy(), 0.5);
+
+  // Freeing everything returns all the space
+  for (Id id : ids)
+    atlas.free(id);
+  EXPECT_EQ(0, atlas.allocationCount());
+  EXPECT_EQ(0, atlas.usedHeight());
+  EXPECT_NE(AtlasAllocator::kNoId, atlas.allocate(Size(256, 256)));
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,935 @@
+// LAF Gfx Library
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gfx/color_transform.h"
+
+#include "base/cpu_features.h"
+#include "base/debug.h"
+#include "gfx/color.h"
+#include "gfx/for_each_chunk.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <list>
+#include <mutex>
+
+#if LAF_HAVE_SSE2
+  #include <emmintrin.h>
+#elif LAF_HAVE_NEON
+  #include <arm_neon.h>
+#endif
+
+namespace gfx {
+
+namespace {
+
+//////////////////////////////////////////////////////////////////////
+// Profiles
+
+using Mat3 = double[3][3];
+
+// D50 white point (PCS illuminant)
+constexpr double kD50[3] = { 0.9642, 1.0, 0.8249 };
+
+// Same values as gSRGB_toXYZD50 in skia/src/core/SkColorSpacePriv.h
+constexpr double kSRGB_toXYZD50[3][3] = {
+  { 0.4360747, 0.3850649, 0.1430804 },
+  { 0.2225045, 0.7168786, 0.0606169 },
+  { 0.0139322, 0.0971045, 0.7141733 },
+};
+
+constexpr ColorSpaceTransferFn kSRGB_transferFn = {
+  2.4f, float(1/1.055), float(0.055/1.055), float(1/12.92), 0.04045f, 0.0f, 0.0f
+};
+
+void mat3_copy(const double src[3][3], Mat3 dst)
+{
+  std::memcpy(dst, src, sizeof(Mat3));
+}
+
+void mat3_mul(const Mat3 a, const Mat3 b, Mat3 out)
+{
+  Mat3 r;
+  for (int i=0; i<3; ++i)
+    for (int j=0; j<3; ++j)
+      r[i][j] = a[i][0]*b[0][j] + a[i][1]*b[1][j] + a[i][2]*b[2][j];
+  mat3_copy(r, out);
+}
+
+bool mat3_invert(const Mat3 m, Mat3 out)
+{
+  const double det =
+    + m[0][0] * (m[1][1]*m[2][2] - m[1][2]*m[2][1])
+    - m[0][1] * (m[1][0]*m[2][2] - m[1][2]*m[2][0])
+    + m[0][2] * (m[1][0]*m[2][1] - m[1][1]*m[2][0]);
+  if (std::fabs(det) < 1e-12)
+    return false;
+
+  Mat3 r;
+  r[0][0] =  (m[1][1]*m[2][2] - m[1][2]*m[2][1]) / det;
+  r[0][1] = -(m[0][1]*m[2][2] - m[0][2]*m[2][1]) / det;
+  r[0][2] =  (m[0][1]*m[1][2] - m[0][2]*m[1][1]) / det;
+  r[1][0] = -(m[1][0]*m[2][2] - m[1][2]*m[2][0]) / det;
+  r[1][1] =  (m[0][0]*m[2][2] - m[0][2]*m[2][0]) / det;
+  r[1][2] = -(m[0][0]*m[1][2] - m[0][2]*m[1][0]) / det;
+  r[2][0] =  (m[1][0]*m[2][1] - m[1][1]*m[2][0]) / det;
+  r[2][1] = -(m[0][0]*m[2][1] - m[0][1]*m[2][0]) / det;
+  r[2][2] =  (m[0][0]*m[1][1] - m[0][1]*m[1][0]) / det;
+  mat3_copy(r, out);
+  return true;
+}
+
+void mat3_apply(const Mat3 m, const double v[3], double out[3])
+{
+  const double r[3] = { v[0], v[1], v[2] };
+  for (int i=0; i<3; ++i)
+    out[i] = m[i][0]*r[0] + m[i][1]*r[1] + m[i][2]*r[2];
+}
+
+// Same as skcms_PrimariesToXYZD50(): RGB->XYZ matrix from the
+// primaries, adapted to D50 with the Bradford transform.
+bool primaries_to_xyzd50(const ColorSpacePrimaries& p, Mat3 toXYZD50)
+{
+  if (p.ry <= 0.0f || p.gy <= 0.0f || p.by <= 0.0f || p.wy <= 0.0f)
+    return false;
+
+  Mat3 prim = {
+    { p.rx/p.ry,           p.gx/p.gy,           p.bx/p.by },
+    { 1.0,                 1.0,                 1.0 },
+    { (1-p.rx-p.ry)/p.ry,  (1-p.gx-p.gy)/p.gy,  (1-p.bx-p.by)/p.by },
+  };
+  const double white[3] = { p.wx/p.wy, 1.0, (1-p.wx-p.wy)/p.wy };
+
+  Mat3 inv;
+  if (!mat3_invert(prim, inv))
+    return false;
+
+  double s[3];
+  mat3_apply(inv, white, s);
+  Mat3 toXYZ;
+  for (int i=0; i<3; ++i)
+    for (int j=0; j<3; ++j)
+      toXYZ[i][j] = prim[i][j] * s[j];
+
+  const Mat3 bradford = {
+    {  0.8951,  0.2664, -0.1614 },
+    { -0.7502,  1.7135,  0.0367 },
+    {  0.0389, -0.0685,  1.0296 },
+  };
+  Mat3 bradfordInv;
+  mat3_invert(bradford, bradfordInv);
+
+  double srcCone[3], dstCone[3];
+  mat3_apply(bradford, white, srcCone);
+  mat3_apply(bradford, kD50, dstCone);
+
+  Mat3 adapt = { { dstCone[0]/srcCone[0], 0, 0 },
+                 { 0, dstCone[1]/srcCone[1], 0 },
+                 { 0, 0, dstCone[2]/srcCone[2] } };
+  mat3_mul(adapt, bradford, adapt);
+  mat3_mul(bradfordInv, adapt, adapt);
+  mat3_mul(adapt, toXYZ, toXYZD50);
+  return true;
+}
+
+double eval_transfer_fn(const ColorSpaceTransferFn& fn, double x)
+{
+  if (x < fn.d)
+    return fn.c*x + fn.f;
+  const double t = fn.a*x + fn.b;
+  return (t > 0.0 ? std::pow(t, double(fn.g)): 0.0) + fn.e;
+}
+
+// Interpolates a table of values in the [0, 1] range.
+double eval_table(const float* table, int n, double x)
+{
+  x = std::clamp(x, 0.0, 1.0) * (n-1);
+  const int i = std::min(int(x), n-2);
+  const double f = x - i;
+  return table[i] + (table[i+1] - table[i]) * f;
+}
+
+// A curve from encoded values to linear values (a TRC tag).
+struct Curve {
+  enum Kind { Identity, Parametric, Table };
+  Kind kind = Identity;
+  ColorSpaceTransferFn fn;
+  std::vector<float> table;
+
+  Curve() { }
+  explicit Curve(const ColorSpaceTransferFn& fn)
+    : kind(Parametric), fn(fn) { }
+
+  double eval(double x) const {
+    x = std::clamp(x, 0.0, 1.0);
+    switch (kind) {
+      case Parametric: return eval_transfer_fn(fn, x);
+      case Table:      return eval_table(table.data(), int(table.size()), x);
+      default:         return x;
+    }
+  }
+};
+
+// Inverse of a (non-decreasing) curve, to convert linear values to
+// encoded values.
+class InverseCurve {
+public:
+  explicit InverseCurve(const Curve& curve) : m_y(kSamples) {
+    for (int i=0; i<kSamples; ++i)
+      m_y[i] = curve.eval(double(i) / (kSamples-1));
+  }
+
+  double eval(double y) const {
+    if (y <= m_y.front())
+      return 0.0;
+    if (y >= m_y.back())
+      return 1.0;
+    const int i = int(std::upper_bound(m_y.begin(), m_y.end(), y) - m_y.begin()) - 1;
+    const double dy = m_y[i+1] - m_y[i];
+    const double f = (dy > 0.0 ? (y - m_y[i]) / dy: 0.0);
+    return (i + f) / (kSamples-1);
+  }
+
+private:
+  static constexpr int kSamples = 4096;
+  std::vector<double> m_y;
+};
+
+// A2B0 lut8/lut16 tag (RGB -> PCS)
+struct Lut {
+  int gridPoints = 0;
+  int inEntries = 0;
+  int outEntries = 0;
+  std::vector<float> inTables;   // 3 tables of inEntries
+  std::vector<float> clut;       // gridPoints^3 * 3
+  std::vector<float> outTables;  // 3 tables of outEntries
+  bool lut16 = false;
+
+  void eval(const double rgb[3], double out[3]) const {
+    double in[3];
+    for (int c=0; c<3; ++c)
+      in[c] = eval_table(&inTables[c*inEntries], inEntries, rgb[c]);
+
+    // Trilinear interpolation (only used to precompute the 3D LUT)
+    const int n = gridPoints;
+    int i0[3];
+    double f[3];
+    for (int c=0; c<3; ++c) {
+      const double x = std::clamp(in[c], 0.0, 1.0) * (n-1);
+      i0[c] = std::min(int(x), n-2);
+      f[c] = x - i0[c];
+    }
+    double v[3] = { 0.0, 0.0, 0.0 };
+    for (int k=0; k<8; ++k) {
+      const int dr = (k>>2)&1, dg = (k>>1)&1, db = k&1;
+      const double w = (dr ? f[0]: 1-f[0]) * (dg ? f[1]: 1-f[1]) * (db ? f[2]: 1-f[2]);
+      const float* e = &clut[3*(((i0[0]+dr)*n + (i0[1]+dg))*n + (i0[2]+db))];
+      for (int c=0; c<3; ++c)
+        v[c] += w * e[c];
+    }
+
+    for (int c=0; c<3; ++c)
+      out[c] = eval_table(&outTables[c*outEntries], outEntries, v[c]);
+  }
+};
+
+struct Profile {
+  bool hasMatrix = false;
+  Mat3 toXYZD50;
+  Curve curves[3];
+
+  bool hasLut = false;
+  bool pcsLab = false;
+  Lut lut;
+
+  // Converts encoded RGB values to XYZ (D50)
+  void toXYZ(const double rgb[3], double xyz[3]) const {
+    if (hasMatrix) {
+      double lin[3];
+      for (int c=0; c<3; ++c)
+        lin[c] = curves[c].eval(rgb[c]);
+      mat3_apply(toXYZD50, lin, xyz);
+      return;
+    }
+
+    double pcs[3];
+    lut.eval(rgb, pcs);
+    if (pcsLab) {
+      // Legacy 16-bit Lab encoding (0xFF00 = L 100) in lut16
+      const double k = (lut.lut16 ? 65535.0 / 65280.0: 1.0);
+      const double L = pcs[0] * k * 100.0;
+      const double a = pcs[1] * k * 255.0 - 128.0;
+      const double b = pcs[2] * k * 255.0 - 128.0;
+      const double fy = (L + 16.0) / 116.0;
+      const double f[3] = { fy + a/500.0, fy, fy - b/200.0 };
+      for (int c=0; c<3; ++c) {
+        const double t = f[c];
+        xyz[c] = kD50[c] * (t > 6.0/29.0 ? t*t*t: 3.0*(6.0/29.0)*(6.0/29.0)*(t - 4.0/29.0));
+      }
+    }
+    else {
+      // u1Fixed15 (0x8000 = 1.0)
+      for (int c=0; c<3; ++c)
+        xyz[c] = pcs[c] * 65535.0 / 32768.0;
+    }
+  }
+};
+
+//////////////////////////////////////////////////////////////////////
+// ICC profiles parsing
+
+class IccReader {
+public:
+  IccReader(const uint8_t* data, size_t size)
+    : m_data(data), m_size(size) { }
+
+  bool valid() const {
+    return (m_size >= 132 &&
+            at(0) <= m_size &&
+            at(36) == sig("acsp") &&
+            132 + size_t(at(128))*12 <= m_size);
+  }
+
+  uint32_t colorSpace() const { return at(16); }
+  uint32_t pcs() const { return at(20); }
+
+  // Returns the tag data (the size is returned in "size")
+  const uint8_t* tag(const char* s, size_t& size) const {
+    const uint32_t signature = sig(s);
+    const uint32_t n = at(128);
+    for (uint32_t i=0; i<n; ++i) {
+      const size_t entry = 132 + i*12;
+      if (at(entry) == signature) {
+        const size_t offset = at(entry+4);
+        size = at(entry+8);
+        if (offset + size > m_size || size < 12)
+          return nullptr;
+        return m_data + offset;
+      }
+    }
+    return nullptr;
+  }
+
+  static uint32_t sig(const char* s) {
+    return (uint32_t(uint8_t(s[0])) << 24) | (uint32_t(uint8_t(s[1])) << 16) |
+           (uint32_t(uint8_t(s[2])) << 8) | uint32_t(uint8_t(s[3]));
+  }
+  static uint32_t read32(const uint8_t* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) |
+           (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+  }
+  static uint16_t read16(const uint8_t* p) {
+    return uint16_t((p[0] << 8) | p[1]);
+  }
+  static double readFixed(const uint8_t* p) {
+    return int32_t(read32(p)) / 65536.0;
+  }
+
+private:
+  uint32_t at(size_t offset) const { return read32(m_data + offset); }
+
+  const uint8_t* m_data;
+  size_t m_size;
+};
+
+bool parse_xyz(const uint8_t* p, size_t size, double xyz[3])
+{
+  if (!p || size < 20 || IccReader::read32(p) != IccReader::sig("XYZ "))
+    return false;
+  for (int i=0; i<3; ++i)
+    xyz[i] = IccReader::readFixed(p + 8 + 4*i);
+  return true;
+}
+
+bool parse_curve(const uint8_t* p, size_t size, Curve& curve)
+{
+  if (!p)
+    return false;
+
+  const uint32_t type = IccReader::read32(p);
+  if (type == IccReader::sig("curv")) {
+    const uint32_t n = IccReader::read32(p+8);
+    if (12 + size_t(n)*2 > size)
+      return false;
+    if (n == 0) {
+      curve.kind = Curve::Identity;
+    }
+    else if (n == 1) {
+      // u8Fixed8 gamma
+      curve = Curve({ IccReader::read16(p+12) / 256.0f, 1, 0, 0, 0, 0, 0 });
+    }
+    else {
+      curve.kind = Curve::Table;
+      curve.table.resize(n);
+      for (uint32_t i=0; i<n; ++i)
+        curve.table[i] = IccReader::read16(p + 12 + 2*i) / 65535.0f;
+    }
+    return true;
+  }
+
+  if (type == IccReader::sig("para")) {
+    static const int kParams[] = { 1, 3, 4, 5, 7 };
+    const int fnType = IccReader::read16(p+8);
+    if (fnType > 4 || 12 + size_t(kParams[fnType])*4 > size)
+      return false;
+
+    float v[7] = { 0, 0, 0, 0, 0, 0, 0 };
+    for (int i=0; i<kParams[fnType]; ++i)
+      v[i] = float(IccReader::readFixed(p + 12 + 4*i));
+
+    // Convert all types to the 7 parameters function
+    ColorSpaceTransferFn fn = { v[0], 1, 0, 0, 0, 0, 0 };
+    switch (fnType) {
+      case 1:
+      case 2:
+        if (v[1] == 0.0f)
+          return false;
+        fn.a = v[1];
+        fn.b = v[2];
+        fn.d = -v[2] / v[1];
+        if (fnType == 2)
+          fn.e = fn.f = v[3];
+        break;
+      case 3:
+      case 4:
+        fn.a = v[1];
+        fn.b = v[2];
+        fn.c = v[3];
+        fn.d = v[4];
+        if (fnType == 4) {
+          fn.e = v[5];
+          fn.f = v[6];
+        }
+        break;
+    }
+    curve = Curve(fn);
+    return true;
+  }
+  return false;
+}
+
+bool parse_lut(const uint8_t* p, size_t size, Lut& lut)
+{
+  if (!p || size < 48)
+    return false;
+
+  const uint32_t type = IccReader::read32(p);
+  const bool lut16 = (type == IccReader::sig("mft2"));
+  if (!lut16 && type != IccReader::sig("mft1"))
+    return false;
+
+  const int inChannels = p[8];
+  const int outChannels = p[9];
+  const int gridPoints = p[10];
+  if (inChannels != 3 || outChannels != 3 || gridPoints < 2)
+    return false;
+
+  size_t offset = 48;
+  if (lut16) {
+    if (size < 52)
+      return false;
+    lut.inEntries = IccReader::read16(p+48);
+    lut.outEntries = IccReader::read16(p+50);
+    offset = 52;
+    if (lut.inEntries < 2 || lut.inEntries > 4096 ||
+        lut.outEntries < 2 || lut.outEntries > 4096)
+      return false;
+  }
+  else {
+    lut.inEntries = lut.outEntries = 256;
+  }
+
+  const int bytes = (lut16 ? 2: 1);
+  const size_t gridSize = size_t(gridPoints)*gridPoints*gridPoints;
+  if (offset + bytes*(3*lut.inEntries + 3*gridSize + 3*lut.outEntries) > size)
+    return false;
+
+  auto read = [p, bytes, &offset]() -> float {
+    float v;
+    if (bytes == 2)
+      v = IccReader::read16(p+offset) / 65535.0f;
+    else
+      v = p[offset] / 255.0f;
+    offset += bytes;
+    return v;
+  };
+
+  lut.lut16 = lut16;
+  lut.gridPoints = gridPoints;
+  lut.inTables.resize(3*lut.inEntries);
+  lut.clut.resize(3*gridSize);
+  lut.outTables.resize(3*lut.outEntries);
+  for (float& v : lut.inTables) v = read();
+  for (float& v : lut.clut) v = read();
+  for (float& v : lut.outTables) v = read();
+  return true;
+}
+
+bool parse_icc(const uint8_t* data, size_t n, Profile& profile)
+{
+  IccReader icc(data, n);
+  if (!icc.valid())
+    return false;
+
+  const uint32_t pcs = icc.pcs();
+  if (pcs != IccReader::sig("XYZ ") && pcs != IccReader::sig("Lab "))
+    return false;
+
+  size_t size = 0;
+  if (icc.colorSpace() == IccReader::sig("GRAY")) {
+    const uint8_t* p = icc.tag("kTRC", size);
+    if (!parse_curve(p, size, profile.curves[0]))
+      return false;
+    profile.curves[1] = profile.curves[2] = profile.curves[0];
+    // Gray as R=G=B, where white is the D50 white point
+    const Mat3 m = { { kD50[0], 0, 0 }, { 0, kD50[1], 0 }, { 0, 0, kD50[2] } };
+    mat3_copy(m, profile.toXYZD50);
+    profile.hasMatrix = true;
+    return true;
+  }
+
+  if (icc.colorSpace() != IccReader::sig("RGB "))
+    return false;
+
+  // Matrix/TRC (preferred, as Skia only supports these profiles)
+  double xyz[3][3];
+  const char* xyzTags[] = { "rXYZ", "gXYZ", "bXYZ" };
+  const char* trcTags[] = { "rTRC", "gTRC", "bTRC" };
+  bool ok = (pcs == IccReader::sig("XYZ "));
+  for (int c=0; c<3 && ok; ++c) {
+    const uint8_t* p = icc.tag(xyzTags[c], size);
+    ok = parse_xyz(p, size, xyz[c]);
+    if (ok) {
+      p = icc.tag(trcTags[c], size);
+      ok = parse_curve(p, size, profile.curves[c]);
+    }
+  }
+  if (ok) {
+    for (int i=0; i<3; ++i)
+      for (int c=0; c<3; ++c)
+        profile.toXYZD50[i][c] = xyz[c][i];
+    profile.hasMatrix = true;
+    return true;
+  }
+
+  const uint8_t* p = icc.tag("A2B0", size);
+  if (parse_lut(p, size, profile.lut)) {
+    profile.hasLut = true;
+    profile.pcsLab = (pcs == IccReader::sig("Lab "));
+    return true;
+  }
+  return false;
+}
+
+bool make_profile(const ColorSpace& cs, Profile& profile)
+{
+  switch (cs.type()) {
+
+    case ColorSpace::sRGB:
+    case ColorSpace::RGB:
+      // Same interpretation of the color space as SkiaColorSpace
+      profile.hasMatrix = true;
+      mat3_copy(kSRGB_toXYZD50, profile.toXYZD50);
+      if (cs.hasGamma()) {
+        if (cs.gamma() != 1.0f) {
+          for (Curve& curve : profile.curves)
+            curve = Curve({ cs.gamma(), 1, 0, 0, 0, 0, 0 });
+        }
+        return true;
+      }
+      if (cs.hasPrimaries() &&
+          !primaries_to_xyzd50(*cs.primaries(), profile.toXYZD50)) {
+        mat3_copy(kSRGB_toXYZD50, profile.toXYZD50);
+      }
+      for (Curve& curve : profile.curves)
+        curve = Curve(cs.hasTransferFn() ? *cs.transferFn(): kSRGB_transferFn);
+      return true;
+
+    case ColorSpace::ICC:
+      return parse_icc((const uint8_t*)cs.iccData(), cs.iccSize(), profile);
+
+    default:
+      return false;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+// Pixel conversion
+//
+// Each pixel is processed with its three channels in the lanes of a
+// SIMD register (the 4th lane is not used). The 1D/3D LUT entries are
+// stored as 4 floats so they can be loaded with one instruction.
+
+struct Scalar {
+  struct F { float v[4]; };
+
+  static F load(const float* p) { return { { p[0], p[1], p[2], 0.0f } }; }
+  static F set1(float x) { return { { x, x, x, x } }; }
+  static F add(F a, F b) { return { { a.v[0]+b.v[0], a.v[1]+b.v[1], a.v[2]+b.v[2], 0.0f } }; }
+  static F sub(F a, F b) { return { { a.v[0]-b.v[0], a.v[1]-b.v[1], a.v[2]-b.v[2], 0.0f } }; }
+  static F mul(F a, float b) { return { { a.v[0]*b, a.v[1]*b, a.v[2]*b, 0.0f } }; }
+  static F madd(F a, F b, float c) { return add(a, mul(b, c)); }
+  static F clamp01(F a) {
+    for (float& x : a.v)
+      x = std::clamp(x, 0.0f, 1.0f);
+    return a;
+  }
+  static F sqrt(F a) {
+    for (float& x : a.v)
+      x = std::sqrt(x);
+    return a;
+  }
+  // Returns the truncated value of a*scale+0.5 for the 3 channels
+  static void to_int(F a, float scale, int out[3]) {
+    for (int c=0; c<3; ++c)
+      out[c] = int(a.v[c]*scale + 0.5f);
+  }
+};
+
+#if LAF_HAVE_SSE2
+
+struct Sse2 {
+  using F = __m128;
+
+  static F load(const float* p) { return _mm_load_ps(p); }
+  static F set1(float x) { return _mm_set1_ps(x); }
+  static F add(F a, F b) { return _mm_add_ps(a, b); }
+  static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+  static F mul(F a, float b) { return _mm_mul_ps(a, _mm_set1_ps(b)); }
+  static F madd(F a, F b, float c) { return _mm_add_ps(a, _mm_mul_ps(b, _mm_set1_ps(c))); }
+  static F clamp01(F a) {
+    return _mm_min_ps(_mm_max_ps(a, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+  }
+  static F sqrt(F a) { return _mm_sqrt_ps(a); }
+  static void to_int(F a, float scale, int out[3]) {
+    const __m128i v = _mm_cvttps_epi32(
+      _mm_add_ps(_mm_mul_ps(a, _mm_set1_ps(scale)), _mm_set1_ps(0.5f)));
+    // All values fit in 16 bits
+    out[0] = _mm_cvtsi128_si32(v);
+    out[1] = _mm_extract_epi16(v, 2);
+    out[2] = _mm_extract_epi16(v, 4);
+  }
+};
+
+using Simd = Sse2;
+
+#elif LAF_HAVE_NEON
+
+struct Neon {
+  using F = float32x4_t;
+
+  static F load(const float* p) { return vld1q_f32(p); }
+  static F set1(float x) { return vdupq_n_f32(x); }
+  static F add(F a, F b) { return vaddq_f32(a, b); }
+  static F sub(F a, F b) { return vsubq_f32(a, b); }
+  static F mul(F a, float b) { return vmulq_n_f32(a, b); }
+  static F madd(F a, F b, float c) { return vmlaq_n_f32(a, b, c); }
+  static F clamp01(F a) {
+    return vminq_f32(vmaxq_f32(a, vdupq_n_f32(0.0f)), vdupq_n_f32(1.0f));
+  }
+  static F sqrt(F a) { return vsqrtq_f32(a); }
+  static void to_int(F a, float scale, int out[3]) {
+    const uint32x4_t v = vcvtq_u32_f32(vmlaq_n_f32(vdupq_n_f32(0.5f), a, scale));
+    out[0] = vgetq_lane_u32(v, 0);
+    out[1] = vgetq_lane_u32(v, 1);
+    out[2] = vgetq_lane_u32(v, 2);
+  }
+};
+
+using Simd = Neon;
+
+#else
+
+using Simd = Scalar;
+
+#endif
+
+// Grid cell and position inside the cell of each 8-bit value
+struct GridIndex {
+  int index[256];
+  float frac[256];
+
+  GridIndex() {
+    const int n = ColorTransform::kGridPoints;
+    for (int i=0; i<256; ++i) {
+      const float x = i * float(n-1) / 255.0f;
+      index[i] = std::min(int(x), n-2);
+      frac[i] = x - index[i];
+    }
+  }
+};
+
+const GridIndex& grid_index()
+{
+  static const GridIndex index;
+  return index;
+}
+
+// "toLinear" are the 1D LUTs of 256 entries (4 floats each) for
+// each channel, and "encode" the 1D LUTs of "encodeSize" entries.
+template<typename V>
+void convert_matrix(const float* const toLinear[3],
+                    const uint8_t* const encode[3],
+                    int encodeSize,
+                    uint32_t* dst, const uint32_t* src, int n)
+{
+  const float scale = float(encodeSize - 1);
+  const float* lr = toLinear[0];
+  const float* lg = toLinear[1];
+  const float* lb = toLinear[2];
+  for (int i=0; i<n; ++i) {
+    const uint32_t p = src[i];
+    typename V::F v = V::add(V::add(V::load(lr + 4*getr(p)),
+                                    V::load(lg + 4*getg(p))),
+                             V::load(lb + 4*getb(p)));
+    int idx[3];
+    V::to_int(V::sqrt(V::clamp01(v)), scale, idx);
+    dst[i] = rgba(encode[0][idx[0]],
+                  encode[1][idx[1]],
+                  encode[2][idx[2]], geta(p));
+  }
+}
+
+template<typename V>
+void convert_grid(const float* grid,
+                  uint32_t* dst, const uint32_t* src, int n)
+{
+  using F = typename V::F;
+  constexpr int N = ColorTransform::kGridPoints;
+  constexpr int sr = 4*N*N, sg = 4*N, sb = 4;
+  const GridIndex& gi = grid_index();
+
+  for (int i=0; i<n; ++i) {
+    const uint32_t p = src[i];
+    const int r = getr(p), g = getg(p), b = getb(p);
+    const float fr = gi.frac[r], fg = gi.frac[g], fb = gi.frac[b];
+    const float* c0 = grid + 4*((gi.index[r]*N + gi.index[g])*N + gi.index[b]);
+
+    // Tetrahedral interpolation, the tetrahedron depends on the
+    // order of the fractional parts.
+    int s1, s2;
+    float f1, f2, f3;
+    if (fr > fg) {
+      if (fg > fb)      { s1 = sr; s2 = sr+sg; f1 = fr; f2 = fg; f3 = fb; }
+      else if (fr > fb) { s1 = sr; s2 = sr+sb; f1 = fr; f2 = fb; f3 = fg; }
+      else              { s1 = sb; s2 = sr+sb; f1 = fb; f2 = fr; f3 = fg; }
+    }
+    else {
+      if (fb > fg)      { s1 = sb; s2 = sg+sb; f1 = fb; f2 = fg; f3 = fr; }
+      else if (fb > fr) { s1 = sg; s2 = sg+sb; f1 = fg; f2 = fb; f3 = fr; }
+      else              { s1 = sg; s2 = sr+sg; f1 = fg; f2 = fr; f3 = fb; }
+    }
+
+    const F v0 = V::load(c0);
+    const F v1 = V::load(c0 + s1);
+    const F v2 = V::load(c0 + s2);
+    const F v3 = V::load(c0 + sr+sg+sb);
+    F v = V::madd(v0, V::sub(v1, v0), f1);
+    v = V::madd(v, V::sub(v2, v1), f2);
+    v = V::madd(v, V::sub(v3, v2), f3);
+
+    int rgb[3];
+    V::to_int(v, 255.0f, rgb);
+    dst[i] = rgba(rgb[0], rgb[1], rgb[2], geta(p));
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+// Cache of transforms
+
+// Key to identify a color space (without its name)
+std::vector<uint8_t> make_key(const ColorSpace& cs)
+{
+  const std::vector<uint8_t>& data = cs.rawData();
+  const float gamma = cs.gamma();
+  std::vector<uint8_t> key;
+  key.reserve(2 + sizeof(float) + data.size());
+  key.push_back(uint8_t(cs.type()));
+  key.push_back(uint8_t(cs.flags()));
+  key.insert(key.end(), (const uint8_t*)&gamma, (const uint8_t*)(&gamma+1));
+  key.insert(key.end(), data.begin(), data.end());
+  return key;
+}
+
+struct CacheEntry {
+  std::vector<uint8_t> src, dst;
+  ColorTransformRef transform;
+};
+
+constexpr size_t kCacheSize = 8;
+std::mutex g_cacheMutex;
+std::list<CacheEntry> g_cache; // Most recently used first
+
+} // anonymous namespace
+
+// static
+ColorTransformRef ColorTransform::Make(const ColorSpaceRef& src,
+                                       const ColorSpaceRef& dst)
+{
+  ASSERT(src);
+  ASSERT(dst);
+
+  CacheEntry entry;
+  entry.src = make_key(*src);
+  entry.dst = make_key(*dst);
+  {
+    const std::lock_guard lock(g_cacheMutex);
+    for (auto it=g_cache.begin(); it!=g_cache.end(); ++it) {
+      if (it->src == entry.src && it->dst == entry.dst) {
+        g_cache.splice(g_cache.begin(), g_cache, it);
+        return it->transform;
+      }
+    }
+  }
+
+  // Create the transform outside the lock (it can take some
+  // milliseconds)
+  auto transform = base::make_ref<ColorTransform>();
+  if (!transform->init(*src, *dst))
+    return nullptr;
+
+  entry.transform = transform;
+  {
+    const std::lock_guard lock(g_cacheMutex);
+    g_cache.push_front(std::move(entry));
+    if (g_cache.size() > kCacheSize)
+      g_cache.pop_back();
+  }
+  return transform;
+}
+
+// static
+bool ColorTransform::IsSupported(const ColorSpace& cs)
+{
+  Profile profile;
+  return (cs.type() == ColorSpace::None || make_profile(cs, profile));
+}
+
+bool ColorTransform::init(const ColorSpace& src, const ColorSpace& dst)
+{
+  for (int i=0; i<256; ++i)
+    m_gray[i] = uint8_t(i);
+
+  if (src.type() == ColorSpace::None ||
+      dst.type() == ColorSpace::None ||
+      src.nearlyEqual(dst)) {
+    m_type = Identity;
+    return true;
+  }
+
+  Profile srcProfile, dstProfile;
+  if (!make_profile(src, srcProfile) ||
+      !make_profile(dst, dstProfile) ||
+      !dstProfile.hasMatrix) {
+    return false;
+  }
+
+  Mat3 fromXYZD50;
+  if (!mat3_invert(dstProfile.toXYZD50, fromXYZD50))
+    return false;
+
+  const InverseCurve dstInvCurves[3] = {
+    InverseCurve(dstProfile.curves[0]),
+    InverseCurve(dstProfile.curves[1]),
+    InverseCurve(dstProfile.curves[2]),
+  };
+
+  if (srcProfile.hasMatrix) {
+    m_type = Matrix;
+
+    Mat3 m;
+    mat3_mul(fromXYZD50, srcProfile.toXYZD50, m);
+    for (int c=0; c<3; ++c) {
+      m_toLinear[c].resize(256);
+      for (int i=0; i<256; ++i) {
+        const double lin = srcProfile.curves[c].eval(i / 255.0);
+        Float4& e = m_toLinear[c][i];
+        for (int j=0; j<3; ++j)
+          e.v[j] = float(m[j][c] * lin);
+        e.v[3] = 0.0f;
+      }
+
+      m_encode[c].resize(kEncodeSize);
+      for (int i=0; i<kEncodeSize; ++i) {
+        const double t = double(i) / (kEncodeSize-1);
+        const double enc = dstInvCurves[c].eval(t*t);
+        m_encode[c][i] = uint8_t(std::clamp(enc, 0.0, 1.0) * 255.0 + 0.5);
+      }
+    }
+  }
+  else {
+    m_type = Grid;
+
+    const int n = kGridPoints;
+    m_grid.resize(n*n*n);
+    Float4* e = m_grid.data();
+    for (int r=0; r<n; ++r)
+      for (int g=0; g<n; ++g)
+        for (int b=0; b<n; ++b, ++e) {
+          const double rgb[3] = { double(r)/(n-1), double(g)/(n-1), double(b)/(n-1) };
+          double xyz[3], lin[3];
+          srcProfile.toXYZ(rgb, xyz);
+          mat3_apply(fromXYZD50, xyz, lin);
+          for (int c=0; c<3; ++c)
+            e->v[c] = float(std::clamp(dstInvCurves[c].eval(lin[c]), 0.0, 1.0));
+          e->v[3] = 0.0f;
+        }
+  }
+
+  // Gray values are converted as R=G=B pixels
+  uint32_t gray[256];
+  for (int i=0; i<256; ++i)
+    gray[i] = rgba(i, i, i);
+  convertRgba(gray, gray, 256);
+  for (int i=0; i<256; ++i)
+    m_gray[i] = getg(gray[i]);
+  return true;
+}
+
+void ColorTransform::convertRgba(uint32_t* dst, const uint32_t* src, int n) const
+{
+  switch (m_type) {
+    case Identity:
+      if (dst != src)
+        std::memmove(dst, src, sizeof(uint32_t)*n);
+      break;
+    case Matrix: {
+      const float* const toLinear[3] = {
+        m_toLinear[0][0].v, m_toLinear[1][0].v, m_toLinear[2][0].v };
+      const uint8_t* const encode[3] = {
+        m_encode[0].data(), m_encode[1].data(), m_encode[2].data() };
+      convert_matrix<Simd>(toLinear, encode, kEncodeSize, dst, src, n);
+      break;
+    }
+    case Grid:
+      convert_grid<Simd>(m_grid[0].v, dst, src, n);
+      break;
+  }
+}
+
+void ColorTransform::convertRgba(uint32_t* dst, const uint32_t* src, int n,
+                                 base::thread_pool& pool, int rowLength) const
+{
+  if (m_type == Identity && dst == src)
+    return;
+
+  for_each_chunk(n, pool, rowLength, [=](size_t i, size_t m){
+    convertRgba(dst+i, src+i, int(m));
+  });
+}
+
+void ColorTransform::convertGray(uint8_t* dst, const uint8_t* src, int n) const
+{
+  for (int i=0; i<n; ++i)
+    dst[i] = m_gray[src[i]];
+}
+
+} // namespace gfx
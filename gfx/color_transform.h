@@ -0,0 +1,95 @@
+// LAF Gfx Library
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef GFX_COLOR_TRANSFORM_H_INCLUDED
+#define GFX_COLOR_TRANSFORM_H_INCLUDED
+#pragma once
+
+#include "base/ref.h"
+#include "gfx/color_space.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace base {
+  class thread_pool;
+}
+
+namespace gfx {
+
+  class ColorTransform;
+  using ColorTransformRef = base::Ref<ColorTransform>;
+
+  // Software conversion of pixels between two color spaces (without
+  // Skia). Supported color spaces are sRGB, gamma, transfer
+  // function/primaries, and ICC profiles with RGB or gray data:
+  // matrix/TRC profiles (XYZ + curv/para tags), and profiles with a
+  // lut8/lut16 A2B0 tag (only as source color space).
+  //
+  // Matrix/TRC transforms are precomputed as 1D LUTs (to linear RGB,
+  // already multiplied by the src->dst matrix) and a 1D LUT to encode
+  // the destination values. Transforms with a source A2B0 LUT are
+  // precomputed as a 3D LUT of kGridPoints^3 entries that is
+  // evaluated with tetrahedral interpolation.
+  class ColorTransform : public base::RefCountT<ColorTransform> {
+  public:
+    static constexpr int kGridPoints = 33;
+
+    // Returns the transform between both color spaces (from a cache
+    // of the last used transforms), or nullptr if some color space is
+    // not supported. A ColorSpace::None color space means "no
+    // conversion" (an identity transform).
+    static ColorTransformRef Make(const ColorSpaceRef& src,
+                                  const ColorSpaceRef& dst);
+
+    // Returns true if the color space can be used in a transform.
+    static bool IsSupported(const ColorSpace& cs);
+
+    // Transforms RGBA pixels (the alpha channel is not modified). dst
+    // and src can be the same buffer.
+    void convertRgba(uint32_t* dst, const uint32_t* src, int n) const;
+    // Same for an image of "n" pixels with rows of "rowLength"
+    // pixels. Chunks of rows are converted in the given thread pool
+    // (and in the calling thread) and it waits until all of them are
+    // converted.
+    void convertRgba(uint32_t* dst, const uint32_t* src, int n,
+                     base::thread_pool& pool, int rowLength) const;
+    // Transforms grayscale pixels (without alpha).
+    void convertGray(uint8_t* dst, const uint8_t* src, int n) const;
+
+    bool isIdentity() const { return m_type == Identity; }
+    bool usesGrid() const { return m_type == Grid; }
+
+    // Use Make()
+    ColorTransform() = default;
+
+  private:
+    enum Type { Identity, Matrix, Grid };
+
+    bool init(const ColorSpace& src, const ColorSpace& dst);
+
+    struct alignas(16) Float4 {
+      float v[4];
+    };
+
+    Type m_type = Identity;
+
+    // Matrix: for each channel and 8-bit value, the linear value
+    // multiplied by the src->dst matrix column of that channel.
+    std::vector<Float4> m_toLinear[3];
+    // Grid: the 3D LUT with destination values in the [0, 1] range.
+    std::vector<Float4> m_grid;
+    // Matrix: linear values (indexed by sqrt(value)*(kEncodeSize-1)) to
+    // 8-bit destination values.
+    static constexpr int kEncodeSize = 4096;
+    std::vector<uint8_t> m_encode[3];
+    // 8-bit gray to 8-bit gray.
+    uint8_t m_gray[256];
+  };
+
+} // namespace gfx
+
+#endif
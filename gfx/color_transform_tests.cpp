@@ -0,0 +1,479 @@
+// LAF Gfx Library
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "base/thread_pool.h"
+#include "gfx/color.h"
+#include "gfx/color_transform.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace gfx;
+
+static const ColorSpacePrimaries kDisplayP3 = {
+  0.680f, 0.320f, 0.265f, 0.690f, 0.150f, 0.060f, 0.3127f, 0.3290f
+};
+
+static const ColorSpaceTransferFn kSRGBFn = {
+  2.4f, float(1/1.055), float(0.055/1.055), float(1/12.92), 0.04045f, 0.0f, 0.0f
+};
+
+// sRGB to XYZ D50 (same matrix used by Skia)
+static const double kSRGB_toXYZD50[3][3] = {
+  { 0.4360747, 0.3850649, 0.1430804 },
+  { 0.2225045, 0.7168786, 0.0606169 },
+  { 0.0139322, 0.0971045, 0.7141733 },
+};
+
+static double srgb_to_linear(double x)
+{
+  return (x < 0.04045 ? x / 12.92: std::pow((x + 0.055) / 1.055, 2.4));
+}
+
+// Display P3 to XYZ D50 (SkNamedGamut::kDisplayP3)
+static const double kP3_toXYZD50[3][3] = {
+  {  0.515102,   0.291965,  0.157153  },
+  {  0.241182,   0.692236,  0.0665819 },
+  { -0.00104941, 0.0418818, 0.784378  },
+};
+
+static double linear_to_srgb(double x)
+{
+  return (x < 0.0031308 ? x * 12.92: 1.055 * std::pow(x, 1/2.4) - 0.055);
+}
+
+static void invert(const double m[3][3], double inv[3][3])
+{
+  const double det =
+    m[0][0]*(m[1][1]*m[2][2] - m[1][2]*m[2][1]) -
+    m[0][1]*(m[1][0]*m[2][2] - m[1][2]*m[2][0]) +
+    m[0][2]*(m[1][0]*m[2][1] - m[1][1]*m[2][0]);
+  for (int i=0; i<3; ++i)
+    for (int j=0; j<3; ++j) {
+      const int r0 = (j+1)%3, r1 = (j+2)%3;
+      const int c0 = (i+1)%3, c1 = (i+2)%3;
+      inv[i][j] = (m[r0][c0]*m[r1][c1] - m[r0][c1]*m[r1][c0]) / det;
+    }
+}
+
+static uint32_t srgb_to_p3(uint32_t c)
+{
+  double fromXYZ[3][3];
+  invert(kP3_toXYZD50, fromXYZ);
+
+  const double lin[3] = { srgb_to_linear(getr(c) / 255.0),
+                          srgb_to_linear(getg(c) / 255.0),
+                          srgb_to_linear(getb(c) / 255.0) };
+  double xyz[3], out[3];
+  for (int i=0; i<3; ++i)
+    xyz[i] = (kSRGB_toXYZD50[i][0]*lin[0] +
+              kSRGB_toXYZD50[i][1]*lin[1] +
+              kSRGB_toXYZD50[i][2]*lin[2]);
+  for (int i=0; i<3; ++i) {
+    const double v = (fromXYZ[i][0]*xyz[0] +
+                      fromXYZ[i][1]*xyz[1] +
+                      fromXYZ[i][2]*xyz[2]);
+    out[i] = linear_to_srgb(std::clamp(v, 0.0, 1.0)) * 255.0 + 0.5;
+  }
+  return rgba(int(out[0]), int(out[1]), int(out[2]), geta(c));
+}
+
+static int channel_distance(uint32_t a, uint32_t b)
+{
+  return std::max({ std::abs(int(getr(a)) - int(getr(b))),
+                    std::abs(int(getg(a)) - int(getg(b))),
+                    std::abs(int(getb(a)) - int(getb(b))) });
+}
+
+static std::vector<uint32_t> make_random_pixels(int n)
+{
+  std::mt19937 rng(42);
+  std::vector<uint32_t> pixels(n);
+  for (auto& p : pixels)
+    p = rng();
+  return pixels;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Minimal ICC profiles writer
+
+class IccWriter {
+public:
+  explicit IccWriter(const char* colorSpace, const char* pcs = "XYZ ")
+    : m_data(128, 0), m_colorSpace(colorSpace), m_pcs(pcs) { }
+
+  void addXYZ(const char* sig, double x, double y, double z) {
+    std::vector<uint8_t> tag;
+    write(tag, "XYZ ");
+    write32(tag, 0);
+    writeFixed(tag, x);
+    writeFixed(tag, y);
+    writeFixed(tag, z);
+    addTag(sig, tag);
+  }
+
+  void addPara(const char* sig, const ColorSpaceTransferFn& fn) {
+    std::vector<uint8_t> tag;
+    write(tag, "para");
+    write32(tag, 0);
+    write16(tag, 4);
+    write16(tag, 0);
+    for (float v : { fn.g, fn.a, fn.b, fn.c, fn.d, fn.e, fn.f })
+      writeFixed(tag, v);
+    addTag(sig, tag);
+  }
+
+  void addCurv(const char* sig, const std::vector<uint16_t>& table) {
+    std::vector<uint8_t> tag;
+    write(tag, "curv");
+    write32(tag, 0);
+    write32(tag, uint32_t(table.size()));
+    for (uint16_t v : table)
+      write16(tag, v);
+    addTag(sig, tag);
+  }
+
+  // lut16 with "inTable" input curves, an identity output curve and a
+  // CLUT with the given function.
+  template<typename Func>
+  void addLut16(const char* sig, int gridPoints,
+                const std::vector<uint16_t>& inTable,
+                Func clut) {
+    std::vector<uint8_t> tag;
+    write(tag, "mft2");
+    write32(tag, 0);
+    tag.push_back(3);
+    tag.push_back(3);
+    tag.push_back(uint8_t(gridPoints));
+    tag.push_back(0);
+    for (int i=0; i<9; ++i)
+      writeFixed(tag, i % 4 == 0 ? 1.0: 0.0);
+    write16(tag, uint16_t(inTable.size()));
+    write16(tag, 2);
+    for (int c=0; c<3; ++c)
+      for (uint16_t v : inTable)
+        write16(tag, v);
+    for (int r=0; r<gridPoints; ++r)
+      for (int g=0; g<gridPoints; ++g)
+        for (int b=0; b<gridPoints; ++b) {
+          double out[3];
+          clut(double(r)/(gridPoints-1),
+               double(g)/(gridPoints-1),
+               double(b)/(gridPoints-1), out);
+          for (int c=0; c<3; ++c)
+            write16(tag, uint16_t(std::clamp(out[c], 0.0, 1.0) * 65535.0 + 0.5));
+        }
+    for (int c=0; c<3; ++c) {
+      write16(tag, 0);
+      write16(tag, 65535);
+    }
+    addTag(sig, tag);
+  }
+
+  std::vector<uint8_t> data() const {
+    std::vector<uint8_t> out(m_data);
+    const size_t tableSize = 4 + 12*m_tags.size();
+    size_t offset = 128 + tableSize;
+    write32(out, uint32_t(m_tags.size()));
+    for (const auto& tag : m_tags) {
+      out.insert(out.end(), tag.first.begin(), tag.first.end());
+      write32(out, uint32_t(offset));
+      write32(out, uint32_t(tag.second.size()));
+      offset += (tag.second.size() + 3) & ~size_t(3);
+    }
+    for (const auto& tag : m_tags) {
+      out.insert(out.end(), tag.second.begin(), tag.second.end());
+      out.resize((out.size() + 3) & ~size_t(3), 0);
+    }
+    set32(out, 0, uint32_t(out.size()));
+    std::copy(m_colorSpace, m_colorSpace+4, out.begin()+16);
+    std::copy(m_pcs, m_pcs+4, out.begin()+20);
+    std::copy("acsp", "acsp"+4, out.begin()+36);
+    return out;
+  }
+
+private:
+  void addTag(const char* sig, const std::vector<uint8_t>& tag) {
+    m_tags.emplace_back(std::string(sig, 4), tag);
+  }
+  static void write(std::vector<uint8_t>& v, const char* s) {
+    v.insert(v.end(), s, s+4);
+  }
+  static void write16(std::vector<uint8_t>& v, uint16_t x) {
+    v.push_back(uint8_t(x >> 8));
+    v.push_back(uint8_t(x));
+  }
+  static void write32(std::vector<uint8_t>& v, uint32_t x) {
+    write16(v, uint16_t(x >> 16));
+    write16(v, uint16_t(x));
+  }
+  static void set32(std::vector<uint8_t>& v, size_t i, uint32_t x) {
+    v[i] = uint8_t(x >> 24);
+    v[i+1] = uint8_t(x >> 16);
+    v[i+2] = uint8_t(x >> 8);
+    v[i+3] = uint8_t(x);
+  }
+  static void writeFixed(std::vector<uint8_t>& v, double x) {
+    write32(v, uint32_t(int32_t(std::lround(x * 65536.0))));
+  }
+
+  std::vector<uint8_t> m_data;
+  const char* m_colorSpace;
+  const char* m_pcs;
+  std::vector<std::pair<std::string, std::vector<uint8_t>>> m_tags;
+};
+
+static ColorSpaceRef make_srgb_icc()
+{
+  IccWriter icc("RGB ");
+  const char* xyzTags[] = { "rXYZ", "gXYZ", "bXYZ" };
+  const char* trcTags[] = { "rTRC", "gTRC", "bTRC" };
+  for (int c=0; c<3; ++c) {
+    icc.addXYZ(xyzTags[c],
+               kSRGB_toXYZD50[0][c], kSRGB_toXYZD50[1][c], kSRGB_toXYZD50[2][c]);
+    icc.addPara(trcTags[c], kSRGBFn);
+  }
+  return ColorSpace::MakeICC(icc.data());
+}
+
+//////////////////////////////////////////////////////////////////////
+
+TEST(ColorTransform, Identity)
+{
+  auto none = ColorSpace::MakeNone();
+  auto srgb = ColorSpace::MakeSRGB();
+  auto p3 = ColorSpace::MakeRGBWithSRGBGamma(kDisplayP3);
+
+  EXPECT_TRUE(ColorTransform::Make(none, p3)->isIdentity());
+  EXPECT_TRUE(ColorTransform::Make(p3, none)->isIdentity());
+  EXPECT_TRUE(ColorTransform::Make(srgb, ColorSpace::MakeSRGB())->isIdentity());
+  EXPECT_FALSE(ColorTransform::Make(srgb, p3)->isIdentity());
+
+  const std::vector<uint32_t> src = make_random_pixels(1000);
+  std::vector<uint32_t> dst(src.size());
+  ColorTransform::Make(none, p3)->convertRgba(dst.data(), src.data(), int(src.size()));
+  EXPECT_EQ(src, dst);
+}
+
+TEST(ColorTransform, Cache)
+{
+  auto srgb = ColorSpace::MakeSRGB();
+  auto p3 = ColorSpace::MakeRGBWithSRGBGamma(kDisplayP3);
+  auto t = ColorTransform::Make(srgb, p3);
+  ASSERT_TRUE(t);
+  // Different ColorSpace instances with the same data
+  EXPECT_EQ(t, ColorTransform::Make(ColorSpace::MakeSRGB(),
+                                    ColorSpace::MakeRGBWithSRGBGamma(kDisplayP3)));
+  EXPECT_NE(t, ColorTransform::Make(p3, srgb));
+}
+
+TEST(ColorTransform, SRGBToDisplayP3)
+{
+  auto t = ColorTransform::Make(ColorSpace::MakeSRGB(),
+                                ColorSpace::MakeRGBWithSRGBGamma(kDisplayP3));
+  ASSERT_TRUE(t);
+  EXPECT_FALSE(t->usesGrid());
+
+  // Known values: sRGB primaries in Display P3
+  uint32_t px[] = { rgba(255, 0, 0, 10), rgba(0, 255, 0, 20), rgba(0, 0, 255, 30),
+                    rgba(255, 255, 255), rgba(0, 0, 0, 0) };
+  t->convertRgba(px, px, 5);
+  EXPECT_LE(channel_distance(rgba(234, 51, 35), px[0]), 1);
+  EXPECT_LE(channel_distance(rgba(117, 251, 76), px[1]), 1);
+  EXPECT_LE(channel_distance(rgba(0, 0, 245), px[2]), 1);
+  EXPECT_EQ(rgba(255, 255, 255), px[3]);
+  EXPECT_EQ(rgba(0, 0, 0, 0), px[4]);
+  EXPECT_EQ(10, geta(px[0]));
+  EXPECT_EQ(20, geta(px[1]));
+  EXPECT_EQ(30, geta(px[2]));
+
+  // Compare with a double precision reference
+  const std::vector<uint32_t> src = make_random_pixels(10000);
+  std::vector<uint32_t> dst(src.size());
+  t->convertRgba(dst.data(), src.data(), int(src.size()));
+  for (size_t i=0; i<src.size(); ++i) {
+    ASSERT_LE(channel_distance(srgb_to_p3(src[i]), dst[i]), 1) << i;
+    ASSERT_EQ(geta(src[i]), geta(dst[i]));
+  }
+}
+
+TEST(ColorTransform, ThreadPool)
+{
+  auto t = ColorTransform::Make(ColorSpace::MakeSRGB(),
+                                ColorSpace::MakeRGBWithSRGBGamma(kDisplayP3));
+  ASSERT_TRUE(t);
+
+  const int w = 300, h = 200;
+  const std::vector<uint32_t> src = make_random_pixels(w*h);
+  std::vector<uint32_t> dst1(src.size()), dst2(src.size());
+  t->convertRgba(dst1.data(), src.data(), w*h);
+
+  base::thread_pool pool(4);
+  t->convertRgba(dst2.data(), src.data(), w*h, pool, w);
+  EXPECT_EQ(dst1, dst2);
+
+  // In-place
+  dst2 = src;
+  t->convertRgba(dst2.data(), dst2.data(), w*h, pool, w);
+  EXPECT_EQ(dst1, dst2);
+}
+
+TEST(ColorTransform, LinearAndGamma)
+{
+  auto srgb = ColorSpace::MakeSRGB();
+  auto linear = ColorTransform::Make(srgb, ColorSpace::MakeLinearSRGB());
+  auto gamma = ColorTransform::Make(ColorSpace::MakeSRGBWithGamma(2.2f), srgb);
+  ASSERT_TRUE(linear);
+  ASSERT_TRUE(gamma);
+
+  for (int i=0; i<256; ++i) {
+    uint32_t px = rgba(i, i, i);
+    linear->convertRgba(&px, &px, 1);
+    const int expected = int(srgb_to_linear(i / 255.0) * 255.0 + 0.5);
+    ASSERT_LE(std::abs(expected - int(getr(px))), 1) << i;
+    ASSERT_EQ(getr(px), getg(px));
+    ASSERT_EQ(getr(px), getb(px));
+
+    px = rgba(i, 0, 0);
+    gamma->convertRgba(&px, &px, 1);
+    const double enc = linear_to_srgb(std::pow(i / 255.0, 2.2));
+    ASSERT_LE(std::abs(int(enc * 255.0 + 0.5) - int(getr(px))), 1) << i;
+  }
+
+  // Gray pixels
+  uint8_t gray[256];
+  for (int i=0; i<256; ++i)
+    gray[i] = uint8_t(i);
+  linear->convertGray(gray, gray, 256);
+  for (int i=0; i<256; ++i) {
+    const int expected = int(srgb_to_linear(i / 255.0) * 255.0 + 0.5);
+    ASSERT_LE(std::abs(expected - int(gray[i])), 1) << i;
+  }
+}
+
+TEST(ColorTransform, IccMatrixTrc)
+{
+  auto icc = make_srgb_icc();
+  ASSERT_TRUE(ColorTransform::IsSupported(*icc));
+
+  // An ICC profile equal to sRGB
+  auto t = ColorTransform::Make(icc, ColorSpace::MakeSRGB());
+  ASSERT_TRUE(t);
+  EXPECT_FALSE(t->isIdentity());
+  for (int i=0; i<(1<<24); i += 97) {
+    uint32_t px = uint32_t(i) | 0xff000000;
+    t->convertRgba(&px, &px, 1);
+    ASSERT_LE(channel_distance(uint32_t(i), px), 1) << i;
+  }
+
+  // Gamma 2.2 as a curv table
+  IccWriter gamma22("RGB ");
+  std::vector<uint16_t> table(1024);
+  for (size_t i=0; i<table.size(); ++i)
+    table[i] = uint16_t(std::pow(i / 1023.0, 2.2) * 65535.0 + 0.5);
+  const char* xyzTags[] = { "rXYZ", "gXYZ", "bXYZ" };
+  const char* trcTags[] = { "rTRC", "gTRC", "bTRC" };
+  for (int c=0; c<3; ++c) {
+    gamma22.addXYZ(xyzTags[c],
+                   kSRGB_toXYZD50[0][c], kSRGB_toXYZD50[1][c], kSRGB_toXYZD50[2][c]);
+    gamma22.addCurv(trcTags[c], table);
+  }
+  auto a = ColorTransform::Make(ColorSpace::MakeICC(gamma22.data()), ColorSpace::MakeSRGB());
+  auto b = ColorTransform::Make(ColorSpace::MakeSRGBWithGamma(2.2f), ColorSpace::MakeSRGB());
+  ASSERT_TRUE(a);
+  ASSERT_TRUE(b);
+  const std::vector<uint32_t> src = make_random_pixels(10000);
+  std::vector<uint32_t> dstA(src.size()), dstB(src.size());
+  a->convertRgba(dstA.data(), src.data(), int(src.size()));
+  b->convertRgba(dstB.data(), src.data(), int(src.size()));
+  for (size_t i=0; i<src.size(); ++i)
+    ASSERT_LE(channel_distance(dstA[i], dstB[i]), 1) << i;
+}
+
+TEST(ColorTransform, IccGray)
+{
+  IccWriter gray("GRAY");
+  gray.addCurv("kTRC", { 256*2 + 51 }); // Gamma 2.2 (u8Fixed8)
+  auto grayCS = ColorSpace::MakeICC(gray.data());
+  auto t = ColorTransform::Make(grayCS, ColorSpace::MakeSRGBWithGamma(1.0f));
+  ASSERT_TRUE(t);
+
+  for (int i=0; i<256; ++i) {
+    uint8_t v = uint8_t(i);
+    t->convertGray(&v, &v, 1);
+    const double expected = std::pow(i / 255.0, (256*2 + 51) / 256.0) * 255.0;
+    ASSERT_NEAR(expected, v, 1.0) << i;
+  }
+}
+
+TEST(ColorTransform, IccLut)
+{
+  // A2B0 with sRGB curves as input tables and a linear CLUT from
+  // linear sRGB to XYZ (u1Fixed15 encoding).
+  std::vector<uint16_t> inTable(4096);
+  for (size_t i=0; i<inTable.size(); ++i)
+    inTable[i] = uint16_t(srgb_to_linear(i / 4095.0) * 65535.0 + 0.5);
+
+  IccWriter lut("RGB ");
+  lut.addLut16("A2B0", 9, inTable,
+               [](double r, double g, double b, double out[3]){
+                 for (int i=0; i<3; ++i) {
+                   const double v = (kSRGB_toXYZD50[i][0]*r +
+                                     kSRGB_toXYZD50[i][1]*g +
+                                     kSRGB_toXYZD50[i][2]*b);
+                   out[i] = v * 32768.0 / 65535.0;
+                 }
+               });
+  auto lutCS = ColorSpace::MakeICC(lut.data());
+  ASSERT_TRUE(ColorTransform::IsSupported(*lutCS));
+
+  auto p3 = ColorSpace::MakeRGBWithSRGBGamma(kDisplayP3);
+  auto t = ColorTransform::Make(lutCS, p3);
+  auto ref = ColorTransform::Make(ColorSpace::MakeSRGB(), p3);
+  ASSERT_TRUE(t);
+  EXPECT_TRUE(t->usesGrid());
+
+  const std::vector<uint32_t> src = make_random_pixels(10000);
+  std::vector<uint32_t> dst(src.size()), dstRef(src.size());
+  t->convertRgba(dst.data(), src.data(), int(src.size()));
+  ref->convertRgba(dstRef.data(), src.data(), int(src.size()));
+  for (size_t i=0; i<src.size(); ++i) {
+    ASSERT_LE(channel_distance(dstRef[i], dst[i]), 2) << i;
+    ASSERT_EQ(geta(src[i]), geta(dst[i]));
+  }
+
+  // Profiles with A2B0 only can't be used as destination
+  EXPECT_FALSE(ColorTransform::Make(p3, lutCS));
+}
+
+TEST(ColorTransform, Unsupported)
+{
+  std::vector<uint8_t> garbage(200, 0x42);
+  auto cs = ColorSpace::MakeICC(std::move(garbage));
+  EXPECT_FALSE(ColorTransform::IsSupported(*cs));
+  EXPECT_FALSE(ColorTransform::Make(cs, ColorSpace::MakeSRGB()));
+  EXPECT_FALSE(ColorTransform::Make(ColorSpace::MakeSRGB(), cs));
+
+  // CMYK profile
+  IccWriter cmyk("CMYK");
+  EXPECT_FALSE(ColorTransform::IsSupported(*ColorSpace::MakeICC(cmyk.data())));
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
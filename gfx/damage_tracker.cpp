@@ -0,0 +1,182 @@
+// LAF Gfx Library
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gfx/damage_tracker.h"
+
+#include "gfx/point.h"
+#include "gfx/region.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+namespace gfx {
+
+namespace {
+
+int64_t area(const Rect& rc)
+{
+  return int64_t(rc.w) * rc.h;
+}
+
+// Area of the bounds of "a" and "b" that is not covered by them.
+int64_t overhead(const Rect& a, const Rect& b)
+{
+  return (area(a.createUnion(b))
+          - area(a) - area(b)
+          + area(a.createIntersection(b)));
+}
+
+void remove_contained(std::vector<Rect>& rects, const Rect& rc)
+{
+  rects.erase(std::remove_if(rects.begin(), rects.end(),
+                             [&rc](const Rect& r){ return rc.contains(r); }),
+              rects.end());
+}
+
+} // anonymous namespace
+
+DamageTracker::DamageTracker(int maxRects, double maxOverhead)
+  : m_maxRects(std::max(1, maxRects))
+  , m_maxOverhead(maxOverhead)
+{
+}
+
+void DamageTracker::setBounds(const Rect& bounds)
+{
+  if (m_bounds == bounds)
+    return;
+  m_bounds = bounds;
+  addAll();
+}
+
+void DamageTracker::add(const Rect& rc)
+{
+  coalesce(m_rects,
+           (m_bounds.isEmpty() ? rc: rc.createIntersection(m_bounds)),
+           m_maxRects, m_maxOverhead);
+}
+
+void DamageTracker::add(const Region& rgn)
+{
+  for (const Rect& rc : rgn)
+    add(rc);
+}
+
+void DamageTracker::addAll()
+{
+  if (!m_bounds.isEmpty()) {
+    m_rects.clear();
+    m_rects.push_back(m_bounds);
+  }
+}
+
+std::vector<Rect> DamageTracker::endFrame(int bufferAge)
+{
+  std::vector<Rect> result;
+  if (!m_bounds.isEmpty() &&
+      (bufferAge <= 0 ||
+       bufferAge > kMaxBufferAge ||
+       bufferAge-1 > int(m_history.size()))) {
+    // Unknown buffer content
+    result.push_back(m_bounds);
+  }
+  else {
+    result = m_rects;
+    int n = int(m_history.size());
+    if (bufferAge > 0 && bufferAge <= kMaxBufferAge)
+      n = std::min(n, bufferAge-1);
+    for (int i=0; i<n; ++i)
+      for (const Rect& rc : m_history[i])
+        coalesce(result, rc, m_maxRects, m_maxOverhead);
+
+    // Present the whole bounds when the damage covers almost all of
+    // them anyway.
+    if (!m_bounds.isEmpty() && result.size() > 1) {
+      int64_t damaged = 0;
+      for (const Rect& rc : result)
+        damaged += area(rc);
+      if (damaged >= (1.0 - m_maxOverhead) * area(m_bounds)) {
+        result.clear();
+        result.push_back(m_bounds);
+      }
+    }
+  }
+
+  m_history.push_front(std::move(m_rects));
+  if (int(m_history.size()) > kMaxBufferAge-1)
+    m_history.pop_back();
+  m_rects.clear();
+  return result;
+}
+
+void DamageTracker::clear()
+{
+  m_rects.clear();
+  m_history.clear();
+}
+
+// static
+void DamageTracker::coalesce(std::vector<Rect>& rects, const Rect& rc,
+                             const int maxRects, const double maxOverhead)
+{
+  if (rc.isEmpty())
+    return;
+
+  for (const Rect& r : rects) {
+    if (r.contains(rc))
+      return;
+  }
+  remove_contained(rects, rc);
+
+  // Merge with the rectangles that add a small overhead (the merged
+  // rectangle can be merged with other ones again).
+  Rect cur = rc;
+  for (;;) {
+    int best = -1;
+    int64_t bestOverhead = std::numeric_limits<int64_t>::max();
+    for (int i=0; i<int(rects.size()); ++i) {
+      const int64_t o = overhead(cur, rects[i]);
+      if (o <= maxOverhead * area(cur.createUnion(rects[i])) &&
+          o < bestOverhead) {
+        best = i;
+        bestOverhead = o;
+      }
+    }
+    if (best < 0)
+      break;
+    cur |= rects[best];
+    rects.erase(rects.begin()+best);
+    remove_contained(rects, cur);
+  }
+  rects.push_back(cur);
+
+  // Too many rectangles, merge the pairs with the smallest overhead.
+  while (int(rects.size()) > maxRects) {
+    int bestI = 0, bestJ = 1;
+    int64_t bestOverhead = std::numeric_limits<int64_t>::max();
+    for (int i=0; i<int(rects.size()); ++i)
+      for (int j=i+1; j<int(rects.size()); ++j) {
+        const int64_t o = overhead(rects[i], rects[j]);
+        if (o < bestOverhead) {
+          bestI = i;
+          bestJ = j;
+          bestOverhead = o;
+        }
+      }
+    const Rect merged = rects[bestI].createUnion(rects[bestJ]);
+    rects.erase(rects.begin()+bestJ);
+    rects.erase(rects.begin()+bestI);
+    remove_contained(rects, merged);
+    rects.push_back(merged);
+  }
+}
+
+} // namespace gfx
@@ -0,0 +1,81 @@
+// LAF Gfx Library
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef GFX_DAMAGE_TRACKER_H_INCLUDED
+#define GFX_DAMAGE_TRACKER_H_INCLUDED
+#pragma once
+
+#include "gfx/rect.h"
+
+#include <deque>
+#include <vector>
+
+namespace gfx {
+
+  class Region;
+
+  // Accumulates the invalidated areas of a window/surface in the
+  // current frame, and returns the list of rectangles that must be
+  // presented at the end of the frame.
+  //
+  // Invalidated rectangles are coalesced as they are added: two
+  // rectangles are merged when the area of their bounds that wasn't
+  // invalidated (the overhead) is less than maxOverhead * bounds
+  // area, and the pair with the smallest overhead is merged when
+  // there are more than maxRects rectangles.
+  //
+  // For double/triple buffering, endFrame() receives the age of the
+  // buffer (the number of frames since its content was presented)
+  // and returns the damage of the last "age" frames.
+  class DamageTracker {
+  public:
+    // Maximum buffer age that can be used in endFrame() (older
+    // buffers are fully repainted).
+    static constexpr int kMaxBufferAge = 3;
+
+    explicit DamageTracker(int maxRects = 8, double maxOverhead = 0.25);
+
+    // Area of the window/surface. Damage is clipped to these bounds,
+    // and changing them damages everything. An empty rectangle means
+    // "no clipping" (and then addAll() and unknown buffer ages can
+    // only use the known damage).
+    const Rect& bounds() const { return m_bounds; }
+    void setBounds(const Rect& bounds);
+
+    void add(const Rect& rc);
+    void add(const Region& rgn);
+    // Damages the whole bounds.
+    void addAll();
+
+    bool hasDamage() const { return !m_rects.empty(); }
+
+    // Coalesced rectangles of the current frame.
+    const std::vector<Rect>& damage() const { return m_rects; }
+
+    // Finishes the current frame and returns the rectangles to
+    // present in a buffer of the given age (1 if the buffer contains
+    // the previous frame, 2 for the frame before that, etc.; 0 or
+    // greater than kMaxBufferAge if its content is unknown, which
+    // returns the whole bounds).
+    std::vector<Rect> endFrame(int bufferAge = 1);
+
+    void clear();
+
+  private:
+    static void coalesce(std::vector<Rect>& rects, const Rect& rc,
+                         int maxRects, double maxOverhead);
+
+    Rect m_bounds;
+    int m_maxRects;
+    double m_maxOverhead;
+    std::vector<Rect> m_rects;
+    // Damage of previous frames (front = last frame).
+    std::deque<std::vector<Rect>> m_history;
+  };
+
+} // namespace gfx
+
+#endif
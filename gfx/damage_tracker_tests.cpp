@@ -0,0 +1,155 @@
+// LAF Gfx Library
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "gfx/damage_tracker.h"
+#include "gfx/rect_io.h"
+#include "gfx/region.h"
+
+#include <random>
+#include <vector>
+
+using namespace gfx;
+
+using Rects = std::vector<Rect>;
+
+static bool covers(const Rects& rects, const Rect& rc)
+{
+  Region rgn;
+  for (const Rect& r : rects)
+    rgn |= Region(r);
+  return rgn.contains(rc) == Region::In;
+}
+
+TEST(DamageTracker, SeparatedRects)
+{
+  DamageTracker damage;
+  damage.setBounds(Rect(0, 0, 1000, 1000));
+  damage.endFrame(0);
+
+  damage.add(Rect(0, 0, 10, 10));
+  damage.add(Rect(990, 990, 10, 10));
+  EXPECT_TRUE(damage.hasDamage());
+  EXPECT_EQ(Rects({ Rect(0, 0, 10, 10), Rect(990, 990, 10, 10) }),
+            damage.endFrame());
+  EXPECT_FALSE(damage.hasDamage());
+  EXPECT_EQ(Rects(), damage.endFrame());
+}
+
+TEST(DamageTracker, Coalesce)
+{
+  DamageTracker damage;
+
+  // Adjacent
+  damage.add(Rect(0, 0, 10, 10));
+  damage.add(Rect(10, 0, 10, 10));
+  EXPECT_EQ(Rects({ Rect(0, 0, 20, 10) }), damage.damage());
+
+  // Contained
+  damage.add(Rect(5, 5, 5, 5));
+  EXPECT_EQ(Rects({ Rect(0, 0, 20, 10) }), damage.damage());
+
+  // Small overhead (10x1 pixels of 20x11)
+  damage.add(Rect(0, 10, 10, 1));
+  EXPECT_EQ(Rects({ Rect(0, 0, 20, 11) }), damage.damage());
+
+  // Contains previous rectangles
+  damage.add(Rect(100, 100, 10, 10));
+  damage.add(Rect(-10, -10, 50, 50));
+  EXPECT_EQ(Rects({ Rect(100, 100, 10, 10), Rect(-10, -10, 50, 50) }),
+            damage.damage());
+
+  // Big overhead (a diagonal) isn't merged
+  damage.clear();
+  damage.add(Rect(0, 0, 10, 10));
+  damage.add(Rect(10, 10, 10, 10));
+  EXPECT_EQ(2, damage.damage().size());
+}
+
+TEST(DamageTracker, MaxRects)
+{
+  std::mt19937 rng(42);
+  DamageTracker damage(4);
+  damage.setBounds(Rect(0, 0, 4000, 4000));
+  damage.endFrame(0);
+
+  Rects added;
+  for (int i=0; i<100; ++i) {
+    const Rect rc(rng() % 3000, rng() % 3000, 1 + rng() % 30, 1 + rng() % 30);
+    added.push_back(rc);
+    damage.add(rc);
+    ASSERT_LE(damage.damage().size(), 4);
+  }
+  for (const Rect& rc : added)
+    EXPECT_TRUE(covers(damage.damage(), rc)) << rc;
+}
+
+TEST(DamageTracker, Bounds)
+{
+  DamageTracker damage;
+  damage.setBounds(Rect(0, 0, 100, 100));
+  EXPECT_EQ(Rects({ Rect(0, 0, 100, 100) }), damage.endFrame());
+
+  // Clipped
+  damage.add(Rect(90, -10, 20, 20));
+  EXPECT_EQ(Rects({ Rect(90, 0, 10, 10) }), damage.endFrame());
+
+  // Almost all the bounds
+  damage.add(Rect(0, 0, 100, 45));
+  damage.add(Rect(0, 55, 100, 45));
+  EXPECT_EQ(Rects({ Rect(0, 0, 100, 100) }), damage.endFrame());
+
+  // Resize
+  damage.setBounds(Rect(0, 0, 200, 100));
+  damage.add(Rect(0, 0, 10, 10));
+  EXPECT_EQ(Rects({ Rect(0, 0, 200, 100) }), damage.endFrame());
+
+  damage.add(Rect(0, 0, 10, 10));
+  damage.addAll();
+  EXPECT_EQ(Rects({ Rect(0, 0, 200, 100) }), damage.endFrame());
+}
+
+TEST(DamageTracker, BufferAge)
+{
+  const Rect a(0, 0, 10, 10);
+  const Rect b(500, 0, 10, 10);
+  const Rect c(0, 500, 10, 10);
+  const Rect d(500, 500, 10, 10);
+  const Rect full(0, 0, 1000, 1000);
+
+  DamageTracker damage;
+  damage.setBounds(full);
+
+  // We don't know the content of the first buffers
+  EXPECT_EQ(Rects({ full }), damage.endFrame(0));
+  damage.add(a);
+  EXPECT_EQ(Rects({ full }), damage.endFrame(2));
+
+  // Double buffering
+  damage.add(b);
+  EXPECT_EQ(Rects({ b }), damage.endFrame(1));
+  damage.add(c);
+  EXPECT_EQ(Rects({ c, b }), damage.endFrame(2));
+
+  // Triple buffering
+  damage.add(d);
+  EXPECT_EQ(Rects({ d, c, b }), damage.endFrame(3));
+
+  // Too old
+  damage.add(a);
+  EXPECT_EQ(Rects({ full }), damage.endFrame(DamageTracker::kMaxBufferAge+1));
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
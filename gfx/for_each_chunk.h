@@ -0,0 +1,76 @@
+// LAF Gfx Library
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef GFX_FOR_EACH_CHUNK_H_INCLUDED
+#define GFX_FOR_EACH_CHUNK_H_INCLUDED
+#pragma once
+
+#include "base/thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+
+namespace gfx {
+
+  // Calls func(i, m) for chunks of rows of an image of "n" pixels
+  // (with rows of "rowLength" pixels) in the thread pool, where "i"
+  // is the first pixel of the chunk and "m" its number of pixels.
+  //
+  // The calling thread processes chunks too and waits only for the
+  // chunks of this call (not for other tasks of the pool), so this
+  // can be called from a worker of the same pool.
+  template<typename Func>
+  void for_each_chunk(size_t n, base::thread_pool& pool, size_t rowLength,
+                      Func&& func)
+  {
+    // Minimum number of pixels of each task
+    constexpr size_t kMinChunk = 16384;
+
+    rowLength = std::max<size_t>(rowLength, 1);
+    const size_t chunk = std::max<size_t>(kMinChunk / rowLength, 1) * rowLength;
+    if (n <= chunk) {
+      func(0, n);
+      return;
+    }
+
+    // Shared with the tasks, which can start running after this
+    // function returns (when all chunks were already processed).
+    struct State {
+      std::atomic<size_t> next { 0 };
+      std::mutex mutex;
+      std::condition_variable cv;
+      size_t done = 0;
+    };
+    auto state = std::make_shared<State>();
+    const size_t chunks = (n + chunk - 1) / chunk;
+
+    auto processChunks = [state, chunks, chunk, n, &func]{
+      size_t c;
+      while ((c = state->next++) < chunks) {
+        const size_t i = c*chunk;
+        func(i, std::min(chunk, n-i));
+
+        const std::lock_guard lock(state->mutex);
+        if (++state->done == chunks)
+          state->cv.notify_all();
+      }
+    };
+
+    for (size_t c=1; c<chunks; ++c)
+      pool.execute(processChunks);
+    processChunks();
+
+    std::unique_lock lock(state->mutex);
+    state->cv.wait(lock, [&state, chunks]{ return state->done == chunks; });
+  }
+
+} // namespace gfx
+
+#endif
@@ -0,0 +1,535 @@
+// LAF Gfx Library
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gfx/hsv_hsl_bulk.h"
+
+#include "base/cpu_features.h"
+#include "gfx/for_each_chunk.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if LAF_HAVE_SSE2
+  #include <immintrin.h>
+#elif LAF_HAVE_NEON
+  #include <arm_neon.h>
+#endif
+
+// Generic kernels instantiated with the Avx2 flavor pass/return AVX
+// vectors, but they are always inlined in LAF_TARGET("avx2")
+// functions (so there is no ABI issue).
+#if LAF_HAVE_X86_DISPATCH && defined(__GNUC__) && !defined(__clang__)
+  #pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+namespace gfx {
+
+namespace {
+
+// Each SIMD flavor is a struct with the same set of static functions
+// over N floats (F) and comparison masks (M), so the same conversion
+// kernel is used for all of them (including the scalar fallback, with
+// N=1, to convert the last pixels).
+
+struct Scalar {
+  static constexpr size_t N = 1;
+  using F = float;
+  using M = bool;
+
+  static F set1(float v) { return v; }
+  static F load(const float* p) { return *p; }
+  static void store(float* p, F v) { *p = v; }
+  static void load_rgb(const Color* p, F& r, F& g, F& b) {
+    r = float(getr(*p));
+    g = float(getg(*p));
+    b = float(getb(*p));
+  }
+  // r/g/b must be in the [0, 255.5) range
+  static void store_rgb(Color* p, F r, F g, F b) {
+    *p = rgba(int(r), int(g), int(b), geta(*p));
+  }
+  static F add(F a, F b) { return a + b; }
+  static F sub(F a, F b) { return a - b; }
+  static F mul(F a, F b) { return a * b; }
+  static F div(F a, F b) { return a / b; }
+  static F min(F a, F b) { return std::min(a, b); }
+  static F max(F a, F b) { return std::max(a, b); }
+  static F abs(F a) { return std::fabs(a); }
+  static F floor(F a) { return std::floor(a); }
+  static M eq(F a, F b) { return a == b; }
+  static M lt(F a, F b) { return a < b; }
+  static F select(M m, F a, F b) { return m ? a: b; }
+};
+
+#if LAF_HAVE_SSE2
+
+struct Sse2 {
+  static constexpr size_t N = 4;
+  using F = __m128;
+  using M = __m128;
+
+  static F set1(float v) { return _mm_set1_ps(v); }
+  static F load(const float* p) { return _mm_loadu_ps(p); }
+  static void store(float* p, F v) { _mm_storeu_ps(p, v); }
+  static void load_rgb(const Color* p, F& r, F& g, F& b) {
+    const __m128i mask = _mm_set1_epi32(0xff);
+    const __m128i v = _mm_loadu_si128((const __m128i*)p);
+    r = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(v, ColorRShift), mask));
+    g = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(v, ColorGShift), mask));
+    b = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(v, ColorBShift), mask));
+  }
+  static void store_rgb(Color* p, F r, F g, F b) {
+    const __m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i*)p),
+                                    _mm_set1_epi32(ColorAMask));
+    const __m128i v =
+      _mm_or_si128(
+        _mm_or_si128(_mm_slli_epi32(_mm_cvttps_epi32(r), ColorRShift),
+                     _mm_slli_epi32(_mm_cvttps_epi32(g), ColorGShift)),
+        _mm_or_si128(_mm_slli_epi32(_mm_cvttps_epi32(b), ColorBShift), a));
+    _mm_storeu_si128((__m128i*)p, v);
+  }
+  static F add(F a, F b) { return _mm_add_ps(a, b); }
+  static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+  static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+  static F div(F a, F b) { return _mm_div_ps(a, b); }
+  static F min(F a, F b) { return _mm_min_ps(a, b); }
+  static F max(F a, F b) { return _mm_max_ps(a, b); }
+  static F abs(F a) {
+    return _mm_andnot_ps(_mm_set1_ps(-0.0f), a);
+  }
+  // SSE2 doesn't have _mm_floor_ps() (SSE4.1), all values here are
+  // small enough to be converted to int32.
+  static F floor(F a) {
+    const F t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a), _mm_set1_ps(1.0f)));
+  }
+  static M eq(F a, F b) { return _mm_cmpeq_ps(a, b); }
+  static M lt(F a, F b) { return _mm_cmplt_ps(a, b); }
+  static F select(M m, F a, F b) {
+    return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+  }
+};
+
+using Simd = Sse2;
+
+#if LAF_HAVE_X86_DISPATCH
+
+// Kernels with this flavor must be called from a LAF_TARGET("avx2")
+// function (so all its functions are inlined) and only when
+// base::get_cpu_features().avx2 is true.
+struct Avx2 {
+  static constexpr size_t N = 8;
+  using F = __m256;
+  using M = __m256;
+
+  LAF_TARGET("avx2")
+  static F set1(float v) { return _mm256_set1_ps(v); }
+  LAF_TARGET("avx2")
+  static F load(const float* p) { return _mm256_loadu_ps(p); }
+  LAF_TARGET("avx2")
+  static void store(float* p, F v) { _mm256_storeu_ps(p, v); }
+  LAF_TARGET("avx2")
+  static void load_rgb(const Color* p, F& r, F& g, F& b) {
+    const __m256i mask = _mm256_set1_epi32(0xff);
+    const __m256i v = _mm256_loadu_si256((const __m256i*)p);
+    r = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(v, ColorRShift), mask));
+    g = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(v, ColorGShift), mask));
+    b = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(v, ColorBShift), mask));
+  }
+  LAF_TARGET("avx2")
+  static void store_rgb(Color* p, F r, F g, F b) {
+    const __m256i a = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)p),
+                                       _mm256_set1_epi32(ColorAMask));
+    const __m256i v =
+      _mm256_or_si256(
+        _mm256_or_si256(_mm256_slli_epi32(_mm256_cvttps_epi32(r), ColorRShift),
+                        _mm256_slli_epi32(_mm256_cvttps_epi32(g), ColorGShift)),
+        _mm256_or_si256(_mm256_slli_epi32(_mm256_cvttps_epi32(b), ColorBShift), a));
+    _mm256_storeu_si256((__m256i*)p, v);
+  }
+  LAF_TARGET("avx2")
+  static F add(F a, F b) { return _mm256_add_ps(a, b); }
+  LAF_TARGET("avx2")
+  static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+  LAF_TARGET("avx2")
+  static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+  LAF_TARGET("avx2")
+  static F div(F a, F b) { return _mm256_div_ps(a, b); }
+  LAF_TARGET("avx2")
+  static F min(F a, F b) { return _mm256_min_ps(a, b); }
+  LAF_TARGET("avx2")
+  static F max(F a, F b) { return _mm256_max_ps(a, b); }
+  LAF_TARGET("avx2")
+  static F abs(F a) {
+    return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a);
+  }
+  LAF_TARGET("avx2")
+  static F floor(F a) { return _mm256_floor_ps(a); }
+  LAF_TARGET("avx2")
+  static M eq(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+  LAF_TARGET("avx2")
+  static M lt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+  LAF_TARGET("avx2")
+  static F select(M m, F a, F b) { return _mm256_blendv_ps(b, a, m); }
+};
+
+#endif // LAF_HAVE_X86_DISPATCH
+
+#elif LAF_HAVE_NEON
+
+struct Neon {
+  static constexpr size_t N = 4;
+  using F = float32x4_t;
+  using M = uint32x4_t;
+
+  static F set1(float v) { return vdupq_n_f32(v); }
+  static F load(const float* p) { return vld1q_f32(p); }
+  static void store(float* p, F v) { vst1q_f32(p, v); }
+  // vshrq_n_u32() needs a shift in the [1, 32] range
+  template<uint32_t S>
+  static uint32x4_t shr(uint32x4_t v) {
+    if constexpr (S == 0)
+      return v;
+    else
+      return vshrq_n_u32(v, S);
+  }
+  static void load_rgb(const Color* p, F& r, F& g, F& b) {
+    const uint32x4_t mask = vdupq_n_u32(0xff);
+    const uint32x4_t v = vld1q_u32(p);
+    r = vcvtq_f32_u32(vandq_u32(shr<ColorRShift>(v), mask));
+    g = vcvtq_f32_u32(vandq_u32(shr<ColorGShift>(v), mask));
+    b = vcvtq_f32_u32(vandq_u32(shr<ColorBShift>(v), mask));
+  }
+  static void store_rgb(Color* p, F r, F g, F b) {
+    const uint32x4_t a = vandq_u32(vld1q_u32(p), vdupq_n_u32(ColorAMask));
+    const uint32x4_t v =
+      vorrq_u32(
+        vorrq_u32(vshlq_n_u32(vcvtq_u32_f32(r), ColorRShift),
+                  vshlq_n_u32(vcvtq_u32_f32(g), ColorGShift)),
+        vorrq_u32(vshlq_n_u32(vcvtq_u32_f32(b), ColorBShift), a));
+    vst1q_u32(p, v);
+  }
+  static F add(F a, F b) { return vaddq_f32(a, b); }
+  static F sub(F a, F b) { return vsubq_f32(a, b); }
+  static F mul(F a, F b) { return vmulq_f32(a, b); }
+  static F div(F a, F b) { return vdivq_f32(a, b); }
+  static F min(F a, F b) { return vminq_f32(a, b); }
+  static F max(F a, F b) { return vmaxq_f32(a, b); }
+  static F abs(F a) { return vabsq_f32(a); }
+  static F floor(F a) { return vrndmq_f32(a); }
+  static M eq(F a, F b) { return vceqq_f32(a, b); }
+  static M lt(F a, F b) { return vcltq_f32(a, b); }
+  static F select(M m, F a, F b) { return vbslq_f32(m, a, b); }
+};
+
+using Simd = Neon;
+
+#else
+
+using Simd = Scalar;
+
+#endif
+
+// Hue (in degrees) of the r/g/b components (in the [0, 255] range)
+// where max/chroma are the max component and max-min. Returns 0 for
+// gray colors (chroma == 0) like gfx::Hsv(const Rgb&).
+template<typename V>
+inline typename V::F hue_from_rgb(typename V::F r,
+                                  typename V::F g,
+                                  typename V::F b,
+                                  typename V::F max,
+                                  typename V::F chroma,
+                                  typename V::M gray)
+{
+  using F = typename V::F;
+  const F zero = V::set1(0.0f);
+  const F c = V::select(gray, V::set1(1.0f), chroma);
+
+  F hr = V::div(V::sub(g, b), c);
+  hr = V::select(V::lt(hr, zero), V::add(hr, V::set1(6.0f)), hr);
+  const F hg = V::add(V::div(V::sub(b, r), c), V::set1(2.0f));
+  const F hb = V::add(V::div(V::sub(r, g), c), V::set1(4.0f));
+
+  const F h = V::select(V::eq(max, r), hr,
+                        V::select(V::eq(max, g), hg, hb));
+  return V::select(gray, zero, V::mul(h, V::set1(60.0f)));
+}
+
+// Component of the RGB color (in the [0, 255.5) range, ready to be
+// truncated) for the given "n" offset (5 for red, 3 for green, 1 for
+// blue) where "max" is the value of the max component (in [0, 1]).
+// Branchless version of the hue sectors of gfx::Rgb(const Hsv&).
+template<typename V>
+inline typename V::F rgb_component(float n,
+                                   typename V::F huePrime,
+                                   typename V::F max,
+                                   typename V::F chroma)
+{
+  using F = typename V::F;
+  const F six = V::set1(6.0f);
+  F k = V::add(V::set1(n), huePrime);
+  k = V::sub(k, V::mul(six, V::floor(V::div(k, six))));
+
+  const F t = V::max(V::set1(0.0f),
+                     V::min(V::min(k, V::sub(V::set1(4.0f), k)),
+                            V::set1(1.0f)));
+  const F v = V::sub(max, V::mul(chroma, t));
+  return V::min(V::max(V::add(V::mul(v, V::set1(255.0f)), V::set1(0.5f)),
+                       V::set1(0.0f)),
+                V::set1(255.0f));
+}
+
+template<typename V>
+size_t rgba_to_hsv_kernel(const Color* src, size_t n,
+                          float* hue, float* saturation, float* value)
+{
+  using F = typename V::F;
+  const F zero = V::set1(0.0f);
+  const F one = V::set1(1.0f);
+  const F inv255 = V::set1(1.0f / 255.0f);
+
+  size_t i = 0;
+  for (; i+V::N <= n; i += V::N) {
+    F r, g, b;
+    V::load_rgb(src+i, r, g, b);
+
+    const F max = V::max(r, V::max(g, b));
+    const F min = V::min(r, V::min(g, b));
+    const F chroma = V::sub(max, min);
+    const typename V::M gray = V::eq(chroma, zero);
+
+    V::store(hue+i, hue_from_rgb<V>(r, g, b, max, chroma, gray));
+    V::store(saturation+i,
+             V::select(gray, zero,
+                       V::div(chroma, V::select(gray, one, max))));
+    V::store(value+i, V::mul(max, inv255));
+  }
+  return i;
+}
+
+template<typename V>
+size_t rgba_to_hsl_kernel(const Color* src, size_t n,
+                          float* hue, float* saturation, float* lightness)
+{
+  using F = typename V::F;
+  const F zero = V::set1(0.0f);
+  const F c255 = V::set1(255.0f);
+  const F inv510 = V::set1(1.0f / 510.0f);
+
+  size_t i = 0;
+  for (; i+V::N <= n; i += V::N) {
+    F r, g, b;
+    V::load_rgb(src+i, r, g, b);
+
+    const F max = V::max(r, V::max(g, b));
+    const F min = V::min(r, V::min(g, b));
+    const F chroma = V::sub(max, min);
+    const F sum = V::add(max, min);
+    const typename V::M gray = V::eq(chroma, zero);
+
+    V::store(hue+i, hue_from_rgb<V>(r, g, b, max, chroma, gray));
+    // chroma/255 / (1-|2l-1|) = chroma / (255-|max+min-255|)
+    V::store(saturation+i,
+             V::select(gray, zero,
+                       V::div(chroma,
+                              V::select(gray, c255,
+                                        V::sub(c255, V::abs(V::sub(sum, c255)))))));
+    V::store(lightness+i, V::mul(sum, inv510));
+  }
+  return i;
+}
+
+template<typename V>
+size_t hsv_to_rgba_kernel(const float* hue, const float* saturation, const float* value,
+                          size_t n, Color* dst)
+{
+  using F = typename V::F;
+  const F inv60 = V::set1(1.0f / 60.0f);
+
+  size_t i = 0;
+  for (; i+V::N <= n; i += V::N) {
+    const F huePrime = V::mul(V::load(hue+i), inv60);
+    const F v = V::load(value+i);
+    const F chroma = V::mul(v, V::load(saturation+i));
+
+    V::store_rgb(dst+i,
+                 rgb_component<V>(5.0f, huePrime, v, chroma),
+                 rgb_component<V>(3.0f, huePrime, v, chroma),
+                 rgb_component<V>(1.0f, huePrime, v, chroma));
+  }
+  return i;
+}
+
+template<typename V>
+size_t hsl_to_rgba_kernel(const float* hue, const float* saturation, const float* lightness,
+                          size_t n, Color* dst)
+{
+  using F = typename V::F;
+  const F one = V::set1(1.0f);
+  const F half = V::set1(0.5f);
+  const F inv60 = V::set1(1.0f / 60.0f);
+
+  size_t i = 0;
+  for (; i+V::N <= n; i += V::N) {
+    const F huePrime = V::mul(V::load(hue+i), inv60);
+    const F l = V::load(lightness+i);
+    const F chroma =
+      V::mul(V::sub(one, V::abs(V::sub(V::add(l, l), one))),
+             V::load(saturation+i));
+    // Value of the max component (lightness + chroma/2)
+    const F max = V::add(l, V::mul(chroma, half));
+
+    V::store_rgb(dst+i,
+                 rgb_component<V>(5.0f, huePrime, max, chroma),
+                 rgb_component<V>(3.0f, huePrime, max, chroma),
+                 rgb_component<V>(1.0f, huePrime, max, chroma));
+  }
+  return i;
+}
+
+#if LAF_HAVE_X86_DISPATCH
+
+// AVX2 instantiations of the kernels, the last pixels (less than 8)
+// are converted with SSE2. The generic kernels aren't compiled for
+// AVX2, so they (and the Avx2 functions) must be inlined in these
+// functions with the flatten attribute.
+#if defined(__GNUC__) || defined(__clang__)
+  #define FLATTEN __attribute__((flatten))
+#else
+  #define FLATTEN
+#endif
+
+LAF_TARGET("avx2") FLATTEN
+size_t rgba_to_hsv_avx2(const Color* src, size_t n,
+                        float* hue, float* saturation, float* value)
+{
+  const size_t i = rgba_to_hsv_kernel<Avx2>(src, n, hue, saturation, value);
+  return i + rgba_to_hsv_kernel<Sse2>(src+i, n-i, hue+i, saturation+i, value+i);
+}
+
+LAF_TARGET("avx2") FLATTEN
+size_t hsv_to_rgba_avx2(const float* hue, const float* saturation, const float* value,
+                        size_t n, Color* dst)
+{
+  const size_t i = hsv_to_rgba_kernel<Avx2>(hue, saturation, value, n, dst);
+  return i + hsv_to_rgba_kernel<Sse2>(hue+i, saturation+i, value+i, n-i, dst+i);
+}
+
+LAF_TARGET("avx2") FLATTEN
+size_t rgba_to_hsl_avx2(const Color* src, size_t n,
+                        float* hue, float* saturation, float* lightness)
+{
+  const size_t i = rgba_to_hsl_kernel<Avx2>(src, n, hue, saturation, lightness);
+  return i + rgba_to_hsl_kernel<Sse2>(src+i, n-i, hue+i, saturation+i, lightness+i);
+}
+
+LAF_TARGET("avx2") FLATTEN
+size_t hsl_to_rgba_avx2(const float* hue, const float* saturation, const float* lightness,
+                        size_t n, Color* dst)
+{
+  const size_t i = hsl_to_rgba_kernel<Avx2>(hue, saturation, lightness, n, dst);
+  return i + hsl_to_rgba_kernel<Sse2>(hue+i, saturation+i, lightness+i, n-i, dst+i);
+}
+
+#undef FLATTEN
+
+#endif // LAF_HAVE_X86_DISPATCH
+
+} // anonymous namespace
+
+void rgba_to_hsv(const Color* src, size_t n,
+                 float* hue, float* saturation, float* value)
+{
+  size_t i;
+#if LAF_HAVE_X86_DISPATCH
+  if (base::get_cpu_features().avx2)
+    i = rgba_to_hsv_avx2(src, n, hue, saturation, value);
+  else
+#endif
+    i = rgba_to_hsv_kernel<Simd>(src, n, hue, saturation, value);
+  rgba_to_hsv_kernel<Scalar>(src+i, n-i, hue+i, saturation+i, value+i);
+}
+
+void hsv_to_rgba(const float* hue, const float* saturation, const float* value,
+                 size_t n, Color* dst)
+{
+  size_t i;
+#if LAF_HAVE_X86_DISPATCH
+  if (base::get_cpu_features().avx2)
+    i = hsv_to_rgba_avx2(hue, saturation, value, n, dst);
+  else
+#endif
+    i = hsv_to_rgba_kernel<Simd>(hue, saturation, value, n, dst);
+  hsv_to_rgba_kernel<Scalar>(hue+i, saturation+i, value+i, n-i, dst+i);
+}
+
+void rgba_to_hsl(const Color* src, size_t n,
+                 float* hue, float* saturation, float* lightness)
+{
+  size_t i;
+#if LAF_HAVE_X86_DISPATCH
+  if (base::get_cpu_features().avx2)
+    i = rgba_to_hsl_avx2(src, n, hue, saturation, lightness);
+  else
+#endif
+    i = rgba_to_hsl_kernel<Simd>(src, n, hue, saturation, lightness);
+  rgba_to_hsl_kernel<Scalar>(src+i, n-i, hue+i, saturation+i, lightness+i);
+}
+
+void hsl_to_rgba(const float* hue, const float* saturation, const float* lightness,
+                 size_t n, Color* dst)
+{
+  size_t i;
+#if LAF_HAVE_X86_DISPATCH
+  if (base::get_cpu_features().avx2)
+    i = hsl_to_rgba_avx2(hue, saturation, lightness, n, dst);
+  else
+#endif
+    i = hsl_to_rgba_kernel<Simd>(hue, saturation, lightness, n, dst);
+  hsl_to_rgba_kernel<Scalar>(hue+i, saturation+i, lightness+i, n-i, dst+i);
+}
+
+void rgba_to_hsv(const Color* src, size_t n,
+                 float* hue, float* saturation, float* value,
+                 base::thread_pool& pool, size_t rowLength)
+{
+  for_each_chunk(n, pool, rowLength, [=](size_t i, size_t m){
+    rgba_to_hsv(src+i, m, hue+i, saturation+i, value+i);
+  });
+}
+
+void hsv_to_rgba(const float* hue, const float* saturation, const float* value,
+                 size_t n, Color* dst,
+                 base::thread_pool& pool, size_t rowLength)
+{
+  for_each_chunk(n, pool, rowLength, [=](size_t i, size_t m){
+    hsv_to_rgba(hue+i, saturation+i, value+i, m, dst+i);
+  });
+}
+
+void rgba_to_hsl(const Color* src, size_t n,
+                 float* hue, float* saturation, float* lightness,
+                 base::thread_pool& pool, size_t rowLength)
+{
+  for_each_chunk(n, pool, rowLength, [=](size_t i, size_t m){
+    rgba_to_hsl(src+i, m, hue+i, saturation+i, lightness+i);
+  });
+}
+
+void hsl_to_rgba(const float* hue, const float* saturation, const float* lightness,
+                 size_t n, Color* dst,
+                 base::thread_pool& pool, size_t rowLength)
+{
+  for_each_chunk(n, pool, rowLength, [=](size_t i, size_t m){
+    hsl_to_rgba(hue+i, saturation+i, lightness+i, m, dst+i);
+  });
+}
+
+} // namespace gfx
@@ -0,0 +1,74 @@
+// LAF Gfx Library
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef GFX_HSV_HSL_BULK_H_INCLUDED
+#define GFX_HSV_HSL_BULK_H_INCLUDED
+#pragma once
+
+#include "gfx/color.h"
+
+#include <cstddef>
+
+namespace base {
+  class thread_pool;
+}
+
+namespace gfx {
+
+  // Conversions of arrays of gfx::Color pixels to planar HSV/HSL
+  // buffers (one float array for each component) and back, to apply
+  // color adjustments to whole images. The components use the same
+  // ranges as gfx::Hsv/gfx::Hsl: hue in [0, 360) degrees, and
+  // saturation/value/lightness in [0, 1].
+  //
+  // These functions use SIMD instructions (SSE2 or NEON) when they
+  // are available, and float math instead of double, so the results
+  // can differ a little from the scalar gfx::Hsv/Hsl/Rgb conversions:
+  // the hue at most kBulkHueMaxError degrees, the other components at
+  // most kBulkMaxError, and each RGB component at most 1 (when the
+  // exact value is really near to X.5). The hue given to *_to_rgba()
+  // must be in the [0, 360] range (like gfx::Rgb(const Hsv&)).
+  // Converting any RGB color to HSV/HSL and back gives the same RGB
+  // color.
+  //
+  // The alpha channel of the "dst" pixels is not modified, so the
+  // same buffer can be used to convert pixels to HSV/HSL and back.
+
+  constexpr float kBulkHueMaxError = 0.001f;
+  constexpr float kBulkMaxError = 0.000001f;
+
+  void rgba_to_hsv(const Color* src, size_t n,
+                   float* hue, float* saturation, float* value);
+  void hsv_to_rgba(const float* hue, const float* saturation, const float* value,
+                   size_t n, Color* dst);
+
+  void rgba_to_hsl(const Color* src, size_t n,
+                   float* hue, float* saturation, float* lightness);
+  void hsl_to_rgba(const float* hue, const float* saturation, const float* lightness,
+                   size_t n, Color* dst);
+
+  // Same functions for images of "n" pixels with rows of "rowLength"
+  // pixels. The image is split in chunks of rows that are converted
+  // in the given thread pool and in the calling thread (these
+  // functions wait until all their chunks are converted, but not for
+  // other tasks of the pool).
+  void rgba_to_hsv(const Color* src, size_t n,
+                   float* hue, float* saturation, float* value,
+                   base::thread_pool& pool, size_t rowLength);
+  void hsv_to_rgba(const float* hue, const float* saturation, const float* value,
+                   size_t n, Color* dst,
+                   base::thread_pool& pool, size_t rowLength);
+
+  void rgba_to_hsl(const Color* src, size_t n,
+                   float* hue, float* saturation, float* lightness,
+                   base::thread_pool& pool, size_t rowLength);
+  void hsl_to_rgba(const float* hue, const float* saturation, const float* lightness,
+                   size_t n, Color* dst,
+                   base::thread_pool& pool, size_t rowLength);
+
+} // namespace gfx
+
+#endif
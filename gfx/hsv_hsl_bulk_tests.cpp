@@ -0,0 +1,202 @@
+// LAF Gfx Library
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "base/thread_pool.h"
+#include "gfx/hsl.h"
+#include "gfx/hsv.h"
+#include "gfx/hsv_hsl_bulk.h"
+#include "gfx/rgb.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace gfx;
+
+// All colors with components multiple of 3, the number of
+// colors is not a multiple of the SIMD width to test the scalar tail.
+static std::vector<Color> make_colors()
+{
+  std::vector<Color> colors;
+  for (int r=0; r<=255; r += 3)
+    for (int g=0; g<=255; g += 3)
+      for (int b=0; b<=255; b += 3)
+        colors.push_back(rgba(r, g, b, (r+g+b) & 0xff));
+  colors.push_back(rgba(255, 0, 1));
+  colors.push_back(rgba(1, 2, 3));
+  colors.push_back(rgba(255, 255, 254));
+  return colors;
+}
+
+static double hue_distance(double a, double b)
+{
+  const double d = std::fabs(a - b);
+  return std::min(d, 360.0 - d);
+}
+
+static void expect_rgb_near(const Rgb& expected, Color c)
+{
+  EXPECT_LE(std::abs(expected.red()   - int(getr(c))), 1);
+  EXPECT_LE(std::abs(expected.green() - int(getg(c))), 1);
+  EXPECT_LE(std::abs(expected.blue()  - int(getb(c))), 1);
+}
+
+TEST(HsvHslBulk, RgbaToHsv)
+{
+  const std::vector<Color> colors = make_colors();
+  const size_t n = colors.size();
+  std::vector<float> h(n), s(n), v(n);
+  rgba_to_hsv(colors.data(), n, h.data(), s.data(), v.data());
+
+  for (size_t i=0; i<n; ++i) {
+    const Hsv hsv(Rgb(getr(colors[i]), getg(colors[i]), getb(colors[i])));
+    ASSERT_GE(h[i], 0.0f);
+    ASSERT_LT(h[i], 360.0f);
+    ASSERT_LE(hue_distance(hsv.hue(), h[i]), kBulkHueMaxError) << i;
+    ASSERT_NEAR(hsv.saturation(), s[i], kBulkMaxError) << i;
+    ASSERT_NEAR(hsv.value(), v[i], kBulkMaxError) << i;
+  }
+}
+
+TEST(HsvHslBulk, RgbaToHsl)
+{
+  const std::vector<Color> colors = make_colors();
+  const size_t n = colors.size();
+  std::vector<float> h(n), s(n), l(n);
+  rgba_to_hsl(colors.data(), n, h.data(), s.data(), l.data());
+
+  for (size_t i=0; i<n; ++i) {
+    const Hsl hsl(Rgb(getr(colors[i]), getg(colors[i]), getb(colors[i])));
+    ASSERT_GE(h[i], 0.0f);
+    ASSERT_LT(h[i], 360.0f);
+    ASSERT_LE(hue_distance(hsl.hue(), h[i]), kBulkHueMaxError) << i;
+    ASSERT_NEAR(hsl.saturation(), s[i], kBulkMaxError) << i;
+    ASSERT_NEAR(hsl.lightness(), l[i], kBulkMaxError) << i;
+  }
+}
+
+TEST(HsvHslBulk, HsvToRgba)
+{
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<float> hueDist(0.0f, 360.0f);
+  std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+
+  const size_t n = 100003;
+  std::vector<float> h(n), s(n), v(n);
+  for (size_t i=0; i<n; ++i) {
+    h[i] = (i < 4 ? 360.0f * (i/3): hueDist(rng));
+    s[i] = (i % 7 == 0 ? 1.0f: dist(rng));
+    v[i] = (i % 5 == 0 ? 1.0f: dist(rng));
+  }
+  std::vector<Color> dst(n, rgba(0, 0, 0, 128));
+  hsv_to_rgba(h.data(), s.data(), v.data(), n, dst.data());
+
+  for (size_t i=0; i<n; ++i) {
+    expect_rgb_near(Rgb(Hsv(h[i], s[i], v[i])), dst[i]);
+    ASSERT_EQ(128, geta(dst[i]));
+  }
+}
+
+TEST(HsvHslBulk, HslToRgba)
+{
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<float> hueDist(0.0f, 360.0f);
+  std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+
+  const size_t n = 100003;
+  std::vector<float> h(n), s(n), l(n);
+  for (size_t i=0; i<n; ++i) {
+    h[i] = hueDist(rng);
+    s[i] = dist(rng);
+    l[i] = dist(rng);
+  }
+  std::vector<Color> dst(n, rgba(0, 0, 0, 64));
+  hsl_to_rgba(h.data(), s.data(), l.data(), n, dst.data());
+
+  for (size_t i=0; i<n; ++i) {
+    expect_rgb_near(Rgb(Hsl(h[i], s[i], l[i])), dst[i]);
+    ASSERT_EQ(64, geta(dst[i]));
+  }
+}
+
+TEST(HsvHslBulk, RoundTrip)
+{
+  const std::vector<Color> colors = make_colors();
+  const size_t n = colors.size();
+  std::vector<float> h(n), s(n), x(n);
+  std::vector<Color> dst = colors;
+
+  rgba_to_hsv(dst.data(), n, h.data(), s.data(), x.data());
+  hsv_to_rgba(h.data(), s.data(), x.data(), n, dst.data());
+  EXPECT_EQ(colors, dst);
+
+  rgba_to_hsl(dst.data(), n, h.data(), s.data(), x.data());
+  hsl_to_rgba(h.data(), s.data(), x.data(), n, dst.data());
+  EXPECT_EQ(colors, dst);
+}
+
+TEST(HsvHslBulk, ThreadPool)
+{
+  const std::vector<Color> colors = make_colors();
+  const size_t n = colors.size();
+  std::vector<float> h1(n), s1(n), v1(n);
+  std::vector<float> h2(n), s2(n), v2(n);
+  base::thread_pool pool(4);
+
+  rgba_to_hsv(colors.data(), n, h1.data(), s1.data(), v1.data());
+  rgba_to_hsv(colors.data(), n, h2.data(), s2.data(), v2.data(), pool, 1000);
+  EXPECT_EQ(h1, h2);
+  EXPECT_EQ(s1, s2);
+  EXPECT_EQ(v1, v2);
+
+  std::vector<Color> dst1(n, 0), dst2(n, 0);
+  hsv_to_rgba(h1.data(), s1.data(), v1.data(), n, dst1.data());
+  hsv_to_rgba(h1.data(), s1.data(), v1.data(), n, dst2.data(), pool, 1000);
+  EXPECT_EQ(dst1, dst2);
+
+  rgba_to_hsl(colors.data(), n, h1.data(), s1.data(), v1.data());
+  rgba_to_hsl(colors.data(), n, h2.data(), s2.data(), v2.data(), pool, 333);
+  EXPECT_EQ(h1, h2);
+  EXPECT_EQ(s1, s2);
+  EXPECT_EQ(v1, v2);
+
+  hsl_to_rgba(h1.data(), s1.data(), v1.data(), n, dst1.data());
+  hsl_to_rgba(h1.data(), s1.data(), v1.data(), n, dst2.data(), pool, 333);
+  EXPECT_EQ(dst1, dst2);
+}
+
+TEST(HsvHslBulk, ThreadPoolFromWorker)
+{
+  const std::vector<Color> colors = make_colors();
+  const size_t n = colors.size();
+  std::vector<float> h1(n), s1(n), v1(n);
+  std::vector<float> h2(n), s2(n), v2(n);
+  base::thread_pool pool(1);
+
+  // The only worker of the pool converts the image (it cannot wait
+  // for itself to finish)
+  rgba_to_hsv(colors.data(), n, h1.data(), s1.data(), v1.data());
+  pool.execute([&]{
+    rgba_to_hsv(colors.data(), n, h2.data(), s2.data(), v2.data(), pool, 1000);
+  });
+  pool.wait_all();
+  EXPECT_EQ(h1, h2);
+  EXPECT_EQ(s1, s2);
+  EXPECT_EQ(v1, v2);
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
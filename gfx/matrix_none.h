@@ -10,50 +10,161 @@
 
 #include "gfx/rect.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 namespace gfx {
 
+  // 3x3 matrix with the same layout and semantics as SkMatrix (used
+  // when laf is compiled without Skia, e.g. by the raster surfaces
+  // of the "none" backend).
   class Matrix {
   public:
-    Matrix() { }
+    enum { kScaleX, kSkewX, kTransX,
+           kSkewY, kScaleY, kTransY,
+           kPersp0, kPersp1, kPersp2 };
+
+    Matrix() { setIdentity(); }
+
+    static Matrix MakeScale(float sx, float sy) {
+      Matrix m;
+      m.setScale(sx, sy);
+      return m;
+    }
+
+    static Matrix MakeScale(float scale) { return MakeScale(scale, scale); }
+
+    static Matrix MakeTrans(float x, float y) {
+      Matrix m;
+      m.setTranslate(x, y);
+      return m;
+    }
 
-    static Matrix MakeScale(float sx, float sy) { return Matrix(); }
-    static Matrix MakeScale(float scale) { return Matrix(); }
-    static Matrix MakeTrans(float x, float y) { return Matrix(); }
     static Matrix MakeAll(float scaleX, float skewX,  float transX,
                           float skewY,  float scaleY, float transY,
                           float pers0, float pers1, float pers2) {
-      return Matrix();
-    }
-
-    Matrix& reset() { return *this; }
-    bool isIdentity() const { return true; }
-    bool isScaleTranslate() const { return false; }
-    bool isTranslate() const { return false; }
-
-    float getScaleX() const { return 1.0f; }
-    float getScaleY() const { return 1.0f; }
-    float getSkewY() const { return 0.0f; }
-    float getSkewX() const { return 0.0f; }
-    float getTranslateX() const { return 0.0f; }
-    float getTranslateY() const { return 0.0f; }
-    float getPerspX() const { return 0.0f; }
-    float getPerspY() const { return 0.0f; }
-
-    Matrix& setIdentity() { return *this; }
-    Matrix& setTranslate(float dx, float dy) { return *this; }
-    void setScale(float sx, float sy, float px, float py) { }
-    void setScale(float sx, float sy) { }
-    void setRotate(float degrees, float px, float py) { }
-    void setRotate(float degrees) { }
-    void setScaleTranslate(float sx, float sy, float tx, float ty) { }
-    Matrix& preTranslate(float dx, float dy) { return *this; }
-    Matrix& postTranslate(float dx, float dy) { return *this; }
-
-    Matrix& setConcat(const Matrix& a, const Matrix& b) { return *this; }
-    Matrix& preConcat(const Matrix& other) { return *this; }
-    Matrix& postConcat(const Matrix& other) { return *this; }
-
-    RectF mapRect(const RectF& src) const { return RectF(); }
+      Matrix m;
+      m.m_v[kScaleX] = scaleX; m.m_v[kSkewX] = skewX;   m.m_v[kTransX] = transX;
+      m.m_v[kSkewY] = skewY;   m.m_v[kScaleY] = scaleY; m.m_v[kTransY] = transY;
+      m.m_v[kPersp0] = pers0;  m.m_v[kPersp1] = pers1;  m.m_v[kPersp2] = pers2;
+      return m;
+    }
+
+    Matrix& reset() { return setIdentity(); }
+
+    bool isIdentity() const {
+      return isTranslate() && m_v[kTransX] == 0.0f && m_v[kTransY] == 0.0f;
+    }
+    bool isScaleTranslate() const {
+      return (m_v[kSkewX] == 0.0f && m_v[kSkewY] == 0.0f &&
+              m_v[kPersp0] == 0.0f && m_v[kPersp1] == 0.0f &&
+              m_v[kPersp2] == 1.0f);
+    }
+    bool isTranslate() const {
+      return (isScaleTranslate() &&
+              m_v[kScaleX] == 1.0f && m_v[kScaleY] == 1.0f);
+    }
+
+    float getScaleX() const { return m_v[kScaleX]; }
+    float getScaleY() const { return m_v[kScaleY]; }
+    float getSkewY() const { return m_v[kSkewY]; }
+    float getSkewX() const { return m_v[kSkewX]; }
+    float getTranslateX() const { return m_v[kTransX]; }
+    float getTranslateY() const { return m_v[kTransY]; }
+    float getPerspX() const { return m_v[kPersp0]; }
+    float getPerspY() const { return m_v[kPersp1]; }
+
+    Matrix& setIdentity() {
+      std::fill(m_v, m_v+9, 0.0f);
+      m_v[kScaleX] = m_v[kScaleY] = m_v[kPersp2] = 1.0f;
+      return *this;
+    }
+
+    Matrix& setTranslate(float dx, float dy) {
+      setIdentity();
+      m_v[kTransX] = dx;
+      m_v[kTransY] = dy;
+      return *this;
+    }
+
+    void setScale(float sx, float sy, float px, float py) {
+      setScaleTranslate(sx, sy, px - sx*px, py - sy*py);
+    }
+
+    void setScale(float sx, float sy) {
+      setScaleTranslate(sx, sy, 0.0f, 0.0f);
+    }
+
+    void setRotate(float degrees, float px, float py) {
+      const double rad = degrees * 3.14159265358979323846 / 180.0;
+      const float s = float(std::sin(rad));
+      const float c = float(std::cos(rad));
+      setIdentity();
+      m_v[kScaleX] = c;  m_v[kSkewX] = -s; m_v[kTransX] = s*py + (1.0f-c)*px;
+      m_v[kSkewY] = s;   m_v[kScaleY] = c; m_v[kTransY] = -s*px + (1.0f-c)*py;
+    }
+
+    void setRotate(float degrees) { setRotate(degrees, 0.0f, 0.0f); }
+
+    void setScaleTranslate(float sx, float sy, float tx, float ty) {
+      setIdentity();
+      m_v[kScaleX] = sx;
+      m_v[kScaleY] = sy;
+      m_v[kTransX] = tx;
+      m_v[kTransY] = ty;
+    }
+
+    Matrix& preTranslate(float dx, float dy) {
+      return preConcat(MakeTrans(dx, dy));
+    }
+
+    Matrix& postTranslate(float dx, float dy) {
+      return postConcat(MakeTrans(dx, dy));
+    }
+
+    // this = a * b
+    Matrix& setConcat(const Matrix& a, const Matrix& b) {
+      float r[9];
+      for (int i=0; i<3; ++i)
+        for (int j=0; j<3; ++j)
+          r[i*3+j] = (a.m_v[i*3+0] * b.m_v[0*3+j] +
+                      a.m_v[i*3+1] * b.m_v[1*3+j] +
+                      a.m_v[i*3+2] * b.m_v[2*3+j]);
+      std::copy(r, r+9, m_v);
+      return *this;
+    }
+
+    Matrix& preConcat(const Matrix& other) {
+      return setConcat(Matrix(*this), other);
+    }
+
+    Matrix& postConcat(const Matrix& other) {
+      return setConcat(other, Matrix(*this));
+    }
+
+    RectF mapRect(const RectF& src) const {
+      float x1 = std::numeric_limits<float>::max(), y1 = x1;
+      float x2 = -x1, y2 = -x1;
+      const float xs[2] = { float(src.x), float(src.x+src.w) };
+      const float ys[2] = { float(src.y), float(src.y+src.h) };
+      for (float x : xs)
+        for (float y : ys) {
+          float u = m_v[kScaleX]*x + m_v[kSkewX]*y + m_v[kTransX];
+          float v = m_v[kSkewY]*x + m_v[kScaleY]*y + m_v[kTransY];
+          const float w = m_v[kPersp0]*x + m_v[kPersp1]*y + m_v[kPersp2];
+          if (w != 0.0f && w != 1.0f) {
+            u /= w;
+            v /= w;
+          }
+          x1 = std::min(x1, u); y1 = std::min(y1, v);
+          x2 = std::max(x2, u); y2 = std::max(y2, v);
+        }
+      return RectF(x1, y1, x2-x1, y2-y1);
+    }
+
+  private:
+    float m_v[9];
   };
 
 } // namespace gfx
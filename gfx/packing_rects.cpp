@@ -1,5 +1,5 @@
 // LAF Gfx Library
-// Copyright (C) 2019-2023  Igara Studio S.A.
+// Copyright (C) 2019-2024  Igara Studio S.A.
 // Copyright (C) 2001-2014 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -11,22 +11,357 @@
 
 #include "gfx/packing_rects.h"
 
+#include "base/thread_pool.h"
+#include "gfx/point.h"
 #include "gfx/region.h"
 #include "gfx/size.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
 namespace gfx {
 
-void PackingRects::add(const Size& sz)
+namespace {
+
+// Skyline bottom-left packer. The skyline is a list of horizontal
+// segments (sorted by x) that cover the whole width of the bin.
+class SkylinePacker {
+public:
+  SkylinePacker(int w, int h) : m_w(w), m_h(h) {
+    m_nodes.push_back(Node{ 0, 0, w });
+  }
+
+  // Position to place a rectangle, the best one has the lowest
+  // bottom side (and then the narrowest node).
+  struct Candidate {
+    int index;
+    Point pt;
+    int y2;
+    int width;
+  };
+
+  static bool better(const Candidate& a, const Candidate& b) {
+    return (a.y2 < b.y2 || (a.y2 == b.y2 && a.width < b.width));
+  }
+
+  bool find(int w, int h, Candidate& best) const {
+    bool found = false;
+    for (int i=0; i<int(m_nodes.size()); ++i) {
+      int y;
+      if (!fits(i, w, h, y))
+        continue;
+
+      const Candidate c = { i, Point(m_nodes[i].x, y), y+h, m_nodes[i].w };
+      if (!found || better(c, best)) {
+        best = c;
+        found = true;
+      }
+    }
+    return found;
+  }
+
+  Point place(const Candidate& c, int w, int h) {
+    addLevel(c.index, c.pt.x, c.pt.y + h, w);
+    return c.pt;
+  }
+
+private:
+  struct Node {
+    int x, y, w;
+  };
+
+  // Returns true if a rectangle of the given size fits with its
+  // left side at the start of the i-th node, "y" will be the lowest
+  // y-coordinate where it can be placed.
+  bool fits(int i, int w, int h, int& y) const {
+    if (m_nodes[i].x + w > m_w)
+      return false;
+
+    y = 0;
+    for (int left=w; left > 0 && i < int(m_nodes.size()); ++i) {
+      y = std::max(y, m_nodes[i].y);
+      if (y + h > m_h)
+        return false;
+      left -= m_nodes[i].w;
+    }
+    return true;
+  }
+
+  void addLevel(int i, int x, int y, int w) {
+    m_nodes.insert(m_nodes.begin()+i, Node{ x, y, w });
+
+    // Shrink/remove the nodes below the new one
+    const int x2 = x + w;
+    for (int j=i+1; j<int(m_nodes.size()); ) {
+      Node& node = m_nodes[j];
+      if (node.x >= x2)
+        break;
+
+      const int shrink = x2 - node.x;
+      if (shrink < node.w) {
+        node.x += shrink;
+        node.w -= shrink;
+        break;
+      }
+      m_nodes.erase(m_nodes.begin()+j);
+    }
+
+    // Merge contiguous nodes at the same level
+    for (int j=0; j+1<int(m_nodes.size()); ) {
+      if (m_nodes[j].y == m_nodes[j+1].y) {
+        m_nodes[j].w += m_nodes[j+1].w;
+        m_nodes.erase(m_nodes.begin()+j+1);
+      }
+      else
+        ++j;
+    }
+  }
+
+  int m_w, m_h;
+  std::vector<Node> m_nodes;
+};
+
+// MaxRects packer, the list of free rectangles contains all the
+// maximal rectangles of the free area (they can overlap).
+class MaxRectsPacker {
+public:
+  MaxRectsPacker(int w, int h, bool bestAreaFit)
+    : m_bestAreaFit(bestAreaFit) {
+    if (w > 0 && h > 0)
+      m_free.push_back(Rect(0, 0, w, h));
+  }
+
+  // The best free rectangle has the smallest leftover side or area.
+  struct Candidate {
+    int index;
+    int score1;
+    int score2;
+  };
+
+  static bool better(const Candidate& a, const Candidate& b) {
+    return (a.score1 < b.score1 ||
+            (a.score1 == b.score1 && a.score2 < b.score2));
+  }
+
+  bool find(int w, int h, Candidate& best) const {
+    bool found = false;
+    for (int i=0; i<int(m_free.size()); ++i) {
+      const Rect& fr = m_free[i];
+      if (fr.w < w || fr.h < h)
+        continue;
+
+      const int leftW = fr.w - w;
+      const int leftH = fr.h - h;
+      Candidate c;
+      c.index = i;
+      if (m_bestAreaFit) {
+        c.score1 = fr.w*fr.h - w*h;
+        c.score2 = std::min(leftW, leftH);
+      }
+      else {
+        c.score1 = std::min(leftW, leftH);
+        c.score2 = std::max(leftW, leftH);
+      }
+      if (!found || better(c, best)) {
+        best = c;
+        found = true;
+      }
+    }
+    return found;
+  }
+
+  Point place(const Candidate& c, int w, int h) {
+    const Point pt = m_free[c.index].origin();
+    split(Rect(pt.x, pt.y, w, h));
+    return pt;
+  }
+
+private:
+  void split(const Rect& used) {
+    // Split all free rectangles that intersect the used one in the
+    // maximal rectangles around it.
+    m_new.clear();
+    for (int i=0; i<int(m_free.size()); ) {
+      const Rect fr = m_free[i];
+      if (!fr.intersects(used)) {
+        ++i;
+        continue;
+      }
+      m_free[i] = m_free.back();
+      m_free.pop_back();
+
+      if (used.x > fr.x)
+        m_new.push_back(Rect(fr.x, fr.y, used.x - fr.x, fr.h));
+      if (used.x2() < fr.x2())
+        m_new.push_back(Rect(used.x2(), fr.y, fr.x2() - used.x2(), fr.h));
+      if (used.y > fr.y)
+        m_new.push_back(Rect(fr.x, fr.y, fr.w, used.y - fr.y));
+      if (used.y2() < fr.y2())
+        m_new.push_back(Rect(fr.x, used.y2(), fr.w, fr.y2() - used.y2()));
+    }
+
+    // Remove new rectangles that are contained in other ones (old
+    // free rectangles cannot be contained in new ones, because new
+    // ones are parts of previous free rectangles).
+    for (int i=0; i<int(m_new.size()); ++i) {
+      const Rect& rc = m_new[i];
+      bool contained = false;
+      for (const Rect& fr : m_free) {
+        if (fr.contains(rc)) {
+          contained = true;
+          break;
+        }
+      }
+      for (int j=0; !contained && j<int(m_new.size()); ++j) {
+        // With equal rectangles, keep the last one
+        if (i != j && m_new[j].contains(rc) && (rc != m_new[j] || i < j))
+          contained = true;
+      }
+      if (!contained)
+        m_free.push_back(rc);
+    }
+  }
+
+  bool m_bestAreaFit;
+  std::vector<Rect> m_free;
+  std::vector<Rect> m_new;
+};
+
+// Guillotine packer with best area fit and the shorter leftover
+// axis split rule. Free rectangles are disjoint.
+class GuillotinePacker {
+public:
+  GuillotinePacker(int w, int h) {
+    if (w > 0 && h > 0)
+      m_free.push_back(Rect(0, 0, w, h));
+  }
+
+  // The best free rectangle has the smallest leftover area.
+  struct Candidate {
+    int index;
+    int area;
+    int side;
+  };
+
+  static bool better(const Candidate& a, const Candidate& b) {
+    return (a.area < b.area || (a.area == b.area && a.side < b.side));
+  }
+
+  bool find(int w, int h, Candidate& best) const {
+    bool found = false;
+    for (int i=0; i<int(m_free.size()); ++i) {
+      const Rect& fr = m_free[i];
+      if (fr.w < w || fr.h < h)
+        continue;
+
+      const Candidate c = { i,
+                            fr.w*fr.h - w*h,
+                            std::min(fr.w - w, fr.h - h) };
+      if (!found || better(c, best)) {
+        best = c;
+        found = true;
+      }
+    }
+    return found;
+  }
+
+  Point place(const Candidate& c, int w, int h) {
+    const Rect fr = m_free[c.index];
+    m_free.erase(m_free.begin()+c.index);
+
+    // Split the leftover L-shaped area in two rectangles
+    Rect bottom(fr.x, fr.y+h, 0, fr.h-h);
+    Rect right(fr.x+w, fr.y, fr.w-w, 0);
+    if (fr.w - w <= fr.h - h) {
+      // Horizontal split
+      bottom.w = fr.w;
+      right.h = h;
+    }
+    else {
+      // Vertical split
+      bottom.w = w;
+      right.h = fr.h;
+    }
+    addFree(bottom);
+    addFree(right);
+    return fr.origin();
+  }
+
+private:
+  // Adds a free rectangle merging it with other free rectangles that
+  // share a whole edge.
+  void addFree(Rect rc) {
+    if (rc.isEmpty())
+      return;
+
+    for (int i=0; i<int(m_free.size()); ++i) {
+      const Rect& fr = m_free[i];
+      if ((fr.x == rc.x && fr.w == rc.w && (fr.y2() == rc.y || rc.y2() == fr.y)) ||
+          (fr.y == rc.y && fr.h == rc.h && (fr.x2() == rc.x || rc.x2() == fr.x))) {
+        rc |= fr;
+        m_free.erase(m_free.begin()+i);
+        i = -1;               // Try to merge again with the bigger rectangle
+      }
+    }
+    m_free.push_back(rc);
+  }
+
+  std::vector<Rect> m_free;
+};
+
+// Places a rectangle of the given size in the best position (in any
+// orientation if "canRotate" is true). Returns false if there is no
+// room for it.
+template<typename Packer>
+bool insert(Packer& packer, int w, int h, const bool canRotate,
+            Point& pt, bool& rotated)
+{
+  typename Packer::Candidate a, b;
+  const bool fitA = packer.find(w, h, a);
+  const bool fitB = (canRotate && w != h && packer.find(h, w, b));
+  if (!fitA && !fitB)
+    return false;
+
+  rotated = (fitB && (!fitA || Packer::better(b, a)));
+  if (rotated)
+    std::swap(w, h);
+  pt = packer.place(rotated ? b: a, w, h);
+  return true;
+}
+
+} // anonymous namespace
+
+void PackingRects::add(const Size& sz, bool canRotate)
 {
-  m_rects.push_back(Rect(sz));
+  add(Rect(sz), canRotate);
 }
 
-void PackingRects::add(const Rect& rc)
+void PackingRects::add(const Rect& rc, bool canRotate)
 {
   m_rects.push_back(rc);
+  m_canRotate.push_back(canRotate);
+  m_rotated.push_back(false);
+}
+
+Size PackingRects::bestFit(base::task_token& token,
+                           const int fixedWidth,
+                           const int fixedHeight)
+{
+  // Shared by all calls, so threads are not created/joined on each
+  // call
+  static base::thread_pool pool(
+    std::clamp<int>(std::thread::hardware_concurrency(), 1, 4));
+  return bestFit(token, pool, fixedWidth, fixedHeight);
 }
 
 Size PackingRects::bestFit(base::task_token& token,
+                           base::thread_pool& pool,
                            const int fixedWidth,
                            const int fixedHeight)
 {
@@ -38,48 +373,199 @@ Size PackingRects::bestFit(base::task_token& token,
 
   // Calculate the amount of pixels that we need, the texture cannot
   // be smaller than that.
-  int neededArea = 0;
-  for (const auto& rc : m_rects) {
-    neededArea += rc.w * rc.h;
-    size |= rc.size();
+  int64_t neededArea = 0;
+  for (int i=0; i<int(m_rects.size()); ++i) {
+    const Rect& rc = m_rects[i];
+    neededArea += int64_t(rc.w) * rc.h;
+    // Original orientation (before the last pack())
+    size |= (m_rotated[i] ? Size(rc.h, rc.w): rc.size());
   }
 
   const int w0 = std::max(size.w, 1);
   const int h0 = std::max(size.h, 1);
-  int w = w0;
-  int h = h0;
-  int z = 0;
-  bool fit = false;
-  while (!token.canceled()) {
-    if (w*h >= neededArea) {
-      const Size sizeCandidate = Size(w + 2 * m_borderPadding,
-                                      h + 2 * m_borderPadding);
-      fit = pack(sizeCandidate, token);
-      if (fit) {
-        size = sizeCandidate;
-        break;
+
+  // Candidate sizes (without border padding) are multiples of w0/h0
+  // growing the width and the height alternately (or only the free
+  // side when one of them is fixed). The z-th candidate is bigger
+  // than all the previous ones, so we can search the first one that
+  // fits instead of trying them one by one.
+  auto candidate = [=](const int z) -> Size {
+    if (fixedWidth == 0 && fixedHeight == 0)
+      return Size(w0 * (1 + (z+1)/2), h0 * (1 + z/2));
+    else if (fixedWidth == 0)
+      return Size(w0 * (1 + z), h0);
+    else
+      return Size(w0, h0 * (1 + z));
+  };
+
+  // Candidates with less area than the rectangles cannot fit
+  int lo = 0;
+  while (int64_t(candidate(lo).w) * candidate(lo).h < neededArea)
+    ++lo;
+
+  // Each round tests kProbes candidates concurrently (using copies
+  // of the rectangles). The probed candidates don't depend on the
+  // number of threads, so the result is deterministic.
+  const int kProbes = 4;
+  struct Probe {
+    int z = -1;
+    bool fit = false;
+    PackingRects pr;
+  };
+
+  // Probes have the settings of this packer, and only the rectangles
+  // are copied in each round.
+  PackingRects settings(m_borderPadding, m_shapePadding, m_algorithm);
+  settings.m_canRotate = m_canRotate;
+  std::vector<Probe> probes(kProbes, Probe{ -1, false, settings });
+  Probe best{ -1, false, settings };
+
+  // The total number of probes is unknown until the search ends, so
+  // the progress is the number of packed probes over the packed ones
+  // plus one more round.
+  std::atomic<int> probesDone(0);
+  auto reportProgress = [&token, &probesDone]{
+    const int n = probesDone;
+    token.set_progress(float(n) / (n + kProbes));
+  };
+
+  // Packs the probes with z >= 0, returns the index of the first
+  // probe that fits (or -1 if none fits).
+  auto evaluate = [&]() -> int {
+    // State of one round shared with the pool tasks. A task can start
+    // after the round ends (e.g. if the pool was busy), in that case
+    // it doesn't find a probe to pack and does nothing.
+    struct Round {
+      std::vector<int> indexes;   // Probes to pack
+      std::atomic<int> next { 0 };
+      // Each probe has its own token because a task_token cannot be
+      // used from several threads at the same time. Only the caller
+      // thread reports progress in "token".
+      base::task_token tokens[kProbes];
+      std::mutex mutex;
+      std::condition_variable cv;
+      int pending = 0;
+    };
+    auto round = std::make_shared<Round>();
+    for (int i=0; i<kProbes; ++i) {
+      probes[i].fit = false;
+      if (probes[i].z >= 0)
+        round->indexes.push_back(i);
+    }
+    round->pending = int(round->indexes.size());
+
+    // Packs the next probe of the round, returns false if all probes
+    // were already taken.
+    auto packNext = [&, round]() -> bool {
+      const int c = round->next++;
+      if (c >= int(round->indexes.size()))
+        return false;
+
+      const int i = round->indexes[c];
+      Probe& probe = probes[i];
+      probe.pr.m_rects = m_rects;
+      probe.pr.m_rotated = m_rotated;
+
+      const Size sz = candidate(probe.z);
+      probe.fit = probe.pr.pack(Size(sz.w + 2*m_borderPadding,
+                                     sz.h + 2*m_borderPadding),
+                                round->tokens[i]);
+
+      // The first fitting probe wins, so we can stop the next ones
+      if (probe.fit) {
+        for (int j=i+1; j<kProbes; ++j)
+          round->tokens[j].cancel();
+      }
+      ++probesDone;
+
+      const std::lock_guard lock(round->mutex);
+      --round->pending;
+      round->cv.notify_all();
+      return true;
+    };
+
+    for (size_t c=0; c<round->indexes.size(); ++c)
+      pool.execute([packNext]{ packNext(); });
+
+    // Waits the probes forwarding the cancellation and reporting the
+    // progress. If the pool doesn't take the probes (e.g. its threads
+    // are busy or this is one of its workers), we pack them here.
+    std::unique_lock lock(round->mutex);
+    while (!round->cv.wait_for(lock, std::chrono::milliseconds(10),
+                               [&round]{ return round->pending == 0; })) {
+      if (token.canceled()) {
+        for (auto& t : round->tokens)
+          t.cancel();
       }
+      reportProgress();
+
+      lock.unlock();
+      packNext();
+      lock.lock();
     }
+    reportProgress();
 
-    if (fixedWidth == 0 && fixedHeight == 0) {
-      if ((++z) & 1)
-        w += w0;
-      else
-        h += h0;
+    for (int i=0; i<kProbes; ++i) {
+      if (probes[i].z >= 0 && probes[i].fit)
+        return i;
     }
-    else if (fixedWidth == 0) {
-      w += w0;
+    return -1;
+  };
+
+  // Keeps the i-th probe as the best one (its rectangles are swapped
+  // so both probes keep the settings)
+  auto keepBest = [&probes, &best](const int i) {
+    best.z = probes[i].z;
+    best.fit = probes[i].fit;
+    std::swap(best.pr, probes[i].pr);
+  };
+
+  // Find the first candidate that fits growing the step
+  // exponentially.
+  int step = 1;
+  while (!token.canceled()) {
+    for (int i=0; i<kProbes; ++i)
+      probes[i].z = lo + i*step;
+
+    const int i = evaluate();
+    if (i >= 0) {
+      if (i > 0)
+        lo = probes[i-1].z + 1;
+      keepBest(i);
+      break;
     }
-    else {
-      h += h0;
+    lo = probes[kProbes-1].z + 1;
+    step *= 2;
+  }
+
+  // Fitting is not monotonic in the candidate size for all
+  // algorithms (e.g. Region), so we cannot bisect the [lo, best.z)
+  // interval. Its candidates are tested in order (kProbes at a
+  // time) to find the first one that fits, as a sequential scan
+  // would do.
+  while (!token.canceled() && lo < best.z) {
+    for (int i=0; i<kProbes; ++i)
+      probes[i].z = (lo + i < best.z ? lo + i: -1);
+
+    const int i = evaluate();
+    if (i >= 0) {
+      keepBest(i);
+      break;
     }
+    lo += kProbes;
   }
 
-  return size;
-}
+  if (token.canceled() || best.z < 0)
+    return size;
+
+  m_rects = std::move(best.pr.m_rects);
+  m_rotated = std::move(best.pr.m_rotated);
+  m_bounds = best.pr.m_bounds;
+  token.set_progress(1.0f);
 
-static bool by_area(const Rect* a, const Rect* b) {
-  return a->w*a->h > b->w*b->h;
+  size = candidate(best.z);
+  return Size(size.w + 2*m_borderPadding,
+              size.h + 2*m_borderPadding);
 }
 
 bool PackingRects::pack(const Size& size,
@@ -87,60 +573,180 @@ bool PackingRects::pack(const Size& size,
 {
   m_bounds = Rect(size).shrink(m_borderPadding);
 
-  // We cannot sort m_rects because we want to
-  std::vector<Rect*> rectPtrs(m_rects.size());
+  // Restore the original orientation of rectangles rotated in a
+  // previous pack()
+  for (int i=0; i<int(m_rects.size()); ++i) {
+    if (m_rotated[i]) {
+      std::swap(m_rects[i].w, m_rects[i].h);
+      m_rotated[i] = false;
+    }
+  }
+
+  // We cannot sort m_rects because we want to keep the original
+  // order, so we sort indexes (bigger rectangles first).
+  std::vector<int> indexes(m_rects.size());
+  for (int i=0; i<int(indexes.size()); ++i)
+    indexes[i] = i;
+
+  // When rectangles can be rotated, Skyline/MaxRects give better
+  // results placing the longest rectangles first (each one in its
+  // best orientation).
+  const bool longerSideFirst =
+    (m_algorithm != Algorithm::Region &&
+     m_algorithm != Algorithm::Guillotine &&
+     std::find(m_canRotate.begin(), m_canRotate.end(), true) != m_canRotate.end());
+
+  std::sort(indexes.begin(), indexes.end(),
+            [this, longerSideFirst](int a, int b){
+              const Rect& ra = m_rects[a];
+              const Rect& rb = m_rects[b];
+              if (longerSideFirst) {
+                const int sa = std::max(ra.w, ra.h);
+                const int sb = std::max(rb.w, rb.h);
+                if (sa != sb)
+                  return sa > sb;
+              }
+              return ra.w*ra.h > rb.w*rb.h;
+            });
+
+  // The bin used by packers is <shapePadding> pixels bigger than
+  // m_bounds because each rectangle is placed with its extra
+  // <shapePadding> border (at the right/bottom sides), which can be
+  // outside the bounds for rectangles touching the right/bottom
+  // edges.
+  const int w = m_bounds.w + m_shapePadding;
+  const int h = m_bounds.h + m_shapePadding;
+
+  switch (m_algorithm) {
+    case Algorithm::SkylineBottomLeft: {
+      SkylinePacker packer(w, h);
+      return packWith(packer, indexes, token);
+    }
+    case Algorithm::MaxRectsBestShortSideFit:
+    case Algorithm::MaxRectsBestAreaFit: {
+      MaxRectsPacker packer(w, h, m_algorithm == Algorithm::MaxRectsBestAreaFit);
+      return packWith(packer, indexes, token);
+    }
+    case Algorithm::Guillotine: {
+      GuillotinePacker packer(w, h);
+      return packWith(packer, indexes, token);
+    }
+    case Algorithm::Region:
+    default:
+      return packWithRegion(indexes, token);
+  }
+}
+
+template<typename Packer>
+bool PackingRects::packWith(Packer& packer,
+                            const std::vector<int>& indexes,
+                            base::task_token& token)
+{
   int i = 0;
-  for (auto& rc : m_rects)
-    rectPtrs[i++] = &rc;
-  std::sort(rectPtrs.begin(), rectPtrs.end(), by_area);
+  for (const int j : indexes) {
+    if (token.canceled())
+      return false;
+    token.set_progress(float(i) / int(indexes.size()));
+
+    gfx::Rect& rc = m_rects[j];
+    if (rc.isEmpty()) {
+      rc.setOrigin(m_bounds.origin());
+    }
+    else {
+      Point pt;
+      bool rotated = false;
+      if (!insert(packer,
+                  rc.w + m_shapePadding,
+                  rc.h + m_shapePadding,
+                  m_canRotate[j], pt, rotated))
+        return false; // There is not enough room for "rc"
+
+      if (rotated) {
+        std::swap(rc.w, rc.h);
+        m_rotated[j] = true;
+      }
+      rc.setOrigin(Point(m_bounds.x + pt.x, m_bounds.y + pt.y));
+    }
+    ++i;
+  }
+  return true;
+}
 
+bool PackingRects::packWithRegion(const std::vector<int>& indexes,
+                                  base::task_token& token)
+{
   gfx::Region rgn(m_bounds);
-  i = 0;
-  for (auto* rcPtr : rectPtrs) {
+  int i = 0;
+  for (const int j : indexes) {
     if (token.canceled())
       return false;
-    token.set_progress(float(i) / int(rectPtrs.size()));
-
-    gfx::Rect& rc = *rcPtr;
-
-    // The rectangles are treated as its original size +
-    // conditional extra border of <shapePadding> during placement.
-    for (int v = 0; v <= m_bounds.h - rc.h; ++v) {
-      const int hShapePadding =
-        (v == (m_bounds.h - rc.h) ? 0 : m_shapePadding);
-      for (int u = 0; u <= m_bounds.w - rc.w; ++u) {
-        if (token.canceled())
-          return false;
-
-        // It's necessary to consider the <shapePadding> as an
-        // integral part of the image size; otherwise, the region
-        // subtraction process may be incorrect, resulting in
-        // overlapping of shape padding between adjacent sprites.
-        // This fix resolves the special cases of exporting with
-        // sheet type 'Packed' + 'Trim Cels' true +
-        // 'Shape padding' > 0 + series of particular image sizes.
-        const int wShapePadding =
-          (u == (m_bounds.w - rc.w) ? 0 : m_shapePadding);
-        const gfx::Rect possible(
-          m_bounds.x + u,
-          m_bounds.y + v,
-          rc.w + wShapePadding,
-          rc.h + hShapePadding);
-
-        const Region::Overlap overlap = rgn.contains(possible);
-        if (overlap == Region::In) {
-          rc = Rect(m_bounds.x + u, m_bounds.y + v, rc.w, rc.h);
-          rgn.createSubtraction(rgn, gfx::Region(Rect(possible)));
-          goto next_rc;
-        }
-      }
+    token.set_progress(float(i) / int(indexes.size()));
+
+    gfx::Rect& rc = m_rects[j];
+    Rect possible, rotatedPossible;
+    const bool fit =
+      findWithRegion(rgn, rc.size(), token, possible);
+    const bool rotatedFit =
+      (m_canRotate[j] && rc.w != rc.h &&
+       findWithRegion(rgn, Size(rc.h, rc.w), token, rotatedPossible));
+    if (!fit && !rotatedFit)
+      return false; // There is not enough room for "rc"
+
+    // Use the rotated rectangle if it can be placed in a previous
+    // position (scanning from top to bottom, left to right)
+    if (rotatedFit &&
+        (!fit ||
+         rotatedPossible.y < possible.y ||
+         (rotatedPossible.y == possible.y && rotatedPossible.x < possible.x))) {
+      possible = rotatedPossible;
+      std::swap(rc.w, rc.h);
+      m_rotated[j] = true;
     }
-    return false; // There is not enough room for "rc"
-  next_rc:;
+
+    rc.setOrigin(possible.origin());
+    rgn.createSubtraction(rgn, gfx::Region(possible));
     ++i;
   }
 
   return true;
 }
 
+// Finds the first position (from top to bottom, left to right) where
+// a rectangle of the given size can be placed. "possible" is the
+// rectangle with its shape padding.
+bool PackingRects::findWithRegion(const Region& rgn, const Size& sz,
+                                  base::task_token& token,
+                                  Rect& possible) const
+{
+  // The rectangles are treated as its original size +
+  // conditional extra border of <shapePadding> during placement.
+  for (int v = 0; v <= m_bounds.h - sz.h; ++v) {
+    const int hShapePadding =
+      (v == (m_bounds.h - sz.h) ? 0 : m_shapePadding);
+    for (int u = 0; u <= m_bounds.w - sz.w; ++u) {
+      if (token.canceled())
+        return false;
+
+      // It's necessary to consider the <shapePadding> as an
+      // integral part of the image size; otherwise, the region
+      // subtraction process may be incorrect, resulting in
+      // overlapping of shape padding between adjacent sprites.
+      // This fix resolves the special cases of exporting with
+      // sheet type 'Packed' + 'Trim Cels' true +
+      // 'Shape padding' > 0 + series of particular image sizes.
+      const int wShapePadding =
+        (u == (m_bounds.w - sz.w) ? 0 : m_shapePadding);
+      possible = gfx::Rect(
+        m_bounds.x + u,
+        m_bounds.y + v,
+        sz.w + wShapePadding,
+        sz.h + hShapePadding);
+
+      if (rgn.contains(possible) == Region::In)
+        return true;
+    }
+  }
+  return false;
+}
+
 } // namespace gfx
@@ -1,5 +1,5 @@
 // LAF Gfx Library
-// Copyright (C) 2019  Igara Studio S.A.
+// Copyright (C) 2019-2024  Igara Studio S.A.
 // Copyright (C) 2001-2015  David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -16,14 +16,38 @@
 
 namespace gfx {
 
-  // TODO add support for rotations
   class PackingRects {
   public:
-    PackingRects(int borderPadding = 0, int shapePadding = 0) :
+    // Algorithm used in pack() to place the rectangles (bigger
+    // rectangles are placed first in all cases).
+    enum class Algorithm {
+      // Tries every pixel position with a gfx::Region, O(W*H*N)
+      // region queries (it's slow, but it's the original algorithm
+      // and gives the same results as previous versions).
+      Region,
+      // Keeps the top edge ("skyline") of the packed rectangles and
+      // places each rectangle in the lowest position.
+      SkylineBottomLeft,
+      // Keeps a list of maximal free rectangles and chooses the one
+      // with the smallest leftover side (BSSF) or the smallest
+      // leftover area (BAF).
+      MaxRectsBestShortSideFit,
+      MaxRectsBestAreaFit,
+      // Keeps a list of disjoint free rectangles (best area fit),
+      // splitting the used one by its shorter leftover axis.
+      Guillotine,
+    };
+
+    PackingRects(int borderPadding = 0, int shapePadding = 0,
+                 Algorithm algorithm = Algorithm::Region) :
       m_borderPadding(borderPadding),
-      m_shapePadding(shapePadding) {
+      m_shapePadding(shapePadding),
+      m_algorithm(algorithm) {
     }
 
+    Algorithm algorithm() const { return m_algorithm; }
+    void setAlgorithm(Algorithm algorithm) { m_algorithm = algorithm; }
+
     typedef std::vector<Rect> Rects;
     typedef Rects::const_iterator const_iterator;
 
@@ -35,12 +59,32 @@ namespace gfx {
     std::size_t size() const { return m_rects.size(); }
     const Rect& operator[](int i) const { return m_rects[i]; }
 
-    // Adds a new rectangle.
-    void add(const Size& sz);
-    void add(const Rect& rc);
+    // Adds a new rectangle. If "canRotate" is true, the packer can
+    // rotate it 90 degrees to use less space (see isRotated()).
+    void add(const Size& sz, bool canRotate = false);
+    void add(const Rect& rc, bool canRotate = false);
 
-    // Returns the best size for the texture.
+    // Returns true if the i-th rectangle was rotated 90 degrees in
+    // the last pack() (its width/height are swapped in that case,
+    // i.e. operator[] returns the rotated rectangle in the texture).
+    bool isRotated(int i) const { return m_rotated[i]; }
+
+    // Returns the best size for the texture. Candidate sizes are
+    // packed concurrently in the given thread pool (or in a pool
+    // shared by all calls). It can be called from a worker of the
+    // same pool.
+    //
+    // Candidates are probed with exponential steps and then all
+    // candidates between the last probe that doesn't fit and the
+    // first one that fits are tried in order. If fitting is not
+    // monotonic in the candidate size (which the algorithms don't
+    // guarantee), a smaller candidate before that interval could
+    // fit too.
+    Size bestFit(base::task_token& token,
+                 const int fixedWidth = 0,
+                 const int fixedHeight = 0);
     Size bestFit(base::task_token& token,
+                 base::thread_pool& pool,
                  const int fixedWidth = 0,
                  const int fixedHeight = 0);
 
@@ -54,11 +98,24 @@ namespace gfx {
     const Rect& bounds() const { return m_bounds; }
 
   private:
+    bool packWithRegion(const std::vector<int>& indexes,
+                        base::task_token& token);
+    bool findWithRegion(const Region& rgn, const Size& sz,
+                        base::task_token& token, Rect& possible) const;
+
+    template<typename Packer>
+    bool packWith(Packer& packer,
+                  const std::vector<int>& indexes,
+                  base::task_token& token);
+
     int m_borderPadding;
     int m_shapePadding;
+    Algorithm m_algorithm;
 
     Rect m_bounds;
     Rects m_rects;
+    std::vector<bool> m_canRotate;
+    std::vector<bool> m_rotated;
   };
 
 } // namespace gfx
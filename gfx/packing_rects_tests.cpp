@@ -1,5 +1,5 @@
 // LAF Gfx Library
-// Copyright (C) 2019-2021  Igara Studio S.A.
+// Copyright (C) 2019-2024  Igara Studio S.A.
 // Copyright (C) 2001-2014 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -13,12 +13,89 @@
 
 #if LAF_WITH_REGION
 
+#include "base/thread_pool.h"
 #include "gfx/packing_rects.h"
 #include "gfx/rect_io.h"
 #include "gfx/size.h"
+#include "gfx/size_io.h"
+
+#include <random>
+#include <vector>
 
 using namespace gfx;
 
+using Algorithm = PackingRects::Algorithm;
+
+static const Algorithm kAlgorithms[] = {
+  Algorithm::Region,
+  Algorithm::SkylineBottomLeft,
+  Algorithm::MaxRectsBestShortSideFit,
+  Algorithm::MaxRectsBestAreaFit,
+  Algorithm::Guillotine,
+};
+
+static const char* algorithm_name(Algorithm algorithm)
+{
+  switch (algorithm) {
+    case Algorithm::Region: return "Region";
+    case Algorithm::SkylineBottomLeft: return "SkylineBottomLeft";
+    case Algorithm::MaxRectsBestShortSideFit: return "MaxRectsBSSF";
+    case Algorithm::MaxRectsBestAreaFit: return "MaxRectsBAF";
+    case Algorithm::Guillotine: return "Guillotine";
+  }
+  return "";
+}
+
+static std::vector<Size> make_random_sizes(int n, int minSize, int maxSize)
+{
+  std::mt19937 rng(42);
+  std::vector<Size> sizes;
+  for (int i=0; i<n; ++i)
+    sizes.emplace_back(minSize + rng() % (maxSize-minSize+1),
+                       minSize + rng() % (maxSize-minSize+1));
+  return sizes;
+}
+
+// Checks that all rectangles are inside the bounds and don't overlap
+// (including the shape padding at the right/bottom sides).
+static void expect_valid_packing(const PackingRects& pr, int shapePadding)
+{
+  for (int i=0; i<int(pr.size()); ++i) {
+    EXPECT_TRUE(pr.bounds().contains(pr[i])) << pr[i];
+    for (int j=0; j<int(pr.size()); ++j) {
+      if (i == j)
+        continue;
+      Rect rc = pr[i];
+      rc.w += shapePadding;
+      rc.h += shapePadding;
+      EXPECT_FALSE(rc.intersects(pr[j])) << pr[i] << " " << pr[j];
+    }
+  }
+}
+
+// Packs the rectangles in the texture with the given width and the
+// smallest height (binary search), returns the percentage of the
+// texture area covered by rectangles.
+static double pack_min_height(PackingRects& pr, int width)
+{
+  base::task_token token;
+  int area = 0;
+  for (const auto& rc : pr)
+    area += rc.w * rc.h;
+
+  int lo = area / width;        // Fails
+  int hi = 8192;                // Fits
+  while (hi - lo > 1) {
+    const int h = (lo + hi) / 2;
+    if (pr.pack(Size(width, h), token))
+      hi = h;
+    else
+      lo = h;
+  }
+  EXPECT_TRUE(pr.pack(Size(width, hi), token));
+  return 100.0 * area / (width * hi);
+}
+
 TEST(PackingRects, Simple)
 {
   base::task_token token;
@@ -120,6 +197,235 @@ TEST(PackingRects, BorderAndShapePadding)
   EXPECT_EQ(Rect(10, 216, 200, 100), pr[2]);
 }
 
+TEST(PackingRects, AlgorithmsSimpleCases)
+{
+  base::task_token token;
+  for (Algorithm algorithm : kAlgorithms) {
+    SCOPED_TRACE(algorithm_name(algorithm));
+
+    PackingRects pr(0, 0, algorithm);
+    pr.add(Size(256, 128));
+    pr.add(Size(256, 120));
+    EXPECT_FALSE(pr.pack(Size(256, 247), token));
+    EXPECT_TRUE(pr.pack(Size(256, 248), token));
+    EXPECT_EQ(Rect(0, 0, 256, 128), pr[0]);
+    EXPECT_EQ(Rect(0, 128, 256, 120), pr[1]);
+
+    PackingRects pr2(10, 3, algorithm);
+    pr2.add(Size(200, 100));
+    pr2.add(Size(200, 100));
+    pr2.add(Size(200, 100));
+    EXPECT_FALSE(pr2.pack(Size(220, 325), token));
+    EXPECT_FALSE(pr2.pack(Size(219, 326), token));
+    EXPECT_TRUE(pr2.pack(Size(220, 326), token));
+    EXPECT_EQ(Rect(10, 10, 200, 100), pr2[0]);
+    EXPECT_EQ(Rect(10, 113, 200, 100), pr2[1]);
+    EXPECT_EQ(Rect(10, 216, 200, 100), pr2[2]);
+
+    pr2.bestFit(token);
+    expect_valid_packing(pr2, 3);
+  }
+}
+
+TEST(PackingRects, AlgorithmsCancel)
+{
+  for (Algorithm algorithm : kAlgorithms) {
+    PackingRects pr(0, 0, algorithm);
+    for (const auto& sz : make_random_sizes(16, 4, 32))
+      pr.add(sz);
+
+    base::task_token token;
+    token.cancel();
+    EXPECT_FALSE(pr.pack(Size(1024, 1024), token));
+  }
+}
+
+// Searches the best size trying all candidate sizes one by one.
+static Size sequential_best_fit(PackingRects& pr, int fixedWidth, int fixedHeight)
+{
+  base::task_token token;
+  Size size(fixedWidth, fixedHeight);
+  int neededArea = 0;
+  for (const auto& rc : pr) {
+    neededArea += rc.w * rc.h;
+    size |= rc.size();
+  }
+  const int w0 = size.w, h0 = size.h;
+  int w = w0, h = h0, z = 0;
+  while (true) {
+    if (w*h >= neededArea && pr.pack(Size(w, h), token))
+      return Size(w, h);
+    if (fixedWidth == 0 && fixedHeight == 0) {
+      if ((++z) & 1)
+        w += w0;
+      else
+        h += h0;
+    }
+    else if (fixedWidth == 0)
+      w += w0;
+    else
+      h += h0;
+  }
+}
+
+TEST(PackingRects, BestFitSearch)
+{
+  for (Algorithm algorithm : { Algorithm::SkylineBottomLeft,
+                               Algorithm::MaxRectsBestShortSideFit,
+                               Algorithm::Guillotine }) {
+    SCOPED_TRACE(algorithm_name(algorithm));
+    for (int n : { 1, 5, 50, 400 }) {
+      for (const Size& fixed : { Size(0, 0), Size(300, 0), Size(0, 200) }) {
+        PackingRects pr(0, 0, algorithm);
+        for (const auto& sz : make_random_sizes(n, 1, 40))
+          pr.add(sz);
+
+        PackingRects pr2 = pr;
+        const Size expected = sequential_best_fit(pr2, fixed.w, fixed.h);
+
+        base::task_token token;
+        const Size size = pr.bestFit(token, fixed.w, fixed.h);
+        EXPECT_EQ(expected, size) << n << " rects " << fixed;
+        EXPECT_EQ(Rect(size), pr.bounds());
+        EXPECT_EQ(1.0f, token.progress());
+        for (int i=0; i<n; ++i)
+          EXPECT_EQ(pr2[i], pr[i]);
+      }
+    }
+  }
+}
+
+// bestFit() with the pool of the caller, called from one of its
+// workers (so the caller must pack the probes itself).
+TEST(PackingRects, BestFitFromPoolWorker)
+{
+  base::thread_pool pool(1);
+  for (Algorithm algorithm : { Algorithm::Region,
+                               Algorithm::MaxRectsBestAreaFit }) {
+    SCOPED_TRACE(algorithm_name(algorithm));
+    PackingRects pr(0, 0, algorithm);
+    for (const auto& sz : make_random_sizes(20, 1, 20))
+      pr.add(sz);
+
+    PackingRects pr2 = pr;
+    const Size expected = sequential_best_fit(pr2, 0, 0);
+
+    Size size;
+    base::task_token token;
+    pool.execute([&]{ size = pr.bestFit(token, pool); });
+    pool.wait_all();
+    EXPECT_EQ(expected, size);
+    EXPECT_EQ(Rect(size), pr.bounds());
+    EXPECT_EQ(1.0f, token.progress());
+  }
+}
+
+TEST(PackingRects, BestFitCancel)
+{
+  PackingRects pr(0, 0, Algorithm::MaxRectsBestAreaFit);
+  for (const auto& sz : make_random_sizes(100, 1, 40))
+    pr.add(sz);
+
+  base::task_token token;
+  token.cancel();
+  EXPECT_EQ(Size(40, 40), pr.bestFit(token));
+}
+
+TEST(PackingRects, Rotation)
+{
+  base::task_token token;
+  for (Algorithm algorithm : kAlgorithms) {
+    SCOPED_TRACE(algorithm_name(algorithm));
+
+    PackingRects pr(0, 0, algorithm);
+    pr.add(Size(100, 10), true);
+    pr.add(Size(10, 100), false);
+    EXPECT_TRUE(pr.pack(Size(20, 100), token));
+    EXPECT_TRUE(pr.isRotated(0));
+    EXPECT_FALSE(pr.isRotated(1));
+    EXPECT_EQ(Size(10, 100), pr[0].size());
+    EXPECT_EQ(Size(10, 100), pr[1].size());
+    expect_valid_packing(pr, 0);
+
+    // Rectangles recover their orientation in each pack()
+    EXPECT_TRUE(pr.pack(Size(100, 110), token));
+    EXPECT_FALSE(pr.isRotated(0));
+    EXPECT_EQ(Size(100, 10), pr[0].size());
+    expect_valid_packing(pr, 0);
+
+    // Cannot be rotated
+    PackingRects pr2(0, 0, algorithm);
+    pr2.add(Size(100, 10), false);
+    EXPECT_FALSE(pr2.pack(Size(20, 100), token));
+  }
+}
+
+// Sprites with very different aspect ratios (e.g. characters,
+// platforms, and UI bars).
+TEST(PackingRects, RotationOccupancy)
+{
+  std::mt19937 rng(42);
+  std::vector<Size> sizes;
+  for (int i=0; i<60; ++i)
+    sizes.emplace_back(8 + rng() % 8, 48 + rng() % 32);      // Tall
+  for (int i=0; i<60; ++i)
+    sizes.emplace_back(48 + rng() % 32, 8 + rng() % 8);      // Wide
+  for (int i=0; i<30; ++i)
+    sizes.emplace_back(16 + rng() % 16, 16 + rng() % 16);    // Square-ish
+
+  for (Algorithm algorithm : { Algorithm::SkylineBottomLeft,
+                               Algorithm::MaxRectsBestShortSideFit,
+                               Algorithm::MaxRectsBestAreaFit,
+                               Algorithm::Guillotine }) {
+    SCOPED_TRACE(algorithm_name(algorithm));
+
+    double occ[2];
+    for (int rotate=0; rotate<2; ++rotate) {
+      PackingRects pr(0, 1, algorithm);
+      for (const auto& sz : sizes)
+        pr.add(sz, rotate == 1);
+      occ[rotate] = pack_min_height(pr, 256);
+      expect_valid_packing(pr, 1);
+    }
+    if (algorithm == Algorithm::Guillotine)
+      EXPECT_GE(occ[1], occ[0]);
+    else
+      EXPECT_GT(occ[1], occ[0] + 2.0);
+  }
+}
+
+// Checks the occupancy of the different algorithms (the Region
+// algorithm is tested with fewer rectangles because it's too slow,
+// see laf_benchmarks for the speed of each one).
+TEST(PackingRects, AlgorithmsOccupancy)
+{
+  struct {
+    int n;
+    int shapePadding;
+  } cases[] = { { 32, 0 }, { 32, 2 }, { 1000, 0 }, { 1000, 1 } };
+
+  for (const auto& c : cases) {
+    for (Algorithm algorithm : kAlgorithms) {
+      if (algorithm == Algorithm::Region && c.n > 32)
+        continue;
+
+      SCOPED_TRACE(algorithm_name(algorithm));
+      PackingRects pr(0, c.shapePadding, algorithm);
+      for (const auto& sz : make_random_sizes(c.n, 4, 48))
+        pr.add(sz);
+
+      base::task_token token;
+      ASSERT_TRUE(pr.pack(Size(512, 8192), token));
+
+      const double occ = pack_min_height(pr, 256);
+      expect_valid_packing(pr, c.shapePadding);
+      if (c.shapePadding == 0) {
+        EXPECT_GT(occ, 75.0);
+      }
+    }
+  }
+}
+
 #endif  // LAF_WITH_REGION
 
 int main(int argc, char** argv)
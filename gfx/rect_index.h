@@ -0,0 +1,441 @@
+// LAF Gfx Library
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef GFX_RECT_INDEX_H_INCLUDED
+#define GFX_RECT_INDEX_H_INCLUDED
+#pragma once
+
+#include "base/debug.h"
+#include "gfx/point.h"
+#include "gfx/rect.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#ifdef _MSC_VER
+  #include <intrin.h>
+#endif
+
+namespace gfx {
+
+  namespace details {
+
+    // Position of (x, y) in a Hilbert curve of 65536x65536 cells.
+    inline uint32_t hilbert_index(uint32_t x, uint32_t y) {
+      uint32_t d = 0;
+      for (uint32_t s=0x8000; s>0; s >>= 1) {
+        const uint32_t rx = ((x & s) ? 1: 0);
+        const uint32_t ry = ((y & s) ? 1: 0);
+        d += s * s * ((3 * rx) ^ ry);
+        if (ry == 0) {
+          if (rx == 1) {
+            x = 0xffff - x;
+            y = 0xffff - y;
+          }
+          std::swap(x, y);
+        }
+      }
+      return d;
+    }
+
+  } // namespace details
+
+  // Spatial index of rectangles to find which ones intersect a
+  // rectangle or contain a point (e.g. hit-testing widgets/sprites,
+  // or culling items outside a damaged area) without checking all of
+  // them.
+  //
+  // It's a packed R-tree: build() sorts all rectangles by the
+  // position of their centers in a Hilbert curve and groups them in
+  // nodes of kNodeSize children. Each node keeps the bounds of its
+  // children in separated arrays (x1[], y1[], x2[], y2[]) so the
+  // compiler can test all children at once with SIMD instructions.
+  //
+  // After build(), insert() adds new rectangles to a small list that
+  // is checked linearly, remove() marks the tree entry as unused, and
+  // move() updates the tree entry in-place (growing the parent nodes
+  // if it's necessary). The tree is built again automatically when
+  // too many of these changes are accumulated.
+  //
+  // Empty rectangles can be added but they are never returned by
+  // queries (like Rect::intersects() and Rect::contains()).
+  template<typename T>
+  class RectIndex {
+  public:
+    using Id = int;
+    static constexpr Id kNoId = -1;
+    static constexpr int kNodeSize = 16;
+
+    RectIndex() { }
+
+    // Number of rectangles in the index.
+    int size() const { return m_count; }
+    bool empty() const { return m_count == 0; }
+
+    const Rect& bounds(Id id) const { return m_items[id].bounds; }
+    const T& value(Id id) const { return m_items[id].value; }
+    T& value(Id id) { return m_items[id].value; }
+
+    void clear() {
+      m_items.clear();
+      m_freeIds.clear();
+      m_nodes.clear();
+      m_pending.clear();
+      m_root = -1;
+      m_leafCount = 0;
+      m_count = 0;
+      m_changes = 0;
+    }
+
+    // Adds a new rectangle. The returned ID is valid until the
+    // rectangle is removed (then it can be reused by other insert()).
+    Id insert(const Rect& rc, const T& value) {
+      Id id;
+      if (!m_freeIds.empty()) {
+        id = m_freeIds.back();
+        m_freeIds.pop_back();
+      }
+      else {
+        id = Id(m_items.size());
+        m_items.emplace_back();
+      }
+      Item& item = m_items[id];
+      item.bounds = rc;
+      item.value = value;
+      item.used = true;
+      addPending(id);
+      ++m_count;
+      ++m_changes;
+      rebuildIfNeeded();
+      return id;
+    }
+
+    void remove(Id id) {
+      Item& item = m_items[id];
+      ASSERT(item.used);
+      if (item.node >= 0) {
+        Node& leaf = m_nodes[item.node];
+        leaf.set(item.slot, Box::empty(), kNoId);
+      }
+      else
+        removePending(item.slot);
+      item = Item();
+      m_freeIds.push_back(id);
+      --m_count;
+      ++m_changes;
+      rebuildIfNeeded();
+    }
+
+    void move(Id id, const Rect& rc) {
+      Item& item = m_items[id];
+      ASSERT(item.used);
+      item.bounds = rc;
+      const Box box(rc);
+      if (item.node < 0) {
+        m_pending[item.slot].box = box;
+        return;
+      }
+
+      m_nodes[item.node].set(item.slot, box, id);
+
+      // Grow the bounds of parent nodes (we never shrink them, so the
+      // tree gets worse with each move outside the original bounds).
+      bool grown = false;
+      for (int i=item.node; m_nodes[i].parent >= 0; i=m_nodes[i].parent) {
+        Node& parent = m_nodes[m_nodes[i].parent];
+        if (!parent.grow(m_nodes[i].parentSlot, box))
+          break;
+        grown = true;
+      }
+      if (grown) {
+        ++m_changes;
+        rebuildIfNeeded();
+      }
+    }
+
+    // Builds the whole tree again from the current rectangles.
+    void build() {
+      m_nodes.clear();
+      m_root = -1;
+      m_leafCount = 0;
+      m_changes = 0;
+
+      std::vector<std::pair<uint32_t, Id>> order;
+      order.reserve(m_count);
+      if (m_count > 0) {
+        // Bounds of the rectangles centers
+        int64_t minX = INT64_MAX, minY = INT64_MAX;
+        int64_t maxX = INT64_MIN, maxY = INT64_MIN;
+        for (const Item& item : m_items) {
+          if (!item.used)
+            continue;
+          const int64_t cx = centerX(item.bounds);
+          const int64_t cy = centerY(item.bounds);
+          minX = std::min(minX, cx);
+          minY = std::min(minY, cy);
+          maxX = std::max(maxX, cx);
+          maxY = std::max(maxY, cy);
+        }
+        const int64_t w = std::max<int64_t>(1, maxX - minX);
+        const int64_t h = std::max<int64_t>(1, maxY - minY);
+        for (Id id=0; id<Id(m_items.size()); ++id) {
+          const Item& item = m_items[id];
+          if (!item.used)
+            continue;
+          const uint32_t hx = uint32_t((centerX(item.bounds) - minX) * 0xffff / w);
+          const uint32_t hy = uint32_t((centerY(item.bounds) - minY) * 0xffff / h);
+          order.emplace_back(details::hilbert_index(hx, hy), id);
+        }
+        std::sort(order.begin(), order.end());
+      }
+      m_pending.clear();
+
+      // Leaves
+      for (size_t i=0; i<order.size(); i += kNodeSize) {
+        const int index = int(m_nodes.size());
+        m_nodes.emplace_back();
+        Node& leaf = m_nodes.back();
+        const int n = int(std::min<size_t>(kNodeSize, order.size() - i));
+        for (int j=0; j<n; ++j) {
+          const Id id = order[i+j].second;
+          Item& item = m_items[id];
+          item.node = index;
+          item.slot = j;
+          leaf.set(j, Box(item.bounds), id);
+        }
+      }
+      m_leafCount = int(m_nodes.size());
+
+      // Upper levels
+      int levelBegin = 0;
+      int levelEnd = m_leafCount;
+      while (levelEnd - levelBegin > 1) {
+        for (int i=levelBegin; i<levelEnd; i += kNodeSize) {
+          const int index = int(m_nodes.size());
+          const int n = std::min(kNodeSize, levelEnd - i);
+          Node node;
+          for (int j=0; j<n; ++j) {
+            m_nodes[i+j].parent = index;
+            m_nodes[i+j].parentSlot = j;
+            node.set(j, m_nodes[i+j].bounds(), i+j);
+          }
+          m_nodes.push_back(node);
+        }
+        levelBegin = levelEnd;
+        levelEnd = int(m_nodes.size());
+      }
+      if (!m_nodes.empty())
+        m_root = int(m_nodes.size()) - 1;
+    }
+
+    // Calls func(Id, const T&) for each rectangle that intersects
+    // "rc" (in no specific order).
+    template<typename Func>
+    void forEach(const Rect& rc, Func&& func) const {
+      if (rc.isEmpty())
+        return;
+      const Box box(rc);
+
+      for (const Pending& p : m_pending) {
+        if (p.box.intersects(box))
+          func(p.id, m_items[p.id].value);
+      }
+
+      if (m_root < 0)
+        return;
+
+      // Each visited node adds at most kNodeSize-1 nodes to the stack
+      // (it was popped from it), and the tree has less than 8 levels
+      // for int Ids.
+      int stack[kNodeSize*8];
+      int n = 0;
+      stack[n++] = m_root;
+      while (n > 0) {
+        const int index = stack[--n];
+        const Node& node = m_nodes[index];
+        uint32_t mask = node.intersects(box);
+        if (index < m_leafCount) {
+          for (; mask; mask &= mask-1) {
+            const Id id = node.child[ctz(mask)];
+            func(id, m_items[id].value);
+          }
+        }
+        else {
+          for (; mask; mask &= mask-1)
+            stack[n++] = node.child[ctz(mask)];
+        }
+      }
+    }
+
+    // Calls func(Id, const T&) for each rectangle that contains "pt".
+    template<typename Func>
+    void forEach(const Point& pt, Func&& func) const {
+      forEach(Rect(pt.x, pt.y, 1, 1), std::forward<Func>(func));
+    }
+
+    // Adds to "out" the values of rectangles that intersect "rc" /
+    // contain "pt".
+    void query(const Rect& rc, std::vector<T>& out) const {
+      forEach(rc, [&out](Id, const T& value){ out.push_back(value); });
+    }
+    void query(const Point& pt, std::vector<T>& out) const {
+      forEach(pt, [&out](Id, const T& value){ out.push_back(value); });
+    }
+
+  private:
+    // Rectangle as [x1, x2) x [y1, y2). Empty rectangles use x1=INT_MAX
+    // and x2=INT_MIN so they never intersect other boxes, and don't
+    // modify the bounds of a node.
+    struct Box {
+      int x1, y1, x2, y2;
+
+      Box() { }
+      Box(int x1, int y1, int x2, int y2) : x1(x1), y1(y1), x2(x2), y2(y2) { }
+      explicit Box(const Rect& rc) {
+        if (rc.isEmpty())
+          *this = empty();
+        else
+          *this = Box(rc.x, rc.y, rc.x2(), rc.y2());
+      }
+
+      static Box empty() { return Box(INT_MAX, INT_MAX, INT_MIN, INT_MIN); }
+
+      bool intersects(const Box& b) const {
+        return (b.x1 < x2 && b.x2 > x1 && b.y1 < y2 && b.y2 > y1);
+      }
+    };
+
+    // Node of the tree with the bounds of its children (items in
+    // leaves, or other nodes) in separated arrays. Unused slots
+    // contain Box::empty() so they never match.
+    struct Node {
+      int x1[kNodeSize];
+      int y1[kNodeSize];
+      int x2[kNodeSize];
+      int y2[kNodeSize];
+      int child[kNodeSize];
+      int parent = -1;
+      int parentSlot = 0;
+
+      Node() {
+        const Box e = Box::empty();
+        for (int i=0; i<kNodeSize; ++i) {
+          x1[i] = e.x1; y1[i] = e.y1;
+          x2[i] = e.x2; y2[i] = e.y2;
+          child[i] = kNoId;
+        }
+      }
+
+      void set(int i, const Box& b, int c) {
+        x1[i] = b.x1; y1[i] = b.y1;
+        x2[i] = b.x2; y2[i] = b.y2;
+        child[i] = c;
+      }
+
+      // Returns true if the bounds of the slot "i" had to be modified
+      // to contain "b".
+      bool grow(int i, const Box& b) {
+        if (b.x1 >= x1[i] && b.y1 >= y1[i] &&
+            b.x2 <= x2[i] && b.y2 <= y2[i])
+          return false;
+        x1[i] = std::min(x1[i], b.x1);
+        y1[i] = std::min(y1[i], b.y1);
+        x2[i] = std::max(x2[i], b.x2);
+        y2[i] = std::max(y2[i], b.y2);
+        return true;
+      }
+
+      Box bounds() const {
+        Box b = Box::empty();
+        for (int i=0; i<kNodeSize; ++i) {
+          b.x1 = std::min(b.x1, x1[i]);
+          b.y1 = std::min(b.y1, y1[i]);
+          b.x2 = std::max(b.x2, x2[i]);
+          b.y2 = std::max(b.y2, y2[i]);
+        }
+        return b;
+      }
+
+      // Returns a bit for each slot that intersects "b" (written
+      // without branches so it can be vectorized).
+      uint32_t intersects(const Box& b) const {
+        uint32_t mask = 0;
+        for (int i=0; i<kNodeSize; ++i) {
+          mask |= uint32_t((b.x1 < x2[i]) & (b.x2 > x1[i]) &
+                           (b.y1 < y2[i]) & (b.y2 > y1[i])) << i;
+        }
+        return mask;
+      }
+    };
+
+    struct Item {
+      Rect bounds;
+      T value = T();
+      int node = -1;            // Leaf node, or -1 if it's in m_pending
+      int slot = 0;             // Index in the leaf or in m_pending
+      bool used = false;
+    };
+
+    // Items inserted after the last build()
+    struct Pending {
+      Box box;
+      Id id;
+    };
+
+    static int64_t centerX(const Rect& rc) { return int64_t(rc.x) + rc.w/2; }
+    static int64_t centerY(const Rect& rc) { return int64_t(rc.y) + rc.h/2; }
+
+    static int ctz(uint32_t mask) {
+#if defined(_MSC_VER)
+      unsigned long i;
+      _BitScanForward(&i, mask);
+      return int(i);
+#else
+      return __builtin_ctz(mask);
+#endif
+    }
+
+    void addPending(Id id) {
+      Item& item = m_items[id];
+      item.node = -1;
+      item.slot = int(m_pending.size());
+      m_pending.push_back(Pending{ Box(item.bounds), id });
+    }
+
+    void removePending(int slot) {
+      if (slot != int(m_pending.size())-1) {
+        m_pending[slot] = m_pending.back();
+        m_items[m_pending[slot].id].slot = slot;
+      }
+      m_pending.pop_back();
+    }
+
+    // The tree is built again when the changes are more than 1/8 of
+    // the number of rectangles (so the cost of build() is amortized
+    // between several calls).
+    void rebuildIfNeeded() {
+      if (m_changes > std::max(kNodeSize*4, m_count / 8))
+        build();
+    }
+
+    std::vector<Item> m_items;
+    std::vector<Id> m_freeIds;
+    // Leaves first, then each level of the tree, the root is the last
+    // node.
+    std::vector<Node> m_nodes;
+    std::vector<Pending> m_pending;
+    int m_root = -1;
+    int m_leafCount = 0;
+    int m_count = 0;
+    int m_changes = 0;
+  };
+
+} // namespace gfx
+
+#endif
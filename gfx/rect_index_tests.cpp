@@ -0,0 +1,170 @@
+// LAF Gfx Library
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "gfx/rect_index.h"
+#include "gfx/rect_io.h"
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <vector>
+
+using namespace gfx;
+
+using Index = RectIndex<int>;
+
+static std::vector<int> query(const Index& index, const Rect& rc)
+{
+  std::vector<int> result;
+  index.query(rc, result);
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+static std::vector<int> query(const Index& index, const Point& pt)
+{
+  std::vector<int> result;
+  index.query(pt, result);
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+TEST(RectIndex, Empty)
+{
+  Index index;
+  EXPECT_TRUE(index.empty());
+  EXPECT_TRUE(query(index, Rect(0, 0, 100, 100)).empty());
+  index.build();
+  EXPECT_TRUE(query(index, Point(0, 0)).empty());
+}
+
+TEST(RectIndex, Simple)
+{
+  Index index;
+  const Index::Id a = index.insert(Rect(0, 0, 10, 10), 1);
+  const Index::Id b = index.insert(Rect(5, 5, 10, 10), 2);
+  index.insert(Rect(20, 0, 0, 10), 3); // Empty
+  EXPECT_EQ(3, index.size());
+  EXPECT_EQ(Rect(5, 5, 10, 10), index.bounds(b));
+  EXPECT_EQ(1, index.value(a));
+
+  for (int built=0; built<2; ++built) {
+    EXPECT_EQ(std::vector<int>({ 1 }), query(index, Point(0, 0)));
+    EXPECT_EQ(std::vector<int>({ 1, 2 }), query(index, Point(9, 9)));
+    EXPECT_EQ(std::vector<int>({ 2 }), query(index, Point(10, 10)));
+    EXPECT_EQ(std::vector<int>(), query(index, Point(15, 15)));
+    EXPECT_EQ(std::vector<int>(), query(index, Point(20, 5)));
+    EXPECT_EQ(std::vector<int>({ 1, 2 }), query(index, Rect(0, 0, 100, 100)));
+    EXPECT_EQ(std::vector<int>({ 2 }), query(index, Rect(10, 0, 10, 10)));
+    EXPECT_EQ(std::vector<int>(), query(index, Rect(0, 0, 0, 0)));
+    index.build();
+  }
+
+  index.move(a, Rect(30, 30, 5, 5));
+  EXPECT_EQ(std::vector<int>({ 2 }), query(index, Point(9, 9)));
+  EXPECT_EQ(std::vector<int>({ 1 }), query(index, Point(34, 34)));
+
+  index.remove(b);
+  EXPECT_EQ(2, index.size());
+  EXPECT_EQ(std::vector<int>({ 1 }), query(index, Rect(0, 0, 100, 100)));
+
+  index.clear();
+  EXPECT_TRUE(index.empty());
+  EXPECT_TRUE(query(index, Rect(0, 0, 100, 100)).empty());
+}
+
+// Compares the index with a linear search after random operations.
+TEST(RectIndex, Random)
+{
+  std::mt19937 rng(42);
+  auto randomRect = [&rng]{
+    return Rect(int(rng() % 2000) - 500, int(rng() % 2000) - 500,
+                int(rng() % 64), int(rng() % 64));
+  };
+
+  Index index;
+  std::map<Index::Id, Rect> rects;
+  int nextValue = 0;
+  std::map<Index::Id, int> values;
+
+  for (int i=0; i<1000; ++i) {
+    const Index::Id id = index.insert(randomRect(), nextValue);
+    rects[id] = index.bounds(id);
+    values[id] = nextValue++;
+  }
+  index.build();
+
+  for (int step=0; step<5000; ++step) {
+    switch (rng() % 4) {
+      case 0: {
+        const Rect rc = randomRect();
+        const Index::Id id = index.insert(rc, nextValue);
+        ASSERT_EQ(0, rects.count(id));
+        rects[id] = rc;
+        values[id] = nextValue++;
+        break;
+      }
+      case 1:
+        if (!rects.empty()) {
+          auto it = std::next(rects.begin(), rng() % rects.size());
+          index.remove(it->first);
+          values.erase(it->first);
+          rects.erase(it);
+        }
+        break;
+      case 2:
+      case 3:
+        if (!rects.empty()) {
+          auto it = std::next(rects.begin(), rng() % rects.size());
+          // Small and big moves
+          Rect rc = it->second;
+          if (rng() % 2)
+            rc.offset(int(rng() % 21) - 10, int(rng() % 21) - 10);
+          else
+            rc = randomRect();
+          index.move(it->first, rc);
+          it->second = rc;
+        }
+        break;
+    }
+    ASSERT_EQ(int(rects.size()), index.size());
+
+    if (step % 50 == 0) {
+      const Rect area(int(rng() % 2000) - 500, int(rng() % 2000) - 500,
+                      int(rng() % 300), int(rng() % 300));
+      const Point pt(area.origin());
+      std::vector<int> expectedArea, expectedPt;
+      for (const auto& kv : rects) {
+        if (kv.second.intersects(area))
+          expectedArea.push_back(values[kv.first]);
+        if (kv.second.contains(pt))
+          expectedPt.push_back(values[kv.first]);
+      }
+      std::sort(expectedArea.begin(), expectedArea.end());
+      std::sort(expectedPt.begin(), expectedPt.end());
+      ASSERT_EQ(expectedArea, query(index, area)) << area;
+      ASSERT_EQ(expectedPt, query(index, pt)) << area;
+
+      // Ids returned by forEach() must be valid
+      index.forEach(area, [&](Index::Id id, int value){
+        ASSERT_EQ(values[id], value);
+        ASSERT_TRUE(index.bounds(id).intersects(area));
+      });
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,513 @@
+// LAF Gfx Library
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gfx/region.h"
+
+#include "base/debug.h"
+#include "base/trace.h"
+#include "gfx/point.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+namespace gfx {
+
+namespace {
+
+using Box = details::Box;
+
+// Returns the end of the band that starts at "box".
+inline const Box* band_end(const Box* box, const Box* end)
+{
+  const int y1 = box->y1;
+  while (++box < end && box->y1 == y1)
+    ;
+  return box;
+}
+
+// Returns the first box in [box, end) that ends below "y" (boxes of
+// different bands are sorted by y2 too).
+inline const Box* find_band(const Box* box, const Box* end, int y)
+{
+  return std::upper_bound(box, end, y,
+                          [](int y, const Box& b){ return y < b.y2; });
+}
+
+// Returns the first box in the [box, end) band that ends after "x".
+inline const Box* find_span(const Box* box, const Box* end, int x)
+{
+  return std::upper_bound(box, end, x,
+                          [](int x, const Box& b){ return x < b.x2; });
+}
+
+inline bool covers(const Box& a, const Box& b)
+{
+  return (a.x1 <= b.x1 && a.y1 <= b.y1 &&
+          a.x2 >= b.x2 && a.y2 >= b.y2);
+}
+
+} // anonymous namespace
+
+Region::Region()
+  : m_boxes(m_inline)
+  , m_size(0)
+  , m_capacity(kInlineBoxes)
+  , m_extents{ 0, 0, 0, 0 }
+{
+}
+
+Region::Region(const Region& copy)
+  : Region()
+{
+  copyFrom(copy);
+}
+
+Region::Region(Region&& other) noexcept
+  : Region()
+{
+  moveFrom(other);
+}
+
+Region::Region(const Rect& rect)
+  : Region()
+{
+  setRect(rect);
+}
+
+Region& Region::operator=(const Rect& rect)
+{
+  setRect(rect);
+  return *this;
+}
+
+Region& Region::operator=(const Region& copy)
+{
+  copyFrom(copy);
+  return *this;
+}
+
+Region& Region::operator=(Region&& other) noexcept
+{
+  moveFrom(other);
+  return *this;
+}
+
+Region::~Region()
+{
+  if (!usesInlineBoxes())
+    delete[] m_boxes;
+}
+
+Rect Region::bounds() const
+{
+  return Rect(m_extents.x1, m_extents.y1,
+              m_extents.x2 - m_extents.x1,
+              m_extents.y2 - m_extents.y1);
+}
+
+void Region::clear()
+{
+  m_size = 0;
+  m_extents = { 0, 0, 0, 0 };
+}
+
+void Region::offset(int dx, int dy)
+{
+  for (int i=0; i<m_size; ++i) {
+    Box& box = m_boxes[i];
+    box.x1 += dx;
+    box.y1 += dy;
+    box.x2 += dx;
+    box.y2 += dy;
+  }
+  if (m_size > 0) {
+    m_extents.x1 += dx;
+    m_extents.y1 += dy;
+    m_extents.x2 += dx;
+    m_extents.y2 += dy;
+  }
+}
+
+void Region::offset(const PointT<int>& delta)
+{
+  offset(delta.x, delta.y);
+}
+
+Region& Region::createIntersection(const Region& a, const Region& b)
+{
+  LAF_TRACE_ZONE("gfx::Region::createIntersection");
+  return createOp(Op::Intersect, a, b);
+}
+
+Region& Region::createUnion(const Region& a, const Region& b)
+{
+  LAF_TRACE_ZONE("gfx::Region::createUnion");
+  return createOp(Op::Union, a, b);
+}
+
+Region& Region::createSubtraction(const Region& a, const Region& b)
+{
+  LAF_TRACE_ZONE("gfx::Region::createSubtraction");
+  return createOp(Op::Subtract, a, b);
+}
+
+bool Region::contains(const PointT<int>& pt) const
+{
+  if (m_size == 0 ||
+      pt.x < m_extents.x1 || pt.x >= m_extents.x2 ||
+      pt.y < m_extents.y1 || pt.y >= m_extents.y2)
+    return false;
+
+  const Box* end = m_boxes + m_size;
+  const Box* box = find_band(m_boxes, end, pt.y);
+  if (box == end || box->y1 > pt.y)
+    return false;
+
+  const Box* bandEnd = band_end(box, end);
+  box = find_span(box, bandEnd, pt.x);
+  return (box != bandEnd && box->x1 <= pt.x);
+}
+
+Region::Overlap Region::contains(const Rect& rect) const
+{
+  LAF_TRACE_ZONE("gfx::Region::contains");
+
+  const int x1 = rect.x, y1 = rect.y;
+  const int x2 = rect.x2(), y2 = rect.y2();
+  if (m_size == 0 || rect.isEmpty() ||
+      x2 <= m_extents.x1 || x1 >= m_extents.x2 ||
+      y2 <= m_extents.y1 || y1 >= m_extents.y2)
+    return Out;
+
+  bool partIn = false;
+  bool partOut = false;
+  int y = y1;
+
+  const Box* end = m_boxes + m_size;
+  const Box* box = find_band(m_boxes, end, y1);
+  while (box < end && box->y1 < y2) {
+    // Gap between bands
+    if (box->y1 > y)
+      partOut = true;
+
+    const Box* bandEnd = band_end(box, end);
+    const Box* span = find_span(box, bandEnd, x1);
+    if (span == bandEnd || span->x1 >= x2)
+      partOut = true;
+    else {
+      partIn = true;
+      // Spans don't touch each other, so only one span can cover
+      // the whole rectangle width.
+      if (span->x1 > x1 || span->x2 < x2)
+        partOut = true;
+    }
+    if (partIn && partOut)
+      return Part;
+
+    y = box->y2;
+    box = bandEnd;
+  }
+  if (y < y2)
+    partOut = true;
+
+  if (!partIn)
+    return Out;
+  return (partOut ? Part: In);
+}
+
+void Region::reserve(int n)
+{
+  if (n <= m_capacity)
+    return;
+
+  const int capacity = std::max(n, 2*m_capacity);
+  Box* boxes = new Box[capacity];
+  std::copy(m_boxes, m_boxes+m_size, boxes);
+  if (!usesInlineBoxes())
+    delete[] m_boxes;
+  m_boxes = boxes;
+  m_capacity = capacity;
+}
+
+void Region::setRect(const Rect& rect)
+{
+  if (rect.isEmpty()) {
+    clear();
+    return;
+  }
+  m_boxes[0] = { rect.x, rect.y, rect.x2(), rect.y2() };
+  m_extents = m_boxes[0];
+  m_size = 1;
+}
+
+void Region::copyFrom(const Region& copy)
+{
+  if (this == &copy)
+    return;
+
+  reserve(copy.m_size);
+  std::copy(copy.m_boxes, copy.m_boxes+copy.m_size, m_boxes);
+  m_size = copy.m_size;
+  m_extents = copy.m_extents;
+}
+
+void Region::moveFrom(Region& other)
+{
+  if (this == &other)
+    return;
+
+  // Inline boxes cannot be stolen
+  if (other.usesInlineBoxes()) {
+    copyFrom(other);
+  }
+  else {
+    if (!usesInlineBoxes())
+      delete[] m_boxes;
+    m_boxes = other.m_boxes;
+    m_size = other.m_size;
+    m_capacity = other.m_capacity;
+    m_extents = other.m_extents;
+
+    other.m_boxes = other.m_inline;
+    other.m_capacity = kInlineBoxes;
+  }
+  other.clear();
+}
+
+void Region::addBox(int x1, int y1, int x2, int y2)
+{
+  if (m_size == m_capacity)
+    reserve(m_size+1);
+  m_boxes[m_size++] = { x1, y1, x2, y2 };
+}
+
+// Adds the boxes of the band [y1, y2) that result of applying the
+// operation to the x-spans of [a, aEnd) and [b, bEnd) (one of them
+// can be empty).
+void Region::addBand(const Op op, const int y1, const int y2,
+                     const Box* a, const Box* aEnd,
+                     const Box* b, const Box* bEnd)
+{
+  switch (op) {
+
+    case Op::Union: {
+      int x1 = 0, x2 = 0;
+      bool first = true;
+      while (a < aEnd || b < bEnd) {
+        const Box* s;
+        if (b == bEnd || (a < aEnd && a->x1 <= b->x1))
+          s = a++;
+        else
+          s = b++;
+
+        if (!first && s->x1 <= x2) {
+          x2 = std::max(x2, s->x2);
+        }
+        else {
+          if (!first)
+            addBox(x1, y1, x2, y2);
+          x1 = s->x1;
+          x2 = s->x2;
+          first = false;
+        }
+      }
+      if (!first)
+        addBox(x1, y1, x2, y2);
+      break;
+    }
+
+    case Op::Intersect:
+      while (a < aEnd && b < bEnd) {
+        const int x1 = std::max(a->x1, b->x1);
+        const int x2 = std::min(a->x2, b->x2);
+        if (x1 < x2)
+          addBox(x1, y1, x2, y2);
+        if (a->x2 < b->x2)
+          ++a;
+        else
+          ++b;
+      }
+      break;
+
+    case Op::Subtract:
+      for (; a < aEnd; ++a) {
+        int x1 = a->x1;
+        const int x2 = a->x2;
+
+        // Skip spans of "b" at the left of "a"
+        while (b < bEnd && b->x2 <= x1)
+          ++b;
+
+        for (const Box* c=b; c < bEnd && c->x1 < x2; ++c) {
+          if (c->x1 > x1)
+            addBox(x1, y1, c->x1, y2);
+          x1 = c->x2;
+          if (x1 >= x2)
+            break;
+        }
+        if (x1 < x2)
+          addBox(x1, y1, x2, y2);
+      }
+      break;
+  }
+}
+
+// Merges the band that starts at "curBand" with the previous band if
+// they are contiguous and have the same x-spans. Returns the index of
+// the last band.
+int Region::coalesce(const int prevBand, const int curBand)
+{
+  const int n = m_size - curBand;
+  if (n == 0)
+    return prevBand;
+
+  if (prevBand < 0 ||
+      curBand - prevBand != n ||
+      m_boxes[prevBand].y2 != m_boxes[curBand].y1)
+    return curBand;
+
+  const Box* prev = m_boxes + prevBand;
+  const Box* cur = m_boxes + curBand;
+  for (int i=0; i<n; ++i) {
+    if (prev[i].x1 != cur[i].x1 ||
+        prev[i].x2 != cur[i].x2)
+      return curBand;
+  }
+
+  const int y2 = cur->y2;
+  for (int i=0; i<n; ++i)
+    m_boxes[prevBand+i].y2 = y2;
+  m_size = curBand;
+  return prevBand;
+}
+
+void Region::updateExtents()
+{
+  if (m_size == 0) {
+    m_extents = { 0, 0, 0, 0 };
+    return;
+  }
+
+  m_extents.x1 = m_boxes[0].x1;
+  m_extents.y1 = m_boxes[0].y1;
+  m_extents.x2 = m_boxes[0].x2;
+  m_extents.y2 = m_boxes[m_size-1].y2;
+  for (int i=1; i<m_size; ++i) {
+    m_extents.x1 = std::min(m_extents.x1, m_boxes[i].x1);
+    m_extents.x2 = std::max(m_extents.x2, m_boxes[i].x2);
+  }
+}
+
+Region& Region::createOp(const Op op, const Region& a, const Region& b)
+{
+  const Box& ea = a.m_extents;
+  const Box& eb = b.m_extents;
+  const bool disjoint =
+    (a.m_size == 0 || b.m_size == 0 ||
+     ea.x2 <= eb.x1 || eb.x2 <= ea.x1 ||
+     ea.y2 <= eb.y1 || eb.y2 <= ea.y1);
+
+  // Trivial cases that don't need a sweep
+  switch (op) {
+    case Op::Union:
+      if (b.m_size == 0 || (a.isRect() && covers(ea, eb))) {
+        copyFrom(a);
+        return *this;
+      }
+      if (a.m_size == 0 || (b.isRect() && covers(eb, ea))) {
+        copyFrom(b);
+        return *this;
+      }
+      break;
+    case Op::Intersect:
+      if (disjoint) {
+        clear();
+        return *this;
+      }
+      if (a.isRect() && b.isRect()) {
+        m_boxes[0] = { std::max(ea.x1, eb.x1), std::max(ea.y1, eb.y1),
+                       std::min(ea.x2, eb.x2), std::min(ea.y2, eb.y2) };
+        m_extents = m_boxes[0];
+        m_size = 1;
+        return *this;
+      }
+      break;
+    case Op::Subtract:
+      if (disjoint) {
+        copyFrom(a);
+        return *this;
+      }
+      if (b.isRect() && covers(eb, ea)) {
+        clear();
+        return *this;
+      }
+      break;
+  }
+
+  // The result is created in a new region because "this" can be "a"
+  // or "b".
+  Region result;
+  if (op != Op::Intersect)
+    result.reserve(a.m_size + b.m_size);
+
+  const Box* aBox = a.m_boxes;
+  const Box* bBox = b.m_boxes;
+  const Box* aEnd = aBox + a.m_size;
+  const Box* bEnd = bBox + b.m_size;
+  const Box* aBandEnd = (aBox < aEnd ? band_end(aBox, aEnd): aEnd);
+  const Box* bBandEnd = (bBox < bEnd ? band_end(bBox, bEnd): bEnd);
+  int y = std::min(aBox < aEnd ? aBox->y1: INT_MAX,
+                   bBox < bEnd ? bBox->y1: INT_MAX);
+  int prevBand = -1;
+
+  // Sweep the bands of both regions from top to bottom, each
+  // iteration processes the next horizontal slab [y, yNext) where
+  // no band starts or ends.
+  while (aBox < aEnd || bBox < bEnd) {
+    if ((op == Op::Intersect && (aBox == aEnd || bBox == bEnd)) ||
+        (op == Op::Subtract && aBox == aEnd))
+      break;
+
+    const bool aIn = (aBox < aEnd && aBox->y1 <= y);
+    const bool bIn = (bBox < bEnd && bBox->y1 <= y);
+    int yNext = INT_MAX;
+    if (aBox < aEnd)
+      yNext = std::min(yNext, aIn ? aBox->y2: aBox->y1);
+    if (bBox < bEnd)
+      yNext = std::min(yNext, bIn ? bBox->y2: bBox->y1);
+
+    if (aIn || bIn) {
+      const int curBand = result.m_size;
+      result.addBand(op, y, yNext,
+                     aBox, (aIn ? aBandEnd: aBox),
+                     bBox, (bIn ? bBandEnd: bBox));
+      prevBand = result.coalesce(prevBand, curBand);
+    }
+
+    y = yNext;
+    if (aBox < aEnd && aBox->y2 <= y) {
+      aBox = aBandEnd;
+      if (aBox < aEnd)
+        aBandEnd = band_end(aBox, aEnd);
+    }
+    if (bBox < bEnd && bBox->y2 <= y) {
+      bBox = bBandEnd;
+      if (bBox < bEnd)
+        bBandEnd = band_end(bBox, bEnd);
+    }
+  }
+
+  result.updateExtents();
+  moveFrom(result);
+  return *this;
+}
+
+} // namespace gfx
@@ -0,0 +1,149 @@
+// LAF Gfx Library
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef GFX_REGION_NATIVE_H_INCLUDED
+#define GFX_REGION_NATIVE_H_INCLUDED
+#pragma once
+
+#include "gfx/rect.h"
+
+#include <cstddef>
+#include <iterator>
+
+namespace gfx {
+
+  template<typename T> class PointT;
+
+  class Region;
+
+  namespace details {
+
+    // Same layout as pixman_box32 (x2/y2 are exclusive).
+    struct Box {
+      int x1, y1, x2, y2;
+    };
+
+    template<typename T>
+    class RegionIterator {
+    public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = T;
+      using difference_type = std::ptrdiff_t;
+      using pointer = T*;
+      using reference = T&;
+
+      RegionIterator() : m_ptr(nullptr) { }
+      RegionIterator(const RegionIterator& o) : m_ptr(o.m_ptr) { }
+      template<typename T2>
+      RegionIterator(const RegionIterator<T2>& o) : m_ptr(o.m_ptr) { }
+      RegionIterator& operator=(const RegionIterator& o) { m_ptr = o.m_ptr; return *this; }
+      RegionIterator& operator++() { ++m_ptr; return *this; }
+      RegionIterator operator++(int) { RegionIterator o(*this); ++m_ptr; return o; }
+      bool operator==(const RegionIterator& o) const { return m_ptr == o.m_ptr; }
+      bool operator!=(const RegionIterator& o) const { return m_ptr != o.m_ptr; }
+      reference operator*() {
+        m_rect.x = m_ptr->x1;
+        m_rect.y = m_ptr->y1;
+        m_rect.w = m_ptr->x2 - m_ptr->x1;
+        m_rect.h = m_ptr->y2 - m_ptr->y1;
+        return m_rect;
+      }
+    private:
+      const Box* m_ptr;
+      mutable Rect m_rect;
+      template<typename> friend class RegionIterator;
+      friend class ::gfx::Region;
+    };
+
+  } // namespace details
+
+  // Portable implementation of gfx::Region (used when there is no
+  // Skia or Pixman). The region is stored as a list of y-x banded
+  // boxes: boxes are sorted by y and then by x, all boxes in a band
+  // have the same y1/y2, boxes in a band don't overlap/touch each
+  // other, and contiguous bands with the same x-spans are
+  // coalesced. The first kInlineBoxes boxes are stored inside the
+  // object itself, so simple regions don't allocate memory.
+  class Region {
+  public:
+    enum Overlap { Out, In, Part };
+
+    using iterator = details::RegionIterator<Rect>;
+    using const_iterator = details::RegionIterator<const Rect>;
+
+    Region();
+    Region(const Region& copy);
+    Region(Region&& other) noexcept;
+    explicit Region(const Rect& rect);
+    Region& operator=(const Rect& rect);
+    Region& operator=(const Region& copy);
+    Region& operator=(Region&& other) noexcept;
+    ~Region();
+
+    iterator begin() { return makeIterator<iterator>(0); }
+    iterator end() { return makeIterator<iterator>(m_size); }
+    const_iterator begin() const { return makeIterator<const_iterator>(0); }
+    const_iterator end() const { return makeIterator<const_iterator>(m_size); }
+
+    bool isEmpty() const { return (m_size == 0); }
+    bool isRect() const { return (m_size == 1); }
+    bool isComplex() const { return (m_size > 1); }
+    std::size_t size() const { return m_size; }
+    Rect bounds() const;
+
+    void clear();
+
+    void offset(int dx, int dy);
+    void offset(const PointT<int>& delta);
+
+    Region& createIntersection(const Region& a, const Region& b);
+    Region& createUnion(const Region& a, const Region& b);
+    Region& createSubtraction(const Region& a, const Region& b);
+
+    bool contains(const PointT<int>& pt) const;
+    Overlap contains(const Rect& rect) const;
+
+    Region& operator+=(const Region& b) { return createUnion(*this, b); }
+    Region& operator|=(const Region& b) { return createUnion(*this, b); }
+    Region& operator&=(const Region& b) { return createIntersection(*this, b); }
+    Region& operator-=(const Region& b) { return createSubtraction(*this, b); }
+
+  private:
+    using Box = details::Box;
+    enum class Op { Union, Intersect, Subtract };
+
+    static constexpr int kInlineBoxes = 4;
+
+    template<typename It>
+    It makeIterator(int i) const {
+      It it;
+      it.m_ptr = m_boxes + i;
+      return it;
+    }
+
+    bool usesInlineBoxes() const { return m_boxes == m_inline; }
+    void reserve(int n);
+    void setRect(const Rect& rect);
+    void copyFrom(const Region& copy);
+    void moveFrom(Region& other);
+    void addBox(int x1, int y1, int x2, int y2);
+    void addBand(Op op, int y1, int y2,
+                 const Box* a, const Box* aEnd,
+                 const Box* b, const Box* bEnd);
+    int coalesce(int prevBand, int curBand);
+    void updateExtents();
+    Region& createOp(Op op, const Region& a, const Region& b);
+
+    Box* m_boxes;
+    int m_size;
+    int m_capacity;
+    Box m_extents;
+    Box m_inline[kInlineBoxes];
+  };
+
+} // namespace gfx
+
+#endif
@@ -11,6 +11,7 @@
 #include "pixman.h"
 
 #include "base/debug.h"
+#include "base/trace.h"
 #include "gfx/point.h"
 #include "gfx/region.h"
 
@@ -139,18 +140,21 @@ void Region::offset(const PointT<int>& delta)
 
 Region& Region::createIntersection(const Region& a, const Region& b)
 {
+  LAF_TRACE_ZONE("gfx::Region::createIntersection");
   pixman_region32_intersect(&m_region, &a.m_region, &b.m_region);
   return *this;
 }
 
 Region& Region::createUnion(const Region& a, const Region& b)
 {
+  LAF_TRACE_ZONE("gfx::Region::createUnion");
   pixman_region32_union(&m_region, &a.m_region, &b.m_region);
   return *this;
 }
 
 Region& Region::createSubtraction(const Region& a, const Region& b)
 {
+  LAF_TRACE_ZONE("gfx::Region::createSubtraction");
   pixman_region32_subtract(&m_region, &a.m_region, &b.m_region);
   return *this;
 }
@@ -167,6 +171,7 @@ Region::Overlap Region::contains(const Rect& rect) const
     int(In)    == int(PIXMAN_REGION_IN) &&
     int(Part)  == int(PIXMAN_REGION_PART), "Pixman constants have changed");
 
+  LAF_TRACE_ZONE("gfx::Region::contains");
   pixman_box32 box = { rect.x, rect.y, rect.x2(), rect.y2() };
   return (Region::Overlap)pixman_region32_contains_rectangle(&m_region, &box);
 }
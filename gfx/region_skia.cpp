@@ -74,6 +74,7 @@ Rect Region::bounds() const
 
 Region::Overlap Region::contains(const Rect& rect) const
 {
+  LAF_TRACE_ZONE("gfx::Region::contains");
   auto rc = SkIRect::MakeXYWH(rect.x, rect.y, rect.w, rect.h);
   if (m_region.contains(rc)) return In;
   if (m_region.intersects(rc)) return Part;
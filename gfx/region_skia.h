@@ -8,6 +8,7 @@
 #define GFX_REGION_SKIA_H_INCLUDED
 #pragma once
 
+#include "base/trace.h"
 #include "gfx/point.h"
 #include "gfx/rect.h"
 
@@ -104,16 +105,19 @@ namespace gfx {
     }
 
     Region& createIntersection(const Region& a, const Region& b) {
+      LAF_TRACE_ZONE("gfx::Region::createIntersection");
       m_region.op(a.m_region, b.m_region, SkRegion::kIntersect_Op);
       return *this;
     }
 
     Region& createUnion(const Region& a, const Region& b) {
+      LAF_TRACE_ZONE("gfx::Region::createUnion");
       m_region.op(a.m_region, b.m_region, SkRegion::kUnion_Op);
       return *this;
     }
 
     Region& createSubtraction(const Region& a, const Region& b) {
+      LAF_TRACE_ZONE("gfx::Region::createSubtraction");
       m_region.op(a.m_region, b.m_region, SkRegion::kDifference_Op);
       return *this;
     }
@@ -1,5 +1,5 @@
 // LAF Gfx Library
-// Copyright (C) 2019-2021  Igara Studio S.A.
+// Copyright (C) 2019-2024  Igara Studio S.A.
 // Copyright (C) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -17,6 +17,9 @@
 #include "gfx/rect_io.h"
 #include "gfx/region.h"
 
+#include <random>
+#include <vector>
+
 using namespace std;
 using namespace gfx;
 
@@ -124,6 +127,167 @@ TEST(Region, Iterators)
   EXPECT_EQ(2, c);
 }
 
+TEST(Region, Intersection)
+{
+  Region a(Rect(0, 0, 10, 10));
+  Region b(Rect(5, 5, 10, 10));
+  Region c;
+  c.createIntersection(a, b);
+  EXPECT_TRUE(c.isRect());
+  EXPECT_EQ(Rect(5, 5, 5, 5), c.bounds());
+
+  c.createIntersection(a, Region(Rect(10, 0, 5, 5)));
+  EXPECT_TRUE(c.isEmpty());
+
+  a.createUnion(a, Region(Rect(20, 0, 10, 10)));
+  a &= Region(Rect(5, 2, 20, 3));
+  ASSERT_EQ(2, a.size());
+  EXPECT_EQ(Rect(5, 2, 5, 3), *a.begin());
+  EXPECT_EQ(Rect(5, 2, 20, 3), a.bounds());
+}
+
+TEST(Region, Subtraction)
+{
+  Region a(Rect(0, 0, 10, 10));
+  a -= Region(Rect(3, 3, 4, 4));
+  EXPECT_EQ(4, a.size());
+  EXPECT_EQ(Rect(0, 0, 10, 10), a.bounds());
+  EXPECT_FALSE(a.contains(Point(3, 3)));
+  EXPECT_FALSE(a.contains(Point(6, 6)));
+  EXPECT_TRUE(a.contains(Point(7, 7)));
+  EXPECT_TRUE(a.contains(Point(2, 5)));
+
+  a -= Region(Rect(-5, -5, 20, 20));
+  EXPECT_TRUE(a.isEmpty());
+}
+
+TEST(Region, ContainsRect)
+{
+  Region a(Rect(0, 0, 10, 10));
+  a |= Region(Rect(20, 0, 10, 10));
+  EXPECT_EQ(Region::In, a.contains(Rect(0, 0, 10, 10)));
+  EXPECT_EQ(Region::In, a.contains(Rect(22, 2, 5, 5)));
+  EXPECT_EQ(Region::Part, a.contains(Rect(5, 5, 20, 2)));
+  EXPECT_EQ(Region::Part, a.contains(Rect(5, 5, 10, 10)));
+  EXPECT_EQ(Region::Out, a.contains(Rect(10, 0, 10, 10)));
+  EXPECT_EQ(Region::Out, a.contains(Rect(0, 10, 30, 5)));
+
+  // Gap between bands
+  Region b(Rect(0, 0, 10, 2));
+  b |= Region(Rect(0, 4, 10, 2));
+  EXPECT_EQ(Region::Part, b.contains(Rect(0, 0, 10, 6)));
+  EXPECT_EQ(Region::Out, b.contains(Rect(0, 2, 10, 2)));
+}
+
+TEST(Region, Offset)
+{
+  Region a(Rect(0, 0, 10, 10));
+  a -= Region(Rect(3, 3, 4, 4));
+  a.offset(5, -5);
+  EXPECT_EQ(Rect(5, -5, 10, 10), a.bounds());
+  EXPECT_FALSE(a.contains(Point(8, -2)));
+  EXPECT_TRUE(a.contains(Point(5, -5)));
+  a.offset(Point(-5, 5));
+  EXPECT_EQ(Rect(0, 0, 10, 10), a.bounds());
+}
+
+TEST(Region, CopyLargeRegions)
+{
+  // Enough rectangles to exceed any inline storage
+  Region a;
+  for (int i=0; i<32; ++i)
+    a |= Region(Rect(i*4, i*4, 2, 2));
+  ASSERT_EQ(32, a.size());
+
+  Region b(a);
+  Region c;
+  c = a;
+  Region d(Rect(0, 0, 1, 1));
+  d = b;
+  for (auto* rgn : { &b, &c, &d }) {
+    EXPECT_EQ(a.size(), rgn->size());
+    EXPECT_EQ(a.bounds(), rgn->bounds());
+  }
+  a.clear();
+  EXPECT_TRUE(a.isEmpty());
+  EXPECT_EQ(32, b.size());
+}
+
+// Compares region operations with a simple bitmap implementation.
+TEST(Region, RandomOpsVsBitmap)
+{
+  const int W = 48, H = 48;
+  using Bitmap = std::vector<bool>;
+
+  std::mt19937 rng(42);
+  auto randomRect = [&rng]{
+    return Rect(rng() % W - 4, rng() % H - 4,
+                1 + rng() % 20, 1 + rng() % 20);
+  };
+  auto fill = [](Bitmap& bmp, const Rect& rc, bool value){
+    for (int y=rc.y; y<rc.y2(); ++y)
+      for (int x=rc.x; x<rc.x2(); ++x)
+        if (x >= 0 && y >= 0 && x < W && y < H)
+          bmp[y*W+x] = value;
+  };
+
+  for (int test=0; test<200; ++test) {
+    Region rgn;
+    Bitmap bmp(W*H, false);
+    for (int i=0; i<12; ++i) {
+      const Rect rc = randomRect();
+      switch (rng() % 3) {
+        case 0:
+          rgn |= Region(rc);
+          fill(bmp, rc, true);
+          break;
+        case 1:
+          rgn -= Region(rc);
+          fill(bmp, rc, false);
+          break;
+        case 2: {
+          Region other(rc);
+          other |= Region(randomRect());
+          Bitmap bmp2(W*H, false);
+          for (const auto& rc2 : other)
+            fill(bmp2, rc2, true);
+          rgn &= other;
+          for (int j=0; j<W*H; ++j)
+            bmp[j] = bmp[j] && bmp2[j];
+          break;
+        }
+      }
+
+      // Rectangles don't overlap
+      int area = 0, count = 0;
+      for (const auto& rc2 : rgn)
+        area += rc2.w * rc2.h;
+      for (int y=0; y<H; ++y) {
+        for (int x=0; x<W; ++x) {
+          ASSERT_EQ(bool(bmp[y*W+x]), rgn.contains(Point(x, y)))
+            << "Test " << test << " op " << i;
+          count += (bmp[y*W+x] ? 1: 0);
+        }
+      }
+      const Rect bounds = rgn.bounds();
+      if (bounds.x >= 0 && bounds.y >= 0 &&
+          bounds.x2() <= W && bounds.y2() <= H) {
+        ASSERT_EQ(count, area);
+      }
+
+      const Rect rc2 = randomRect();
+      int in = 0;
+      for (int y=rc2.y; y<rc2.y2(); ++y)
+        for (int x=rc2.x; x<rc2.x2(); ++x)
+          in += (rgn.contains(Point(x, y)) ? 1: 0);
+      const Region::Overlap expected =
+        (in == 0 ? Region::Out:
+         in == rc2.w*rc2.h ? Region::In: Region::Part);
+      ASSERT_EQ(expected, rgn.contains(rc2));
+    }
+  }
+}
+
 #endif  // LAF_WITH_REGION
 
 int main(int argc, char** argv)
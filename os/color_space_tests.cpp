@@ -0,0 +1,105 @@
+// LAF OS Library
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "os/system.h"
+
+#if LAF_SKIA
+
+#include "gfx/color.h"
+#include "os/common/generic_color_space.h"
+#include "os/skia/skia_color_space.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace os;
+
+static SystemRef g_system;
+
+static const gfx::ColorSpacePrimaries kDisplayP3 = {
+  0.680f, 0.320f, 0.265f, 0.690f, 0.150f, 0.060f, 0.3127f, 0.3290f
+};
+
+static std::vector<gfx::ColorSpaceRef> make_color_spaces()
+{
+  return {
+    gfx::ColorSpace::MakeSRGB(),
+    gfx::ColorSpace::MakeLinearSRGB(),
+    gfx::ColorSpace::MakeSRGBWithGamma(2.2f),
+    gfx::ColorSpace::MakeRGBWithSRGBGamma(kDisplayP3),
+  };
+}
+
+static std::vector<uint32_t> make_pixels()
+{
+  // All gray levels and random colors
+  std::vector<uint32_t> pixels;
+  for (int v=0; v<256; ++v)
+    pixels.push_back(gfx::rgba(v, v, v, 255-v));
+  std::mt19937 rng(42);
+  for (int i=0; i<4096; ++i)
+    pixels.push_back(rng());
+  return pixels;
+}
+
+// The Skia backend converts pixels with gfx::ColorTransform, which
+// must give the same result as skcms (the previous engine) +/-1.
+TEST(ColorSpace, SkiaBackendMatchesSkcms)
+{
+  const std::vector<uint32_t> src = make_pixels();
+  const int n = int(src.size());
+
+  for (const auto& srcGfxCS : make_color_spaces()) {
+    for (const auto& dstGfxCS : make_color_spaces()) {
+      const ColorSpaceRef srcCS = g_system->makeColorSpace(srcGfxCS);
+      const ColorSpaceRef dstCS = g_system->makeColorSpace(dstGfxCS);
+      SCOPED_TRACE(srcGfxCS->name() + " -> " + dstGfxCS->name());
+
+      auto conversion = g_system->convertBetweenColorSpace(srcCS, dstCS);
+      ASSERT_TRUE(conversion != nullptr);
+      ASSERT_TRUE(dynamic_cast<GenericColorSpaceConversion*>(conversion.get()));
+      auto skcms = make_ref<SkiaColorSpaceConversion>(srcCS, dstCS);
+
+      std::vector<uint32_t> dst(n), expected(n);
+      ASSERT_TRUE(conversion->convertRgba(dst.data(), src.data(), n));
+      ASSERT_TRUE(skcms->convertRgba(expected.data(), src.data(), n));
+
+      int maxDiff = 0;
+      for (int i=0; i<n; ++i) {
+        const int d = std::max({
+            std::abs(int(gfx::getr(expected[i])) - int(gfx::getr(dst[i]))),
+            std::abs(int(gfx::getg(expected[i])) - int(gfx::getg(dst[i]))),
+            std::abs(int(gfx::getb(expected[i])) - int(gfx::getb(dst[i]))) });
+        maxDiff = std::max(maxDiff, d);
+        EXPECT_EQ(gfx::geta(src[i]), gfx::geta(dst[i])) << i;
+      }
+      EXPECT_LE(maxDiff, 1);
+    }
+  }
+}
+
+#endif  // LAF_SKIA
+
+int app_main(int argc, char* argv[])
+{
+#if LAF_SKIA
+  g_system = os::make_system();
+#endif
+  ::testing::InitGoogleTest(&argc, argv);
+  const int result = RUN_ALL_TESTS();
+#if LAF_SKIA
+  g_system = nullptr;
+#endif
+  return result;
+}
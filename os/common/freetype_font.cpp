@@ -1,5 +1,5 @@
 // LAF OS Library
-// Copyright (C) 2020  Igara Studio S.A.
+// Copyright (C) 2020-2024  Igara Studio S.A.
 // Copyright (C) 2016-2017  David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -16,15 +16,17 @@
 #include "gfx/point.h"
 #include "gfx/size.h"
 
+#include <algorithm>
+
 namespace os {
 
 FreeTypeFont::FreeTypeFont(ft::Lib& lib,
                            const char* filename,
                            const int height)
-  : m_face(lib.open(filename))
+  : m_pool(lib, filename)
 {
-  if (m_face.isValid())
-    m_face.setSize(height);
+  if (m_pool.isValid())
+    setSize(height);
 }
 
 FreeTypeFont::~FreeTypeFont()
@@ -33,7 +35,7 @@ FreeTypeFont::~FreeTypeFont()
 
 bool FreeTypeFont::isValid() const
 {
-  return m_face.isValid();
+  return m_pool.isValid();
 }
 
 FontType FreeTypeFont::type()
@@ -43,12 +45,12 @@ FontType FreeTypeFont::type()
 
 int FreeTypeFont::height() const
 {
-  return int(m_face.height());
+  return int(face().height());
 }
 
 int FreeTypeFont::textLength(const std::string& str) const
 {
-  return ft::calc_text_bounds(m_face, str).w;
+  return ft::calc_text_bounds(face(), str).w;
 }
 
 bool FreeTypeFont::isScalable() const
@@ -58,17 +60,41 @@ bool FreeTypeFont::isScalable() const
 
 void FreeTypeFont::setSize(int size)
 {
-  m_face.setSize(size);
+  m_pool.setSize(size);
 }
 
 void FreeTypeFont::setAntialias(bool antialias)
 {
-  m_face.setAntialias(antialias);
+  m_pool.setAntialias(antialias);
 }
 
 bool FreeTypeFont::hasCodePoint(int codepoint) const
 {
-  return m_face.hasCodePoint(codepoint);
+  return m_pool.coverage().contains(codepoint);
+}
+
+GlyphAtlas* FreeTypeFont::glyphAtlas()
+{
+  if (!m_pool.isOwnerThread())
+    return nullptr;
+
+  const int size = m_pool.size();
+  const bool antialias = m_pool.antialias();
+  auto it = std::find_if(m_atlases.begin(), m_atlases.end(),
+                         [size, antialias](const Atlas& a){
+                           return (a.size == size &&
+                                   a.antialias == antialias);
+                         });
+  if (it == m_atlases.end()) {
+    if (int(m_atlases.size()) == kMaxAtlases)
+      m_atlases.pop_back();
+    m_atlases.push_back(
+      Atlas{ size, antialias, std::make_unique<GlyphAtlas>() });
+    it = m_atlases.end()-1;
+  }
+  // Move to the front
+  std::rotate(m_atlases.begin(), it, it+1);
+  return m_atlases.front().atlas.get();
 }
 
 Ref<FreeTypeFont> load_free_type_font(ft::Lib& lib,
@@ -1,5 +1,5 @@
 // LAF OS Library
-// Copyright (C) 2020  Igara Studio S.A.
+// Copyright (C) 2020-2024  Igara Studio S.A.
 // Copyright (C) 2016-2017  David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -9,10 +9,15 @@
 #define OS_COMMON_FREETYPE_FONT_H_INCLUDED
 #pragma once
 
+#include "ft/face_pool.h"
 #include "ft/hb_face.h"
 #include "ft/lib.h"
+#include "os/common/glyph_atlas.h"
 #include "os/font.h"
 
+#include <memory>
+#include <vector>
+
 namespace os {
   class Font;
 
@@ -34,10 +39,41 @@ namespace os {
     void setAntialias(bool antialias) override;
     bool hasCodePoint(int codepoint) const override;
 
-    Face& face() { return m_face; }
+    // Returns the face for the current thread, so the font can be
+    // used to draw/measure text from several threads at the same
+    // time (but setSize()/setAntialias() must not be called
+    // meanwhile).
+    Face& face() const { return m_pool.face(); }
+
+    // Returns the atlas of rendered glyphs for the current size and
+    // antialiasing (atlases of the last used sizes are kept). Returns
+    // nullptr if it's called from other thread than the one that
+    // created the font.
+    GlyphAtlas* glyphAtlas();
+
+    // If it's enabled, antialiased glyphs are drawn scaling a signed
+    // distance field of each glyph (rendered once at
+    // ft::SdfCache::kBaseSize) instead of rasterizing each glyph for
+    // each size. Useful for text that is drawn in several sizes
+    // (e.g. zooming), but small sizes look better without it. It's
+    // used only for surfaces with direct access to their pixels
+    // (e.g. not for GPU-accelerated surfaces).
+    void setSdfRendering(bool state) { m_sdfRendering = state; }
+    bool sdfRendering() const { return m_sdfRendering; }
 
   private:
-    mutable Face m_face;
+    static constexpr int kMaxAtlases = 4;
+
+    struct Atlas {
+      int size;
+      bool antialias;
+      std::unique_ptr<GlyphAtlas> atlas;
+    };
+
+    mutable ft::FacePool m_pool;
+    // Atlases sorted from the most recently used
+    std::vector<Atlas> m_atlases;
+    bool m_sdfRendering = false;
   };
 
   Ref<FreeTypeFont> load_free_type_font(ft::Lib& lib,
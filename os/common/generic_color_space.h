@@ -0,0 +1,80 @@
+// LAF OS Library
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef OS_COMMON_GENERIC_COLOR_SPACE_H_INCLUDED
+#define OS_COMMON_GENERIC_COLOR_SPACE_H_INCLUDED
+#pragma once
+
+#include "base/debug.h"
+#include "base/disable_copying.h"
+#include "gfx/color_transform.h"
+#include "os/color_space.h"
+
+namespace os {
+
+// Color space that doesn't depend on a specific backend, its pixels
+// are converted with gfx::ColorTransform.
+class GenericColorSpace : public ColorSpace {
+public:
+  GenericColorSpace(const gfx::ColorSpaceRef& gfxcs)
+    : m_gfxcs(gfxcs) {
+    ASSERT(m_gfxcs);
+    if (m_gfxcs->name().empty()) {
+      if (m_gfxcs->type() == gfx::ColorSpace::None)
+        m_gfxcs->setName("None");
+      else if (m_gfxcs->type() == gfx::ColorSpace::ICC)
+        m_gfxcs->setName("Custom Profile");
+    }
+  }
+
+  const gfx::ColorSpaceRef& gfxColorSpace() const override { return m_gfxcs; }
+
+  bool isSRGB() const override {
+    return m_gfxcs->nearlyEqual(*gfx::ColorSpace::MakeSRGB());
+  }
+
+private:
+  gfx::ColorSpaceRef m_gfxcs;
+
+  DISABLE_COPYING(GenericColorSpace);
+};
+
+class GenericColorSpaceConversion : public ColorSpaceConversion {
+public:
+  GenericColorSpaceConversion(const gfx::ColorTransformRef& transform)
+    : m_transform(transform) { }
+
+  // Returns nullptr if the conversion between these color spaces is
+  // not supported by gfx::ColorTransform.
+  static Ref<ColorSpaceConversion> Make(const os::ColorSpaceRef& src,
+                                        const os::ColorSpaceRef& dst) {
+    if (!src || !dst ||
+        !src->gfxColorSpace() || !dst->gfxColorSpace())
+      return nullptr;
+    gfx::ColorTransformRef transform =
+      gfx::ColorTransform::Make(src->gfxColorSpace(), dst->gfxColorSpace());
+    if (!transform)
+      return nullptr;
+    return os::make_ref<GenericColorSpaceConversion>(transform);
+  }
+
+  bool convertRgba(uint32_t* dst, const uint32_t* src, int n) override {
+    m_transform->convertRgba(dst, src, n);
+    return true;
+  }
+
+  bool convertGray(uint8_t* dst, const uint8_t* src, int n) override {
+    m_transform->convertGray(dst, src, n);
+    return true;
+  }
+
+private:
+  gfx::ColorTransformRef m_transform;
+};
+
+} // namespace os
+
+#endif
@@ -0,0 +1,537 @@
+// LAF OS Library
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "os/common/generic_surface.h"
+
+#include "base/cpu_features.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if LAF_HAVE_SSE2
+  #include <immintrin.h>
+#elif LAF_HAVE_NEON
+  #include <arm_neon.h>
+#endif
+
+namespace os {
+
+namespace {
+
+// The blend() of an opaque backdrop B with a color F of alpha A
+// doesn't need divisions because the result alpha is always 255:
+//
+//   R = B + (F-B)*A/255
+//
+// where the division truncates towards zero, i.e. we can use
+// floor(|F-B|*A/255), which is exactly (x + 1 + (x >> 8)) >> 8 for
+// all x = |F-B|*A in [0, 255*255]. The same expression is applied to
+// the four channels of the pixel (the alpha channel stays in 255 as
+// both colors are converted to opaque pixels in the kernel).
+inline int div255_floor(const int x)
+{
+  return (x + 1 + (x >> 8)) >> 8;
+}
+
+inline uint32_t lerp_opaque(const uint32_t b, const uint32_t f, const int a)
+{
+  uint32_t r = 0;
+  for (int shift=0; shift<32; shift += 8) {
+    const int bc = (b >> shift) & 0xff;
+    const int fc = (f >> shift) & 0xff;
+    const int c = (fc >= bc ? bc + div255_floor((fc-bc)*a):
+                              bc - div255_floor((bc-fc)*a));
+    r |= uint32_t(c) << shift;
+  }
+  return r;
+}
+
+// x*a/255 rounded for each 8-bit channel of c.
+inline uint32_t mul_div255(const uint32_t c, const uint32_t a)
+{
+  uint32_t rb = (c & 0x00ff00ff) * a + 0x00800080;
+  rb = ((rb + ((rb >> 8) & 0x00ff00ff)) >> 8) & 0x00ff00ff;
+  uint32_t ag = ((c >> 8) & 0x00ff00ff) * a + 0x00800080;
+  ag = (ag + ((ag >> 8) & 0x00ff00ff)) & 0xff00ff00;
+  return rb | ag;
+}
+
+inline uint32_t to_pixel(const SurfaceFormatData& fmt, const gfx::Color c)
+{
+  return ((uint32_t(gfx::getr(c)) << fmt.redShift) |
+          (uint32_t(gfx::getg(c)) << fmt.greenShift) |
+          (uint32_t(gfx::getb(c)) << fmt.blueShift) |
+          (uint32_t(gfx::geta(c)) << fmt.alphaShift));
+}
+
+inline gfx::Color from_pixel(const SurfaceFormatData& fmt, const uint32_t p)
+{
+  return gfx::rgba((p & fmt.redMask) >> fmt.redShift,
+                   (p & fmt.greenMask) >> fmt.greenShift,
+                   (p & fmt.blueMask) >> fmt.blueShift,
+                   (p & fmt.alphaMask) >> fmt.alphaShift);
+}
+
+struct RowContext {
+  const SurfaceFormatData* dstFormat;
+  uint32_t alphaMask;           // Alpha mask of "dst"
+  uint32_t srcAlphaMask;        // Alpha of the "src" mask
+  uint32_t srcAlphaShift;
+  int coverageAlpha;            // Coverage is multiplied by this alpha
+  gfx::Color fg, bg;
+  uint32_t fgPixel;             // fg/bg as opaque pixels in "dst" format
+  uint32_t bgPixel;
+  int bgAlpha;
+  bool opaque;                  // "dst" format ignores the alpha channel
+  bool simd;                    // SIMD kernels can be used
+};
+
+RowContext make_context(const SurfaceFormatData& dstFormat,
+                        const gfx::Color fg, const gfx::Color bg)
+{
+  RowContext ctx;
+  ctx.dstFormat = &dstFormat;
+  ctx.alphaMask = dstFormat.alphaMask;
+  ctx.srcAlphaMask = 0;
+  ctx.srcAlphaShift = 0;
+  ctx.coverageAlpha = 255;
+  ctx.fg = fg;
+  ctx.bg = bg;
+  ctx.fgPixel = to_pixel(dstFormat, fg | gfx::ColorAMask);
+  ctx.bgPixel = to_pixel(dstFormat, bg | gfx::ColorAMask);
+  ctx.bgAlpha = gfx::geta(bg);
+  ctx.opaque = (dstFormat.pixelAlpha == PixelAlpha::kOpaque);
+  // The kernels expect an 8-bit alpha channel
+  ctx.simd = (dstFormat.alphaMask == (0xffu << dstFormat.alphaShift));
+  return ctx;
+}
+
+// Composites one pixel, handles all the cases.
+inline uint32_t composite_pixel(const RowContext& ctx, uint32_t d, const int a)
+{
+  if (ctx.opaque || (d & ctx.alphaMask) == ctx.alphaMask) {
+    if (ctx.bgAlpha > 0)
+      d = lerp_opaque(d, ctx.bgPixel, ctx.bgAlpha);
+    if (a > 0)
+      d = lerp_opaque(d, ctx.fgPixel, a);
+    return d;
+  }
+
+  const SurfaceFormatData& fmt = *ctx.dstFormat;
+  if (fmt.pixelAlpha == PixelAlpha::kPremultiplied) {
+    // SrcOver with premultiplied colors
+    if (ctx.bgAlpha > 0) {
+      const uint32_t bg = mul_div255(ctx.bgPixel, ctx.bgAlpha);
+      d = bg + mul_div255(d, 255 - ctx.bgAlpha);
+    }
+    if (a > 0) {
+      const uint32_t fg = mul_div255(ctx.fgPixel, a);
+      d = fg + mul_div255(d, 255 - a);
+    }
+    return d;
+  }
+
+  gfx::Color c = from_pixel(fmt, d);
+  if (ctx.bgAlpha > 0)
+    c = blend(c, ctx.bg);
+  if (a > 0)
+    c = blend(c, gfx::rgba(gfx::getr(ctx.fg),
+                           gfx::getg(ctx.fg),
+                           gfx::getb(ctx.fg), a));
+  return to_pixel(fmt, c);
+}
+
+// Coverage/mask formats: the alpha channel of 32-bit RGBA pixels
+// (RgbaCoverage), or 8-bit values (A8Coverage). The SIMD loaders
+// return the coverage of each pixel in a 32-bit lane.
+struct RgbaCoverage {
+  using Src = uint32_t;
+
+  static int get(const RowContext& ctx, const uint32_t* s) {
+    return (*s & ctx.srcAlphaMask) >> ctx.srcAlphaShift;
+  }
+
+#if LAF_HAVE_SSE2
+  static __m128i load4(const RowContext& ctx, const uint32_t* s) {
+    return _mm_and_si128(
+      _mm_srl_epi32(_mm_loadu_si128((const __m128i*)s),
+                    _mm_cvtsi32_si128(ctx.srcAlphaShift)),
+      _mm_set1_epi32(0xff));
+  }
+
+#if LAF_HAVE_X86_DISPATCH
+  LAF_TARGET("avx2")
+  static __m256i load8(const RowContext& ctx, const uint32_t* s) {
+    return _mm256_and_si256(
+      _mm256_srl_epi32(_mm256_loadu_si256((const __m256i*)s),
+                       _mm_cvtsi32_si128(ctx.srcAlphaShift)),
+      _mm256_set1_epi32(0xff));
+  }
+#endif
+#elif LAF_HAVE_NEON
+  static uint32x4_t load4(const RowContext& ctx, const uint32_t* s) {
+    return vandq_u32(vshlq_u32(vld1q_u32(s), vdupq_n_s32(-int(ctx.srcAlphaShift))),
+                     vdupq_n_u32(0xff));
+  }
+#endif
+};
+
+struct A8Coverage {
+  using Src = uint8_t;
+
+  static int get(const RowContext& ctx, const uint8_t* s) {
+    return *s;
+  }
+
+#if LAF_HAVE_SSE2
+  static __m128i load4(const RowContext& ctx, const uint8_t* s) {
+    int v;
+    std::memcpy(&v, s, 4);
+    const __m128i zero = _mm_setzero_si128();
+    return _mm_unpacklo_epi16(
+      _mm_unpacklo_epi8(_mm_cvtsi32_si128(v), zero), zero);
+  }
+
+#if LAF_HAVE_X86_DISPATCH
+  LAF_TARGET("avx2")
+  static __m256i load8(const RowContext& ctx, const uint8_t* s) {
+    return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)s));
+  }
+#endif
+#elif LAF_HAVE_NEON
+  static uint32x4_t load4(const RowContext& ctx, const uint8_t* s) {
+    uint32_t v;
+    std::memcpy(&v, s, 4);
+    return vmovl_u16(vget_low_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(v)))));
+  }
+#endif
+};
+
+// Returns the coverage multiplied by the coverageAlpha (same as
+// MUL_UN8).
+inline int scale_coverage(const RowContext& ctx, const int a)
+{
+  if (ctx.coverageAlpha == 255)
+    return a;
+  int t;
+  return MUL_UN8(a, ctx.coverageAlpha, t);
+}
+
+#if LAF_HAVE_SSE2
+
+inline __m128i div255_floor_sse2(const __m128i x)
+{
+  return _mm_srli_epi16(
+    _mm_add_epi16(_mm_add_epi16(x, _mm_set1_epi16(1)),
+                  _mm_srli_epi16(x, 8)), 8);
+}
+
+// Same as lerp_opaque() for 16-bit channels.
+inline __m128i lerp_opaque_sse2(const __m128i b, const __m128i f, const __m128i a)
+{
+  const __m128i pos = _mm_mullo_epi16(_mm_subs_epu16(f, b), a);
+  const __m128i neg = _mm_mullo_epi16(_mm_subs_epu16(b, f), a);
+  return _mm_sub_epi16(_mm_add_epi16(b, div255_floor_sse2(pos)),
+                       div255_floor_sse2(neg));
+}
+
+// Same as scale_coverage() for 32-bit lanes.
+inline __m128i scale_coverage_sse2(const __m128i a, const __m128i ca)
+{
+  const __m128i t = _mm_add_epi16(_mm_mullo_epi16(a, ca), _mm_set1_epi32(0x80));
+  return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+template<typename Coverage>
+int row_sse2(uint32_t* dst, const typename Coverage::Src* src, int n,
+             const RowContext& ctx)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i alphaMask = _mm_set1_epi32(ctx.opaque ? 0: ctx.alphaMask);
+  const __m128i fg = _mm_unpacklo_epi8(_mm_set1_epi32(ctx.fgPixel), zero);
+  const __m128i bg = _mm_unpacklo_epi8(_mm_set1_epi32(ctx.bgPixel), zero);
+  const __m128i bgA = _mm_set1_epi16(short(ctx.bgAlpha));
+  const __m128i ca = _mm_set1_epi32(ctx.coverageAlpha);
+
+  int i = 0;
+  for (; i+4 <= n; i += 4) {
+    const __m128i d = _mm_loadu_si128((const __m128i*)(dst+i));
+    if (_mm_movemask_epi8(
+          _mm_cmpeq_epi32(_mm_and_si128(d, alphaMask), alphaMask)) != 0xffff)
+      break;
+
+    // Coverage of each pixel in the four 16-bit channels
+    __m128i a = Coverage::load4(ctx, src+i);
+    if (ctx.coverageAlpha < 255)
+      a = scale_coverage_sse2(a, ca);
+    a = _mm_or_si128(a, _mm_slli_epi32(a, 16));
+    const __m128i aLo = _mm_unpacklo_epi32(a, a);
+    const __m128i aHi = _mm_unpackhi_epi32(a, a);
+
+    __m128i lo = _mm_unpacklo_epi8(d, zero);
+    __m128i hi = _mm_unpackhi_epi8(d, zero);
+    if (ctx.bgAlpha > 0) {
+      lo = lerp_opaque_sse2(lo, bg, bgA);
+      hi = lerp_opaque_sse2(hi, bg, bgA);
+    }
+    lo = lerp_opaque_sse2(lo, fg, aLo);
+    hi = lerp_opaque_sse2(hi, fg, aHi);
+    _mm_storeu_si128((__m128i*)(dst+i), _mm_packus_epi16(lo, hi));
+  }
+  return i;
+}
+
+#if LAF_HAVE_X86_DISPATCH
+
+LAF_TARGET("avx2")
+inline __m256i div255_floor_avx2(const __m256i x)
+{
+  return _mm256_srli_epi16(
+    _mm256_add_epi16(_mm256_add_epi16(x, _mm256_set1_epi16(1)),
+                     _mm256_srli_epi16(x, 8)), 8);
+}
+
+LAF_TARGET("avx2")
+inline __m256i lerp_opaque_avx2(const __m256i b, const __m256i f, const __m256i a)
+{
+  const __m256i pos = _mm256_mullo_epi16(_mm256_subs_epu16(f, b), a);
+  const __m256i neg = _mm256_mullo_epi16(_mm256_subs_epu16(b, f), a);
+  return _mm256_sub_epi16(_mm256_add_epi16(b, div255_floor_avx2(pos)),
+                          div255_floor_avx2(neg));
+}
+
+LAF_TARGET("avx2")
+inline __m256i scale_coverage_avx2(const __m256i a, const __m256i ca)
+{
+  const __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(a, ca),
+                                     _mm256_set1_epi32(0x80));
+  return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+template<typename Coverage>
+LAF_TARGET("avx2")
+int row_avx2(uint32_t* dst, const typename Coverage::Src* src, int n,
+             const RowContext& ctx)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i alphaMask = _mm256_set1_epi32(ctx.opaque ? 0: ctx.alphaMask);
+  const __m256i fg = _mm256_unpacklo_epi8(_mm256_set1_epi32(ctx.fgPixel), zero);
+  const __m256i bg = _mm256_unpacklo_epi8(_mm256_set1_epi32(ctx.bgPixel), zero);
+  const __m256i bgA = _mm256_set1_epi16(short(ctx.bgAlpha));
+  const __m256i ca = _mm256_set1_epi32(ctx.coverageAlpha);
+
+  int i = 0;
+  for (; i+8 <= n; i += 8) {
+    const __m256i d = _mm256_loadu_si256((const __m256i*)(dst+i));
+    if (_mm256_movemask_epi8(
+          _mm256_cmpeq_epi32(_mm256_and_si256(d, alphaMask), alphaMask)) != -1)
+      break;
+
+    __m256i a = Coverage::load8(ctx, src+i);
+    if (ctx.coverageAlpha < 255)
+      a = scale_coverage_avx2(a, ca);
+    a = _mm256_or_si256(a, _mm256_slli_epi32(a, 16));
+    const __m256i aLo = _mm256_unpacklo_epi32(a, a);
+    const __m256i aHi = _mm256_unpackhi_epi32(a, a);
+
+    // Unpack/pack work on each 128-bit lane, so pixels keep their
+    // order in the packed result.
+    __m256i lo = _mm256_unpacklo_epi8(d, zero);
+    __m256i hi = _mm256_unpackhi_epi8(d, zero);
+    if (ctx.bgAlpha > 0) {
+      lo = lerp_opaque_avx2(lo, bg, bgA);
+      hi = lerp_opaque_avx2(hi, bg, bgA);
+    }
+    lo = lerp_opaque_avx2(lo, fg, aLo);
+    hi = lerp_opaque_avx2(hi, fg, aHi);
+    _mm256_storeu_si256((__m256i*)(dst+i), _mm256_packus_epi16(lo, hi));
+  }
+  return i + row_sse2<Coverage>(dst+i, src+i, n-i, ctx);
+}
+
+#endif // LAF_HAVE_X86_DISPATCH
+
+#elif LAF_HAVE_NEON
+
+inline uint16x8_t div255_floor_neon(const uint16x8_t x)
+{
+  return vshrq_n_u16(vaddq_u16(vaddq_u16(x, vdupq_n_u16(1)),
+                               vshrq_n_u16(x, 8)), 8);
+}
+
+inline uint16x8_t lerp_opaque_neon(const uint16x8_t b, const uint16x8_t f, const uint16x8_t a)
+{
+  const uint16x8_t pos = vmulq_u16(vqsubq_u16(f, b), a);
+  const uint16x8_t neg = vmulq_u16(vqsubq_u16(b, f), a);
+  return vsubq_u16(vaddq_u16(b, div255_floor_neon(pos)),
+                   div255_floor_neon(neg));
+}
+
+inline uint32x4_t scale_coverage_neon(const uint32x4_t a, const uint32x4_t ca)
+{
+  const uint32x4_t t = vaddq_u32(vmulq_u32(a, ca), vdupq_n_u32(0x80));
+  return vshrq_n_u32(vaddq_u32(t, vshrq_n_u32(t, 8)), 8);
+}
+
+template<typename Coverage>
+int row_neon(uint32_t* dst, const typename Coverage::Src* src, int n,
+             const RowContext& ctx)
+{
+  const uint32x4_t alphaMask = vdupq_n_u32(ctx.opaque ? 0: ctx.alphaMask);
+  const uint16x8_t fg = vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(ctx.fgPixel)));
+  const uint16x8_t bg = vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(ctx.bgPixel)));
+  const uint16x8_t bgA = vdupq_n_u16(uint16_t(ctx.bgAlpha));
+  const uint32x4_t ca = vdupq_n_u32(ctx.coverageAlpha);
+
+  int i = 0;
+  for (; i+4 <= n; i += 4) {
+    const uint32x4_t d = vld1q_u32(dst+i);
+    if (vminvq_u32(vceqq_u32(vandq_u32(d, alphaMask), alphaMask)) == 0)
+      break;
+
+    uint32x4_t a = Coverage::load4(ctx, src+i);
+    if (ctx.coverageAlpha < 255)
+      a = scale_coverage_neon(a, ca);
+    a = vorrq_u32(a, vshlq_n_u32(a, 16));
+    const uint16x8_t aLo = vreinterpretq_u16_u32(vzip1q_u32(a, a));
+    const uint16x8_t aHi = vreinterpretq_u16_u32(vzip2q_u32(a, a));
+
+    const uint8x16_t d8 = vreinterpretq_u8_u32(d);
+    uint16x8_t lo = vmovl_u8(vget_low_u8(d8));
+    uint16x8_t hi = vmovl_u8(vget_high_u8(d8));
+    if (ctx.bgAlpha > 0) {
+      lo = lerp_opaque_neon(lo, bg, bgA);
+      hi = lerp_opaque_neon(hi, bg, bgA);
+    }
+    lo = lerp_opaque_neon(lo, fg, aLo);
+    hi = lerp_opaque_neon(hi, fg, aHi);
+    vst1q_u32(dst+i, vreinterpretq_u32_u8(vcombine_u8(vmovn_u16(lo),
+                                                      vmovn_u16(hi))));
+  }
+  return i;
+}
+
+#else
+
+template<typename Coverage>
+int row_scalar(uint32_t* dst, const typename Coverage::Src* src, int n,
+               const RowContext& ctx)
+{
+  return 0;
+}
+
+#endif
+
+// SIMD kernels process blocks of pixels while all the destination
+// pixels are opaque and return the number of processed pixels. The
+// rest of the pixels (and the blocks with non-opaque pixels) are
+// handled by composite_pixel().
+template<typename Coverage>
+using RowKernel = int (*)(uint32_t* dst, const typename Coverage::Src* src, int n,
+                          const RowContext& ctx);
+
+template<typename Coverage>
+RowKernel<Coverage> select_kernel()
+{
+#if LAF_HAVE_X86_DISPATCH
+  if (base::get_cpu_features().avx2)
+    return row_avx2<Coverage>;
+#endif
+#if LAF_HAVE_SSE2
+  return row_sse2<Coverage>;
+#elif LAF_HAVE_NEON
+  return row_neon<Coverage>;
+#else
+  return row_scalar<Coverage>;
+#endif
+}
+
+template<typename Coverage>
+void draw_row(uint32_t* dst, const typename Coverage::Src* src, const int n,
+              const RowContext& ctx)
+{
+  static const RowKernel<Coverage> kernel = select_kernel<Coverage>();
+
+  int i = 0;
+  while (i < n) {
+    if (ctx.simd) {
+      i += kernel(dst+i, src+i, n-i, ctx);
+      if (i == n)
+        break;
+    }
+
+    // Composite pixels until the next opaque pixel (or the end)
+    do {
+      dst[i] = composite_pixel(ctx, dst[i],
+                               scale_coverage(ctx, Coverage::get(ctx, src+i)));
+      ++i;
+    } while (i < n && !ctx.opaque && (dst[i] & ctx.alphaMask) != ctx.alphaMask);
+  }
+}
+
+// Each entry contains the 8 pixels of a byte of a 1-bit mask (the
+// most significant bit is the first pixel).
+struct A1Table {
+  uint8_t pixels[256][8];
+  A1Table() {
+    for (int byte=0; byte<256; ++byte)
+      for (int bit=0; bit<8; ++bit)
+        pixels[byte][bit] = ((byte & (0x80 >> bit)) ? 255: 0);
+  }
+};
+
+} // anonymous namespace
+
+void draw_colored_rgba_row(uint32_t* dst, const SurfaceFormatData& dstFormat,
+                           const uint32_t* src, const SurfaceFormatData& srcFormat,
+                           gfx::Color fg, gfx::Color bg, int n,
+                           int maskAlpha)
+{
+  RowContext ctx = make_context(dstFormat, fg, bg);
+  ctx.coverageAlpha = maskAlpha;
+  ctx.srcAlphaMask = srcFormat.alphaMask;
+  ctx.srcAlphaShift = srcFormat.alphaShift;
+  ctx.simd = (ctx.simd &&
+              srcFormat.alphaMask == (0xffu << srcFormat.alphaShift));
+
+  draw_row<RgbaCoverage>(dst, src, n, ctx);
+}
+
+void draw_colored_a8_row(uint32_t* dst, const SurfaceFormatData& dstFormat,
+                         const uint8_t* coverage,
+                         gfx::Color fg, gfx::Color bg, int n)
+{
+  RowContext ctx = make_context(dstFormat, fg, bg);
+  ctx.coverageAlpha = gfx::geta(fg);
+
+  draw_row<A8Coverage>(dst, coverage, n, ctx);
+}
+
+void expand_a1_row(const uint8_t* bits, int x, int n, uint8_t* coverage)
+{
+  static const A1Table table;
+
+  bits += x / 8;
+  x %= 8;
+
+  // First pixels of a partial byte
+  if (x > 0) {
+    const int m = std::min(n, 8-x);
+    std::memcpy(coverage, table.pixels[*bits++] + x, m);
+    coverage += m;
+    n -= m;
+  }
+  for (; n >= 8; n -= 8, coverage += 8)
+    std::memcpy(coverage, table.pixels[*bits++], 8);
+  if (n > 0)
+    std::memcpy(coverage, table.pixels[*bits], n);
+}
+
+} // namespace os
@@ -1,4 +1,5 @@
 // LAF OS Library
+// Copyright (C) 2024  Igara Studio S.A.
 // Copyright (C) 2012-2017  David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -52,6 +53,30 @@ inline gfx::Color blend(const gfx::Color backdrop, gfx::Color src)
 
 } // anoynmous namespace
 
+// Draws n pixels of the "src" row in the "dst" row, using the alpha
+// channel of "src" as a mask to draw the "fg" color over a "bg"
+// fill (both pixel rows must be 32-bit RGBA pixels in the given
+// formats). Gives the same result as the blend() function for
+// opaque and straight alpha "dst" pixels, and uses SrcOver for
+// premultiplied pixels with alpha < 255. The mask can be multiplied
+// by "maskAlpha" (e.g. the alpha of "fg" to draw glyphs).
+void draw_colored_rgba_row(uint32_t* dst, const SurfaceFormatData& dstFormat,
+                           const uint32_t* src, const SurfaceFormatData& srcFormat,
+                           gfx::Color fg, gfx::Color bg, int n,
+                           int maskAlpha = 255);
+
+// Same as draw_colored_rgba_row() with an 8-bit coverage per pixel
+// (e.g. an antialiased glyph bitmap), which is multiplied by the
+// alpha of "fg".
+void draw_colored_a8_row(uint32_t* dst, const SurfaceFormatData& dstFormat,
+                         const uint8_t* coverage,
+                         gfx::Color fg, gfx::Color bg, int n);
+
+// Converts n pixels of a 1-bit mask row (the most significant bit
+// is the first pixel, e.g. FT_PIXEL_MODE_MONO glyphs) starting from
+// the "x" bit to 8-bit coverage values (0 or 255).
+void expand_a1_row(const uint8_t* bits, int x, int n, uint8_t* coverage);
+
 template<typename Base>
 class GenericDrawColoredRgbaSurface : public Base {
 public:
@@ -69,6 +94,21 @@ public:
     ASSERT(format.format == kRgbaSurfaceFormat);
     ASSERT(format.bitsPerPixel == 32);
 
+    // Access the destination pixels directly when it's possible
+    SurfaceFormatData dstFormat;
+    this->getFormat(&dstFormat);
+    if (dstFormat.format == kRgbaSurfaceFormat &&
+        dstFormat.bitsPerPixel == 32 &&
+        this->getData(0, 0)) {
+      for (int v=0; v<clip.size.h; ++v) {
+        draw_colored_rgba_row(
+          (uint32_t*)this->getData(clip.dst.x, clip.dst.y+v), dstFormat,
+          (const uint32_t*)src->getData(clip.src.x, clip.src.y+v), format,
+          fg, bg, clip.size.w);
+      }
+      return;
+    }
+
     for (int v=0; v<clip.size.h; ++v) {
       const uint32_t* ptr = (const uint32_t*)src->getData(
         clip.src.x, clip.src.y+v);
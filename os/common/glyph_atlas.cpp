@@ -0,0 +1,167 @@
+// LAF OS Library
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "os/common/glyph_atlas.h"
+
+#include "base/debug.h"
+#include "os/common/generic_surface.h"
+#include "os/system.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace os {
+
+GlyphAtlas::GlyphAtlas(int size)
+  : m_allocator(gfx::Size(size, size))
+{
+  if (System* system = instance())
+    m_surface = system->makeRgbaSurface(size, size);
+}
+
+const gfx::Rect* GlyphAtlas::find(Key key)
+{
+  auto it = m_glyphs.find(key);
+  if (it == m_glyphs.end())
+    return nullptr;
+
+  Entry& entry = it->second;
+  entry.run = m_run;
+  m_lru.splice(m_lru.begin(), m_lru, entry.lru);
+  return &entry.bounds;
+}
+
+const gfx::Rect* GlyphAtlas::add(Key key, const gfx::Size& size,
+                                 const uint8_t* bitmap, int pitch, bool mono)
+{
+  ASSERT(m_glyphs.find(key) == m_glyphs.end());
+  if (!m_surface ||
+      size.w <= 0 || size.w > m_allocator.size().w ||
+      size.h <= 0 || size.h > m_allocator.size().h)
+    return nullptr;
+
+  gfx::AtlasAllocator::Id id;
+  bool compacted = false;
+  while ((id = m_allocator.allocate(size)) == gfx::AtlasAllocator::kNoId) {
+    if (evictLeastRecentlyUsed())
+      continue;
+
+    // The free space can be fragmented between the glyphs of the
+    // current run
+    if (compacted || !compact())
+      return nullptr;
+    compacted = true;
+  }
+
+  const gfx::Rect bounds(m_allocator.rect(id).origin(), size);
+
+  SurfaceLock lock(m_surface.get());
+  if (!m_surface->getData(bounds.x, bounds.y)) {
+    m_allocator.free(id);
+    return nullptr;
+  }
+
+  // Glyph pixels are white with the coverage as alpha (for
+  // premultiplied surfaces all components are the coverage).
+  SurfaceFormatData fd;
+  m_surface->getFormat(&fd);
+  const uint32_t rgbMask = (fd.redMask | fd.greenMask | fd.blueMask);
+  const bool premultiplied = (fd.pixelAlpha == PixelAlpha::kPremultiplied);
+
+  std::vector<uint8_t> coverage(mono ? size.w: 0);
+  for (int v=0; v<size.h; ++v) {
+    const uint8_t* p = bitmap + v*pitch;
+    if (mono) {
+      expand_a1_row(p, 0, size.w, coverage.data());
+      p = coverage.data();
+    }
+
+    uint32_t* dst = (uint32_t*)m_surface->getData(bounds.x, bounds.y+v);
+    for (int u=0; u<size.w; ++u, ++p) {
+      const uint32_t a = *p;
+      *dst++ = (((a << fd.alphaShift) & fd.alphaMask) |
+                (premultiplied ? (a * 0x01010101u) & rgbMask: rgbMask));
+    }
+  }
+
+  m_lru.push_front(key);
+  Entry& entry = m_glyphs[key];
+  entry.id = id;
+  entry.bounds = bounds;
+  entry.run = m_run;
+  entry.lru = m_lru.begin();
+  return &entry.bounds;
+}
+
+void GlyphAtlas::clear()
+{
+  m_allocator.clear();
+  m_glyphs.clear();
+  m_lru.clear();
+}
+
+bool GlyphAtlas::evictLeastRecentlyUsed()
+{
+  if (m_lru.empty())
+    return false;
+
+  auto it = m_glyphs.find(m_lru.back());
+  ASSERT(it != m_glyphs.end());
+
+  // Glyphs of the current run cannot be evicted
+  if (it->second.run == m_run)
+    return false;
+
+  m_allocator.free(it->second.id);
+  m_glyphs.erase(it);
+  m_lru.pop_back();
+  return true;
+}
+
+bool GlyphAtlas::compact()
+{
+  SurfaceLock lock(m_surface.get());
+  if (!m_surface->getData(0, 0))
+    return false;
+
+  const std::vector<gfx::AtlasAllocator::Move> moves = m_allocator.compact();
+  if (moves.empty())
+    return false;
+
+  // Moves can overlap, so the pixels of all moved glyphs are copied
+  // before writing them in their new positions.
+  std::vector<uint32_t> pixels;
+  for (const auto& move : moves) {
+    for (int v=0; v<move.from.h; ++v) {
+      const uint32_t* src = (const uint32_t*)m_surface->getData(move.from.x, move.from.y+v);
+      pixels.insert(pixels.end(), src, src+move.from.w);
+    }
+  }
+  const uint32_t* src = pixels.data();
+  for (const auto& move : moves) {
+    ASSERT(move.from.size() == move.to.size());
+    for (int v=0; v<move.to.h; ++v, src+=move.to.w) {
+      uint32_t* dst = (uint32_t*)m_surface->getData(move.to.x, move.to.y+v);
+      std::copy(src, src+move.to.w, dst);
+    }
+  }
+
+  std::unordered_map<gfx::AtlasAllocator::Id, Entry*> entries;
+  for (auto& it : m_glyphs)
+    entries[it.second.id] = &it.second;
+  for (const auto& move : moves) {
+    Entry* entry = entries[move.id];
+    ASSERT(entry);
+    entry->bounds.setOrigin(move.to.origin());
+  }
+  return true;
+}
+
+} // namespace os
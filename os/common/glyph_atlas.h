@@ -0,0 +1,85 @@
+// LAF OS Library
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef OS_COMMON_GLYPH_ATLAS_H_INCLUDED
+#define OS_COMMON_GLYPH_ATLAS_H_INCLUDED
+#pragma once
+
+#include "gfx/atlas_allocator.h"
+#include "gfx/rect.h"
+#include "os/surface.h"
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+
+namespace os {
+
+  // Cache of rendered glyphs (of one face with a specific size and
+  // antialiasing) stored in a RGBA surface, where the alpha channel
+  // is the coverage of each glyph pixel (the color is white). The
+  // space is allocated with a gfx::AtlasAllocator, and the least
+  // recently used glyphs are evicted when a new glyph doesn't fit. If
+  // it doesn't fit even after that, the atlas is compacted (moving
+  // the remaining glyphs) to remove fragmentation.
+  //
+  // Glyphs used in the current run (see beginRun()) are never
+  // evicted, so they can be composited at once at the end of the
+  // run. Their bounds can be moved by add() though, so the returned
+  // pointers must be used (instead of copies of the rectangles).
+  class GlyphAtlas {
+  public:
+    using Key = uint32_t;       // Glyph index
+    static constexpr int kDefaultSize = 512;
+
+    explicit GlyphAtlas(int size = kDefaultSize);
+
+    // Returns the surface with the glyphs (nullptr if it cannot be
+    // created).
+    Surface* surface() const { return m_surface.get(); }
+
+    // Starts a new run, i.e. glyphs of previous runs can be evicted.
+    void beginRun() { ++m_run; }
+
+    // Returns the bounds of the glyph in the surface (and marks it as
+    // used in the current run), or nullptr if it isn't in the atlas.
+    const gfx::Rect* find(Key key);
+
+    // Adds a glyph from a 8-bit coverage bitmap (or a 1-bit bitmap if
+    // "mono" is true, where the most significant bit is the first
+    // pixel). Returns nullptr if there is no room for the glyph even
+    // after evicting the glyphs of previous runs and compacting the
+    // atlas (the caller can composite the current run, call
+    // beginRun(), and try again).
+    const gfx::Rect* add(Key key, const gfx::Size& size,
+                         const uint8_t* bitmap, int pitch, bool mono);
+
+    void clear();
+
+    int glyphCount() const { return int(m_glyphs.size()); }
+
+  private:
+    struct Entry {
+      gfx::AtlasAllocator::Id id;
+      gfx::Rect bounds;
+      uint64_t run;
+      std::list<Key>::iterator lru;
+    };
+
+    bool evictLeastRecentlyUsed();
+    bool compact();
+
+    gfx::AtlasAllocator m_allocator;
+    SurfaceRef m_surface;
+    std::unordered_map<Key, Entry> m_glyphs;
+    // Glyphs sorted from the most recently used to the least one
+    std::list<Key> m_lru;
+    uint64_t m_run = 0;
+  };
+
+} // namespace os
+
+#endif
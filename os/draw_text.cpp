@@ -1,5 +1,5 @@
 // LAF OS Library
-// Copyright (C) 2020-2022  Igara Studio S.A.
+// Copyright (C) 2020-2024  Igara Studio S.A.
 // Copyright (C) 2017  David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -11,47 +11,198 @@
 
 #include "os/draw_text.h"
 
+#include "base/trace.h"
 #include "ft/algorithm.h"
 #include "ft/hb_shaper.h"
 #include "gfx/clip.h"
 #include "os/common/freetype_font.h"
 #include "os/common/generic_surface.h"
+#include "os/common/glyph_atlas.h"
 #include "os/common/sprite_sheet_font.h"
 
+#include <cmath>
+#include <vector>
+
 namespace os {
 
-gfx::Rect draw_text(Surface* surface, Font* font,
-                    const std::string& text,
+namespace {
+
+// Glyph to be composited from the glyph atlas.
+struct AtlasGlyph {
+  // The source point is relative to the glyph bounds in the atlas,
+  // which are read when the glyph is composited (glyphs can be moved
+  // when the atlas is compacted).
+  gfx::Clip clip;
+  const gfx::Rect* bounds;
+  gfx::Color fg;
+  gfx::Color bg;
+};
+
+// Composites all the given glyphs from the atlas at once (locking the
+// atlas only one time per run), and clears the list.
+void draw_atlas_glyphs(Surface* surface, const SurfaceFormatData& fd,
+                       Surface* atlas, std::vector<AtlasGlyph>& glyphs)
+{
+  if (glyphs.empty())
+    return;
+
+  SurfaceLock lock(atlas);
+  if (fd.format == kRgbaSurfaceFormat &&
+      fd.bitsPerPixel == 32 &&
+      surface->getData(0, 0)) {
+    SurfaceFormatData atlasFormat;
+    atlas->getFormat(&atlasFormat);
+
+    for (const AtlasGlyph& g : glyphs) {
+      const gfx::Point src = g.bounds->origin() + g.clip.src;
+      for (int v=0; v<g.clip.size.h; ++v) {
+        draw_colored_rgba_row(
+          (uint32_t*)surface->getData(g.clip.dst.x, g.clip.dst.y+v), fd,
+          (const uint32_t*)atlas->getData(src.x, src.y+v), atlasFormat,
+          g.fg, g.bg, g.clip.size.w, gfx::geta(g.fg));
+      }
+    }
+  }
+  // We cannot access the pixels directly (e.g. GPU-accelerated
+  // surfaces)
+  else {
+    for (const AtlasGlyph& g : glyphs) {
+      gfx::Clip clip = g.clip;
+      clip.src += g.bounds->origin();
+      surface->drawColoredRgbaSurface(atlas, g.fg, g.bg, clip);
+    }
+  }
+  glyphs.clear();
+}
+
+// Composites a glyph directly from its FreeType bitmap (the glyph
+// is clipped once, then each row is composited with the SIMD
+// kernels of draw_colored_a8_row()).
+void draw_glyph_bitmap(Surface* surface, const SurfaceFormatData& fd,
+                       const FT_Bitmap* bitmap,
+                       const gfx::Rect& origDstBounds,
+                       const gfx::Rect& dstBounds,
+                       gfx::Color fg, gfx::Color bg,
+                       std::vector<uint8_t>& coverage)
+{
+  const bool mono = (bitmap->pixel_mode == FT_PIXEL_MODE_MONO);
+  const int clippedRows = dstBounds.y - origDstBounds.y;
+  const int clippedCols = dstBounds.x - origDstBounds.x;
+  for (int v=0; v<dstBounds.h; ++v) {
+    uint32_t* dst_address =
+      (uint32_t*)surface->getData(dstBounds.x, dstBounds.y+v);
+
+    // TODO maybe if we are trying to draw in a SkiaSurface with a nullptr m_bitmap
+    //      (when GPU-acceleration is enabled)
+    if (!dst_address)
+      break;
+
+    const uint8_t* p = bitmap->buffer
+      + (v+clippedRows)*bitmap->pitch;
+    if (mono) {
+      coverage.resize(dstBounds.w);
+      expand_a1_row(p, clippedCols, dstBounds.w, coverage.data());
+      p = coverage.data();
+    }
+    else
+      p += clippedCols;
+
+    draw_colored_a8_row(dst_address, fd, p, fg, bg, dstBounds.w);
+  }
+}
+
+// Draws a glyph scaling its signed distance field (rendered at the
+// base size of the face SDF cache) to the current size of the face.
+// The coverage of each row is calculated from the field and then
+// composited with draw_colored_a8_row(). Returns false if the glyph
+// doesn't have a SDF (e.g. bitmap-only glyphs), so it must be drawn
+// from its rendered bitmap.
+bool draw_sdf_glyph(Surface* surface, const SurfaceFormatData& fd,
+                    FreeTypeFont::Face& face,
+                    const FreeTypeFont::Face::Glyph* glyph,
+                    const int x, const int y,
+                    const gfx::Rect& glyphBounds,
+                    const gfx::Rect& clipBounds,
                     gfx::Color fg, gfx::Color bg,
-                    int x, int y,
-                    DrawTextDelegate* delegate)
+                    std::vector<uint8_t>& coverage)
 {
-  base::utf8_decode decode(text);
-  gfx::Rect textBounds;
+  const ft::SdfGlyph* sdf = face.sdfCache().glyph(face, glyph->glyph_index);
+  if (!sdf)
+    return false;
+  if (sdf->field.empty())
+    return true;
+
+  const double scale = double(face->size->metrics.y_ppem) / sdf->baseSize;
+
+  // Top-left corner of the field in the surface (from the pen
+  // position and the baseline)
+  const double originX = x + glyph->x - glyph->bearingX + sdf->left*scale;
+  const double originY = y + glyph->y + glyph->bearingY - sdf->top*scale;
+
+  gfx::Rect dstBounds(int(std::floor(originX)),
+                      int(std::floor(originY)),
+                      int(std::ceil(sdf->width*scale)) + 1,
+                      int(std::ceil(sdf->rows*scale)) + 1);
+  dstBounds &= clipBounds;
+  if (dstBounds.isEmpty())
+    return true;
+
+  // The field is bigger than the glyph bitmap (it includes the
+  // spread), so the background is painted only in the glyph bounds
+  // (as with rendered glyphs), in other case we would paint over the
+  // edges of the previous glyph.
+  gfx::Rect bgBounds = glyphBounds & dstBounds;
+  if (gfx::geta(bg) == 0)
+    bgBounds = gfx::Rect();
+  const int bgBegin = bgBounds.x - dstBounds.x;
+  const int bgEnd = bgBounds.x2() - dstBounds.x;
+
+  coverage.resize(dstBounds.w);
+
+  // Position in the field of the center of the first pixel of each row
+  const double fx = (dstBounds.x + 0.5 - originX) / scale - 0.5;
+  for (int v=0; v<dstBounds.h; ++v) {
+    uint32_t* dst_address =
+      (uint32_t*)surface->getData(dstBounds.x, dstBounds.y+v);
+    if (!dst_address)
+      break;
 
-retry:;
-  // Check if this font is enough to draw the given string or we will
-  // need the fallback for some special Unicode chars
-  if (font->fallback()) {
-    // TODO compose unicode characters and check those codepoints, the
-    //      same in the drawing code of sprite sheet font
-    while (const uint32_t code = decode.next()) {
-      if (code && !font->hasCodePoint(code)) {
-        Font* newFont = font->fallback();
-
-        // Search a valid fallback
-        while (newFont && !newFont->hasCodePoint(code))
-          newFont = newFont->fallback();
-        if (!newFont)
-          break;
+    const double fy = (dstBounds.y + v + 0.5 - originY) / scale - 0.5;
+    ft::sdf_coverage_row(*sdf, scale, fx, fy, dstBounds.w, coverage.data());
 
-        y += font->height()/2 - newFont->height()/2;
+    const int row = dstBounds.y + v;
+    if (bgBounds.isEmpty() || row < bgBounds.y || row >= bgBounds.y2()) {
+      draw_colored_a8_row(dst_address, fd, coverage.data(),
+                          fg, gfx::ColorNone, dstBounds.w);
+      continue;
+    }
 
-        font = newFont;
-        goto retry;
-      }
+    if (bgBegin > 0) {
+      draw_colored_a8_row(dst_address, fd, coverage.data(),
+                          fg, gfx::ColorNone, bgBegin);
+    }
+    draw_colored_a8_row(dst_address+bgBegin, fd, coverage.data()+bgBegin,
+                        fg, bg, bgEnd - bgBegin);
+    if (bgEnd < dstBounds.w) {
+      draw_colored_a8_row(dst_address+bgEnd, fd, coverage.data()+bgEnd,
+                          fg, gfx::ColorNone, dstBounds.w - bgEnd);
     }
   }
+  return true;
+}
+
+// Draws a run of text with one font (without fallbacks). "index" is
+// the position of the run in the whole string (for the delegate), and
+// "x" is moved to the end of the run. Returns false if the delegate
+// stopped the process.
+bool draw_run(Surface* surface, Font* font,
+              const std::string& text, const int index,
+              gfx::Color& fg, gfx::Color& bg,
+              int& x, const int y,
+              DrawTextDelegate* delegate,
+              gfx::Rect& textBounds)
+{
+  bool stopped = false;
 
   switch (font->type()) {
 
@@ -68,7 +219,7 @@ retry:;
         surface->lock();
       }
 
-      decode = base::utf8_decode(text);
+      base::utf8_decode decode(text);
       while (true) {
         const int i = decode.pos() - text.begin();
         const int chr = decode.next();
@@ -79,10 +230,12 @@ retry:;
         const gfx::Rect outCharBounds(x, y, charBounds.w, charBounds.h);
 
         if (delegate)
-          delegate->preProcessChar(i, chr, fg, bg, outCharBounds);
+          delegate->preProcessChar(index+i, chr, fg, bg, outCharBounds);
 
-        if (delegate && !delegate->preDrawChar(outCharBounds))
+        if (delegate && !delegate->preDrawChar(outCharBounds)) {
+          stopped = true;
           break;
+        }
 
         if (!charBounds.isEmpty()) {
           if (surface)
@@ -105,7 +258,19 @@ retry:;
 
     case FontType::FreeType: {
       FreeTypeFont* ttFont = static_cast<FreeTypeFont*>(font);
-      const int fg_alpha = gfx::geta(fg);
+      // Coverage of the current row of a FT_PIXEL_MODE_MONO or SDF glyph
+      std::vector<uint8_t> coverage;
+      // Glyphs of the current run that are in the atlas
+      std::vector<AtlasGlyph> atlasGlyphs;
+      GlyphAtlas* atlas = nullptr;
+      double endX = 0.0;
+
+      // Glyphs are drawn from their SDFs, so we don't need to
+      // rasterize them for this size
+      bool sdf = (surface &&
+                  ttFont->sdfRendering() &&
+                  ttFont->face().antialias() &&
+                  ft::is_sdf_supported());
 
       gfx::Rect clipBounds;
       os::SurfaceFormatData fd;
@@ -113,9 +278,27 @@ retry:;
         clipBounds = surface->getClipBounds();
         surface->getFormat(&fd);
         surface->lock();
+
+        // SDF coverage is composited directly in the surface pixels,
+        // surfaces without pixel access (e.g. GPU-accelerated Skia
+        // surfaces) use the glyph atlas path
+        if (sdf && !surface->getData(0, 0))
+          sdf = false;
+
+        // The atlas is available only in the thread that created
+        // the font
+        if (!sdf)
+          atlas = ttFont->glyphAtlas();
+        if (atlas && atlas->surface())
+          atlas->beginRun();
+        else
+          atlas = nullptr;
       }
 
-      ft::ForEachGlyph<FreeTypeFont::Face> feg(ttFont->face(), text);
+      // Without surface we just measure the text (glyphs are not
+      // rendered)
+      ft::ForEachGlyph<FreeTypeFont::Face> feg(ttFont->face(), text,
+                                               !surface || sdf);
       while (feg.next()) {
         gfx::Rect origDstBounds;
         const auto* glyph = feg.glyph();
@@ -128,7 +311,7 @@ retry:;
 
         if (delegate) {
           delegate->preProcessChar(
-            feg.charIndex(),
+            index + feg.charIndex(),
             feg.unicodeChar(),
             fg, bg, origDstBounds);
         }
@@ -136,8 +319,13 @@ retry:;
         if (!glyph)
           continue;
 
-        if (delegate && !delegate->preDrawChar(origDstBounds))
+        if (delegate && !delegate->preDrawChar(origDstBounds)) {
+          stopped = true;
           break;
+        }
+
+        // Pen position after this glyph
+        endX = glyph->endX;
 
         origDstBounds.x = x + int(glyph->x);
         origDstBounds.w = int(glyph->bitmap->width);
@@ -147,93 +335,160 @@ retry:;
         if (surface)
           dstBounds &= clipBounds;
 
-        if (surface && !dstBounds.isEmpty()) {
-          const int clippedRows = dstBounds.y - origDstBounds.y;
-          int dst_y = dstBounds.y;
-          int t;
-          for (int v=0; v<dstBounds.h; ++v, ++dst_y) {
-            int bit = 0;
-            const uint8_t* p = glyph->bitmap->buffer
-              + (v+clippedRows)*glyph->bitmap->pitch;
-            int dst_x = dstBounds.x;
-            uint32_t* dst_address =
-              (uint32_t*)surface->getData(dst_x, dst_y);
-
-            // TODO maybe if we are trying to draw in a SkiaSurface with a nullptr m_bitmap
-            //      (when GPU-acceleration is enabled)
-            if (!dst_address)
-              break;
-
-            // Skip first clipped pixels
-            for (int u=0; u<dstBounds.x-origDstBounds.x; ++u) {
-              if (glyph->bitmap->pixel_mode == FT_PIXEL_MODE_GRAY) {
-                ++p;
-              }
-              else if (glyph->bitmap->pixel_mode == FT_PIXEL_MODE_MONO) {
-                if (++bit == 8) {
-                  bit = 0;
-                  ++p;
-                }
+        const FT_Bitmap* bitmap = glyph->bitmap;
+        const bool mono = (bitmap->pixel_mode == FT_PIXEL_MODE_MONO);
+        if (sdf) {
+          if (!draw_sdf_glyph(surface, fd, ttFont->face(), glyph, x, y,
+                              origDstBounds, clipBounds, fg, bg, coverage)) {
+            // The run was loaded without rendering the glyphs, so we
+            // render this one now
+            FreeTypeFont::Face& face = ttFont->face();
+            auto* rendered = face.cache().loadGlyph(face, glyph->glyph_index,
+                                                    face.antialias());
+            if (rendered) {
+              const FT_Bitmap* renderedBitmap = rendered->bitmap;
+              const gfx::Rect renderedBounds(origDstBounds.x, origDstBounds.y,
+                                             int(renderedBitmap->width),
+                                             int(renderedBitmap->rows));
+              const gfx::Rect renderedDstBounds = renderedBounds & clipBounds;
+              if (!renderedDstBounds.isEmpty() &&
+                  (renderedBitmap->pixel_mode == FT_PIXEL_MODE_MONO ||
+                   renderedBitmap->pixel_mode == FT_PIXEL_MODE_GRAY)) {
+                draw_glyph_bitmap(surface, fd, renderedBitmap,
+                                  renderedBounds, renderedDstBounds,
+                                  fg, bg, coverage);
               }
+              face.cache().doneGlyph(rendered);
             }
-
-            for (int u=0; u<dstBounds.w; ++u, ++dst_x) {
-              ASSERT(clipBounds.contains(gfx::Point(dst_x, dst_y)));
-
-              int alpha;
-              if (glyph->bitmap->pixel_mode == FT_PIXEL_MODE_GRAY) {
-                alpha = *(p++);
-              }
-              else if (glyph->bitmap->pixel_mode == FT_PIXEL_MODE_MONO) {
-                alpha = ((*p) & (1 << (7 - (bit++))) ? 255: 0);
-                if (bit == 8) {
-                  bit = 0;
-                  ++p;
-                }
+          }
+        }
+        else if (surface && !dstBounds.isEmpty() &&
+            (mono || bitmap->pixel_mode == FT_PIXEL_MODE_GRAY)) {
+          // Glyphs are rendered in the atlas only the first time
+          const gfx::Rect* rc = nullptr;
+          if (atlas) {
+            rc = atlas->find(glyph->glyph_index);
+            if (!rc) {
+              const gfx::Size size(origDstBounds.w, origDstBounds.h);
+              rc = atlas->add(glyph->glyph_index, size,
+                              bitmap->buffer, bitmap->pitch, mono);
+
+              // If there is no room, we composite the current run so
+              // its glyphs can be evicted too.
+              if (!rc && !atlasGlyphs.empty()) {
+                draw_atlas_glyphs(surface, fd, atlas->surface(), atlasGlyphs);
+                atlas->beginRun();
+                rc = atlas->add(glyph->glyph_index, size,
+                                bitmap->buffer, bitmap->pitch, mono);
               }
-
-              const uint32_t backdrop = *dst_address;
-              const gfx::Color backdropColor =
-                gfx::rgba(
-                  ((backdrop & fd.redMask) >> fd.redShift),
-                  ((backdrop & fd.greenMask) >> fd.greenShift),
-                  ((backdrop & fd.blueMask) >> fd.blueShift),
-                  ((backdrop & fd.alphaMask) >> fd.alphaShift));
-
-              gfx::Color output = gfx::rgba(gfx::getr(fg),
-                                            gfx::getg(fg),
-                                            gfx::getb(fg),
-                                            MUL_UN8(fg_alpha, alpha, t));
-              if (gfx::geta(bg) > 0)
-                output = blend(blend(backdropColor, bg), output);
-              else
-                output = blend(backdropColor, output);
-
-              *dst_address =
-                ((gfx::getr(output) << fd.redShift  ) & fd.redMask  ) |
-                ((gfx::getg(output) << fd.greenShift) & fd.greenMask) |
-                ((gfx::getb(output) << fd.blueShift ) & fd.blueMask ) |
-                ((gfx::geta(output) << fd.alphaShift) & fd.alphaMask);
-
-              ++dst_address;
             }
           }
+
+          if (rc) {
+            atlasGlyphs.push_back(
+              AtlasGlyph{
+                gfx::Clip(dstBounds.origin(),
+                          gfx::Rect(dstBounds.x - origDstBounds.x,
+                                    dstBounds.y - origDstBounds.y,
+                                    dstBounds.w, dstBounds.h)),
+                rc, fg, bg });
+          }
+          // The glyph doesn't fit in the atlas
+          else {
+            // Keep the drawing order of the glyphs
+            if (atlas)
+              draw_atlas_glyphs(surface, fd, atlas->surface(), atlasGlyphs);
+            draw_glyph_bitmap(surface, fd, bitmap, origDstBounds, dstBounds,
+                              fg, bg, coverage);
+          }
         }
 
         if (!origDstBounds.w) origDstBounds.w = 1;
         if (!origDstBounds.h) origDstBounds.h = 1;
         textBounds |= origDstBounds;
-        if (delegate)
+        if (delegate) {
+          // The delegate can draw over this glyph (e.g. a caret or an
+          // underline), so it must be composited before.
+          if (atlas)
+            draw_atlas_glyphs(surface, fd, atlas->surface(), atlasGlyphs);
           delegate->postDrawChar(origDstBounds);
+        }
       }
 
-      if (surface)
+      if (surface) {
+        if (atlas)
+          draw_atlas_glyphs(surface, fd, atlas->surface(), atlasGlyphs);
         surface->unlock();
+      }
+      x += int(endX);
       break;
     }
 
   }
 
+  return !stopped;
+}
+
+} // anonymous namespace
+
+gfx::Rect draw_text(Surface* surface, Font* font,
+                    const std::string& text,
+                    gfx::Color fg, gfx::Color bg,
+                    int x, int y,
+                    DrawTextDelegate* delegate)
+{
+  LAF_TRACE_ZONE("os::draw_text");
+  gfx::Rect textBounds;
+
+  if (!font->fallback()) {
+    draw_run(surface, font, text, 0, fg, bg, x, y, delegate, textBounds);
+    return textBounds;
+  }
+
+  // Split the text in runs of characters that can be drawn with the
+  // same font (the given font, or the first fallback that has the
+  // character) in one pass, and draw each run with its font.
+  //
+  // TODO compose unicode characters and check those codepoints, the
+  //      same in the drawing code of sprite sheet font
+  base::utf8_decode decode(text);
+  Font* runFont = nullptr;
+  int runBegin = 0;
+  while (true) {
+    const int pos = decode.pos() - text.begin();
+    const int chr = decode.next();
+
+    Font* chrFont = nullptr;
+    if (chr) {
+      chrFont = font;
+      if (!font->hasCodePoint(chr)) {
+        for (Font* f=font->fallback(); f; f=f->fallback()) {
+          if (f->hasCodePoint(chr)) {
+            chrFont = f;
+            break;
+          }
+        }
+      }
+    }
+
+    if (chrFont != runFont) {
+      if (runFont) {
+        const bool whole = (runBegin == 0 && !chr);
+        if (!draw_run(surface, runFont,
+                      (whole ? text: text.substr(runBegin, pos-runBegin)),
+                      runBegin, fg, bg, x,
+                      y + font->height()/2 - runFont->height()/2,
+                      delegate, textBounds))
+          break;
+      }
+      runFont = chrFont;
+      runBegin = pos;
+    }
+
+    if (!chr)
+      break;
+  }
+
   return textBounds;
 }
 
@@ -1,5 +1,5 @@
 // LAF OS Library
-// Copyright (C) 2021  Igara Studio S.A.
+// Copyright (C) 2021-2024  Igara Studio S.A.
 // Copyright (C) 2012-2018  David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -20,7 +20,8 @@ namespace os {
     virtual ~EventQueue() { }
 
     // Wait for a new event. We can specify a timeout in seconds to
-    // limit the time of wait for the next event.
+    // limit the time of wait for the next event (fractions of a
+    // millisecond are supported, e.g. 0.0005 to wait 500us).
     virtual void getEvent(Event& ev, double timeout = kWithoutTimeout) = 0;
 
     // Adds a new event in the queue to be processed by
@@ -0,0 +1,183 @@
+// LAF OS Library
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "os/common/generic_surface.h"
+
+#include <random>
+#include <vector>
+
+using namespace os;
+
+static SurfaceFormatData make_format(bool bgra, PixelAlpha pixelAlpha)
+{
+  SurfaceFormatData fmt;
+  fmt.format = kRgbaSurfaceFormat;
+  fmt.bitsPerPixel = 32;
+  fmt.redShift = (bgra ? 16: 0);
+  fmt.greenShift = 8;
+  fmt.blueShift = (bgra ? 0: 16);
+  fmt.alphaShift = 24;
+  fmt.redMask = 0xff << fmt.redShift;
+  fmt.greenMask = 0xff << fmt.greenShift;
+  fmt.blueMask = 0xff << fmt.blueShift;
+  fmt.alphaMask = 0xffu << fmt.alphaShift;
+  fmt.pixelAlpha = pixelAlpha;
+  return fmt;
+}
+
+static gfx::Color get_color(const SurfaceFormatData& fmt, uint32_t p)
+{
+  return gfx::rgba((p & fmt.redMask) >> fmt.redShift,
+                   (p & fmt.greenMask) >> fmt.greenShift,
+                   (p & fmt.blueMask) >> fmt.blueShift,
+                   (p & fmt.alphaMask) >> fmt.alphaShift);
+}
+
+static uint32_t make_pixel(const SurfaceFormatData& fmt, gfx::Color c)
+{
+  return ((gfx::getr(c) << fmt.redShift) |
+          (gfx::getg(c) << fmt.greenShift) |
+          (gfx::getb(c) << fmt.blueShift) |
+          (uint32_t(gfx::geta(c)) << fmt.alphaShift));
+}
+
+// Per-pixel loop of GenericDrawColoredRgbaSurface with straight
+// colors (what getPixel()/putPixel() return/receive), or the per-pixel
+// loop of os::draw_text() for 8-bit glyphs (where the alpha of "fg"
+// is used).
+static gfx::Color reference(gfx::Color dstColor, uint32_t mask,
+                            gfx::Color fg, gfx::Color bg, bool a8)
+{
+  if (a8) {
+    int t;
+    mask = MUL_UN8(gfx::geta(fg), mask, t);
+  }
+  if (gfx::geta(bg) > 0)
+    dstColor = blend(dstColor, bg);
+  if (mask > 0)
+    dstColor = blend(dstColor, gfx::rgba(gfx::getr(fg),
+                                         gfx::getg(fg),
+                                         gfx::getb(fg), mask));
+  return dstColor;
+}
+
+static void test_rows(bool bgra, PixelAlpha pixelAlpha, bool opaqueDst,
+                      bool a8 = false)
+{
+  std::mt19937 rng(42);
+  const SurfaceFormatData dstFmt = make_format(bgra, pixelAlpha);
+  const SurfaceFormatData srcFmt = make_format(false, PixelAlpha::kPremultiplied);
+  const int bgAlphas[] = { 0, 1, 128, 254, 255 };
+
+  for (int n=1; n<=40; ++n) {
+    for (int bgAlpha : bgAlphas) {
+      const gfx::Color fg = rng();
+      const gfx::Color bg = (rng() & gfx::ColorRGBMask) | (bgAlpha << gfx::ColorAShift);
+
+      std::vector<uint32_t> src(n), dst(n);
+      std::vector<uint8_t> coverage(n);
+      std::vector<gfx::Color> expected(n);
+      for (int i=0; i<n; ++i) {
+        // Masks with a lot of 0 and 255 values
+        uint32_t a = rng() % 512;
+        a = (a < 128 ? 0: a >= 384 ? 255: a-128);
+        src[i] = (a << 24) | (a << 16) | (a << 8) | a;
+        coverage[i] = a;
+
+        gfx::Color d = rng();
+        if (opaqueDst)
+          d |= gfx::ColorAMask;
+        dst[i] = make_pixel(dstFmt, d);
+        expected[i] = reference(d, a, fg, bg, a8);
+      }
+
+      if (a8)
+        draw_colored_a8_row(dst.data(), dstFmt, coverage.data(), fg, bg, n);
+      else
+        draw_colored_rgba_row(dst.data(), dstFmt, src.data(), srcFmt,
+                              fg, bg, n);
+      for (int i=0; i<n; ++i)
+        ASSERT_EQ(expected[i], get_color(dstFmt, dst[i]))
+          << "n=" << n << " i=" << i << " bgAlpha=" << bgAlpha;
+    }
+  }
+}
+
+TEST(GenericSurface, OpaqueDst)
+{
+  test_rows(false, PixelAlpha::kPremultiplied, true);
+  test_rows(true, PixelAlpha::kPremultiplied, true);
+  test_rows(false, PixelAlpha::kStraight, true);
+  test_rows(true, PixelAlpha::kOpaque, true);
+}
+
+TEST(GenericSurface, StraightDst)
+{
+  test_rows(false, PixelAlpha::kStraight, false);
+  test_rows(true, PixelAlpha::kStraight, false);
+}
+
+TEST(GenericSurface, A8Coverage)
+{
+  test_rows(false, PixelAlpha::kPremultiplied, true, true);
+  test_rows(true, PixelAlpha::kPremultiplied, true, true);
+  test_rows(false, PixelAlpha::kStraight, false, true);
+  test_rows(true, PixelAlpha::kOpaque, true, true);
+}
+
+TEST(GenericSurface, ExpandA1)
+{
+  const uint8_t bits[3] = { 0b10110000, 0b00000001, 0b11000000 };
+  std::vector<uint8_t> coverage(24, 7);
+
+  expand_a1_row(bits, 0, 4, coverage.data());
+  EXPECT_EQ(std::vector<uint8_t>({ 255, 0, 255, 255, 7 }),
+            std::vector<uint8_t>(coverage.begin(), coverage.begin()+5));
+
+  expand_a1_row(bits, 2, 16, coverage.data());
+  EXPECT_EQ(std::vector<uint8_t>({ 255, 255, 0, 0, 0, 0,
+                                   0, 0, 0, 0, 0, 0, 0, 255,
+                                   255, 255, 7 }),
+            std::vector<uint8_t>(coverage.begin(), coverage.begin()+17));
+
+  expand_a1_row(bits, 15, 3, coverage.data());
+  EXPECT_EQ(std::vector<uint8_t>({ 255, 255, 255 }),
+            std::vector<uint8_t>(coverage.begin(), coverage.begin()+3));
+}
+
+TEST(GenericSurface, PremultipliedDst)
+{
+  const SurfaceFormatData fmt = make_format(false, PixelAlpha::kPremultiplied);
+  const gfx::Color fg = gfx::rgba(255, 128, 0);
+
+  // Transparent destination, half of the mask, and without background
+  uint32_t dst[3] = { 0, 0, 0 };
+  const uint32_t src[3] = { 0, 0x80000000, 0xff000000 };
+  draw_colored_rgba_row(dst, fmt, src, fmt, fg, gfx::ColorNone, 3);
+  EXPECT_EQ(0, dst[0]);
+  EXPECT_EQ(gfx::rgba(128, 64, 0, 128), dst[1]);
+  EXPECT_EQ(fg, dst[2]);
+
+  // Semi-transparent background
+  const gfx::Color bg = gfx::rgba(0, 0, 255, 128);
+  uint32_t dst2[3] = { 0, 0, 0 };
+  draw_colored_rgba_row(dst2, fmt, src, fmt, fg, bg, 3);
+  EXPECT_EQ(gfx::rgba(0, 0, 128, 128), dst2[0]);
+  EXPECT_EQ(gfx::rgba(128, 64, 64, 192), dst2[1]);
+  EXPECT_EQ(fg, dst2[2]);
+}
+
+int app_main(int argc, char* argv[])
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
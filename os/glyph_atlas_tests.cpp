@@ -0,0 +1,133 @@
+// LAF OS Library
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "os/common/glyph_atlas.h"
+#include "os/system.h"
+
+#include <utility>
+#include <vector>
+
+using namespace os;
+
+static const uint8_t kGlyph[8*8] = { 0 };
+
+TEST(GlyphAtlas, AddAndFind)
+{
+  GlyphAtlas atlas(16);
+  ASSERT_TRUE(atlas.surface() != nullptr);
+  EXPECT_EQ(nullptr, atlas.find(1));
+
+  const uint8_t gray[2*3] = { 0, 128, 255,
+                              255, 64, 0 };
+  const gfx::Rect* rc = atlas.add(1, gfx::Size(3, 2), gray, 3, false);
+  ASSERT_TRUE(rc != nullptr);
+  EXPECT_EQ(gfx::Size(3, 2), rc->size());
+  EXPECT_EQ(*rc, *atlas.find(1));
+  EXPECT_EQ(1, atlas.glyphCount());
+
+  Surface* sur = atlas.surface();
+  EXPECT_EQ(0, gfx::geta(sur->getPixel(rc->x, rc->y)));
+  EXPECT_EQ(128, gfx::geta(sur->getPixel(rc->x+1, rc->y)));
+  EXPECT_EQ(gfx::rgba(255, 255, 255), sur->getPixel(rc->x+2, rc->y));
+  EXPECT_EQ(64, gfx::geta(sur->getPixel(rc->x+1, rc->y+1)));
+
+  // 1-bit glyph
+  const uint8_t mono[2] = { 0b10100000, 0b01000000 };
+  rc = atlas.add(2, gfx::Size(3, 2), mono, 1, true);
+  ASSERT_TRUE(rc != nullptr);
+  EXPECT_EQ(255, gfx::geta(sur->getPixel(rc->x, rc->y)));
+  EXPECT_EQ(0, gfx::geta(sur->getPixel(rc->x+1, rc->y)));
+  EXPECT_EQ(255, gfx::geta(sur->getPixel(rc->x+2, rc->y)));
+  EXPECT_EQ(0, gfx::geta(sur->getPixel(rc->x, rc->y+1)));
+  EXPECT_EQ(255, gfx::geta(sur->getPixel(rc->x+1, rc->y+1)));
+
+  atlas.clear();
+  EXPECT_EQ(nullptr, atlas.find(1));
+  EXPECT_EQ(0, atlas.glyphCount());
+}
+
+TEST(GlyphAtlas, EvictLeastRecentlyUsed)
+{
+  // Room for 4 glyphs of 8x8
+  GlyphAtlas atlas(16);
+  for (int i=1; i<=4; ++i)
+    ASSERT_TRUE(atlas.add(i, gfx::Size(8, 8), kGlyph, 8, false) != nullptr);
+
+  // All glyphs are used in the current run
+  EXPECT_EQ(nullptr, atlas.add(5, gfx::Size(8, 8), kGlyph, 8, false));
+  EXPECT_EQ(4, atlas.glyphCount());
+
+  atlas.beginRun();
+  EXPECT_TRUE(atlas.find(1) != nullptr);
+  EXPECT_TRUE(atlas.add(5, gfx::Size(8, 8), kGlyph, 8, false) != nullptr);
+  EXPECT_TRUE(atlas.add(6, gfx::Size(8, 8), kGlyph, 8, false) != nullptr);
+  EXPECT_EQ(4, atlas.glyphCount());
+  EXPECT_TRUE(atlas.find(1) != nullptr);
+  EXPECT_EQ(nullptr, atlas.find(2));
+  EXPECT_EQ(nullptr, atlas.find(3));
+  EXPECT_TRUE(atlas.find(4) != nullptr);
+
+  // Bigger than the atlas
+  atlas.beginRun();
+  EXPECT_EQ(nullptr, atlas.add(7, gfx::Size(17, 1), kGlyph, 17, false));
+  EXPECT_EQ(4, atlas.glyphCount());
+}
+
+TEST(GlyphAtlas, Compact)
+{
+  // 8x8 glyphs filled with the glyph key
+  auto glyph = [](int key) {
+    return std::vector<uint8_t>(8*8, uint8_t(key*10));
+  };
+
+  GlyphAtlas atlas(16);
+  for (int i=1; i<=4; ++i)
+    ASSERT_TRUE(atlas.add(i, gfx::Size(8, 8), glyph(i).data(), 8, false) != nullptr);
+
+  // Glyphs 1 and 4 are used in the current run, so the atlas is
+  // fragmented after evicting 2 and 3, and glyph 4 is moved to make
+  // room for a 16x8 glyph
+  atlas.beginRun();
+  const gfx::Rect* rc1 = atlas.find(1);
+  const gfx::Rect* rc4 = atlas.find(4);
+  ASSERT_TRUE(rc1 && rc4);
+  const gfx::Rect old1 = *rc1;
+  const gfx::Rect old4 = *rc4;
+
+  const std::vector<uint8_t> wide(16*8, 50);
+  const gfx::Rect* rc5 = atlas.add(5, gfx::Size(16, 8), wide.data(), 16, false);
+  ASSERT_TRUE(rc5 != nullptr);
+  EXPECT_EQ(3, atlas.glyphCount());
+  EXPECT_EQ(old1, *rc1);
+  EXPECT_NE(old4, *rc4);
+  EXPECT_EQ(rc4, atlas.find(4));
+  EXPECT_FALSE(rc1->intersects(*rc4));
+  EXPECT_FALSE(rc1->intersects(*rc5));
+  EXPECT_FALSE(rc4->intersects(*rc5));
+
+  // Pixels were moved with the glyph
+  Surface* sur = atlas.surface();
+  for (const auto& [rc, a] : { std::make_pair(rc1, 10),
+                               std::make_pair(rc4, 40),
+                               std::make_pair(rc5, 50) }) {
+    for (int y=rc->y; y<rc->y2(); ++y)
+      for (int x=rc->x; x<rc->x2(); ++x)
+        EXPECT_EQ(a, gfx::geta(sur->getPixel(x, y))) << x << "," << y;
+  }
+}
+
+int app_main(int argc, char* argv[])
+{
+  SystemRef system = make_system();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -12,7 +12,9 @@
 #include "base/memory.h"
 #include "base/string.h"
 #include "gfx/size.h"
+#include "os/common/generic_color_space.h"
 #include "os/font.h"
+#include "os/none/surface.h"
 #include "os/system.h"
 #include "os/window.h"
 
@@ -40,12 +42,20 @@ public:
   Window* defaultWindow() override { return nullptr; }
   Ref<Window> makeWindow(const WindowSpec& spec) override { return nullptr; }
   Ref<Surface> makeSurface(int width, int height,
-                           const os::ColorSpaceRef& colorSpace) override { return nullptr; }
+                           const os::ColorSpaceRef& colorSpace) override {
+    auto sur = os::make_ref<NoneSurface>();
+    sur->create(width, height, colorSpace);
+    return sur;
+  }
 #if CLIP_ENABLE_IMAGE
   Ref<Surface> makeSurface(const clip::image& image) override { return nullptr; }
 #endif
   Ref<Surface> makeRgbaSurface(int width, int height,
-                               const os::ColorSpaceRef& colorSpace) override { return nullptr; }
+                               const os::ColorSpaceRef& colorSpace) override {
+    auto sur = os::make_ref<NoneSurface>();
+    sur->createRgba(width, height, colorSpace);
+    return sur;
+  }
   Ref<Surface> loadSurface(const char* filename) override { return nullptr; }
   Ref<Surface> loadRgbaSurface(const char* filename) override { return nullptr; }
   Ref<Cursor> makeCursor(const Surface* surface,
@@ -62,9 +72,15 @@ public:
   void setMousePosition(const gfx::Point& screenPosition) override { }
   gfx::Color getColorFromScreen(const gfx::Point& screenPosition) const override { return gfx::ColorNone; }
   void listColorSpaces(std::vector<os::ColorSpaceRef>& list) override { }
-  os::ColorSpaceRef makeColorSpace(const gfx::ColorSpaceRef& cs) override { return nullptr; }
+  os::ColorSpaceRef makeColorSpace(const gfx::ColorSpaceRef& cs) override {
+    if (!cs)
+      return nullptr;
+    return os::make_ref<GenericColorSpace>(cs);
+  }
   Ref<ColorSpaceConversion> convertBetweenColorSpace(
-    const os::ColorSpaceRef& src, const os::ColorSpaceRef& dst) override { return nullptr; }
+    const os::ColorSpaceRef& src, const os::ColorSpaceRef& dst) override {
+    return GenericColorSpaceConversion::Make(src, dst);
+  }
   void setWindowsColorSpace(const os::ColorSpaceRef& cs) override { }
   os::ColorSpaceRef windowsColorSpace() override { return nullptr; }
 
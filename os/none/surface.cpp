@@ -0,0 +1,839 @@
+// LAF OS Library
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "os/none/surface.h"
+
+#include "base/cpu_features.h"
+#include "base/debug.h"
+#include "gfx/path.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+#if LAF_HAVE_SSE2
+  #include <emmintrin.h>
+#elif LAF_HAVE_NEON
+  #include <arm_neon.h>
+#endif
+
+namespace os {
+
+namespace {
+
+// All kernels use the same integer approximation of x*a/255 (exact
+// for all 8-bit values) so the SIMD and the scalar versions give the
+// same results:
+//
+//   t = x*a + 128
+//   x*a/255 = (t + (t >> 8)) >> 8
+//
+// Two channels are processed at the same time in 16-bit lanes.
+inline uint32_t mul_div255(const uint32_t c, const uint32_t a)
+{
+  uint32_t rb = (c & 0x00ff00ff) * a + 0x00800080;
+  rb = ((rb + ((rb >> 8) & 0x00ff00ff)) >> 8) & 0x00ff00ff;
+  uint32_t ag = ((c >> 8) & 0x00ff00ff) * a + 0x00800080;
+  ag = (ag + ((ag >> 8) & 0x00ff00ff)) & 0xff00ff00;
+  return rb | ag;
+}
+
+inline uint32_t premultiply(const gfx::Color c)
+{
+  const uint32_t a = gfx::geta(c);
+  if (a == 255)
+    return c;
+  return mul_div255(c | gfx::ColorAMask, a);
+}
+
+inline gfx::Color unpremultiply(const uint32_t c)
+{
+  const uint32_t a = (c >> 24);
+  if (a == 255)
+    return c;
+  if (a == 0)
+    return 0;
+  const uint32_t r = ((c & 0xff) * 255 + a/2) / a;
+  const uint32_t g = (((c >> 8) & 0xff) * 255 + a/2) / a;
+  const uint32_t b = (((c >> 16) & 0xff) * 255 + a/2) / a;
+  return gfx::rgba(std::min<uint32_t>(r, 255),
+                   std::min<uint32_t>(g, 255),
+                   std::min<uint32_t>(b, 255), a);
+}
+
+inline uint32_t srcover(const uint32_t src, const uint32_t dst)
+{
+  return src + mul_div255(dst, 255 - (src >> 24));
+}
+
+#if LAF_HAVE_SSE2
+
+inline __m128i mul_div255_sse2(const __m128i c, const __m128i a16)
+{
+  const __m128i half = _mm_set1_epi16(0x80);
+  __m128i rb = _mm_and_si128(c, _mm_set1_epi16(0x00ff));
+  __m128i ag = _mm_srli_epi16(c, 8);
+  rb = _mm_add_epi16(_mm_mullo_epi16(rb, a16), half);
+  ag = _mm_add_epi16(_mm_mullo_epi16(ag, a16), half);
+  rb = _mm_srli_epi16(_mm_add_epi16(rb, _mm_srli_epi16(rb, 8)), 8);
+  ag = _mm_and_si128(_mm_add_epi16(ag, _mm_srli_epi16(ag, 8)),
+                     _mm_set1_epi16(short(0xff00)));
+  return _mm_or_si128(rb, ag);
+}
+
+// Returns 255-alpha of each pixel in both 16-bit lanes of each pixel.
+inline __m128i inv_alpha16_sse2(const __m128i s)
+{
+  const __m128i ia = _mm_sub_epi32(_mm_set1_epi32(255), _mm_srli_epi32(s, 24));
+  return _mm_or_si128(ia, _mm_slli_epi32(ia, 16));
+}
+
+#elif LAF_HAVE_NEON
+
+inline uint32x4_t mul_div255_neon(const uint32x4_t c, const uint16x8_t a16)
+{
+  const uint16x8_t half = vdupq_n_u16(0x80);
+  const uint16x8_t c16 = vreinterpretq_u16_u32(c);
+  uint16x8_t rb = vandq_u16(c16, vdupq_n_u16(0x00ff));
+  uint16x8_t ag = vshrq_n_u16(c16, 8);
+  rb = vaddq_u16(vmulq_u16(rb, a16), half);
+  ag = vaddq_u16(vmulq_u16(ag, a16), half);
+  rb = vshrq_n_u16(vaddq_u16(rb, vshrq_n_u16(rb, 8)), 8);
+  ag = vandq_u16(vaddq_u16(ag, vshrq_n_u16(ag, 8)), vdupq_n_u16(0xff00));
+  return vreinterpretq_u32_u16(vorrq_u16(rb, ag));
+}
+
+inline uint16x8_t inv_alpha16_neon(const uint32x4_t s)
+{
+  const uint32x4_t ia = vsubq_u32(vdupq_n_u32(255), vshrq_n_u32(s, 24));
+  return vreinterpretq_u16_u32(vorrq_u32(ia, vshlq_n_u32(ia, 16)));
+}
+
+#endif
+
+// dst = src + dst*(1-src.alpha) for premultiplied pixels.
+void srcover_row(uint32_t* dst, const uint32_t* src, int n)
+{
+#if LAF_HAVE_SSE2
+  const __m128i opaque = _mm_set1_epi32(gfx::ColorAMask);
+  const __m128i zero = _mm_setzero_si128();
+  for (; n >= 4; n -= 4, src += 4, dst += 4) {
+    const __m128i s = _mm_loadu_si128((const __m128i*)src);
+    const __m128i sa = _mm_and_si128(s, opaque);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(sa, opaque)) == 0xffff) {
+      _mm_storeu_si128((__m128i*)dst, s);
+      continue;
+    }
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(s, zero)) == 0xffff)
+      continue;
+    const __m128i d = _mm_loadu_si128((const __m128i*)dst);
+    _mm_storeu_si128((__m128i*)dst,
+                     _mm_add_epi8(s, mul_div255_sse2(d, inv_alpha16_sse2(s))));
+  }
+#elif LAF_HAVE_NEON
+  for (; n >= 4; n -= 4, src += 4, dst += 4) {
+    const uint32x4_t s = vld1q_u32(src);
+    const uint32x4_t sa = vshrq_n_u32(s, 24);
+    if (vminvq_u32(sa) == 255) {
+      vst1q_u32(dst, s);
+      continue;
+    }
+    if (vmaxvq_u32(s) == 0)
+      continue;
+    const uint32x4_t d = vld1q_u32(dst);
+    vst1q_u32(dst, vaddq_u32(s, mul_div255_neon(d, inv_alpha16_neon(s))));
+  }
+#endif
+  for (; n > 0; --n, ++src, ++dst)
+    *dst = srcover(*src, *dst);
+}
+
+// dst = color + dst*(1-color.alpha) for a premultiplied color.
+void srcover_solid_row(uint32_t* dst, const uint32_t color, int n)
+{
+  const uint32_t ia = 255 - (color >> 24);
+#if LAF_HAVE_SSE2
+  const __m128i s = _mm_set1_epi32(color);
+  const __m128i ia16 = _mm_set1_epi16(short(ia));
+  for (; n >= 4; n -= 4, dst += 4) {
+    const __m128i d = _mm_loadu_si128((const __m128i*)dst);
+    _mm_storeu_si128((__m128i*)dst, _mm_add_epi8(s, mul_div255_sse2(d, ia16)));
+  }
+#elif LAF_HAVE_NEON
+  const uint32x4_t s = vdupq_n_u32(color);
+  const uint16x8_t ia16 = vdupq_n_u16(uint16_t(ia));
+  for (; n >= 4; n -= 4, dst += 4) {
+    const uint32x4_t d = vld1q_u32(dst);
+    vst1q_u32(dst, vaddq_u32(s, mul_div255_neon(d, ia16)));
+  }
+#endif
+  for (; n > 0; --n, ++dst)
+    *dst = color + mul_div255(*dst, ia);
+}
+
+// Multiplies all channels of n premultiplied pixels by alpha/255.
+void modulate_row(uint32_t* dst, const uint32_t* src, const uint32_t alpha, int n)
+{
+#if LAF_HAVE_SSE2
+  const __m128i a16 = _mm_set1_epi16(short(alpha));
+  for (; n >= 4; n -= 4, src += 4, dst += 4) {
+    const __m128i s = _mm_loadu_si128((const __m128i*)src);
+    _mm_storeu_si128((__m128i*)dst, mul_div255_sse2(s, a16));
+  }
+#elif LAF_HAVE_NEON
+  const uint16x8_t a16 = vdupq_n_u16(uint16_t(alpha));
+  for (; n >= 4; n -= 4, src += 4, dst += 4)
+    vst1q_u32(dst, mul_div255_neon(vld1q_u32(src), a16));
+#endif
+  for (; n > 0; --n, ++src, ++dst)
+    *dst = mul_div255(*src, alpha);
+}
+
+// Blends a row of premultiplied pixels in a row of the destination
+// surface (which can use straight alpha).
+void blend_row(uint32_t* dst, const uint32_t* src, const int n,
+               const BlendMode blendMode, const PixelAlpha dstAlpha)
+{
+  switch (blendMode) {
+    case BlendMode::Clear:
+      std::fill(dst, dst+n, 0);
+      return;
+    case BlendMode::Src:
+      if (dstAlpha == PixelAlpha::kStraight) {
+        for (int i=0; i<n; ++i)
+          dst[i] = unpremultiply(src[i]);
+      }
+      else
+        std::copy(src, src+n, dst);
+      return;
+    case BlendMode::Dst:
+      return;
+    default:
+      if (dstAlpha == PixelAlpha::kStraight) {
+        for (int i=0; i<n; ++i)
+          dst[i] = unpremultiply(srcover(src[i], premultiply(dst[i])));
+      }
+      else
+        srcover_row(dst, src, n);
+      return;
+  }
+}
+
+// Reads rows of pixels of any surface as premultiplied pixels with
+// the gfx::Color layout.
+class SourceReader {
+public:
+  SourceReader(const Surface* src) : m_src(src) {
+    src->getFormat(&m_fmt);
+    m_direct = (m_fmt.bitsPerPixel == 32 &&
+                m_fmt.redShift == gfx::ColorRShift &&
+                m_fmt.greenShift == gfx::ColorGShift &&
+                m_fmt.blueShift == gfx::ColorBShift &&
+                m_fmt.alphaShift == gfx::ColorAShift &&
+                m_fmt.pixelAlpha == PixelAlpha::kPremultiplied);
+  }
+
+  // Returns n pixels starting at x,y (the pointer is valid until the
+  // next call).
+  const uint32_t* read(const int x, const int y, const int n) {
+    const uint32_t* p = (const uint32_t*)m_src->getData(x, y);
+    if (m_direct)
+      return p;
+
+    m_buf.resize(n);
+    for (int i=0; i<n; ++i) {
+      const uint32_t c = p[i];
+      const uint32_t r = (c & m_fmt.redMask) >> m_fmt.redShift;
+      const uint32_t g = (c & m_fmt.greenMask) >> m_fmt.greenShift;
+      const uint32_t b = (c & m_fmt.blueMask) >> m_fmt.blueShift;
+      uint32_t a = (c & m_fmt.alphaMask) >> m_fmt.alphaShift;
+      if (m_fmt.pixelAlpha == PixelAlpha::kOpaque)
+        a = 255;
+      const gfx::Color color = gfx::rgba(r, g, b, a);
+      m_buf[i] = (m_fmt.pixelAlpha == PixelAlpha::kStraight ?
+                  premultiply(color): color);
+    }
+    return m_buf.data();
+  }
+
+private:
+  const Surface* m_src;
+  SurfaceFormatData m_fmt;
+  bool m_direct;
+  std::vector<uint32_t> m_buf;
+};
+
+} // anonymous namespace
+
+NoneSurface::NoneSurface()
+{
+}
+
+NoneSurface::~NoneSurface()
+{
+  destroy();
+}
+
+void NoneSurface::create(int width, int height, const os::ColorSpaceRef& cs)
+{
+  createRgba(width, height, cs);
+  m_pixelAlpha = PixelAlpha::kOpaque;
+}
+
+void NoneSurface::createRgba(int width, int height, const os::ColorSpaceRef& cs,
+                             PixelAlpha pixelAlpha)
+{
+  ASSERT(width > 0);
+  ASSERT(height > 0);
+
+  destroy();
+
+  m_pixels.resize(size_t(width) * height, 0);
+  m_width = width;
+  m_height = height;
+  m_pixelAlpha = pixelAlpha;
+  m_colorSpace = cs;
+  m_state.clip = gfx::Rect(0, 0, width, height);
+}
+
+void NoneSurface::destroy()
+{
+  m_pixels.clear();
+  m_pixels.shrink_to_fit();
+  m_width = m_height = 0;
+  m_colorSpace.reset();
+  m_state = State();
+  m_saved.clear();
+}
+
+int NoneSurface::getSaveCount() const
+{
+  return 1 + int(m_saved.size());
+}
+
+gfx::Rect NoneSurface::getClipBounds() const
+{
+  return gfx::Rect(m_state.clip).offset(-m_state.origin);
+}
+
+void NoneSurface::saveClip()
+{
+  m_saved.push_back(m_state);
+}
+
+void NoneSurface::restoreClip()
+{
+  restore();
+}
+
+bool NoneSurface::clipRect(const gfx::Rect& rc)
+{
+  m_state.clip &= gfx::Rect(rc).offset(m_state.origin);
+  return !m_state.clip.isEmpty();
+}
+
+void NoneSurface::clipPath(const gfx::Path& path)
+{
+  // Not supported (gfx::Path is empty without Skia)
+}
+
+void NoneSurface::save()
+{
+  m_saved.push_back(m_state);
+}
+
+void NoneSurface::concat(const gfx::Matrix& matrix)
+{
+  m_state.origin.x += int(std::round(matrix.getTranslateX()));
+  m_state.origin.y += int(std::round(matrix.getTranslateY()));
+}
+
+void NoneSurface::setMatrix(const gfx::Matrix& matrix)
+{
+  m_state.origin.x = int(std::round(matrix.getTranslateX()));
+  m_state.origin.y = int(std::round(matrix.getTranslateY()));
+}
+
+void NoneSurface::resetMatrix()
+{
+  m_state.origin = gfx::Point(0, 0);
+}
+
+void NoneSurface::restore()
+{
+  if (!m_saved.empty()) {
+    m_state = m_saved.back();
+    m_saved.pop_back();
+  }
+}
+
+gfx::Matrix NoneSurface::matrix() const
+{
+  return gfx::Matrix::MakeTrans(float(m_state.origin.x),
+                                float(m_state.origin.y));
+}
+
+void NoneSurface::lock()
+{
+  ASSERT(m_lock >= 0);
+  ++m_lock;
+}
+
+void NoneSurface::unlock()
+{
+  ASSERT(m_lock > 0);
+  --m_lock;
+}
+
+void NoneSurface::applyScale(int scaleFactor)
+{
+  ASSERT(scaleFactor > 0);
+  if (scaleFactor < 2 || m_pixels.empty())
+    return;
+
+  const int w = m_width * scaleFactor;
+  const int h = m_height * scaleFactor;
+  std::vector<uint32_t> pixels(size_t(w) * h);
+  for (int y=0; y<h; ++y) {
+    const uint32_t* src = row(y / scaleFactor);
+    uint32_t* dst = pixels.data() + size_t(y)*w;
+    for (int x=0; x<w; ++x)
+      dst[x] = src[x / scaleFactor];
+  }
+
+  m_pixels.swap(pixels);
+  m_width = w;
+  m_height = h;
+  m_state = State();
+  m_state.clip = gfx::Rect(0, 0, w, h);
+  m_saved.clear();
+}
+
+void NoneSurface::clear()
+{
+  fillRect(getClipBounds(), gfx::ColorNone, BlendMode::Clear);
+}
+
+uint8_t* NoneSurface::getData(int x, int y) const
+{
+  if (m_pixels.empty())
+    return nullptr;
+  return (uint8_t*)(row(y) + x);
+}
+
+void NoneSurface::getFormat(SurfaceFormatData* formatData) const
+{
+  formatData->format = kRgbaSurfaceFormat;
+  formatData->bitsPerPixel = 32;
+  formatData->redShift   = gfx::ColorRShift;
+  formatData->greenShift = gfx::ColorGShift;
+  formatData->blueShift  = gfx::ColorBShift;
+  formatData->alphaShift = gfx::ColorAShift;
+  formatData->redMask    = gfx::ColorRMask;
+  formatData->greenMask  = gfx::ColorGMask;
+  formatData->blueMask   = gfx::ColorBMask;
+  formatData->alphaMask  = gfx::ColorAMask;
+  formatData->pixelAlpha = m_pixelAlpha;
+}
+
+gfx::Color NoneSurface::getPixel(int x, int y) const
+{
+  if (x < 0 || y < 0 || x >= m_width || y >= m_height)
+    return gfx::ColorNone;
+
+  const uint32_t c = row(y)[x];
+  return (m_pixelAlpha == PixelAlpha::kStraight ? c: unpremultiply(c));
+}
+
+void NoneSurface::putPixel(gfx::Color color, int x, int y)
+{
+  if (x < 0 || y < 0 || x >= m_width || y >= m_height)
+    return;
+
+  row(y)[x] = (m_pixelAlpha == PixelAlpha::kStraight ? color: premultiply(color));
+}
+
+void NoneSurface::drawLine(const float x0, const float y0,
+                           const float x1, const float y1,
+                           const Paint& paint)
+{
+  int ax = int(std::floor(x0)), ay = int(std::floor(y0));
+  const int bx = int(std::floor(x1)), by = int(std::floor(y1));
+  const int t = std::max(1, int(std::round(paint.strokeWidth())));
+  const int t0 = t/2;
+
+  // Horizontal spans of each row (the union of the line pixels in
+  // each row is contiguous, so each pixel is blended only once)
+  const int top = std::min(ay, by) - t0;
+  std::vector<std::pair<int, int>> spans(std::abs(by - ay) + t,
+                                         std::make_pair(INT_MAX, INT_MIN));
+
+  // Bresenham's line algorithm
+  const int dx = std::abs(bx - ax), sx = (ax < bx ? 1: -1);
+  const int dy = -std::abs(by - ay), sy = (ay < by ? 1: -1);
+  int err = dx + dy;
+  while (true) {
+    for (int i=0; i<t; ++i) {
+      auto& span = spans[ay - t0 + i - top];
+      span.first = std::min(span.first, ax - t0);
+      span.second = std::max(span.second, ax - t0 + t);
+    }
+    if (ax == bx && ay == by)
+      break;
+    const int e2 = 2*err;
+    if (e2 >= dy) { err += dy; ax += sx; }
+    if (e2 <= dx) { err += dx; ay += sy; }
+  }
+
+  for (int i=0; i<int(spans.size()); ++i) {
+    const auto& span = spans[i];
+    fillRect(gfx::Rect(span.first, top+i, span.second - span.first, 1),
+             paint.color(), paint.blendMode());
+  }
+}
+
+void NoneSurface::drawRect(const gfx::RectF& rcF,
+                           const Paint& paint)
+{
+  const int x1 = int(std::round(rcF.x));
+  const int y1 = int(std::round(rcF.y));
+  const int x2 = int(std::round(rcF.x2()));
+  const int y2 = int(std::round(rcF.y2()));
+  const gfx::Rect rc(x1, y1, x2-x1, y2-y1);
+  if (rc.isEmpty())
+    return;
+
+  if (paint.style() == Paint::Stroke) {
+    const int t = std::max(1, int(std::round(paint.strokeWidth())));
+    if (2*t < rc.w && 2*t < rc.h) {
+      // Four sides without overlapping pixels
+      fillRect(gfx::Rect(rc.x, rc.y, rc.w, t), paint.color(), paint.blendMode());
+      fillRect(gfx::Rect(rc.x, rc.y2()-t, rc.w, t), paint.color(), paint.blendMode());
+      fillRect(gfx::Rect(rc.x, rc.y+t, t, rc.h-2*t), paint.color(), paint.blendMode());
+      fillRect(gfx::Rect(rc.x2()-t, rc.y+t, t, rc.h-2*t), paint.color(), paint.blendMode());
+      return;
+    }
+  }
+
+  fillRect(rc, paint.color(), paint.blendMode());
+}
+
+void NoneSurface::drawCircle(const float cx, const float cy,
+                             const float radius,
+                             const Paint& paint)
+{
+  float outer = radius;
+  float inner = -1.0f;
+  if (paint.style() == Paint::Stroke) {
+    const float t = std::max(1.0f, paint.strokeWidth());
+    outer = radius + t/2;
+    inner = radius - t/2;
+  }
+  if (outer <= 0.0f)
+    return;
+
+  // Returns the range of pixels [x1, x2) of the row y which centers
+  // are inside the circle of radius r.
+  auto span = [cx, cy](const int y, const float r, int& x1, int& x2) -> bool {
+    const float dy = float(y) + 0.5f - cy;
+    if (r <= 0.0f || std::fabs(dy) > r)
+      return false;
+    const float half = std::sqrt(r*r - dy*dy);
+    x1 = int(std::ceil(cx - half - 0.5f));
+    x2 = int(std::floor(cx + half - 0.5f)) + 1;
+    return x1 < x2;
+  };
+
+  const int y1 = int(std::floor(cy - outer));
+  const int y2 = int(std::ceil(cy + outer));
+  for (int y=y1; y<=y2; ++y) {
+    int ox1, ox2, ix1, ix2;
+    if (!span(y, outer, ox1, ox2))
+      continue;
+    if (span(y, inner, ix1, ix2)) {
+      fillRect(gfx::Rect(ox1, y, ix1-ox1, 1), paint.color(), paint.blendMode());
+      fillRect(gfx::Rect(ix2, y, ox2-ix2, 1), paint.color(), paint.blendMode());
+    }
+    else
+      fillRect(gfx::Rect(ox1, y, ox2-ox1, 1), paint.color(), paint.blendMode());
+  }
+}
+
+void NoneSurface::drawPath(const gfx::Path& path,
+                           const Paint& paint)
+{
+  // Not supported (gfx::Path is empty without Skia)
+}
+
+void NoneSurface::blitTo(Surface* _dst, int srcx, int srcy, int dstx, int dsty, int width, int height) const
+{
+  const gfx::Rect srcRect(srcx, srcy, width, height);
+  const gfx::Rect dstRect(dstx, dsty, width, height);
+
+  if (auto dst = dynamic_cast<NoneSurface*>(_dst)) {
+    dst->drawImage(this, srcRect, dstRect, BlendMode::Src, Tint());
+  }
+  // Other kind of surface (it reads our pixels with getData())
+  else {
+    Paint paint;
+    paint.blendMode(BlendMode::Src);
+    _dst->drawSurface(this, srcRect, dstRect, Sampling(), &paint);
+  }
+}
+
+void NoneSurface::scrollTo(const gfx::Rect& rc, int dx, int dy)
+{
+  int w = width();
+  int h = height();
+  gfx::Clip clip(rc.x+dx, rc.y+dy, rc);
+  if (!clip.clip(w, h, w, h))
+    return;
+
+  int rowDelta;
+  if (dy > 0) {
+    clip.src.y += clip.size.h-1;
+    clip.dst.y += clip.size.h-1;
+    rowDelta = -m_width;
+  }
+  else
+    rowDelta = m_width;
+
+  uint32_t* dst = row(clip.dst.y) + clip.dst.x;
+  const uint32_t* src = row(clip.src.y) + clip.src.x;
+  w = sizeof(uint32_t)*clip.size.w;
+  h = clip.size.h;
+
+  while (--h >= 0) {
+    std::memmove(dst, src, w);
+    dst += rowDelta;
+    src += rowDelta;
+  }
+}
+
+void NoneSurface::drawSurface(const Surface* src, int dstx, int dsty)
+{
+  drawImage(src,
+            src->bounds(),
+            gfx::Rect(dstx, dsty, src->width(), src->height()),
+            BlendMode::Src, Tint());
+}
+
+void NoneSurface::drawSurface(const Surface* src,
+                              const gfx::Rect& srcRect,
+                              const gfx::Rect& dstRect,
+                              const Sampling& sampling,
+                              const os::Paint* paint)
+{
+  BlendMode blendMode = BlendMode::Src;
+  Tint tint;
+  if (paint) {
+    blendMode = paint->blendMode();
+    tint.alpha = gfx::geta(paint->color());
+  }
+  drawImage(src, srcRect, dstRect, blendMode, tint);
+}
+
+void NoneSurface::drawRgbaSurface(const Surface* src, int dstx, int dsty)
+{
+  drawImage(src,
+            src->bounds(),
+            gfx::Rect(dstx, dsty, src->width(), src->height()),
+            BlendMode::SrcOver, Tint());
+}
+
+void NoneSurface::drawRgbaSurface(const Surface* src, int srcx, int srcy, int dstx, int dsty, int w, int h)
+{
+  drawImage(src,
+            gfx::Rect(srcx, srcy, w, h),
+            gfx::Rect(dstx, dsty, w, h),
+            BlendMode::SrcOver, Tint());
+}
+
+void NoneSurface::drawColoredRgbaSurface(const Surface* src, gfx::Color fg, gfx::Color bg, const gfx::Clip& clip)
+{
+  const gfx::Rect srcRect(clip.src, clip.size);
+  const gfx::Rect dstRect(clip.dst, clip.size);
+
+  if (gfx::geta(bg) > 0)
+    fillRect(dstRect, bg, BlendMode::SrcOver);
+
+  // A transparent color (e.g. ColorNone) draws nothing as in other
+  // backends (Tint::color == ColorNone means "no tint").
+  if (gfx::geta(fg) == 0)
+    return;
+
+  Tint tint;
+  tint.color = fg;
+  drawImage(src, srcRect, dstRect, BlendMode::SrcOver, tint);
+}
+
+void NoneSurface::drawSurfaceNine(os::Surface* surface,
+                                  const gfx::Rect& src,
+                                  const gfx::Rect& center,
+                                  const gfx::Rect& dst,
+                                  const bool drawCenter,
+                                  const os::Paint* paint)
+{
+  Tint tint;
+  if (paint && paint->color() != gfx::ColorNone)
+    tint.color = paint->color();
+
+  // Edges of the 3x3 patches in the source and destination
+  const int sx[4] = { src.x, src.x+center.x, src.x+center.x2(), src.x2() };
+  const int sy[4] = { src.y, src.y+center.y, src.y+center.y2(), src.y2() };
+  const int dx[4] = { dst.x, dst.x+center.x, dst.x2()-(src.w-center.x2()), dst.x2() };
+  const int dy[4] = { dst.y, dst.y+center.y, dst.y2()-(src.h-center.y2()), dst.y2() };
+
+  for (int j=0; j<3; ++j) {
+    for (int i=0; i<3; ++i) {
+      if (i == 1 && j == 1 && !drawCenter)
+        continue;
+
+      drawImage(surface,
+                gfx::Rect(sx[i], sy[j], sx[i+1]-sx[i], sy[j+1]-sy[j]),
+                gfx::Rect(dx[i], dy[j], dx[i+1]-dx[i], dy[j+1]-dy[j]),
+                BlendMode::SrcOver, tint);
+    }
+  }
+}
+
+// Fills the given rectangle (in the current matrix coordinates) with
+// a straight-alpha color.
+void NoneSurface::fillRect(const gfx::Rect& rc, gfx::Color color, BlendMode blendMode)
+{
+  const gfx::Rect bounds = gfx::Rect(rc).offset(m_state.origin) & m_state.clip;
+  if (bounds.isEmpty() || blendMode == BlendMode::Dst)
+    return;
+
+  if (blendMode == BlendMode::Clear) {
+    color = 0;
+    blendMode = BlendMode::Src;
+  }
+  const uint32_t pixel = premultiply(color);
+  // SrcOver with an opaque color is the same as Src
+  if (blendMode != BlendMode::Src) {
+    if ((pixel >> 24) == 255)
+      blendMode = BlendMode::Src;
+    else if (pixel == 0)
+      return;
+  }
+
+  for (int y=bounds.y; y<bounds.y2(); ++y) {
+    uint32_t* dst = row(y) + bounds.x;
+    if (blendMode == BlendMode::Src) {
+      std::fill(dst, dst+bounds.w,
+                (m_pixelAlpha == PixelAlpha::kStraight ? uint32_t(color): pixel));
+    }
+    else if (m_pixelAlpha == PixelAlpha::kStraight) {
+      for (int x=0; x<bounds.w; ++x)
+        dst[x] = unpremultiply(srcover(pixel, premultiply(dst[x])));
+    }
+    else
+      srcover_solid_row(dst, pixel, bounds.w);
+  }
+}
+
+// Draws the srcRect of the src surface scaled to dstRect (in the
+// current matrix coordinates) using nearest neighbor sampling.
+void NoneSurface::drawImage(const Surface* src,
+                            const gfx::Rect& srcRect,
+                            const gfx::Rect& dstRect,
+                            BlendMode blendMode,
+                            const Tint& tint)
+{
+  if (srcRect.isEmpty() || dstRect.isEmpty() || blendMode == BlendMode::Dst)
+    return;
+
+  // Clip the source rectangle to the source bounds (and the
+  // destination rectangle proportionally)
+  const gfx::Rect s = srcRect & src->bounds();
+  if (s.isEmpty())
+    return;
+
+  gfx::Rect d = dstRect;
+  if (s != srcRect) {
+    const double fx = double(dstRect.w) / srcRect.w;
+    const double fy = double(dstRect.h) / srcRect.h;
+    const int x1 = dstRect.x + int(std::round((s.x - srcRect.x) * fx));
+    const int y1 = dstRect.y + int(std::round((s.y - srcRect.y) * fy));
+    const int x2 = dstRect.x + int(std::round((s.x2() - srcRect.x) * fx));
+    const int y2 = dstRect.y + int(std::round((s.y2() - srcRect.y) * fy));
+    d = gfx::Rect(x1, y1, x2-x1, y2-y1);
+  }
+  d.offset(m_state.origin);
+
+  const gfx::Rect vis = d & m_state.clip;
+  if (vis.isEmpty())
+    return;
+
+  // Copy the source pixels when we are drawing this surface in
+  // itself (the source and destination areas can overlap).
+  if (src == this) {
+    NoneSurface copy;
+    copy.createRgba(s.w, s.h, m_colorSpace, m_pixelAlpha);
+    for (int y=0; y<s.h; ++y)
+      std::copy(row(s.y+y) + s.x, row(s.y+y) + s.x2(), copy.row(y));
+
+    const gfx::Point origin = m_state.origin;
+    m_state.origin = gfx::Point(0, 0);
+    drawImage(&copy, gfx::Rect(0, 0, s.w, s.h), d, blendMode, tint);
+    m_state.origin = origin;
+    return;
+  }
+
+  SourceReader reader(src);
+  const bool scaleX = (d.w != s.w);
+  const bool tinted = (tint.alpha < 255 || tint.color != gfx::ColorNone);
+  const uint32_t tintColor = premultiply(tint.color);
+  if (tinted && tint.alpha <= 0)
+    return;
+
+  // Source X coordinate of each visible destination pixel
+  std::vector<int> xmap;
+  if (scaleX) {
+    xmap.resize(vis.w);
+    for (int x=0; x<vis.w; ++x)
+      xmap[x] = int((2*int64_t(vis.x - d.x + x) + 1) * s.w / (2*int64_t(d.w)));
+  }
+
+  std::vector<uint32_t> buf;
+  if (scaleX || tinted)
+    buf.resize(vis.w);
+
+  for (int y=vis.y; y<vis.y2(); ++y) {
+    const int srcY = s.y + int((2*int64_t(y - d.y) + 1) * s.h / (2*int64_t(d.h)));
+    const uint32_t* srcRow;
+    if (scaleX) {
+      const uint32_t* p = reader.read(s.x, srcY, s.w);
+      for (int x=0; x<vis.w; ++x)
+        buf[x] = p[xmap[x]];
+      srcRow = buf.data();
+    }
+    else
+      srcRow = reader.read(s.x + vis.x - d.x, srcY, vis.w);
+
+    if (tinted) {
+      if (tint.color != gfx::ColorNone) {
+        for (int x=0; x<vis.w; ++x)
+          buf[x] = mul_div255(tintColor, srcRow[x] >> 24);
+        if (tint.alpha < 255)
+          modulate_row(buf.data(), buf.data(), tint.alpha, vis.w);
+      }
+      else
+        modulate_row(buf.data(), srcRow, tint.alpha, vis.w);
+      srcRow = buf.data();
+    }
+
+    blend_row(row(y) + vis.x, srcRow, vis.w, blendMode, m_pixelAlpha);
+  }
+}
+
+} // namespace os
@@ -0,0 +1,154 @@
+// LAF OS Library
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef OS_NONE_SURFACE_H_INCLUDED
+#define OS_NONE_SURFACE_H_INCLUDED
+#pragma once
+
+#include "base/disable_copying.h"
+#include "gfx/clip.h"
+#include "gfx/matrix.h"
+#include "os/surface.h"
+#include "os/surface_format.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace os {
+
+// Surface rendered in the CPU without Skia (for LAF_BACKEND=none,
+// e.g. to render/export images in headless processes).
+//
+// Pixels are 32-bit RGBA values with the same layout as gfx::Color
+// (red in the lowest byte), premultiplied by alpha by default, or
+// with straight alpha (createRgba(..., PixelAlpha::kStraight)).
+//
+// Limitations compared with SkiaSurface:
+// * Only the translation of the matrix is used (rounded to integer
+//   pixels), scale/rotation are ignored.
+// * Clip regions are rectangles (clipPath() is ignored), and paths
+//   are not drawn (gfx::Path is empty without Skia).
+// * Only the Clear, Src, Dst and SrcOver blend modes are supported,
+//   other blend modes are drawn as SrcOver.
+// * Shapes are drawn without antialiasing, and scaled surfaces are
+//   always sampled with nearest neighbor.
+// * Pixels are not converted between color spaces.
+class NoneSurface final : public Surface {
+public:
+  NoneSurface();
+  ~NoneSurface();
+
+  // Creates a surface where the alpha channel is ignored when it's
+  // drawn in other surfaces (kOpaque).
+  void create(int width, int height, const os::ColorSpaceRef& cs);
+  void createRgba(int width, int height, const os::ColorSpaceRef& cs,
+                  PixelAlpha pixelAlpha = PixelAlpha::kPremultiplied);
+  void destroy();
+
+  PixelAlpha pixelAlpha() const { return m_pixelAlpha; }
+
+  // Surface impl
+  int width() const override { return m_width; }
+  int height() const override { return m_height; }
+  const ColorSpaceRef& colorSpace() const override { return m_colorSpace; }
+  bool isDirectToScreen() const override { return false; }
+  void setImmutable() override { }
+  int getSaveCount() const override;
+  gfx::Rect getClipBounds() const override;
+  void saveClip() override;
+  void restoreClip() override;
+  bool clipRect(const gfx::Rect& rc) override;
+  void clipPath(const gfx::Path& path) override;
+  void save() override;
+  void concat(const gfx::Matrix& matrix) override;
+  void setMatrix(const gfx::Matrix& matrix) override;
+  void resetMatrix() override;
+  void restore() override;
+  gfx::Matrix matrix() const override;
+  void lock() override;
+  void unlock() override;
+  void applyScale(int scaleFactor) override;
+
+  void* nativeHandle() override { return (void*)this; }
+
+  void clear() override;
+  uint8_t* getData(int x, int y) const override;
+  void getFormat(SurfaceFormatData* formatData) const override;
+
+  gfx::Color getPixel(int x, int y) const override;
+  void putPixel(gfx::Color color, int x, int y) override;
+
+  void drawLine(const float x0, const float y0,
+                const float x1, const float y1,
+                const Paint& paint) override;
+  void drawRect(const gfx::RectF& rc,
+                const Paint& paint) override;
+  void drawCircle(const float cx, const float cy,
+                  const float radius,
+                  const Paint& paint) override;
+  void drawPath(const gfx::Path& path,
+                const Paint& paint) override;
+
+  void blitTo(Surface* dst, int srcx, int srcy, int dstx, int dsty, int width, int height) const override;
+  void scrollTo(const gfx::Rect& rc, int dx, int dy) override;
+  void drawSurface(const Surface* src, int dstx, int dsty) override;
+  void drawSurface(const Surface* src,
+                   const gfx::Rect& srcRect,
+                   const gfx::Rect& dstRect,
+                   const Sampling& sampling,
+                   const os::Paint* paint) override;
+  void drawRgbaSurface(const Surface* src, int dstx, int dsty) override;
+  void drawRgbaSurface(const Surface* src, int srcx, int srcy, int dstx, int dsty, int width, int height) override;
+  void drawColoredRgbaSurface(const Surface* src, gfx::Color fg, gfx::Color bg, const gfx::Clip& clip) override;
+  void drawSurfaceNine(os::Surface* surface,
+                       const gfx::Rect& src,
+                       const gfx::Rect& center,
+                       const gfx::Rect& dst,
+                       const bool drawCenter,
+                       const os::Paint* paint) override;
+
+private:
+  // How source pixels are modified before they are blended.
+  struct Tint {
+    // Source pixels are multiplied by this alpha.
+    int alpha = 255;
+    // If it's not ColorNone, source pixels are replaced with this
+    // color using the source alpha as coverage (SrcIn).
+    gfx::Color color = gfx::ColorNone;
+  };
+
+  // Canvas state saved with save()/saveClip().
+  struct State {
+    gfx::Rect clip;             // In pixels of this surface
+    gfx::Point origin;          // Integer translation
+  };
+
+  uint32_t* row(int y) const {
+    return const_cast<uint32_t*>(m_pixels.data()) + size_t(y)*m_width;
+  }
+
+  void fillRect(const gfx::Rect& rc, gfx::Color color, BlendMode blendMode);
+  void drawImage(const Surface* src,
+                 const gfx::Rect& srcRect,
+                 const gfx::Rect& dstRect,
+                 BlendMode blendMode,
+                 const Tint& tint);
+
+  std::vector<uint32_t> m_pixels;
+  int m_width = 0;
+  int m_height = 0;
+  PixelAlpha m_pixelAlpha = PixelAlpha::kPremultiplied;
+  ColorSpaceRef m_colorSpace;
+  State m_state;
+  std::vector<State> m_saved;
+  int m_lock = 0;
+
+  DISABLE_COPYING(NoneSurface);
+};
+
+} // namespace os
+
+#endif
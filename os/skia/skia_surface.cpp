@@ -12,6 +12,7 @@
 #include "os/skia/skia_surface.h"
 
 #include "base/file_handle.h"
+#include "base/trace.h"
 #include "gfx/path.h"
 #include "os/skia/skia_helpers.h"
 #include "os/surface_format.h"
@@ -283,6 +284,7 @@ void* SkiaSurface::nativeHandle()
 
 void SkiaSurface::clear()
 {
+  LAF_TRACE_ZONE("SkiaSurface::clear");
   m_canvas->clear(0);
 }
 
@@ -407,12 +409,14 @@ void SkiaSurface::drawLine(const float x0, const float y0,
                            const float x1, const float y1,
                            const Paint& paint)
 {
+  LAF_TRACE_ZONE("SkiaSurface::drawLine");
   m_canvas->drawLine(x0, y0, x1, y1, paint.skPaint());
 }
 
 void SkiaSurface::drawRect(const gfx::RectF& rc,
                            const Paint& paint)
 {
+  LAF_TRACE_ZONE("SkiaSurface::drawRect");
   if (rc.isEmpty())
     return;
 
@@ -426,17 +430,20 @@ void SkiaSurface::drawCircle(const float cx, const float cy,
                              const float radius,
                              const Paint& paint)
 {
+  LAF_TRACE_ZONE("SkiaSurface::drawCircle");
   m_canvas->drawCircle(cx, cy, radius, paint.skPaint());
 }
 
 void SkiaSurface::drawPath(const gfx::Path& path,
                            const Paint& paint)
 {
+  LAF_TRACE_ZONE("SkiaSurface::drawPath");
   m_canvas->drawPath(path.skPath(), paint.skPaint());
 }
 
 void SkiaSurface::blitTo(Surface* _dst, int srcx, int srcy, int dstx, int dsty, int width, int height) const
 {
+  LAF_TRACE_ZONE("SkiaSurface::blitTo");
   auto dst = static_cast<SkiaSurface*>(_dst);
 
   SkRect srcRect = SkRect::MakeXYWH(srcx, srcy, width, height);
@@ -478,6 +485,7 @@ void SkiaSurface::blitTo(Surface* _dst, int srcx, int srcy, int dstx, int dsty,
 
 void SkiaSurface::scrollTo(const gfx::Rect& rc, int dx, int dy)
 {
+  LAF_TRACE_ZONE("SkiaSurface::scrollTo");
   int w = width();
   int h = height();
   gfx::Clip clip(rc.x+dx, rc.y+dy, rc);
@@ -520,6 +528,7 @@ void SkiaSurface::scrollTo(const gfx::Rect& rc, int dx, int dy)
 
 void SkiaSurface::drawSurface(const Surface* src, int dstx, int dsty)
 {
+  LAF_TRACE_ZONE("SkiaSurface::drawSurface");
   gfx::Clip clip(dstx, dsty, 0, 0, src->width(), src->height());
   // Don't call clip.clip() and left the clipping to the Skia library
   // (mainly because Skia knows how to handle clipping even when a
@@ -541,6 +550,7 @@ void SkiaSurface::drawSurface(const Surface* src,
                               const Sampling& sampling,
                               const os::Paint* paint)
 {
+  LAF_TRACE_ZONE("SkiaSurface::drawSurface");
   SkPaint skSrcPaint;
   skSrcPaint.setBlendMode(SkBlendMode::kSrc);
 
@@ -558,6 +568,7 @@ void SkiaSurface::drawSurface(const Surface* src,
 
 void SkiaSurface::drawRgbaSurface(const Surface* src, int dstx, int dsty)
 {
+  LAF_TRACE_ZONE("SkiaSurface::drawRgbaSurface");
   gfx::Clip clip(dstx, dsty, 0, 0, src->width(), src->height());
 
   SkPaint paint;
@@ -572,6 +583,7 @@ void SkiaSurface::drawRgbaSurface(const Surface* src, int dstx, int dsty)
 
 void SkiaSurface::drawRgbaSurface(const Surface* src, int srcx, int srcy, int dstx, int dsty, int w, int h)
 {
+  LAF_TRACE_ZONE("SkiaSurface::drawRgbaSurface");
   gfx::Clip clip(dstx, dsty, srcx, srcy, w, h);
 
   SkPaint paint;
@@ -586,6 +598,7 @@ void SkiaSurface::drawRgbaSurface(const Surface* src, int srcx, int srcy, int ds
 
 void SkiaSurface::drawColoredRgbaSurface(const Surface* src, gfx::Color fg, gfx::Color bg, const gfx::Clip& clipbase)
 {
+  LAF_TRACE_ZONE("SkiaSurface::drawColoredRgbaSurface");
   gfx::Clip clip(clipbase);
 
   SkRect srcRect = SkRect::Make(SkIRect::MakeXYWH(clip.src.x, clip.src.y, clip.size.w, clip.size.h));
@@ -621,6 +634,7 @@ void SkiaSurface::drawSurfaceNine(os::Surface* surface,
                                   const bool drawCenter,
                                   const os::Paint* paint)
 {
+  LAF_TRACE_ZONE("SkiaSurface::drawSurfaceNine");
   SkIRect srcRect = SkIRect::MakeXYWH(src.x, src.y, src.w, src.h);
   SkRect dstRect = SkRect::Make(SkIRect::MakeXYWH(dst.x, dst.y, dst.w, dst.h));
 
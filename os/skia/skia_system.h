@@ -11,6 +11,7 @@
 
 #include "gfx/color_space.h"
 #include "gfx/size.h"
+#include "os/common/generic_color_space.h"
 #include "os/common/system.h"
 #include "os/skia/skia_color_space.h"
 #include "os/skia/skia_font_manager.h"
@@ -138,6 +139,10 @@ public:
   Ref<ColorSpaceConversion> convertBetweenColorSpace(
     const os::ColorSpaceRef& src,
     const os::ColorSpaceRef& dst) override {
+    // Use the same software conversion as other backends, and Skia
+    // only for color spaces that gfx::ColorTransform doesn't support.
+    if (auto conversion = GenericColorSpaceConversion::Make(src, dst))
+      return conversion;
     return os::make_ref<SkiaColorSpaceConversion>(src, dst);
   }
 
@@ -11,6 +11,7 @@
 
 #include "os/skia/skia_window_x11.h"
 
+#include "base/trace.h"
 #include "gfx/size.h"
 #include "os/event.h"
 #include "os/event_queue.h"
@@ -58,6 +59,7 @@ SkiaWindowX11::SkiaWindowX11(const WindowSpec& spec)
 
 void SkiaWindowX11::onPaint(const gfx::Rect& rc)
 {
+  LAF_TRACE_ZONE("SkiaWindowX11::onPaint");
 #if SK_SUPPORT_GPU
   if (backend() == Backend::GL)
     return;
@@ -0,0 +1,201 @@
+// LAF OS Library
+// Copyright (C) 2024  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "gfx/matrix.h"
+#include "os/surface.h"
+#include "os/system.h"
+
+#include <cstdlib>
+
+using namespace os;
+
+static SystemRef g_system;
+
+static SurfaceRef make_surface(int w, int h, gfx::Color color = gfx::ColorNone)
+{
+  SurfaceRef sur = g_system->makeRgbaSurface(w, h);
+  EXPECT_TRUE(sur != nullptr);
+  Paint paint;
+  paint.color(color);
+  paint.blendMode(BlendMode::Src);
+  sur->drawRect(sur->bounds(), paint);
+  return sur;
+}
+
+static void expect_near(gfx::Color expected, gfx::Color actual)
+{
+  EXPECT_LE(std::abs(gfx::getr(expected) - gfx::getr(actual)), 1);
+  EXPECT_LE(std::abs(gfx::getg(expected) - gfx::getg(actual)), 1);
+  EXPECT_LE(std::abs(gfx::getb(expected) - gfx::getb(actual)), 1);
+  EXPECT_LE(std::abs(gfx::geta(expected) - gfx::geta(actual)), 1);
+}
+
+TEST(Surface, FillRect)
+{
+  const gfx::Color red = gfx::rgba(255, 0, 0);
+  auto sur = make_surface(8, 8);
+  EXPECT_EQ(gfx::ColorNone, sur->getPixel(0, 0));
+
+  Paint paint;
+  paint.color(red);
+  sur->drawRect(gfx::Rect(1, 2, 3, 4), paint);
+  EXPECT_EQ(gfx::ColorNone, sur->getPixel(0, 2));
+  EXPECT_EQ(red, sur->getPixel(1, 2));
+  EXPECT_EQ(red, sur->getPixel(3, 5));
+  EXPECT_EQ(gfx::ColorNone, sur->getPixel(4, 5));
+  EXPECT_EQ(gfx::ColorNone, sur->getPixel(3, 6));
+
+  // SrcOver with semi-transparent colors
+  paint.color(gfx::rgba(0, 0, 255, 128));
+  sur->drawRect(gfx::Rect(0, 0, 8, 8), paint);
+  expect_near(gfx::rgba(127, 0, 128), sur->getPixel(1, 2));
+  expect_near(gfx::rgba(0, 0, 255, 128), sur->getPixel(0, 0));
+
+  sur->clear();
+  EXPECT_EQ(gfx::ColorNone, sur->getPixel(1, 2));
+}
+
+TEST(Surface, ClipAndMatrix)
+{
+  const gfx::Color white = gfx::rgba(255, 255, 255);
+  auto sur = make_surface(8, 8);
+  Paint paint;
+  paint.color(white);
+
+  EXPECT_EQ(1, sur->getSaveCount());
+  sur->save();
+  sur->setMatrix(gfx::Matrix::MakeTrans(2, 3));
+  EXPECT_TRUE(sur->clipRect(gfx::Rect(0, 0, 2, 2)));
+  EXPECT_EQ(gfx::Rect(0, 0, 2, 2), sur->getClipBounds());
+  sur->drawRect(gfx::Rect(-5, -5, 20, 20), paint);
+  EXPECT_EQ(2, sur->getSaveCount());
+  sur->restore();
+  EXPECT_EQ(1, sur->getSaveCount());
+  EXPECT_EQ(gfx::Rect(0, 0, 8, 8), sur->getClipBounds());
+
+  for (int y=0; y<8; ++y)
+    for (int x=0; x<8; ++x)
+      EXPECT_EQ((gfx::Rect(2, 3, 2, 2).contains(gfx::Point(x, y)) ? white:
+                                                                    gfx::ColorNone),
+                sur->getPixel(x, y)) << x << "," << y;
+}
+
+TEST(Surface, DrawRgbaSurface)
+{
+  const gfx::Color red = gfx::rgba(255, 0, 0);
+  const gfx::Color blue = gfx::rgba(0, 0, 255);
+  auto dst = make_surface(8, 8, red);
+  auto src = make_surface(4, 4, blue);
+  src->putPixel(gfx::ColorNone, 0, 0);
+
+  dst->drawRgbaSurface(src.get(), 6, 6);
+  EXPECT_EQ(red, dst->getPixel(5, 5));
+  EXPECT_EQ(red, dst->getPixel(6, 6));   // Transparent pixel
+  EXPECT_EQ(blue, dst->getPixel(7, 7));
+
+  dst->drawRgbaSurface(src.get(), 0, 0, -1, 0, 3, 1);
+  EXPECT_EQ(blue, dst->getPixel(0, 0));
+  EXPECT_EQ(blue, dst->getPixel(1, 0));
+  EXPECT_EQ(red, dst->getPixel(2, 0));
+  EXPECT_EQ(red, dst->getPixel(0, 1));
+
+  // drawSurface() uses the Src blend mode
+  dst->drawSurface(src.get(), 4, 0);
+  EXPECT_EQ(gfx::ColorNone, dst->getPixel(4, 0));
+  EXPECT_EQ(blue, dst->getPixel(5, 0));
+
+  // Scaled
+  dst->drawSurface(src.get(), gfx::Rect(1, 1, 2, 2), gfx::Rect(0, 4, 4, 4));
+  EXPECT_EQ(blue, dst->getPixel(0, 4));
+  EXPECT_EQ(blue, dst->getPixel(3, 7));
+}
+
+TEST(Surface, DrawColoredRgbaSurface)
+{
+  const gfx::Color white = gfx::rgba(255, 255, 255);
+  const gfx::Color green = gfx::rgba(0, 255, 0);
+  const gfx::Color black = gfx::rgba(0, 0, 0);
+  auto dst = make_surface(4, 4, white);
+  auto mask = make_surface(4, 4, white);
+  mask->putPixel(gfx::ColorNone, 1, 1);
+
+  dst->drawColoredRgbaSurface(mask.get(), green, black, gfx::Clip(0, 0, 0, 0, 2, 2));
+  EXPECT_EQ(green, dst->getPixel(0, 0));
+  EXPECT_EQ(black, dst->getPixel(1, 1));
+  EXPECT_EQ(white, dst->getPixel(2, 2));
+
+  // A transparent foreground only paints the background
+  dst = make_surface(4, 4, white);
+  dst->drawColoredRgbaSurface(mask.get(), gfx::ColorNone, black, gfx::Clip(0, 0, 0, 0, 2, 2));
+  EXPECT_EQ(black, dst->getPixel(0, 0));
+  EXPECT_EQ(black, dst->getPixel(1, 1));
+  EXPECT_EQ(white, dst->getPixel(2, 2));
+}
+
+TEST(Surface, BlitTo)
+{
+  const gfx::Color red = gfx::rgba(255, 0, 0);
+  auto src = make_surface(2, 2, red);
+  auto dst = make_surface(4, 4);
+
+  src->blitTo(dst.get(), 0, 0, 1, 1, 2, 2);
+  EXPECT_EQ(gfx::ColorNone, dst->getPixel(0, 0));
+  EXPECT_EQ(red, dst->getPixel(1, 1));
+  EXPECT_EQ(red, dst->getPixel(2, 2));
+  EXPECT_EQ(gfx::ColorNone, dst->getPixel(3, 3));
+}
+
+TEST(Surface, ScrollTo)
+{
+  auto sur = make_surface(4, 4);
+  for (int y=0; y<4; ++y)
+    for (int x=0; x<4; ++x)
+      sur->putPixel(gfx::rgba(x*10, y*10, 0), x, y);
+
+  sur->scrollTo(gfx::Rect(0, 0, 3, 3), 1, 1);
+  EXPECT_EQ(gfx::rgba(0, 0, 0), sur->getPixel(0, 0));
+  EXPECT_EQ(gfx::rgba(0, 0, 0), sur->getPixel(1, 1));
+  EXPECT_EQ(gfx::rgba(10, 10, 0), sur->getPixel(2, 2));
+  EXPECT_EQ(gfx::rgba(20, 20, 0), sur->getPixel(3, 3));
+  EXPECT_EQ(gfx::rgba(30, 0, 0), sur->getPixel(3, 0));
+}
+
+TEST(Surface, DrawSurfaceNine)
+{
+  const gfx::Color red = gfx::rgba(255, 0, 0);
+  const gfx::Color blue = gfx::rgba(0, 0, 255);
+
+  // 3x3 source with a blue border and a red center
+  auto src = make_surface(3, 3, blue);
+  src->putPixel(red, 1, 1);
+
+  auto dst = make_surface(8, 6);
+  dst->drawSurfaceNine(src.get(), gfx::Rect(0, 0, 3, 3), gfx::Rect(1, 1, 1, 1),
+                       gfx::Rect(1, 1, 6, 4), true, nullptr);
+  EXPECT_EQ(gfx::ColorNone, dst->getPixel(0, 0));
+  EXPECT_EQ(blue, dst->getPixel(1, 1));
+  EXPECT_EQ(blue, dst->getPixel(6, 1));
+  EXPECT_EQ(blue, dst->getPixel(1, 4));
+  EXPECT_EQ(blue, dst->getPixel(6, 4));
+  EXPECT_EQ(red, dst->getPixel(2, 2));
+  EXPECT_EQ(red, dst->getPixel(5, 3));
+  EXPECT_EQ(gfx::ColorNone, dst->getPixel(7, 5));
+}
+
+int app_main(int argc, char* argv[])
+{
+  g_system = make_system();
+  ::testing::InitGoogleTest(&argc, argv);
+  const int result = RUN_ALL_TESTS();
+  g_system = nullptr;
+  return result;
+}
@@ -1,5 +1,5 @@
 // LAF OS Library
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2024  Igara Studio S.A.
 // Copyright (C) 2012-2018  David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -15,10 +15,21 @@
 
 #include "os/win/event_queue.h"
 
-#include "base/time.h"
+#include "base/clock.h"
+
+// Available since Windows 10 version 1803
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+  #define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
 
 namespace os {
 
+EventQueueWin::~EventQueueWin()
+{
+  if (m_timer)
+    CloseHandle(m_timer);
+}
+
 void EventQueueWin::queueEvent(const Event& ev)
 {
   m_events.push(ev);
@@ -31,7 +42,9 @@ void EventQueueWin::clearEvents()
 
 void EventQueueWin::getEvent(Event& ev, double timeout)
 {
-  const base::tick_t untilTick = base::current_tick() + timeout*1000.0;
+  uint64_t untilNs = 0;
+  if (timeout > 0.0)
+    untilNs = base::monotonic_ns() + uint64_t(timeout * 1.0e9);
   MSG msg;
 
   ev.setWindow(nullptr);
@@ -43,13 +56,9 @@ void EventQueueWin::getEvent(Event& ev, double timeout)
       res = GetMessage(&msg, nullptr, 0, 0);
     }
     else {
-      const base::tick_t now = base::current_tick();
-      if (untilTick > now) {
-        const base::tick_t msecs = (untilTick - now);
-        MsgWaitForMultipleObjects(0, nullptr, FALSE,
-                                  (DWORD)msecs, // Milliseconds to wait
-                                  QS_ALLINPUT | QS_ALLPOSTMESSAGE);
-      }
+      const uint64_t now = base::monotonic_ns();
+      if (timeout > 0.0 && untilNs > now)
+        waitForMessages(untilNs - now);
       res = PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE);
     }
 
@@ -77,4 +86,35 @@ void EventQueueWin::getEvent(Event& ev, double timeout)
   }
 }
 
+void EventQueueWin::waitForMessages(const uint64_t nanoseconds)
+{
+  // MsgWaitForMultipleObjects() timeout is in milliseconds, so we use
+  // a high resolution waitable timer to wait less than 1ms (or a
+  // fraction of a millisecond).
+  if (!m_timerInitialized) {
+    m_timer = CreateWaitableTimerExW(nullptr, nullptr,
+                                     CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,
+                                     TIMER_ALL_ACCESS);
+    m_timerInitialized = true;
+  }
+
+  if (m_timer) {
+    LARGE_INTEGER dueTime;
+    // Negative values indicate relative time in 100ns intervals
+    dueTime.QuadPart = -LONGLONG((nanoseconds + 99) / 100);
+    if (SetWaitableTimer(m_timer, &dueTime, 0, nullptr, nullptr, FALSE)) {
+      MsgWaitForMultipleObjects(1, &m_timer, FALSE, INFINITE,
+                                QS_ALLINPUT | QS_ALLPOSTMESSAGE);
+      CancelWaitableTimer(m_timer);
+      return;
+    }
+  }
+
+  // Fallback for old Windows versions, rounding up to 1ms to avoid a
+  // busy loop with small timeouts
+  MsgWaitForMultipleObjects(0, nullptr, FALSE,
+                            DWORD((nanoseconds + 999999) / 1000000),
+                            QS_ALLINPUT | QS_ALLPOSTMESSAGE);
+}
+
 } // namespace os
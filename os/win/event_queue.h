@@ -1,5 +1,5 @@
 // LAF OS Library
-// Copyright (C) 2020-2021  Igara Studio S.A.
+// Copyright (C) 2020-2024  Igara Studio S.A.
 // Copyright (C) 2012-2018  David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -13,18 +13,26 @@
 #include "os/event.h"
 #include "os/event_queue.h"
 
+#include <cstdint>
 #include <queue>
 
 namespace os {
 
 class EventQueueWin : public EventQueue {
 public:
+  ~EventQueueWin();
+
   void queueEvent(const Event& ev) override;
   void getEvent(Event& ev, double timeout) override;
   void clearEvents();
 
 private:
+  // Waits until a new message arrives or the given time elapses.
+  void waitForMessages(uint64_t nanoseconds);
+
   base::concurrent_queue<Event> m_events;
+  void* m_timer = nullptr;      // HANDLE of the waitable timer
+  bool m_timerInitialized = false;
 };
 
 using EventQueueImpl = EventQueueWin;
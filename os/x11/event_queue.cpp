@@ -11,7 +11,9 @@
 
 #include "os/x11/event_queue.h"
 
+#include "base/clock.h"
 #include "base/thread.h"
+#include "base/trace.h"
 #include "os/x11/window.h"
 
 #include <X11/Xlib.h>
@@ -67,19 +69,21 @@ const char* get_event_name(XEvent& event)
 }
 #endif
 
-void wait_file_descriptor_for_reading(int fd, base::tick_t timeoutMilliseconds)
+void wait_file_descriptor_for_reading(int fd, uint64_t timeoutNanoseconds)
 {
   fd_set fds;
   FD_ZERO(&fds);
   FD_SET(fd, &fds);
 
-  timeval timeout;
-  timeout.tv_sec = timeoutMilliseconds / 1000;
-  timeout.tv_usec = ((timeoutMilliseconds % 1000) * 1000);
+  // We use pselect() instead of select() to wait with nanosecond
+  // precision (select() uses microseconds).
+  timespec timeout;
+  timeout.tv_sec = timeoutNanoseconds / 1000000000;
+  timeout.tv_nsec = timeoutNanoseconds % 1000000000;
 
   // First argument must be set to the highest-numbered file
   // descriptor in any of the three sets, plus 1.
-  select(fd+1, &fds, nullptr, nullptr, &timeout);
+  pselect(fd+1, &fds, nullptr, nullptr, &timeout, nullptr);
 }
 
 } // anonymous namespace
@@ -91,7 +95,8 @@ void EventQueueX11::queueEvent(const Event& ev)
 
 void EventQueueX11::getEvent(Event& ev, double timeout)
 {
-  base::tick_t startTime = base::current_tick();
+  LAF_TRACE_ZONE("EventQueueX11::getEvent");
+  const uint64_t startTime = base::monotonic_ns();
 
   ev.setWindow(nullptr);
 
@@ -114,12 +119,12 @@ void EventQueueX11::getEvent(Event& ev, double timeout)
       // a read operation). We've to use this method to wait for
       // events with timeout because we don't have a X11 function like
       // XNextEvent() with a timeout.
-      const base::tick_t timeoutMsecs = base::tick_t(timeout * 1000.0);
-      const base::tick_t elapsedMsecs = base::current_tick() - startTime;
-      if (int(timeoutMsecs - elapsedMsecs) > 0) {
+      const uint64_t timeoutNsecs = uint64_t(timeout * 1.0e9);
+      const uint64_t elapsedNsecs = base::monotonic_ns() - startTime;
+      if (timeoutNsecs > elapsedNsecs) {
         const int connFileDesc = ConnectionNumber(display);
         wait_file_descriptor_for_reading(connFileDesc,
-                                         timeoutMsecs - elapsedMsecs);
+                                         timeoutNsecs - elapsedNsecs);
       }
 
       events = XEventsQueued(display, QueuedAlready);
@@ -765,11 +765,21 @@ void WindowX11::setMousePosition(const gfx::Point& position)
 
 void WindowX11::invalidateRegion(const gfx::Region& rgn)
 {
-  const gfx::Rect bounds = rgn.bounds();
-  onPaint(gfx::Rect(bounds.x*m_scale,
-                    bounds.y*m_scale,
-                    bounds.w*m_scale,
-                    bounds.h*m_scale));
+  for (const gfx::Rect& rc : rgn) {
+    m_damage.add(gfx::Rect(rc.x*m_scale,
+                           rc.y*m_scale,
+                           rc.w*m_scale,
+                           rc.h*m_scale));
+  }
+  paintDamage();
+}
+
+// The window is painted directly with XPutImage() (there is no back
+// buffer), so we only need to present the damage of this frame.
+void WindowX11::paintDamage()
+{
+  for (const gfx::Rect& rc : m_damage.endFrame())
+    onPaint(rc);
 }
 
 bool WindowX11::setCursor(NativeCursor nativeCursor)
@@ -1023,6 +1033,7 @@ void WindowX11::processX11Event(XEvent& event)
 
       if (rc.w > 0 && rc.h > 0 && rc.size() != m_lastClientSize) {
         m_lastClientSize = rc.size();
+        m_damage.setBounds(gfx::Rect(rc.size()));
         onResize(rc.size());
       }
       break;
@@ -1031,7 +1042,12 @@ void WindowX11::processX11Event(XEvent& event)
     case Expose: {
       const gfx::Rect rc(event.xexpose.x, event.xexpose.y,
                          event.xexpose.width, event.xexpose.height);
-      onPaint(rc);
+      m_damage.add(rc);
+
+      // Paint when we receive the last Expose event of a series
+      // (count == 0) so the exposed areas can be coalesced.
+      if (event.xexpose.count == 0)
+        paintDamage();
       break;
     }
 
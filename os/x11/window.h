@@ -1,5 +1,5 @@
 // LAF OS Library
-// Copyright (C) 2018-2022  Igara Studio S.A.
+// Copyright (C) 2018-2024  Igara Studio S.A.
 // Copyright (C) 2016-2018  David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -12,6 +12,7 @@
 #include "base/time.h"
 #include "gfx/border.h"
 #include "gfx/color_space.h"    // Include here avoid error with None
+#include "gfx/damage_tracker.h"
 #include "gfx/fwd.h"
 #include "gfx/size.h"
 #include "os/color_space.h"
@@ -108,6 +109,7 @@ private:
   bool setX11Cursor(::Cursor xcursor);
   bool requestX11FrameExtents();
   void getX11FrameExtents();
+  void paintDamage();
   static void addWindow(WindowX11* window);
   static void removeWindow(WindowX11* window);
 
@@ -119,6 +121,8 @@ private:
   gfx::Point m_lastMousePos;
   gfx::Size m_lastClientSize;
   gfx::Border m_frameExtents;
+  // Invalidated/exposed areas (in real pixels) to paint.
+  gfx::DamageTracker m_damage;
   bool m_initializingActions = true;
   bool m_fullscreen = false;
   bool m_borderless = false;